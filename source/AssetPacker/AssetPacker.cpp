@@ -0,0 +1,113 @@
+#define DAR_MODULE_NAME "AssetPacker"
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include <AssetArchive.hpp>
+#include <DarEngine.hpp>
+#include <Exception.hpp>
+#include <File.hpp>
+
+namespace fs = std::filesystem;
+
+/**
+ * @brief Matches name against pattern, in which * stands for any number of characters.
+ */
+static bool matchesPattern(const char* pattern, const char* name)
+{
+  if(*pattern == '\0') {
+    return *name == '\0';
+  }
+  if(*pattern == '*') {
+    for(const char* rest = name;; ++rest) {
+      if(matchesPattern(pattern + 1, rest)) {
+        return true;
+      }
+      if(*rest == '\0') {
+        return false;
+      }
+    }
+  }
+  return *name != '\0' && *pattern == *name && matchesPattern(pattern + 1, name + 1);
+}
+
+static void collectFiles(const fs::path& rootDirectory, const std::string& path, std::vector<fs::path>* files)
+{
+  const fs::path fullPath = rootDirectory / path;
+  const std::string fileName = fullPath.filename().string();
+  if(fileName.find('*') != std::string::npos) {
+    const fs::path directory = fullPath.parent_path();
+    if(fs::is_directory(directory)) {
+      for(const fs::directory_entry& entry : fs::directory_iterator(directory)) {
+        if(entry.is_regular_file() && matchesPattern(fileName.c_str(), entry.path().filename().string().c_str())) {
+          files->push_back(entry.path());
+        }
+      }
+    }
+  } else if(fs::is_directory(fullPath)) {
+    for(const fs::directory_entry& entry : fs::recursive_directory_iterator(fullPath)) {
+      if(entry.is_regular_file()) {
+        files->push_back(entry.path());
+      }
+    }
+  } else if(fs::is_regular_file(fullPath)) {
+    files->push_back(fullPath);
+  } else {
+    throw De::Exception("No such file or directory: " + fullPath.string());
+  }
+}
+
+/**
+ * Usage: AssetPacker [--compress] <archive> <root directory> <path>...
+ * Entries are named by their path relative to the root directory. A path is a file, a directory,
+ * which is added recursively, or a file name pattern with * in the last component, e.g. *.cso.
+ * With --compress entries are stored LZ4 compressed when that makes them noticeably smaller.
+ */
+int main(int argc, char** argv)
+{
+  int argument = 1;
+  bool compress = false;
+  if(argument < argc && std::strcmp(argv[argument], "--compress") == 0) {
+    compress = true;
+    ++argument;
+  }
+  if(argc - argument < 3) {
+    fprintf(stderr, "Usage: AssetPacker [--compress] <archive> <root directory> <path>...\n");
+    return 1;
+  }
+  const char* archiveFileName = argv[argument++];
+  const fs::path rootDirectory = argv[argument++];
+
+  try {
+    std::vector<fs::path> files;
+    for(; argument < argc; ++argument) {
+      collectFiles(rootDirectory, argv[argument], &files);
+    }
+
+    De::AssetArchiveWriter writer;
+    uint64_t totalSize = 0;
+    for(const fs::path& file : files) {
+      const std::string name = file.lexically_relative(rootDirectory).generic_string();
+      const De::MappedFile data(file.string().c_str(), De::MappedFile::Access::Sequential);
+      if(!writer.add(name.c_str(), data.getSpan(), compress)) {
+        fprintf(stderr, "Skipping duplicate %s\n", name.c_str());
+        continue;
+      }
+      totalSize += data.getSize();
+    }
+    writer.write(archiveFileName);
+    printf("Packed %zu files, %llu bytes, into %s (%llu bytes).\n",
+      files.size(),
+      (unsigned long long)totalSize,
+      archiveFileName,
+      (unsigned long long)fs::file_size(archiveFileName)
+    );
+  } catch(const std::exception& e) {
+    fprintf(stderr, "%s\n", e.what());
+    return 1;
+  }
+  return 0;
+}
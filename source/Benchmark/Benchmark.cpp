@@ -0,0 +1,182 @@
+#define DAR_MODULE_NAME "Benchmark"
+
+#include "Benchmark.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <numeric>
+
+#include <DarMath.hpp>
+
+BenchmarkRunner::BenchmarkRunner(const char* filter)
+  : filter(filter ? filter : "")
+{}
+
+bool BenchmarkRunner::isFilteredOut(const char* name) const noexcept
+{
+  return !filter.empty() && std::strstr(name, filter.c_str()) == nullptr;
+}
+
+void BenchmarkRunner::addResult(const char* name, long long iterationsPerSample, std::vector<double>& sampleNsPerOperation)
+{
+  std::sort(sampleNsPerOperation.begin(), sampleNsPerOperation.end());
+  const size_t count = sampleNsPerOperation.size();
+  BenchmarkResult result;
+  result.name = name;
+  result.iterationsPerSample = iterationsPerSample;
+  result.sampleCount = (int)count;
+  result.medianNs = count % 2 ? sampleNsPerOperation[count / 2] : 
+    (sampleNsPerOperation[count / 2 - 1] + sampleNsPerOperation[count / 2]) / 2.;
+  result.p99Ns = sampleNsPerOperation[std::min(count - 1, (count * 99) / 100)];
+  result.minNs = sampleNsPerOperation.front();
+  result.meanNs = std::accumulate(sampleNsPerOperation.begin(), sampleNsPerOperation.end(), 0.) / count;
+  printf("%-40s median %9.3f ns  p99 %9.3f ns  min %9.3f ns\n", name, result.medianNs, result.p99Ns, result.minNs);
+  results.push_back(std::move(result));
+}
+
+void writeResultsJson(const std::vector<BenchmarkResult>& results, const char* simdLevel, FILE* file)
+{
+  // One benchmark per line, keeps diffs against the baseline readable.
+  fprintf(file, "{\n  \"simdLevel\": \"%s\",\n  \"benchmarks\": [\n", simdLevel);
+  for(size_t i = 0; i < results.size(); ++i) {
+    const BenchmarkResult& result = results[i];
+    fprintf(file, 
+      "    {\"name\": \"%s\", \"iterationsPerSample\": %lld, \"samples\": %d, \"medianNs\": %.4f, \"p99Ns\": %.4f, \"minNs\": %.4f, \"meanNs\": %.4f}%s\n",
+      result.name.c_str(), result.iterationsPerSample, result.sampleCount, 
+      result.medianNs, result.p99Ns, result.minNs, result.meanNs,
+      i + 1 < results.size() ? "," : ""
+    );
+  }
+  fprintf(file, "  ]\n}\n");
+}
+
+static bool readStringField(const char* line, const char* key, std::string* value)
+{
+  const char* found = std::strstr(line, key);
+  if(!found) {
+    return false;
+  }
+  const char* begin = std::strchr(found + std::strlen(key), '"');
+  const char* end = begin ? std::strchr(begin + 1, '"') : nullptr;
+  if(!end) {
+    return false;
+  }
+  value->assign(begin + 1, end);
+  return true;
+}
+
+static bool readNumberField(const char* line, const char* key, double* value)
+{
+  const char* found = std::strstr(line, key);
+  if(!found) {
+    return false;
+  }
+  const char* colon = std::strchr(found, ':');
+  if(!colon) {
+    return false;
+  }
+  *value = std::strtod(colon + 1, nullptr);
+  return true;
+}
+
+int compareWithBaseline(const std::vector<BenchmarkResult>& results, const char* baselineFileName, double threshold)
+{
+  FILE* file = fopen(baselineFileName, "r");
+  if(!file) {
+    fprintf(stderr, "Failed to open baseline %s\n", baselineFileName);
+    return -1;
+  }
+  int regressionCount = 0;
+  char line[1024];
+  while(fgets(line, sizeof(line), file)) {
+    std::string name;
+    double baselineMedianNs;
+    if(!readStringField(line, "\"name\"", &name) || !readNumberField(line, "\"medianNs\"", &baselineMedianNs)) {
+      continue;
+    }
+    auto result = std::find_if(results.begin(), results.end(), [&name](const BenchmarkResult& r) { return r.name == name; });
+    if(result == results.end()) {
+      continue;
+    }
+    const double change = (result->medianNs - baselineMedianNs) / baselineMedianNs;
+    const bool isRegression = change > threshold;
+    printf("%-40s %9.3f ns -> %9.3f ns  %+7.2f%%%s\n", name.c_str(), baselineMedianNs, result->medianNs, change * 100., isRegression ? "  REGRESSION" : "");
+    regressionCount += isRegression;
+  }
+  fclose(file);
+  return regressionCount;
+}
+
+static const char* toString(SimdLevel level)
+{
+  switch(level) {
+    case SimdLevel::Scalar: return "Scalar";
+    case SimdLevel::Avx: return "Avx";
+  }
+  return "Unknown";
+}
+
+static const char usage[] = 
+  "Usage: Benchmark [--filter substring] [--output results.json] [--baseline baseline.json] [--threshold 0.05]\n"
+  "  [--screenshot frame.ppm]\n";
+
+/**
+ * Returns 1 if any benchmark regressed against the baseline by more than threshold, 2 on errors.
+ */
+int main(int argc, char** argv)
+{
+  const char* filter = nullptr;
+  const char* outputFileName = "benchmark.json";
+  const char* baselineFileName = nullptr;
+  double threshold = 0.05;
+  const char* screenshotFileName = nullptr;
+  for(int i = 1; i < argc; i += 2) {
+    if(i + 1 == argc) {
+      fprintf(stderr, "Missing value of %s\n%s", argv[i], usage);
+      return 2;
+    }
+    if(std::strcmp(argv[i], "--filter") == 0) {
+      filter = argv[i + 1];
+    } else if(std::strcmp(argv[i], "--output") == 0) {
+      outputFileName = argv[i + 1];
+    } else if(std::strcmp(argv[i], "--baseline") == 0) {
+      baselineFileName = argv[i + 1];
+    } else if(std::strcmp(argv[i], "--threshold") == 0) {
+      threshold = std::atof(argv[i + 1]);
+    } else if(std::strcmp(argv[i], "--screenshot") == 0) {
+      screenshotFileName = argv[i + 1];
+    } else {
+      fprintf(stderr, "Unknown argument %s\n%s", argv[i], usage);
+      return 2;
+    }
+  }
+
+  BenchmarkRunner runner(filter);
+  runDarMathBenchmarks(runner);
+  runJobSystemBenchmarks(runner);
+  runCubeMesherBenchmarks(runner);
+  runRenderQueueBenchmarks(runner);
+  runTlsfAllocatorBenchmarks(runner);
+  runSoftwareRendererBenchmarks(runner, screenshotFileName);
+  runVulkanRendererBenchmarks(runner);
+
+  FILE* outputFile = fopen(outputFileName, "w");
+  if(!outputFile) {
+    fprintf(stderr, "Failed to open %s for writing\n", outputFileName);
+    return 2;
+  }
+  writeResultsJson(runner.getResults(), toString(getSimdLevel()), outputFile);
+  fclose(outputFile);
+
+  if(baselineFileName) {
+    const int regressionCount = compareWithBaseline(runner.getResults(), baselineFileName, threshold);
+    if(regressionCount < 0) {
+      return 2;
+    }
+    if(regressionCount != 0) {
+      return 1;
+    }
+  }
+  return 0;
+}
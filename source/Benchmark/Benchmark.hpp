@@ -0,0 +1,133 @@
+#pragma once
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#ifdef _MSC_VER
+  #include <intrin.h>
+#endif
+
+/**
+ * @brief Keeps the compiler from optimizing away computation of value.
+ */
+template<typename T>
+inline void doNotOptimize(const T& value) noexcept
+{
+#ifdef _MSC_VER
+  const volatile char* bytes = reinterpret_cast<const volatile char*>(&value);
+  (void)*bytes;
+  _ReadWriteBarrier();
+#else
+  asm volatile("" : : "r,m"(value) : "memory");
+#endif
+}
+
+struct BenchmarkResult
+{
+  std::string name;
+  long long iterationsPerSample;
+  int sampleCount;
+  double medianNs;
+  double p99Ns;
+  double minNs;
+  double meanNs;
+};
+
+class BenchmarkRunner
+{
+public:
+  /**
+   * @param filter Only benchmarks with names containing filter are run, nullptr to run all.
+   */
+  explicit BenchmarkRunner(const char* filter = nullptr);
+
+  /**
+   * @brief Measures ns per call of operation, which is called with an increasing index to cycle through inputs.
+   * Runs warm-up samples first, then sampleCount timed samples of calibrated iteration count.
+   */
+  template<typename Operation>
+  void run(const char* name, Operation&& operation);
+
+  const std::vector<BenchmarkResult>& getResults() const noexcept { return results; }
+
+  static constexpr int sampleCount = 100;
+  static constexpr std::chrono::nanoseconds targetSampleDuration = std::chrono::milliseconds(1);
+  static constexpr std::chrono::nanoseconds warmUpDuration = std::chrono::milliseconds(50);
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  bool isFilteredOut(const char* name) const noexcept;
+  void addResult(const char* name, long long iterationsPerSample, std::vector<double>& sampleNsPerOperation);
+
+  template<typename Operation>
+  static double measureSample(Operation& operation, long long iterations, int* index)
+  {
+    const Clock::time_point start = Clock::now();
+    for(long long i = 0; i < iterations; ++i) {
+      operation((*index)++);
+    }
+    const Clock::time_point end = Clock::now();
+    return double(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+  }
+
+  std::string filter;
+  std::vector<BenchmarkResult> results;
+};
+
+template<typename Operation>
+void BenchmarkRunner::run(const char* name, Operation&& operation)
+{
+  if(isFilteredOut(name)) {
+    return;
+  }
+
+  int index = 0;
+  // Calibration, double iterations until one sample takes long enough to be well above clock resolution.
+  long long iterations = 1;
+  while(measureSample(operation, iterations, &index) < double(targetSampleDuration.count()) && iterations < (1ll << 40)) {
+    iterations *= 2;
+  }
+
+  const Clock::time_point warmUpEnd = Clock::now() + warmUpDuration;
+  while(Clock::now() < warmUpEnd) {
+    measureSample(operation, iterations, &index);
+  }
+
+  std::vector<double> sampleNsPerOperation(sampleCount);
+  for(double& sample : sampleNsPerOperation) {
+    sample = measureSample(operation, iterations, &index) / iterations;
+  }
+  addResult(name, iterations, sampleNsPerOperation);
+}
+
+void writeResultsJson(const std::vector<BenchmarkResult>& results, const char* simdLevel, FILE* file);
+/**
+ * @brief Compares median times against a file previously written by writeResultsJson.
+ * @param threshold Relative slowdown reported as regression, e.g. 0.05 for 5%.
+ * @return Count of regressed benchmarks, -1 if the baseline can't be read.
+ */
+int compareWithBaseline(const std::vector<BenchmarkResult>& results, const char* baselineFileName, double threshold);
+
+void runDarMathBenchmarks(BenchmarkRunner& runner);
+void runJobSystemBenchmarks(BenchmarkRunner& runner);
+void runCubeMesherBenchmarks(BenchmarkRunner& runner);
+void runRenderQueueBenchmarks(BenchmarkRunner& runner);
+void runTlsfAllocatorBenchmarks(BenchmarkRunner& runner);
+
+struct GameState;
+/**
+ * @brief Settles the lower rows with a few gaps and puts a tetracube above them. Always the same, for reference images.
+ */
+void setUpBenchmarkGameState(GameState& gameState);
+/**
+ * @param screenshotFileName Written with the frame the benchmarks render, nullptr to skip it.
+ */
+void runSoftwareRendererBenchmarks(BenchmarkRunner& runner, const char* screenshotFileName);
+/**
+ * @brief Renders offscreen through the Vulkan loader of the system, e.g. with lavapipe or SwiftShader on Linux.
+ * Skipped without a Vulkan device or the SPIR-V files in the shaders directory.
+ */
+void runVulkanRendererBenchmarks(BenchmarkRunner& runner);
@@ -0,0 +1,76 @@
+#include "Benchmark.hpp"
+
+#include <cstdint>
+#include <vector>
+
+#include <CubeMesher.hpp>
+
+namespace
+{
+  constexpr Vec3i arenaSize = { 32, 32, 32 };
+
+  // Lower half filled the way settled tetracubes stack up, a few cells left empty and classes in runs.
+  void fillSettledStack(PlayingSpace& playingSpace)
+  {
+    uint32_t random = 0x12345678u;
+    for(int y = 0; y < arenaSize.y / 2; ++y) {
+      for(int z = 0; z < arenaSize.z; ++z) {
+        for(int x = 0; x < arenaSize.x; ++x) {
+          random = random * 1664525u + 1013904223u;
+          const bool isEmpty = (random >> 24) < 16;
+          playingSpace.set(x, y, z, isEmpty ? PlayingSpace::emptyValue : PlayingSpace::ValueType((x / 4 + z / 4 + y) % 7));
+        }
+      }
+    }
+  }
+
+  // Worst case, no face is hidden and no two faces merge.
+  void fillCheckerboard(PlayingSpace& playingSpace)
+  {
+    for(int y = 0; y < arenaSize.y; ++y) {
+      for(int z = 0; z < arenaSize.z; ++z) {
+        for(int x = 0; x < arenaSize.x; ++x) {
+          playingSpace.set(x, y, z, (x + y + z) % 2 ? PlayingSpace::emptyValue : 0);
+        }
+      }
+    }
+  }
+}
+
+void runCubeMesherBenchmarks(BenchmarkRunner& runner)
+{
+  constexpr int cellCount = arenaSize.x * arenaSize.y * arenaSize.z;
+  CubeMesher cubeMesher;
+  std::vector<CubeMesher::Vertex> vertices;
+  std::vector<uint32_t> indices;
+  vertices.reserve(CubeMesher::calculateMaxVertexCount(cellCount));
+  indices.reserve(CubeMesher::calculateMaxIndexCount(cellCount));
+
+  PlayingSpace settledStack{ arenaSize };
+  fillSettledStack(settledStack);
+  PlayingSpace checkerboard{ arenaSize };
+  fillCheckerboard(checkerboard);
+
+  const auto meshWhole = [&](const PlayingSpace& playingSpace) {
+    vertices.clear();
+    indices.clear();
+    cubeMesher.mesh(playingSpace, {}, arenaSize, vertices, indices);
+    doNotOptimize(indices.back());
+  };
+  runner.run("CubeMesher/SettledStack32", [&](int) { meshWhole(settledStack); });
+  runner.run("CubeMesher/Checkerboard32", [&](int) { meshWhole(checkerboard); });
+  // As the renderer meshes it, in chunks of 4x4x4 cells.
+  runner.run("CubeMesher/SettledStack32/Chunks4", [&](int) {
+    vertices.clear();
+    indices.clear();
+    constexpr int chunkSize = 4;
+    for(int y = 0; y < arenaSize.y; y += chunkSize) {
+      for(int z = 0; z < arenaSize.z; z += chunkSize) {
+        for(int x = 0; x < arenaSize.x; x += chunkSize) {
+          cubeMesher.mesh(settledStack, { x, y, z }, { x + chunkSize, y + chunkSize, z + chunkSize }, vertices, indices);
+        }
+      }
+    }
+    doNotOptimize(indices.back());
+  });
+}
@@ -0,0 +1,232 @@
+#include "Benchmark.hpp"
+
+#include <random>
+#include <string>
+
+#include <DarMath.hpp>
+
+namespace
+{
+  constexpr int inputCount = 256; // Power of two, inputs are cycled with index & inputMask.
+  constexpr int inputMask = inputCount - 1;
+
+  struct Inputs
+  {
+    Vec3f vec3s[inputCount];
+    Vec4f vec4s[inputCount];
+    Mat3f mat3s[inputCount];
+    Mat4x3f mat4x3s[inputCount];
+    Mat4f mat4s[inputCount];
+    Quatf quats[inputCount];
+    float factors[inputCount];
+  };
+
+  void generateInputs(Inputs* inputs)
+  {
+    std::mt19937 generator(42);
+    std::uniform_real_distribution<float> distribution(-1.f, 1.f);
+    auto random = [&]() { return distribution(generator); };
+    for(int i = 0; i < inputCount; ++i) {
+      inputs->vec3s[i] = { random(), random(), random() };
+      inputs->vec4s[i] = { random(), random(), random(), 1.f };
+      inputs->mat3s[i] = Mat3f::rotationX(random()) * Mat3f::rotationY(random());
+      inputs->mat4x3s[i] = Mat3f::rotationZ(random()) * Mat4x3f::translation(random(), random(), random());
+      inputs->mat4s[i] = toMat4f(inputs->mat4x3s[i]) * Mat4f::perspectiveProjectionD3d(1.2f, 16.f / 9.f, 1.f, 100.f);
+      inputs->quats[i] = normalized(Quatf{ { random(), random(), random() }, random() });
+      inputs->factors[i] = (random() + 1.f) / 2.f;
+    }
+  }
+
+  const char* simdLevelNames[] = { "Scalar", "Avx" };
+}
+
+void runDarMathBenchmarks(BenchmarkRunner& runner)
+{
+  static Inputs in;
+  generateInputs(&in);
+
+  // Vectors
+  runner.run("Vec3f+Vec3f", [&](int i) {
+    doNotOptimize(in.vec3s[i & inputMask] + in.vec3s[(i + 1) & inputMask]);
+  });
+  runner.run("dot(Vec3f)", [&](int i) {
+    doNotOptimize(dot(in.vec3s[i & inputMask], in.vec3s[(i + 1) & inputMask]));
+  });
+  runner.run("cross(Vec3f)", [&](int i) {
+    doNotOptimize(cross(in.vec3s[i & inputMask], in.vec3s[(i + 1) & inputMask]));
+  });
+  runner.run("normalized(Vec3f)", [&](int i) {
+    doNotOptimize(normalized(in.vec3s[i & inputMask]));
+  });
+  runner.run("lerp(Vec3f)", [&](int i) {
+    doNotOptimize(lerp(in.vec3s[i & inputMask], in.vec3s[(i + 1) & inputMask], in.factors[i & inputMask]));
+  });
+  runner.run("Vec3f*Mat3f", [&](int i) {
+    doNotOptimize(in.vec3s[i & inputMask] * in.mat3s[(i + 1) & inputMask]);
+  });
+
+  // Matrices
+  runner.run("Mat3f*Mat3f", [&](int i) {
+    doNotOptimize(in.mat3s[i & inputMask] * in.mat3s[(i + 1) & inputMask]);
+  });
+  runner.run("Mat3f*Mat4x3f", [&](int i) {
+    doNotOptimize(in.mat3s[i & inputMask] * in.mat4x3s[(i + 1) & inputMask]);
+  });
+  runner.run("Mat4x3f*Mat4x3f", [&](int i) {
+    doNotOptimize(in.mat4x3s[i & inputMask] * in.mat4x3s[(i + 1) & inputMask]);
+  });
+  runner.run("Mat4f*Mat4x3f", [&](int i) {
+    doNotOptimize(in.mat4s[i & inputMask] * in.mat4x3s[(i + 1) & inputMask]);
+  });
+  runner.run("Vec4f*Mat4f", [&](int i) {
+    doNotOptimize(in.vec4s[i & inputMask] * in.mat4s[(i + 1) & inputMask]);
+  });
+  runner.run("Mat4x3f*Mat4f", [&](int i) {
+    doNotOptimize(in.mat4x3s[i & inputMask] * in.mat4s[(i + 1) & inputMask]);
+  });
+  // The only product with a kernel per level.
+  const SimdLevel detectedLevel = getSimdLevel();
+  for(int level = 0; level <= (int)detectedLevel; ++level) {
+    setSimdLevel(SimdLevel(level));
+    runner.run((std::string("Mat4f*Mat4f/") + simdLevelNames[level]).c_str(), [&](int i) {
+      doNotOptimize(in.mat4s[i & inputMask] * in.mat4s[(i + 1) & inputMask]);
+    });
+  }
+  setSimdLevel(detectedLevel);
+  runner.run("Mat4x3f::lookAt", [&](int i) {
+    doNotOptimize(Mat4x3f::lookAt(in.vec3s[i & inputMask] * 10.f, { 0.f, 0.f, 0.f }, Vec3f::up()));
+  });
+
+  // Culling
+  runner.run("Frustum::fromViewProjectionD3d", [&](int i) {
+    doNotOptimize(Frustum::fromViewProjectionD3d(in.mat4s[i & inputMask]));
+  });
+  const Frustum frustum = Frustum::fromViewProjectionD3d(in.mat4s[0]);
+  runner.run("intersects(Frustum, Aabb)", [&](int i) {
+    const Vec3f& center = in.vec3s[i & inputMask];
+    doNotOptimize(intersects(frustum, Aabb{ center * 10.f, center * 10.f + Vec3f{ 1.f, 1.f, 1.f } }));
+  });
+  runner.run("intersects(Frustum, Sphere)", [&](int i) {
+    doNotOptimize(intersects(frustum, Sphere{ in.vec3s[i & inputMask] * 10.f, in.factors[i & inputMask] }));
+  });
+  static float boxComponents[6][inputCount];
+  static uint8_t boxVisibility[inputCount];
+  for(int i = 0; i < inputCount; ++i) {
+    boxComponents[0][i] = in.vec3s[i].x * 10.f;
+    boxComponents[1][i] = in.vec3s[i].y * 10.f;
+    boxComponents[2][i] = in.vec3s[i].z * 10.f;
+    boxComponents[3][i] = boxComponents[4][i] = boxComponents[5][i] = in.factors[i];
+  }
+  runner.run("testAabbsAgainstFrustum/256", [&](int i) {
+    testAabbsAgainstFrustum(
+      boxComponents[0], boxComponents[1], boxComponents[2], 
+      boxComponents[3], boxComponents[4], boxComponents[5], inputCount, 
+      frustum, 
+      boxVisibility
+    );
+    doNotOptimize(boxVisibility[i & inputMask]);
+  });
+
+  // Structure of arrays, against the same work done one element at a time.
+  static float pointComponents[4][inputCount];
+  static float outputComponents[4][inputCount];
+  static Mat4f translations[inputCount];
+  for(int i = 0; i < inputCount; ++i) {
+    pointComponents[0][i] = in.vec4s[i].x;
+    pointComponents[1][i] = in.vec4s[i].y;
+    pointComponents[2][i] = in.vec4s[i].z;
+    pointComponents[3][i] = in.vec4s[i].w;
+  }
+  const Mat4f& batchMatrix = in.mat4s[0];
+  runner.run("Vec4f*Mat4f/256", [&](int i) {
+    for(int j = 0; j < inputCount; ++j) {
+      const Vec4f transformed = in.vec4s[j] * batchMatrix;
+      outputComponents[0][j] = transformed.x;
+      outputComponents[1][j] = transformed.y;
+      outputComponents[2][j] = transformed.z;
+      outputComponents[3][j] = transformed.w;
+    }
+    doNotOptimize(outputComponents[0][i & inputMask]);
+  });
+  runner.run("transformPoints/256", [&](int i) {
+    transformPoints(
+      pointComponents[0], pointComponents[1], pointComponents[2], inputCount, 
+      batchMatrix, 
+      outputComponents[0], outputComponents[1], outputComponents[2], outputComponents[3]
+    );
+    doNotOptimize(outputComponents[0][i & inputMask]);
+  });
+  runner.run("transform/256", [&](int i) {
+    transform(
+      pointComponents[0], pointComponents[1], pointComponents[2], pointComponents[3], inputCount, 
+      batchMatrix, 
+      outputComponents[0], outputComponents[1], outputComponents[2], outputComponents[3]
+    );
+    doNotOptimize(outputComponents[0][i & inputMask]);
+  });
+  runner.run("Mat4f::translation*Mat4f/256", [&](int i) {
+    for(int j = 0; j < inputCount; ++j) {
+      translations[j] = Mat4f::translation(pointComponents[0][j], pointComponents[1][j], pointComponents[2][j]) * batchMatrix;
+    }
+    doNotOptimize(translations[i & inputMask]);
+  });
+  runner.run("concatenateTranslations/256", [&](int i) {
+    concatenateTranslations(pointComponents[0], pointComponents[1], pointComponents[2], inputCount, batchMatrix, translations);
+    doNotOptimize(translations[i & inputMask]);
+  });
+  static uint8_t pointVisibility[inputCount];
+  runner.run("testPointsAgainstPlanes/256", [&](int i) {
+    testPointsAgainstPlanes(
+      boxComponents[0], boxComponents[1], boxComponents[2], inputCount, 
+      frustum.planes, Frustum::PlaneCount, 0.5f, 
+      pointVisibility
+    );
+    doNotOptimize(pointVisibility[i & inputMask]);
+  });
+
+  // Quaternions
+  runner.run("Quatf*Quatf", [&](int i) {
+    doNotOptimize(in.quats[i & inputMask] * in.quats[(i + 1) & inputMask]);
+  });
+  runner.run("rotated(Vec3f, Quatf)", [&](int i) {
+    doNotOptimize(rotated(in.vec3s[i & inputMask], in.quats[(i + 1) & inputMask]));
+  });
+  runner.run("rlerp", [&](int i) {
+    doNotOptimize(rlerp(in.quats[i & inputMask], in.quats[(i + 1) & inputMask], in.factors[i & inputMask]));
+  });
+  runner.run("slerp", [&](int i) {
+    doNotOptimize(slerp(in.quats[i & inputMask], in.quats[(i + 1) & inputMask], in.factors[i & inputMask]));
+  });
+  runner.run("slerpFast", [&](int i) {
+    doNotOptimize(slerpFast(in.quats[i & inputMask], in.quats[(i + 1) & inputMask], in.factors[i & inputMask]));
+  });
+  static float quatComponents[3][4][inputCount];
+  for(int i = 0; i < inputCount; ++i) {
+    const Quatf& q = in.quats[i];
+    const Quatf& next = in.quats[(i + 1) & inputMask];
+    quatComponents[0][0][i] = q.v.x; quatComponents[0][1][i] = q.v.y; quatComponents[0][2][i] = q.v.z; quatComponents[0][3][i] = q.s;
+    quatComponents[1][0][i] = next.v.x; quatComponents[1][1][i] = next.v.y; quatComponents[1][2][i] = next.v.z; quatComponents[1][3][i] = next.s;
+  }
+  const QuatfArrays from = { quatComponents[0][0], quatComponents[0][1], quatComponents[0][2], quatComponents[0][3] };
+  const QuatfArrays to = { quatComponents[1][0], quatComponents[1][1], quatComponents[1][2], quatComponents[1][3] };
+  const QuatfArrays output = { quatComponents[2][0], quatComponents[2][1], quatComponents[2][2], quatComponents[2][3] };
+  runner.run("slerpFast(QuatfArrays)/256", [&](int i) {
+    slerpFast(from, to, in.factors, inputCount, output);
+    doNotOptimize(quatComponents[2][0][i & inputMask]);
+  });
+
+  // TrackSphere
+  TrackSphere trackSphere(0.f, Pi / 8.f, 8.f, 2.f, 10.f);
+  runner.run("TrackSphere::rotateTheta+rotatePhi", [&](int i) {
+    trackSphere.rotateTheta(in.factors[i & inputMask] * 0.1f);
+    trackSphere.rotatePhi(in.vec3s[i & inputMask].x * 0.01f);
+    doNotOptimize(trackSphere);
+  });
+  runner.run("TrackSphere::zoom", [&](int i) {
+    trackSphere.zoom(in.vec3s[i & inputMask].y);
+    doNotOptimize(trackSphere);
+  });
+  runner.run("TrackSphere::calculateView", [&](int i) {
+    doNotOptimize(trackSphere.calculateView(in.vec3s[i & inputMask]));
+  });
+}
@@ -0,0 +1,41 @@
+#include "Benchmark.hpp"
+
+#include <cmath>
+#include <vector>
+
+#include <JobSystem.hpp>
+
+namespace
+{
+  constexpr int elementCount = 1 << 20;
+
+  void transform(std::vector<float>& values, int begin, int end)
+  {
+    for(int i = begin; i < end; ++i) {
+      values[i] = std::sqrt(values[i] * values[i] + 1.f);
+    }
+  }
+}
+
+void runJobSystemBenchmarks(BenchmarkRunner& runner)
+{
+  De::JobSystem jobSystem;
+  std::vector<float> values(elementCount, 1.f);
+
+  runner.run("Transform1M/Serial", [&](int) {
+    transform(values, 0, elementCount);
+    doNotOptimize(values[elementCount - 1]);
+  });
+  runner.run("Transform1M/ParallelFor", [&](int) {
+    jobSystem.parallelFor(0, elementCount, [&](int begin, int end) { transform(values, begin, end); });
+    doNotOptimize(values[elementCount - 1]);
+  });
+  // Scheduling overhead, 256 jobs that do nothing.
+  runner.run("JobSystem/Run256EmptyJobs", [&](int) {
+    De::JobCounter counter;
+    for(int i = 0; i < 256; ++i) {
+      jobSystem.run([]() {}, &counter);
+    }
+    jobSystem.wait(counter);
+  });
+}
@@ -0,0 +1,43 @@
+#include "Benchmark.hpp"
+
+#include <random>
+#include <vector>
+
+#include <Memory.hpp>
+#include <RenderQueue.hpp>
+
+namespace
+{
+  constexpr int commandCount = 4096;
+}
+
+void runRenderQueueBenchmarks(BenchmarkRunner& runner)
+{
+  De::LinearArena arena(1 << 20);
+  std::mt19937 random(42);
+  std::uniform_int_distribution<int> pipelineDistribution(0, 3);
+  std::uniform_int_distribution<int> meshDistribution(0, 63);
+  std::uniform_real_distribution<float> depthDistribution(1.f, 100.f);
+  std::vector<De::RenderCommand> commands(commandCount);
+  for(De::RenderCommand& command : commands) {
+    command = {};
+    command.sortKey = De::RenderQueue::makeSortKey(
+      0,
+      pipelineDistribution(random),
+      meshDistribution(random),
+      De::RenderQueue::toDepthKey(depthDistribution(random))
+    );
+  }
+
+  // Commands pushed in random order, the way a frame with many draws records them.
+  runner.run("RenderQueue/PushSort4096", [&](int) {
+    arena.reset();
+    De::RenderQueue queue;
+    queue.reset(arena);
+    for(const De::RenderCommand& command : commands) {
+      queue.push(command);
+    }
+    queue.sort();
+    doNotOptimize(queue.begin()->sortKey);
+  });
+}
@@ -0,0 +1,71 @@
+#include "Benchmark.hpp"
+
+#include <JobSystem.hpp>
+#include <Memory.hpp>
+#include <RenderFrame.hpp>
+#include <SoftwareRenderer.hpp>
+
+namespace
+{
+  const CubeClass cubeClasses[] = {
+    {ColorRgbaf{ 0.f, 1.f, 1.f, 1.f }},
+    {ColorRgbaf{ 1.f, 1.f, 0.f, 1.f }},
+    {ColorRgbaf{ 1.f, 0.f, 1.f, 1.f }},
+    {ColorRgbaf{ 0.f, 1.f, 0.f, 1.f }},
+    {ColorRgbaf{ 1.f, 0.f, 0.f, 1.f }},
+    {ColorRgbaf{ 0.f, 0.f, 1.f, 1.f }},
+    {ColorRgbaf{ 1.f, 0.5f, 0.f, 1.f }}
+  };
+}
+
+void setUpBenchmarkGameState(GameState& gameState)
+{
+  gameState.cubeClasses = cubeClasses;
+  gameState.cubeClassCount = (int)arrayCount(cubeClasses);
+  uint32_t random = 1;
+  for(int y = 0; y < 3; ++y) {
+    for(int z = 0; z < GameState::gridSize.z; ++z) {
+      for(int x = 0; x < GameState::gridSize.x; ++x) {
+        random = random * 1664525u + 1013904223u;
+        if((random >> 28) < 12) {
+          gameState.playingSpace.set(x, y, z, PlayingSpace::ValueType((x + y + z) % arrayCount(cubeClasses)));
+        }
+      }
+    }
+  }
+  gameState.currentTetracube = { {{ 0, 0, 0 }, { 1, 0, 0 }, { 2, 0, 0 }, { 1, 0, 1 }}, { 1, 4, 1 }, 2 };
+}
+
+void runSoftwareRendererBenchmarks(BenchmarkRunner& runner, const char* screenshotFileName)
+{
+  constexpr int width = 1280;
+  constexpr int height = 720;
+  De::JobSystem jobSystem;
+  GameState gameState;
+  setUpBenchmarkGameState(gameState);
+  gameState.clientAreaWidth = width;
+  gameState.clientAreaHeight = height;
+  SoftwareRenderer renderer(width, height, jobSystem);
+  RenderFrameBuilder renderFrameBuilder;
+  De::LinearArena arena(1 << 22);
+
+  // The first frame meshes every cube chunk, the measured ones only draw.
+  renderer.render(renderFrameBuilder.build(gameState, arena));
+  if(screenshotFileName) {
+    renderer.writeScreenshot(screenshotFileName);
+  }
+
+  // Recording is part of a frame, as for the GPU renderers.
+  runner.run("SoftwareRenderer/Frame720p", [&](int) {
+    arena.reset();
+    renderer.render(renderFrameBuilder.build(gameState, arena));
+    doNotOptimize(renderer.getPixel(0, 0));
+  });
+  // Moving the camera keeps the work per frame from repeating exactly.
+  runner.run("SoftwareRenderer/Frame720p/OrbitingCamera", [&](int i) {
+    gameState.camera.rotatePhi(i % 2 ? 0.01f : -0.01f);
+    arena.reset();
+    renderer.render(renderFrameBuilder.build(gameState, arena));
+    doNotOptimize(renderer.getPixel(0, 0));
+  });
+}
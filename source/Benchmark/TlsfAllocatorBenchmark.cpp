@@ -0,0 +1,52 @@
+#include "Benchmark.hpp"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include <TlsfAllocator.hpp>
+
+namespace
+{
+  constexpr int allocationCount = 4096;
+
+  struct Request
+  {
+    uint64_t size;
+    uint64_t alignment;
+    uint8_t kind;
+  };
+}
+
+void runTlsfAllocatorBenchmarks(BenchmarkRunner& runner)
+{
+  // Sizes and alignments of buffers and images in a 256 MiB block, with a bufferImageGranularity of 1 KiB.
+  std::mt19937 random(42);
+  std::uniform_int_distribution<uint64_t> sizeDistribution(256, 64 << 10);
+  std::uniform_int_distribution<int> alignmentDistribution(4, 16);
+  std::uniform_int_distribution<int> kindDistribution(0, 1);
+  std::vector<Request> requests(allocationCount);
+  for(Request& request : requests) {
+    request.size = sizeDistribution(random);
+    request.alignment = uint64_t(1) << alignmentDistribution(random);
+    request.kind = uint8_t(kindDistribution(random));
+  }
+  std::vector<int> deallocationOrder(allocationCount);
+  for(int i = 0; i < allocationCount; ++i) {
+    deallocationOrder[i] = i;
+  }
+  std::shuffle(deallocationOrder.begin(), deallocationOrder.end(), random);
+
+  De::TlsfAllocator allocator(uint64_t(256) << 20, 1024);
+  std::vector<De::TlsfAllocator::Allocation> allocations(allocationCount);
+  // Freed in random order, so that the free ranges are merged from both sides.
+  runner.run("TlsfAllocator/AllocateFree4096", [&](int) {
+    for(int i = 0; i < allocationCount; ++i) {
+      allocator.allocate(requests[i].size, requests[i].alignment, requests[i].kind, &allocations[i]);
+    }
+    doNotOptimize(allocator.getStatistics().largestFreeSize);
+    for(int i : deallocationOrder) {
+      allocator.deallocate(allocations[i].handle);
+    }
+  });
+}
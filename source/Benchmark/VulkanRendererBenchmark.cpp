@@ -0,0 +1,47 @@
+#define DAR_MODULE_NAME "VulkanRendererBenchmark"
+
+#include "Benchmark.hpp"
+
+#include <exception>
+#include <memory>
+#include <vector>
+
+#include <AssetLoader.hpp>
+#include <DarEngine.hpp>
+#include <Memory.hpp>
+#include <RenderFrame.hpp>
+#include <VulkanRenderer.h>
+
+void runVulkanRendererBenchmarks(BenchmarkRunner& runner)
+{
+  constexpr int width = 1280;
+  constexpr int height = 720;
+  GameState gameState;
+  setUpBenchmarkGameState(gameState);
+  gameState.clientAreaWidth = width;
+  gameState.clientAreaHeight = height;
+
+  De::AssetLoader assetLoader;
+  std::unique_ptr<VulkanRenderer> renderer;
+  try {
+    renderer = std::make_unique<VulkanRenderer>(width, height, assetLoader);
+  } catch(const std::exception& e) {
+    logWarning("Skipping the Vulkan renderer benchmarks: %s", e.what());
+    return;
+  }
+
+  RenderFrameBuilder renderFrameBuilder;
+  De::LinearArena arena(1 << 22);
+  std::vector<uint32_t> pixels(size_t(width) * height);
+  // The first frame meshes and uploads every cube chunk, the measured ones only draw.
+  renderer->render(renderFrameBuilder.build(gameState, arena));
+  renderer->readPixels(pixels.data());
+
+  // Reading the pixels back waits for the device, so a sample covers the whole frame.
+  runner.run("VulkanRenderer/Frame720p", [&](int) {
+    arena.reset();
+    renderer->render(renderFrameBuilder.build(gameState, arena));
+    renderer->readPixels(pixels.data());
+    doNotOptimize(pixels[0]);
+  });
+}
@@ -9,6 +9,8 @@
 #include <objbase.h>
 
 #include <DarEngine.hpp>
+#include <Exception.hpp>
+#include <Profiler.hpp>
 
 FMOD::Studio::System* studioSystem = nullptr;
 FMOD::System* coreSystem = nullptr;
@@ -16,6 +18,10 @@ constexpr int sampleRate = 48000;
 FMOD::Studio::EventInstance* musicInstance = nullptr;
 FMOD::Studio::Bus* masterBus = nullptr;
 float masterVolume = 0.05f;
+constexpr const char* bankFileNames[] = { "audio/Master.bank", "audio/Master.strings.bank", "audio/music.bank" };
+constexpr int bankCount = arrayCount(bankFileNames);
+// Banks are loaded in place from the files, which have to stay valid while the banks are loaded.
+De::LoadedFile bankFiles[bankCount];
 
 #define initializeErrorCheckFatal(call) \
 result = call; \
@@ -31,8 +37,36 @@ if(result != FMOD_OK) { \
   logError(#call " failed: %d - %s", result, FMOD_ErrorString(result)); \
 } else
 
-Audio::Audio()
+static FMOD::Studio::Bank* loadBank(std::future<De::LoadedFile>* bankFileLoad, De::LoadedFile* bankFile)
 {
+  try {
+    *bankFile = bankFileLoad->get();
+  } catch(const De::Exception&) {
+    // Logged by the loader.
+    return nullptr;
+  }
+  static_assert(FMOD_STUDIO_LOAD_MEMORY_ALIGNMENT <= De::LoadedFile::alignment, "Banks have to be aligned for loading in place.");
+  FMOD_RESULT result;
+  FMOD::Studio::Bank* bank = nullptr;
+  errorCheck(studioSystem->loadBankMemory(
+    reinterpret_cast<const char*>(bankFile->getData()),
+    (int)bankFile->getSize(),
+    FMOD_STUDIO_LOAD_MEMORY_POINT,
+    FMOD_STUDIO_LOAD_BANK_NORMAL,
+    &bank
+  )) {
+    return bank;
+  }
+  *bankFile = De::LoadedFile();
+  return nullptr;
+}
+
+Audio::Audio(De::AssetLoader& assetLoader)
+{
+  // The banks are read while FMOD initializes.
+  std::future<De::LoadedFile> bankFileLoads[bankCount];
+  assetLoader.readBatch(bankFileNames, bankCount, bankFileLoads);
+
   FMOD_RESULT result;
 
   // from doc: Before calling any FMOD functions it is important to ensure COM is initialized. 
@@ -59,12 +93,9 @@ Audio::Audio()
     nullptr/*extraDriverData*/
   ));
 
-  FMOD::Studio::Bank* masterBank = nullptr;
-  errorCheck(studioSystem->loadBankFile("audio/Master.bank", FMOD_STUDIO_LOAD_BANK_NORMAL, &masterBank));
-  FMOD::Studio::Bank* stringsBank = nullptr;
-  errorCheck(studioSystem->loadBankFile("audio/Master.strings.bank", FMOD_STUDIO_LOAD_BANK_NORMAL, &stringsBank));
-  FMOD::Studio::Bank* musicBank = nullptr;
-  errorCheck(studioSystem->loadBankFile("audio/music.bank", FMOD_STUDIO_LOAD_BANK_NORMAL, &musicBank));
+  for(int i = 0; i < bankCount; ++i) {
+    loadBank(&bankFileLoads[i], &bankFiles[i]);
+  }
 
   FMOD::Studio::EventDescription* musicDescription = nullptr;
   errorCheck(studioSystem->getEvent("event:/music/music", &musicDescription)) {
@@ -79,12 +110,19 @@ Audio::Audio()
 Audio::~Audio()
 {
   if(isInitialized) {
+    // Unloads the banks before their mappings go away.
+    studioSystem->release();
+    studioSystem = nullptr;
+    for(De::LoadedFile& bankFile : bankFiles) {
+      bankFile = De::LoadedFile();
+    }
     CoUninitialize();
   }
 }
 
 void Audio::update(const GameState& gameState)
 {
+  DAR_PROFILE_SCOPE("Audio::update");
   if(!isInitialized) {
     return;
   }
@@ -1,11 +1,16 @@
 #pragma once
 
+#include <AssetLoader.hpp>
+
 #include "GameState.hpp"
 
 class Audio
 {
 public:
-  Audio();
+  /**
+   * @brief Starts reading the banks with assetLoader while FMOD initializes.
+   */
+  explicit Audio(De::AssetLoader& assetLoader);
   Audio(const Audio& other) = delete;
   Audio(Audio&& other) = delete;
   Audio& operator=(const Audio& rhs) = delete;
@@ -4,14 +4,16 @@ static const float colorThresholdMin = 0.3f;
 static const float colorThresholdMax = 0.4f;
 
 float4 main(
-  float3 originalPosition : POSITION,
+  float3 gridPosition : POSITION,
   float4 position : SV_POSITION,
   float4 color : COLOR
 ) : SV_TARGET
 {
-  float xStep = smoothstep(colorThresholdMin, colorThresholdMax, abs(originalPosition.x));
-  float yStep = smoothstep(colorThresholdMin, colorThresholdMax, abs(originalPosition.y));
-  float zStep = smoothstep(colorThresholdMin, colorThresholdMax, abs(originalPosition.z));
+  // Merged faces span several cells, the borders are drawn around every cell of them.
+  float3 cellPosition = frac(gridPosition) - 0.5f;
+  float xStep = smoothstep(colorThresholdMin, colorThresholdMax, abs(cellPosition.x));
+  float yStep = smoothstep(colorThresholdMin, colorThresholdMax, abs(cellPosition.y));
+  float zStep = smoothstep(colorThresholdMin, colorThresholdMax, abs(cellPosition.z));
   float modifier = 1.f - smoothstep(1.75f, 2.f, xStep + yStep + zStep);
   return modifier * color;
 }
\ No newline at end of file
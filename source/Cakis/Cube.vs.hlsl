@@ -1,21 +1,29 @@
 #pragma pack_matrix(row_major)
 
+cbuffer CubeConstants : register(b0)
+{
+  float4x4 viewProjection;
+};
+
+// Colors of the cube classes, the size has to match maxCubeClassCount in RenderFrame.hpp.
+cbuffer CubePalette : register(b1)
+{
+  float4 cubeClassColors[16];
+};
+
 struct Output
 {
-  float3 originalPosition : POSITION;
+  float3 gridPosition : POSITION;
   float4 position : SV_POSITION;
   nointerpolation float4 color : COLOR;
 };
 
-Output main(
-  float3 position : POSITION,
-  float4x4 transform : INSTANCE_TRANSFORM,
-  float4 color : INSTANCE_COLOR
-)
+// Grid position in xyz and the cube class in w, see CubeMesher::Vertex.
+Output main(int4 packedVertex : POSITION)
 {
   Output output;
-  output.originalPosition = position;
-  output.position = mul(float4(position, 1.0f), transform);
-  output.color = float4(color);
+  output.gridPosition = float3(packedVertex.xyz);
+  output.position = mul(float4(output.gridPosition, 1.0f), viewProjection);
+  output.color = cubeClassColors[packedVertex.w];
   return output;
 }
\ No newline at end of file
@@ -0,0 +1,161 @@
+#include "CubeMesher.hpp"
+
+#include <cassert>
+
+namespace
+{
+  Vec3i toVec3i(const int (&v)[3]) noexcept
+  {
+    return { v[0], v[1], v[2] };
+  }
+
+  bool isRepresentable(int coordinate) noexcept
+  {
+    return coordinate >= CubeMesher::minCoordinate && coordinate <= CubeMesher::maxCoordinate;
+  }
+
+  /**
+   * @param axis Normal of the quad, u and v span it with u x v = axis.
+   * @param isFacingPositive Whether the quad faces towards +axis.
+   */
+  void appendQuad(
+    const int (&origin)[3],
+    int axis,
+    int uSize,
+    int vSize,
+    bool isFacingPositive,
+    PlayingSpace::ValueType cubeClassIndex,
+    std::vector<CubeMesher::Vertex>& vertices,
+    std::vector<uint32_t>& indices
+  )
+  {
+    const int u = (axis + 1) % 3;
+    const int v = (axis + 2) % 3;
+    int corners[4][3] = {
+      { origin[0], origin[1], origin[2] },
+      { origin[0], origin[1], origin[2] },
+      { origin[0], origin[1], origin[2] },
+      { origin[0], origin[1], origin[2] }
+    };
+    corners[1][u] += uSize;
+    corners[2][u] += uSize;
+    corners[2][v] += vSize;
+    corners[3][v] += vSize;
+
+    const uint32_t first = (uint32_t)vertices.size();
+    for(const int (&corner)[3] : corners) {
+      assert(isRepresentable(corner[0]) && isRepresentable(corner[1]) && isRepresentable(corner[2]));
+      vertices.push_back({ int8_t(corner[0]), int8_t(corner[1]), int8_t(corner[2]), cubeClassIndex });
+    }
+    // (corner1 - corner0) x (corner2 - corner0) points along +axis, which makes 0, 1, 2 clockwise seen from +axis
+    // in the left-handed D3D convention.
+    if(isFacingPositive) {
+      indices.insert(indices.end(), { first, first + 1, first + 2, first, first + 2, first + 3 });
+    } else {
+      indices.insert(indices.end(), { first, first + 2, first + 1, first, first + 3, first + 2 });
+    }
+  }
+}
+
+void CubeMesher::mesh(
+  const PlayingSpace& playingSpace,
+  const Vec3i& begin,
+  const Vec3i& end,
+  std::vector<Vertex>& vertices,
+  std::vector<uint32_t>& indices
+)
+{
+  const Vec3i& size = playingSpace.getSize();
+  const int sizes[3] = { size.x, size.y, size.z };
+  const int begins[3] = { begin.x, begin.y, begin.z };
+  const int ends[3] = { end.x, end.y, end.z };
+
+  for(int axis = 0; axis < 3; ++axis) {
+    const int u = (axis + 1) % 3;
+    const int v = (axis + 2) % 3;
+    const int uCount = ends[u] - begins[u];
+    const int vCount = ends[v] - begins[v];
+    if(uCount <= 0 || vCount <= 0) {
+      continue;
+    }
+    mask.resize(size_t(uCount) * vCount);
+
+    // Slice s is the plane between the cells s - 1 and s along axis.
+    for(int s = begins[axis]; s <= ends[axis]; ++s) {
+      int cell[3];
+      cell[axis] = s;
+      for(int j = 0; j < vCount; ++j) {
+        cell[v] = begins[v] + j;
+        for(int i = 0; i < uCount; ++i) {
+          cell[u] = begins[u] + i;
+          int behindCell[3] = { cell[0], cell[1], cell[2] };
+          --behindCell[axis];
+          // Cells outside of the playing space are empty. A face belongs to the range holding its cube.
+          const PlayingSpace::ValueType behind = s > 0 ? playingSpace.at(toVec3i(behindCell)) : PlayingSpace::emptyValue;
+          const PlayingSpace::ValueType ahead = s < sizes[axis] ? playingSpace.at(toVec3i(cell)) : PlayingSpace::emptyValue;
+          int face = 0;
+          if(behind != PlayingSpace::emptyValue && ahead == PlayingSpace::emptyValue && s > begins[axis]) {
+            face = behind + 1;
+          } else if(ahead != PlayingSpace::emptyValue && behind == PlayingSpace::emptyValue && s < ends[axis]) {
+            face = -(ahead + 1);
+          }
+          mask[size_t(j) * uCount + i] = face;
+        }
+      }
+
+      // Grows each remaining face first along u, then along v as long as whole rows match.
+      for(int j = 0; j < vCount; ++j) {
+        for(int i = 0; i < uCount; ) {
+          const int face = mask[size_t(j) * uCount + i];
+          if(face == 0) {
+            ++i;
+            continue;
+          }
+          int width = 1;
+          while(i + width < uCount && mask[size_t(j) * uCount + i + width] == face) {
+            ++width;
+          }
+          int height = 1;
+          for(; j + height < vCount; ++height) {
+            const int* row = &mask[size_t(j + height) * uCount + i];
+            bool isRowMatching = true;
+            for(int k = 0; k < width && isRowMatching; ++k) {
+              isRowMatching = row[k] == face;
+            }
+            if(!isRowMatching) {
+              break;
+            }
+          }
+          for(int l = 0; l < height; ++l) {
+            std::fill_n(&mask[size_t(j + l) * uCount + i], width, 0);
+          }
+
+          int origin[3];
+          origin[axis] = s;
+          origin[u] = begins[u] + i;
+          origin[v] = begins[v] + j;
+          const bool isFacingPositive = face > 0;
+          const PlayingSpace::ValueType cubeClassIndex = PlayingSpace::ValueType((isFacingPositive ? face : -face) - 1);
+          appendQuad(origin, axis, width, height, isFacingPositive, cubeClassIndex, vertices, indices);
+          i += width;
+        }
+      }
+    }
+  }
+}
+
+void CubeMesher::appendCube(
+  const Vec3i& position,
+  PlayingSpace::ValueType cubeClassIndex,
+  std::vector<Vertex>& vertices,
+  std::vector<uint32_t>& indices
+)
+{
+  const int cell[3] = { position.x, position.y, position.z };
+  for(int axis = 0; axis < 3; ++axis) {
+    int origin[3] = { cell[0], cell[1], cell[2] };
+    appendQuad(origin, axis, 1, 1, false, cubeClassIndex, vertices, indices);
+    ++origin[axis];
+    appendQuad(origin, axis, 1, 1, true, cubeClassIndex, vertices, indices);
+  }
+}
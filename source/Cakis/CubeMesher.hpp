@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <DarMath.hpp>
+
+#include "GameState.hpp"
+
+/**
+ * @brief Turns occupied cells of a PlayingSpace into a mesh of their visible faces. Faces between two occupied
+ * cells are left out and neighbouring coplanar faces of the same cube class are merged into rectangles (greedy meshing).
+ * Vertices are in grid space, cell (x, y, z) spans [x, x + 1] on each axis. Front faces are clockwise, as D3D11 expects.
+ * Coordinates have to lie in [minCoordinate, maxCoordinate], which keeps a vertex at 4 bytes.
+ */
+class CubeMesher
+{
+public:
+  // Read by the cube vertex shaders as a signed 8 bit vector, the color comes from a palette of cube classes.
+  struct Vertex
+  {
+    int8_t x;
+    int8_t y;
+    int8_t z;
+    PlayingSpace::ValueType cubeClassIndex;
+  };
+  static_assert(sizeof(Vertex) == 4, "The cube vertex format is 4 x 8 bits.");
+  static constexpr int minCoordinate = INT8_MIN;
+  static constexpr int maxCoordinate = INT8_MAX;
+
+  // Worst case of cellCount cells without a single shared or merged face, e.g. a checkerboard.
+  static constexpr int calculateMaxVertexCount(int cellCount) noexcept { return cellCount * 6 * 4; }
+  static constexpr int calculateMaxIndexCount(int cellCount) noexcept { return cellCount * 6 * 6; }
+
+  /**
+   * @brief Appends the faces of the cells in [begin, end). Faces towards cells outside of the range are culled
+   * against them as well, so that ranges meshed separately fit together without hidden faces.
+   */
+  void mesh(
+    const PlayingSpace& playingSpace,
+    const Vec3i& begin,
+    const Vec3i& end,
+    std::vector<Vertex>& vertices,
+    std::vector<uint32_t>& indices
+  );
+  /**
+   * @brief Appends all six faces of a cube at position.
+   */
+  static void appendCube(
+    const Vec3i& position,
+    PlayingSpace::ValueType cubeClassIndex,
+    std::vector<Vertex>& vertices,
+    std::vector<uint32_t>& indices
+  );
+
+private:
+  // Faces of one slice, cube class + 1 for faces towards +axis, -(cube class + 1) towards -axis, 0 for none.
+  std::vector<int> mask;
+};
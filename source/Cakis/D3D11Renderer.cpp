@@ -1,15 +1,27 @@
 #define DAR_MODULE_NAME "D3D11Renderer"
 
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <string>
 #include <vector>
 
 #include <d3d11_4.h>
 #include <dwrite_2.h>
 #include <d2d1_2.h>
 #include <atlbase.h>
+#ifdef DAR_DEBUG
+#include <d3dcompiler.h>
+#endif
 
 #include "D3D11Renderer.hpp"
 #include "DarEngine.hpp"
 #include "DarMath.hpp"
+#include "AssetLoader.hpp"
+#include "Exception.hpp"
+#include "FileWatcher.hpp"
+#include "Profiler.hpp"
+#include "RenderFrame.hpp"
 
 namespace 
 {
@@ -25,7 +37,8 @@ CComPtr<ID3D11Texture2D> renderTarget = nullptr;
 CD3D11_TEXTURE2D_DESC renderTargetDesc = {};
 CComPtr<ID3D11RenderTargetView> renderTargetView = nullptr;
 CComPtr<ID3D11DepthStencilView> depthStencilView = nullptr;
-float clearColor[4] = { 0.2f, 0.2f, 0.2f, 1.0f };
+// Size the targets were last resized to.
+Vec2i clientAreaSize = {};
 CComPtr<ID3D11RasterizerState> rasterizerState = nullptr;
 D3D11_RASTERIZER_DESC rasterizerDesc =
 {
@@ -43,10 +56,6 @@ D3D11_RASTERIZER_DESC rasterizerDesc =
 CComPtr<IDWriteFactory2> dwriteFactory;
 CComPtr<ID2D1Device1> d2Device = nullptr;
 CComPtr<ID2D1DeviceContext1> d2Context = nullptr;
-constexpr float verticalFieldOfView = 74.f;
-constexpr float nearPlane = 1.f;
-constexpr float farPlane = 100.f;
-Mat4f projectionMatrix = Mat4f::identity();
 
 #ifdef DAR_DEBUG
   CComPtr<ID3D11Debug> debug = nullptr;
@@ -54,7 +63,11 @@ Mat4f projectionMatrix = Mat4f::identity();
   CComPtr<IDWriteTextFormat> debugTextFormat = nullptr;
 #endif
 
-  static void* loadShaderFile(const char* fileName, SIZE_T* shaderSize);
+  // Requested when the renderer is created and waited for when the shaders are created.
+  constexpr const char* shaderFileNames[] = { "grid.vs.cso", "grid.ps.cso", "cube.vs.cso", "cube.ps.cso" };
+  std::future<De::LoadedFile> shaderFileLoads[arrayCount(shaderFileNames)];
+
+  static bool loadShaderFile(const char* fileName, De::LoadedFile* shaderFile);
   static ID3D11VertexShader* loadVertexShader(const char* shaderName, D3D11_INPUT_ELEMENT_DESC* inputElementDescs, UINT inputElementDescCount, ID3D11InputLayout** inputLayout);
   static ID3D11PixelShader* loadPixelShader(const char* name);
 
@@ -62,46 +75,26 @@ Mat4f projectionMatrix = Mat4f::identity();
   CComPtr<ID3D11VertexShader> gridVertexShader = nullptr;
   CComPtr<ID3D11PixelShader> gridPixelShader = nullptr;
   CComPtr<ID3D11InputLayout> gridInputLayout = nullptr;
-  CComPtr<ID3D11Buffer> gridConstantBuffer = nullptr;
-  struct Grid
-  {
-    Mat4f transformation;
-    CComPtr<ID3D11Buffer> vertexBuffer;
-    const int vertexCount;
-  };
-  static constexpr int calculateGridVertexCount(int x, int y) { return 2 * (x + 1 + y + 1); }
-  Grid grids[5] = {
-    {Mat4f::rotationX(degreesToRadians(90)), nullptr, calculateGridVertexCount(GameState::gridSize.x, GameState::gridSize.z)}, // Bottom.
-    {Mat4f::rotationY(degreesToRadians(-90)), nullptr, calculateGridVertexCount(GameState::gridSize.z, GameState::gridSize.y)}, // Left.
-    {toMat4f(Mat3f::rotationY(degreesToRadians(-90)) * Mat4x3f::translation((float)GameState::gridSize.x, 0.f, 0.f)), nullptr, calculateGridVertexCount(GameState::gridSize.z, GameState::gridSize.y)}, // Right.
-    {Mat4f::identity(), nullptr, calculateGridVertexCount(GameState::gridSize.x, GameState::gridSize.y)}, // Front.
-    {Mat4f::translation(0.f, 0.f, (float)GameState::gridSize.z), nullptr, calculateGridVertexCount(GameState::gridSize.x, GameState::gridSize.y)} // Back.
-  };
-  static void generateGridVertices(int xSize, int ySize, Vec2f* output)
-  {
-    int gridVertexIndex = 0;
-    // Vertical lines
-    for(int i = 0; i <= xSize; ++i) {
-      output[gridVertexIndex].x = (float)i;
-      output[gridVertexIndex].y = 0.f;
-      ++gridVertexIndex;
-      output[gridVertexIndex].x = (float)i;
-      output[gridVertexIndex].y = (float)ySize;
-      ++gridVertexIndex;
-    }
-    // Horizontal lines
-    for(int i = 0; i <= ySize; ++i) {
-      output[gridVertexIndex].x = 0.f;
-      output[gridVertexIndex].y = (float)i;
-      ++gridVertexIndex;
-      output[gridVertexIndex].x = (float)xSize;
-      output[gridVertexIndex].y = (float)i;
-      ++gridVertexIndex;
-    }
-  }
-  static void generateGrid(std::vector<Vec2f>& vertices, int xSize, int ySize, ID3D11Buffer** vertexBuffer)
-  {
-    generateGridVertices(xSize, ySize, vertices.data());
+
+// Meshes by RenderMesh::Type, those drawn with indices have an index buffer.
+struct Mesh
+{
+  CComPtr<ID3D11Buffer> vertexBuffer;
+  CComPtr<ID3D11Buffer> indexBuffer;
+  UINT vertexStride;
+  // Rewritten as a whole with WRITE_DISCARD, the others are updated a range at a time.
+  bool isDynamic;
+};
+Mesh meshes[RenderMesh::Count];
+// Constants of the current command, bound to b0 of every pipeline.
+constexpr UINT maxConstantsSize = sizeof(Mat4f);
+CComPtr<ID3D11Buffer> constantBuffer = nullptr;
+
+static void initializeGrids()
+{
+  for(const RenderMesh::Type mesh : { RenderMesh::BottomGrid, RenderMesh::SideGrid, RenderMesh::FrontGrid }) {
+    std::vector<Vec2f> vertices(calculateGridVertexCount(mesh));
+    generateGridVertices(mesh, vertices.data());
     D3D11_BUFFER_DESC vertexBufferDesc
     {
       UINT(vertices.size() * sizeof(Vec2f)),
@@ -109,118 +102,166 @@ Mat4f projectionMatrix = Mat4f::identity();
       D3D11_BIND_VERTEX_BUFFER
     };
     D3D11_SUBRESOURCE_DATA vertexBufferData{ vertices.data(), 0, 0 };
-    if(FAILED(device->CreateBuffer(&vertexBufferDesc, &vertexBufferData, vertexBuffer))) {
+    if(FAILED(device->CreateBuffer(&vertexBufferDesc, &vertexBufferData, &meshes[mesh].vertexBuffer))) {
       throw D3D11Renderer::InitializeException("Failed to create grid vertex buffer.");
     }
+    meshes[mesh].vertexStride = sizeof(Vec2f);
   }
-  static void initializeGrid()
-  {
-    std::vector<Vec2f> vertices(grids[0].vertexCount);
-    generateGrid(vertices, GameState::gridSize.x, GameState::gridSize.z, &grids[0].vertexBuffer);
-    if(GameState::gridSize.z == GameState::gridSize.x && GameState::gridSize.y == GameState::gridSize.z) {
-      grids[1].vertexBuffer = grids[0].vertexBuffer;
-      grids[2].vertexBuffer = grids[0].vertexBuffer;
-    } else {
-      vertices.resize(grids[1].vertexCount);
-      generateGrid(vertices, GameState::gridSize.z, GameState::gridSize.y, &grids[1].vertexBuffer);
-      grids[2].vertexBuffer = grids[1].vertexBuffer;
-    }
-    if(GameState::gridSize.y == GameState::gridSize.z) {
-      grids[3].vertexBuffer = grids[0].vertexBuffer;
-      grids[4].vertexBuffer = grids[0].vertexBuffer;
-    } else if(GameState::gridSize.x == GameState::gridSize.z) {
-      grids[3].vertexBuffer = grids[1].vertexBuffer;
-      grids[4].vertexBuffer = grids[1].vertexBuffer;
-    } else {
-      vertices.resize(grids[3].vertexCount);
-      generateGrid(vertices, GameState::gridSize.x, GameState::gridSize.y, &grids[3].vertexBuffer);
-      grids[4].vertexBuffer = grids[3].vertexBuffer;
-    }
 
-    D3D11_INPUT_ELEMENT_DESC gridInputElementDescs[] = {
-      {"POSITION", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0}
-    };
-    gridVertexShader = loadVertexShader("grid", gridInputElementDescs, arrayCount(gridInputElementDescs), &gridInputLayout);
-    gridPixelShader = loadPixelShader("grid");
-    D3D11_BUFFER_DESC gridCBDesc
-    {
-      sizeof(Mat4f),
-      D3D11_USAGE_DYNAMIC,
-      D3D11_BIND_CONSTANT_BUFFER,
-      D3D11_CPU_ACCESS_WRITE
-    };
-    device->CreateBuffer(&gridCBDesc, nullptr, &gridConstantBuffer);
-  }
-  static void renderGrids(const Mat4f& viewProjection)
-  {
-    context->VSSetShader(gridVertexShader, nullptr, 0);
-    context->PSSetShader(gridPixelShader, nullptr, 0);
-    context->IASetInputLayout(gridInputLayout);
-    context->VSSetConstantBuffers(0, 1, &gridConstantBuffer.p);
-    context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_LINELIST);
-    D3D11_MAPPED_SUBRESOURCE mappedResource;
-    constexpr UINT vertexBufferStride = sizeof(Vec2f);
-    constexpr UINT vertexBufferOffset = 0;
-    for(const Grid& grid : grids) {
-      Mat4f transform = grid.transformation * viewProjection;
-      context->Map(gridConstantBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource);
-      memcpy(mappedResource.pData, &transform, sizeof(transform));
-      context->Unmap(gridConstantBuffer, 0);
-      context->IASetVertexBuffers(0, 1, &grid.vertexBuffer.p, &vertexBufferStride, &vertexBufferOffset);
-      context->Draw(grid.vertexCount, 0);
-    }
-  }
+  D3D11_INPUT_ELEMENT_DESC gridInputElementDescs[] = {
+    {"POSITION", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0}
+  };
+  gridVertexShader = loadVertexShader("grid", gridInputElementDescs, arrayCount(gridInputElementDescs), &gridInputLayout);
+  gridPixelShader = loadPixelShader("grid");
+}
 
 // Cube
-CComPtr<ID3D11Buffer> cubeVertexBuffer = nullptr;
-CComPtr<ID3D11Buffer> cubeInstanceBuffer = nullptr;
-struct CubeInstanceData
+// Vertices are CubeMesher::Vertex, the vertex shader transforms them and looks up their color in the palette.
+struct CubePalette
 {
-  Mat4f transform;
-  ColorRgbaf color;
-} cubeInstanceData[GameState::gridSize.x * GameState::gridSize.y * GameState::gridSize.z + 4];
-CComPtr<ID3D11Buffer> cubeIndexBuffer = nullptr;
+  ColorRgbaf cubeClassColors[maxCubeClassCount];
+};
+CComPtr<ID3D11Buffer> cubePaletteBuffer = nullptr;
+CubePalette uploadedCubePalette = {};
+bool isCubePaletteValid = false;
 CComPtr<ID3D11VertexShader> cubeVertexShader = nullptr;
 CComPtr<ID3D11PixelShader> cubePixelShader = nullptr;
 CComPtr<ID3D11InputLayout> cubeInputLayout = nullptr;
+#ifdef DAR_DEBUG
+// Shaders recompiled from their sources on a background thread when they change, swapped in by render.
+// The input layouts are kept, changing the input signature of a vertex shader still requires a restart.
+// The file watcher recompiles on the main thread, render swaps on the render thread.
+// Neither waits for a compilation, a change during one is queued and compiled once the pending result is swapped in.
+std::mutex hotReloadMutex;
+struct HotReloadedShader
+{
+  const char* sourceFileName;
+  const char* target;
+  CComPtr<ID3D11VertexShader>* vertexShader;
+  CComPtr<ID3D11PixelShader>* pixelShader;
+  std::future<CComPtr<ID3DBlob>> bytecode;
+  std::wstring sourcePath;
+  bool isRecompileQueued;
+} hotReloadedShaders[] = {
+  { "grid.vs.hlsl", "vs_4_0", &gridVertexShader, nullptr },
+  { "grid.ps.hlsl", "ps_4_0", nullptr, &gridPixelShader },
+  { "cube.vs.hlsl", "vs_4_0", &cubeVertexShader, nullptr },
+  { "cube.ps.hlsl", "ps_4_0", nullptr, &cubePixelShader }
+};
 
-static void* loadShaderFile(const char* fileName, SIZE_T* shaderSize)
+static CComPtr<ID3DBlob> compileShader(const std::wstring& sourcePath, const char* target)
 {
-  HANDLE file = CreateFileA(fileName, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
-  if(file == INVALID_HANDLE_VALUE) {
-    logError("Failed to load shader file %s", fileName);
+  CComPtr<ID3DBlob> bytecode;
+  CComPtr<ID3DBlob> errors;
+  const HRESULT result = D3DCompileFromFile(
+    sourcePath.c_str(),
+    nullptr,
+    D3D_COMPILE_STANDARD_FILE_INCLUDE,
+    "main",
+    target,
+    D3DCOMPILE_DEBUG | D3DCOMPILE_ENABLE_STRICTNESS,
+    0,
+    &bytecode,
+    &errors
+  );
+  if(FAILED(result)) {
+    logError("Failed to compile %ls:\n%s", sourcePath.c_str(), errors ? static_cast<const char*>(errors->GetBufferPointer()) : "");
     return nullptr;
   }
-  LARGE_INTEGER fileSize;
-  if(!GetFileSizeEx(file, &fileSize)) {
-    logError("Failed to get file size of shader file %s", fileName);
-    CloseHandle(file);
-    return nullptr;
+  return bytecode;
+}
+
+static void recompileShader(const char* sourcePath)
+{
+  std::lock_guard lock(hotReloadMutex);
+  const char* fileName = sourcePath + strlen(sourcePath);
+  while(fileName > sourcePath && fileName[-1] != '/' && fileName[-1] != '\\') {
+    --fileName;
   }
-  static byte shaderLoadBuffer[64 * 1024];
-  DWORD bytesRead;
-  if(!ReadFile(file, shaderLoadBuffer, (DWORD)fileSize.QuadPart, &bytesRead, nullptr)) {
-    logError("Failed to read shader file %s", fileName);
-    CloseHandle(file);
-    return nullptr;
+  for(HotReloadedShader& shader : hotReloadedShaders) {
+    if(_stricmp(shader.sourceFileName, fileName) != 0) {
+      continue;
+    }
+    const int pathLength = MultiByteToWideChar(CP_UTF8, 0, sourcePath, -1, nullptr, 0);
+    shader.sourcePath.assign(pathLength, L'\0');
+    MultiByteToWideChar(CP_UTF8, 0, sourcePath, -1, shader.sourcePath.data(), pathLength);
+    shader.sourcePath.pop_back();
+    // Replacing a pending future would block until its compilation finished.
+    if(shader.bytecode.valid()) {
+      shader.isRecompileQueued = true;
+    } else {
+      shader.bytecode = std::async(std::launch::async, compileShader, shader.sourcePath, shader.target);
+    }
+    return;
   }
-  *shaderSize = bytesRead;
-  CloseHandle(file);
-  return shaderLoadBuffer;
+}
+
+static void swapRecompiledShaders()
+{
+  std::lock_guard lock(hotReloadMutex);
+  for(HotReloadedShader& shader : hotReloadedShaders) {
+    if(!shader.bytecode.valid() || shader.bytecode.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+      continue;
+    }
+    const CComPtr<ID3DBlob> bytecode = shader.bytecode.get();
+    if(shader.isRecompileQueued) {
+      shader.isRecompileQueued = false;
+      shader.bytecode = std::async(std::launch::async, compileShader, shader.sourcePath, shader.target);
+    }
+    if(!bytecode) {
+      continue;
+    }
+    HRESULT result;
+    if(shader.vertexShader) {
+      CComPtr<ID3D11VertexShader> vertexShader;
+      result = device->CreateVertexShader(bytecode->GetBufferPointer(), bytecode->GetBufferSize(), nullptr, &vertexShader);
+      if(SUCCEEDED(result)) {
+        *shader.vertexShader = vertexShader;
+      }
+    } else {
+      CComPtr<ID3D11PixelShader> pixelShader;
+      result = device->CreatePixelShader(bytecode->GetBufferPointer(), bytecode->GetBufferSize(), nullptr, &pixelShader);
+      if(SUCCEEDED(result)) {
+        *shader.pixelShader = pixelShader;
+      }
+    }
+    if(FAILED(result)) {
+      logError("Failed to create the recompiled shader %s.", shader.sourceFileName);
+    } else {
+      logInfo("Reloaded %s.", shader.sourceFileName);
+    }
+  }
+}
+#endif
+
+static bool loadShaderFile(const char* fileName, De::LoadedFile* shaderFile)
+{
+  for(size_t i = 0; i < arrayCount(shaderFileNames); ++i) {
+    if(strcmp(shaderFileNames[i], fileName) == 0 && shaderFileLoads[i].valid()) {
+      try {
+        *shaderFile = shaderFileLoads[i].get();
+        return true;
+      } catch(const De::Exception&) {
+        // Logged by the loader.
+        return false;
+      }
+    }
+  }
+  logError("Shader file %s wasn't requested.", fileName);
+  return false;
 }
 
 static ID3D11VertexShader* loadVertexShader(const char* shaderName, D3D11_INPUT_ELEMENT_DESC* inputElementDescs, UINT inputElementDescCount, ID3D11InputLayout** inputLayout)
 {
   char shaderFileName[128];
   _snprintf_s(shaderFileName, sizeof(shaderFileName), "%s.vs.cso", shaderName);
-  SIZE_T shaderCodeSize;
-  void* shaderCode = loadShaderFile(shaderFileName, &shaderCodeSize);
-  if(!shaderCode) {
+  De::LoadedFile shaderFile;
+  if(!loadShaderFile(shaderFileName, &shaderFile)) {
     return nullptr;
   }
   ID3D11VertexShader* vertexShader;
-  if(SUCCEEDED(device->CreateVertexShader(shaderCode, shaderCodeSize, nullptr, &vertexShader))) {
-    if(SUCCEEDED(device->CreateInputLayout(inputElementDescs, inputElementDescCount, shaderCode, shaderCodeSize, inputLayout))) {
+  if(SUCCEEDED(device->CreateVertexShader(shaderFile.getData(), shaderFile.getSize(), nullptr, &vertexShader))) {
+    if(SUCCEEDED(device->CreateInputLayout(inputElementDescs, inputElementDescCount, shaderFile.getData(), shaderFile.getSize(), inputLayout))) {
       return vertexShader;
     }
   } else {
@@ -234,11 +275,16 @@ static ID3D11PixelShader* loadPixelShader(const char* name)
 {
   char shaderFileName[128];
   _snprintf_s(shaderFileName, sizeof(shaderFileName), "%s.ps.cso", name);
-  SIZE_T shaderCodeSize;
-  void* shaderCode = loadShaderFile(shaderFileName, &shaderCodeSize);
-  ID3D11PixelShader* vertexShader;
-  device->CreatePixelShader(shaderCode, shaderCodeSize, nullptr, &vertexShader);
-  return vertexShader;
+  De::LoadedFile shaderFile;
+  if(!loadShaderFile(shaderFileName, &shaderFile)) {
+    return nullptr;
+  }
+  ID3D11PixelShader* pixelShader;
+  if(FAILED(device->CreatePixelShader(shaderFile.getData(), shaderFile.getSize(), nullptr, &pixelShader))) {
+    logError("Failed to create pixel shader %s", name);
+    return nullptr;
+  }
+  return pixelShader;
 }
 
 static void setViewport(FLOAT width, FLOAT height)
@@ -256,14 +302,6 @@ static void setViewport(FLOAT width, FLOAT height)
 static void updateViewport()
 {
   setViewport((FLOAT)renderTargetDesc.Width, (FLOAT)renderTargetDesc.Height);
-
-  float aspectRatio = (float)renderTargetDesc.Width / renderTargetDesc.Height;
-  projectionMatrix = Mat4f::perspectiveProjectionD3d(
-    degreesToRadians(verticalFieldOfView), 
-    aspectRatio, 
-    nearPlane, 
-    farPlane
-  );
 }
 
 static CComPtr<ID3D11Texture2D> createRenderTarget()
@@ -352,8 +390,10 @@ static bool bindD2dTargetToD3dTarget()
 
 } // anonymous namespace
 
-D3D11Renderer::D3D11Renderer(HWND window)
+D3D11Renderer::D3D11Renderer(HWND window, De::AssetLoader& assetLoader)
 {
+  assetLoader.readBatch(shaderFileNames, arrayCount(shaderFileNames), shaderFileLoads);
+
   // DEVICE
   UINT createDeviceFlags = D3D11_CREATE_DEVICE_BGRA_SUPPORT;
   #ifdef DAR_DEBUG
@@ -455,68 +495,85 @@ D3D11Renderer::D3D11Renderer(HWND window)
   context->OMSetRenderTargets(1, &renderTargetView.p, depthStencilView);
 
   updateViewport();
+  clientAreaSize = { (int)swapChainDesc.Width, (int)swapChainDesc.Height };
 
   // Cube
-  Vec3f cubeVertices[] = {
-    { -0.5f, -0.5f, -0.5f },
-    {  0.5f, -0.5f, -0.5f },
-    {  0.5f, -0.5f,  0.5f },
-    { -0.5f, -0.5f,  0.5f },
-    { -0.5f,  0.5f, -0.5f },
-    {  0.5f,  0.5f, -0.5f },
-    {  0.5f,  0.5f,  0.5f },
-    { -0.5f,  0.5f,  0.5f }
-  };
+  // Updated a chunk at a time with UpdateSubresource, WRITE_DISCARD would need the whole buffer rewritten.
   D3D11_BUFFER_DESC cubeVertexBufferDesc
   {
-    sizeof(cubeVertices),
-    D3D11_USAGE_IMMUTABLE,
+    UINT(cubeChunkCount * maxCubeChunkVertexCount * sizeof(CubeMesher::Vertex)),
+    D3D11_USAGE_DEFAULT,
     D3D11_BIND_VERTEX_BUFFER
   };
-  D3D11_SUBRESOURCE_DATA cubeVBData {cubeVertices, 0, 0};
-  if(FAILED(device->CreateBuffer(&cubeVertexBufferDesc, &cubeVBData, &cubeVertexBuffer))) {
-    throw D3D11Renderer::InitializeException("Failed to create cube vertex buffer.");
+  D3D11_BUFFER_DESC cubeIndexBufferDesc
+  {
+    UINT(cubeChunkCount * maxCubeChunkIndexCount * sizeof(uint32_t)),
+    D3D11_USAGE_DEFAULT,
+    D3D11_BIND_INDEX_BUFFER
+  };
+  Mesh& cubes = meshes[RenderMesh::Cubes];
+  if(FAILED(device->CreateBuffer(&cubeVertexBufferDesc, nullptr, &cubes.vertexBuffer)) ||
+    FAILED(device->CreateBuffer(&cubeIndexBufferDesc, nullptr, &cubes.indexBuffer))) {
+    throw D3D11Renderer::InitializeException("Failed to create cube mesh buffers.");
+  }
+  cubes.vertexStride = sizeof(CubeMesher::Vertex);
+
+  // The cubes of the tetracube are indexed alike, only their vertices change.
+  std::vector<CubeMesher::Vertex> tetracubeVertices;
+  std::vector<uint32_t> tetracubeIndices;
+  for(int i = 0; i < tetracubeCubeCount; ++i) {
+    CubeMesher::appendCube({}, 0, tetracubeVertices, tetracubeIndices);
   }
-  D3D11_BUFFER_DESC cubeInstanceBufferDesc
+  D3D11_BUFFER_DESC tetracubeVertexBufferDesc
   {
-    sizeof(cubeInstanceData),
+    UINT(tetracubeVertices.size() * sizeof(CubeMesher::Vertex)),
     D3D11_USAGE_DYNAMIC,
     D3D11_BIND_VERTEX_BUFFER,
     D3D11_CPU_ACCESS_WRITE
   };
-  if(FAILED(device->CreateBuffer(&cubeInstanceBufferDesc, nullptr, &cubeInstanceBuffer))) {
-    throw D3D11Renderer::InitializeException("Failed to create cube instance buffer.");
-  }
-  short cubeIndices[] = { 
-    0,4,5, 0,5,1, // front
-    1,5,6, 1,6,2, // right
-    2,6,7, 2,7,3, // back
-    3,7,4, 3,4,0, // left
-    4,7,6, 4,6,5, // top
-    3,0,1, 3,1,2  // bottom
-  };
-  D3D11_BUFFER_DESC cubeIBDesc
+  D3D11_BUFFER_DESC tetracubeIndexBufferDesc
   {
-    sizeof(cubeIndices),
+    UINT(tetracubeIndices.size() * sizeof(uint32_t)),
     D3D11_USAGE_IMMUTABLE,
     D3D11_BIND_INDEX_BUFFER
   };
-  D3D11_SUBRESOURCE_DATA cubeIBData{cubeIndices, 0, 0};
-  if(FAILED(device->CreateBuffer(&cubeIBDesc, &cubeIBData, &cubeIndexBuffer))) {
-    throw D3D11Renderer::InitializeException("Failed to create cube index buffer.");
+  D3D11_SUBRESOURCE_DATA tetracubeIndexData{ tetracubeIndices.data(), 0, 0 };
+  Mesh& tetracube = meshes[RenderMesh::Tetracube];
+  if(FAILED(device->CreateBuffer(&tetracubeVertexBufferDesc, nullptr, &tetracube.vertexBuffer)) ||
+    FAILED(device->CreateBuffer(&tetracubeIndexBufferDesc, &tetracubeIndexData, &tetracube.indexBuffer))) {
+    throw D3D11Renderer::InitializeException("Failed to create tetracube buffers.");
+  }
+  tetracube.vertexStride = sizeof(CubeMesher::Vertex);
+  tetracube.isDynamic = true;
+
+  D3D11_BUFFER_DESC constantBufferDesc
+  {
+    maxConstantsSize,
+    D3D11_USAGE_DYNAMIC,
+    D3D11_BIND_CONSTANT_BUFFER,
+    D3D11_CPU_ACCESS_WRITE
+  };
+  if(FAILED(device->CreateBuffer(&constantBufferDesc, nullptr, &constantBuffer))) {
+    throw D3D11Renderer::InitializeException("Failed to create constant buffer.");
+  }
+  D3D11_BUFFER_DESC cubePaletteDesc
+  {
+    sizeof(CubePalette),
+    D3D11_USAGE_DEFAULT,
+    D3D11_BIND_CONSTANT_BUFFER
+  };
+  if(FAILED(device->CreateBuffer(&cubePaletteDesc, nullptr, &cubePaletteBuffer))) {
+    throw D3D11Renderer::InitializeException("Failed to create cube palette buffer.");
   }
   D3D11_INPUT_ELEMENT_DESC cubeInputElementDescs[] = {
-    {"POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0},
-    {"INSTANCE_TRANSFORM", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 0, D3D11_INPUT_PER_INSTANCE_DATA, 1},
-    {"INSTANCE_TRANSFORM", 1, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1},
-    {"INSTANCE_TRANSFORM", 2, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1},
-    {"INSTANCE_TRANSFORM", 3, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1},
-    {"INSTANCE_COLOR", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1}
+    {"POSITION", 0, DXGI_FORMAT_R8G8B8A8_SINT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0}
   };
   cubeVertexShader = loadVertexShader("cube", cubeInputElementDescs, arrayCount(cubeInputElementDescs), &cubeInputLayout);
   cubePixelShader = loadPixelShader("cube");
+  // The palette buffer is empty, the first frame fills it.
+  isCubePaletteValid = false;
 
-  initializeGrid();
+  initializeGrids();
 
   device->CreateRasterizerState(&rasterizerDesc, &rasterizerState);
   context->RSSetState(rasterizerState);
@@ -534,6 +591,7 @@ D3D11Renderer::D3D11Renderer(HWND window)
 
 void D3D11Renderer::onWindowResize(int clientAreaWidth, int clientAreaHeight)
 {
+  clientAreaSize = { clientAreaWidth, clientAreaHeight };
   if(swapChain) {
     d2Context->SetTarget(nullptr);  // Clears the binding to swapChain's back buffer.
     depthStencilView.Release();
@@ -592,65 +650,166 @@ static void resolveRenderTargetIntoBackBuffer()
   }
 }
 
-static void renderCubes(
-  const PlayingSpace& playingSpace, 
-  const Mat4f& viewProjection, 
-  const CubeClass* cubeClasses,
-  const Tetracube& currentTetracube
-)
+/**
+ * @brief Uploads the colors of the cube classes when the game hands over other ones, e.g. after a reload.
+ */
+static void updateCubePalette(const ColorRgbaf (&cubeClassColors)[maxCubeClassCount])
 {
-  constexpr Vec3f cubePositionOffset = { 0.5f, 0.5f, 0.5f };
-  Mat4f baseTransform = Mat4x3f::translation(cubePositionOffset) * viewProjection;
-
-  context->VSSetShader(cubeVertexShader, nullptr, 0);
-  context->PSSetShader(cubePixelShader, nullptr, 0);
-  context->IASetInputLayout(cubeInputLayout);
-  ID3D11Buffer* const vertexBuffers[] = {cubeVertexBuffer.p, cubeInstanceBuffer.p};
-  constexpr UINT cubeVertexBufferStrides[] = { sizeof(Vec3f), sizeof(CubeInstanceData) };
-  constexpr UINT cubeVertexBufferOffsets[] = {0, 0};
-  context->IASetVertexBuffers(0, arrayCount(vertexBuffers), vertexBuffers, cubeVertexBufferStrides, cubeVertexBufferOffsets);
-  context->IASetIndexBuffer(cubeIndexBuffer, DXGI_FORMAT_R16_UINT, 0);
-  context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-
-  D3D11_MAPPED_SUBRESOURCE mappedResource;
-
-  Vec3i size = playingSpace.getSize();
-  int instanceCount = 0;
-  for(int y = 0; y < size.y; ++y) {
-    for(int z = 0; z < size.z; ++z) {
-      for(int x = 0; x < size.x; ++x) {
-        PlayingSpace::ValueType cubeClassIndex = playingSpace.at(x, y, z);
-        if(cubeClassIndex >= 0) {
-          cubeInstanceData[instanceCount].transform = Mat4f::translation((float)x, (float)y, (float)z) * baseTransform;
-          cubeInstanceData[instanceCount].color = cubeClasses[cubeClassIndex].color;
-          ++instanceCount;
-        }
+  if(isCubePaletteValid && memcmp(uploadedCubePalette.cubeClassColors, cubeClassColors, sizeof(cubeClassColors)) == 0) {
+    return;
+  }
+  memcpy(uploadedCubePalette.cubeClassColors, cubeClassColors, sizeof(cubeClassColors));
+  context->UpdateSubresource(cubePaletteBuffer, 0, nullptr, &uploadedCubePalette, 0, 0);
+  isCubePaletteValid = true;
+}
+
+static void applyMeshUpdates(const De::RenderQueue& queue)
+{
+  DAR_PROFILE_SCOPE("applyMeshUpdates");
+  for(int i = 0; i < queue.getMeshUpdateCount(); ++i) {
+    const De::MeshUpdate& update = queue.getMeshUpdates()[i];
+    const Mesh& mesh = meshes[update.mesh];
+    if(mesh.isDynamic) {
+      // The whole buffer is discarded, a dynamic mesh is rewritten from its first vertex.
+      assert(update.firstVertex == 0 && update.indexCount == 0);
+      D3D11_MAPPED_SUBRESOURCE mappedResource;
+      if(SUCCEEDED(context->Map(mesh.vertexBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource))) {
+        memcpy(mappedResource.pData, update.vertices, update.vertexCount * mesh.vertexStride);
+        context->Unmap(mesh.vertexBuffer, 0);
       }
+      continue;
+    }
+    // Updated a range at a time with UpdateSubresource, WRITE_DISCARD would need the whole buffer rewritten.
+    if(update.vertexCount > 0) {
+      const UINT begin = update.firstVertex * mesh.vertexStride;
+      const D3D11_BOX box{ begin, 0, 0, begin + update.vertexCount * mesh.vertexStride, 1, 1 };
+      context->UpdateSubresource(mesh.vertexBuffer, 0, &box, update.vertices, 0, 0);
+    }
+    if(update.indexCount > 0) {
+      const UINT begin = UINT(update.firstIndex * sizeof(uint32_t));
+      const D3D11_BOX box{ begin, 0, 0, UINT(begin + update.indexCount * sizeof(uint32_t)), 1, 1 };
+      context->UpdateSubresource(mesh.indexBuffer, 0, &box, update.indices, 0, 0);
+    }
+  }
+}
+
+static void bindPipeline(RenderPipeline::Type pipeline)
+{
+  switch(pipeline) {
+    case RenderPipeline::Cube: {
+      context->VSSetShader(cubeVertexShader, nullptr, 0);
+      context->PSSetShader(cubePixelShader, nullptr, 0);
+      context->IASetInputLayout(cubeInputLayout);
+      ID3D11Buffer* const constantBuffers[] = { constantBuffer.p, cubePaletteBuffer.p };
+      context->VSSetConstantBuffers(0, arrayCount(constantBuffers), constantBuffers);
+      context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
     }
+    break;
+    case RenderPipeline::Grid:
+      context->VSSetShader(gridVertexShader, nullptr, 0);
+      context->PSSetShader(gridPixelShader, nullptr, 0);
+      context->IASetInputLayout(gridInputLayout);
+      context->VSSetConstantBuffers(0, 1, &constantBuffer.p);
+      context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_LINELIST);
+    break;
+    default:
+      assert(!"Unknown render pipeline.");
+    break;
   }
+}
 
-  for(const Vec3i& position : currentTetracube.positions) {
-    cubeInstanceData[instanceCount].transform = Mat4x3f::translation(toVec3f(position + currentTetracube.translation)) * baseTransform;
-    cubeInstanceData[instanceCount].color = cubeClasses[currentTetracube.cubeClassIndex].color;
-    ++instanceCount;
+static void bindMesh(const Mesh& mesh)
+{
+  constexpr UINT vertexBufferOffset = 0;
+  context->IASetVertexBuffers(0, 1, &mesh.vertexBuffer.p, &mesh.vertexStride, &vertexBufferOffset);
+  if(mesh.indexBuffer) {
+    context->IASetIndexBuffer(mesh.indexBuffer, DXGI_FORMAT_R32_UINT, 0);
   }
+}
 
-  context->Map(cubeInstanceBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource);
-  memcpy(mappedResource.pData, &cubeInstanceData, sizeof(cubeInstanceData));
-  context->Unmap(cubeInstanceBuffer, 0);
+struct CommandStatistics
+{
+  int commandCount;
+  int pipelineChangeCount;
+  int meshChangeCount;
+  int constantsUploadCount;
+};
 
-  context->DrawIndexedInstanced(36, instanceCount, 0, 0, 0);
+/**
+ * @brief Draws the sorted commands, state is only set when it differs from the previous command.
+ */
+static CommandStatistics executeCommands(const De::RenderQueue& queue)
+{
+  DAR_PROFILE_SCOPE("executeCommands");
+  CommandStatistics statistics = { queue.getCommandCount(), 0, 0, 0 };
+  int boundPipeline = -1;
+  int boundMesh = -1;
+  const void* boundConstants = nullptr;
+  for(const De::RenderCommand& command : queue) {
+    if(command.pipeline != boundPipeline) {
+      bindPipeline(RenderPipeline::Type(command.pipeline));
+      boundPipeline = command.pipeline;
+      ++statistics.pipelineChangeCount;
+    }
+    if(command.mesh != boundMesh) {
+      bindMesh(meshes[command.mesh]);
+      boundMesh = command.mesh;
+      ++statistics.meshChangeCount;
+    }
+    if(command.constants != boundConstants) {
+      assert(command.constantsSize <= maxConstantsSize);
+      D3D11_MAPPED_SUBRESOURCE mappedResource;
+      if(SUCCEEDED(context->Map(constantBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource))) {
+        memcpy(mappedResource.pData, command.constants, command.constantsSize);
+        context->Unmap(constantBuffer, 0);
+      }
+      boundConstants = command.constants;
+      ++statistics.constantsUploadCount;
+    }
+    if(meshes[command.mesh].indexBuffer) {
+      context->DrawIndexed(command.elementCount, command.firstElement, command.baseVertex);
+    } else {
+      context->Draw(command.elementCount, command.firstElement);
+    }
+  }
+  return statistics;
+}
+
+#ifdef DAR_DEBUG
+void D3D11Renderer::watchShaderSources(De::FileWatcher& fileWatcher)
+{
+  fileWatcher.subscribe(DAR_SHADER_SOURCE_DIRECTORY, ".hlsl", recompileShader);
 }
+#endif
 
-void D3D11Renderer::render(const GameState& gameState)
+void D3D11Renderer::render(const RenderFrame& frame)
 {
+  if(frame.clientAreaWidth != clientAreaSize.x || frame.clientAreaHeight != clientAreaSize.y) {
+    onWindowResize(frame.clientAreaWidth, frame.clientAreaHeight);
+  }
+
   d2Context->BeginDraw();
 
   #ifdef DAR_DEBUG
-    if(gameState.input.keyboard.F1.pressedDown) {
+    swapRecompiledShaders();
+
+    if(frame.switchWireframe) {
       switchWireframeState();
     }
+  #endif
+
+  const float clearColor[4] = { frame.clearColor.r, frame.clearColor.g, frame.clearColor.b, frame.clearColor.a };
+  context->ClearRenderTargetView(renderTargetView, clearColor);
+  context->ClearDepthStencilView(depthStencilView, D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, 1.0f, 0);
+
+  applyMeshUpdates(frame.queue);
+  updateCubePalette(frame.cubeClassColors);
+  // Shown in the debug text.
+  [[maybe_unused]] const CommandStatistics statistics = executeCommands(frame.queue);
 
+  resolveRenderTargetIntoBackBuffer();
+
+  #ifdef DAR_DEBUG
     DXGI_QUERY_VIDEO_MEMORY_INFO videoMemoryInfo{};
     UINT64 videoMemoryUsageMB = 0;
     if(SUCCEEDED(dxgiAdapter->QueryVideoMemoryInfo(
@@ -663,36 +822,45 @@ void D3D11Renderer::render(const GameState& gameState)
       logError("Failed to query video memory info.");
     }
     UINT64 videoMemoryTotalMB = dxgiAdapterDesc.DedicatedVideoMemory / (1ull << 20ull);
-    debugText(L"VRAM %llu MB / %llu MB", videoMemoryUsageMB, videoMemoryTotalMB); 
-  #endif
-
-  context->ClearRenderTargetView(renderTargetView, clearColor);
-  context->ClearDepthStencilView(depthStencilView, D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, 1.0f, 0);
-
-  Mat4x3f viewMatrix = gameState.camera.calculateView({GameState::gridSize.x / 2.f, GameState::gridSize.y / 2.f, GameState::gridSize.z / 2.f });
-  Mat4f viewProjection = viewMatrix * projectionMatrix;
-
-  renderCubes(gameState.playingSpace, viewProjection, gameState.cubeClasses, gameState.currentTetracube);
 
-  renderGrids(viewProjection);
-
-  resolveRenderTargetIntoBackBuffer();
-
-  #ifdef DAR_DEBUG
     // DEBUG TEXT
+    // The global text belongs to the main thread, which is already writing the next frame. The lines of the renderer
+    // follow the copy in the frame.
+    static wchar_t debugTextBuffer[arrayCount(_debugText) + 256];
+    int debugTextLength = std::min(frame.debugTextLength, (int)arrayCount(_debugText));
+    std::copy_n(frame.debugText, debugTextLength, debugTextBuffer);
+    const int rendererTextLength = _snwprintf_s(
+      debugTextBuffer + debugTextLength,
+      arrayCount(debugTextBuffer) - debugTextLength,
+      _TRUNCATE,
+      L"VRAM %llu MB / %llu MB\nCommands %d, pipeline changes %d, mesh changes %d, constant uploads %d\n",
+      videoMemoryUsageMB,
+      videoMemoryTotalMB,
+      statistics.commandCount,
+      statistics.pipelineChangeCount,
+      statistics.meshChangeCount,
+      statistics.constantsUploadCount
+    );
+    if(rendererTextLength > 0) {
+      debugTextLength += rendererTextLength;
+    }
     CComPtr<IDWriteTextLayout> debugTextLayout;
     dwriteFactory->CreateTextLayout(
-      _debugText, 
-      _debugTextLength, 
+      debugTextBuffer, 
+      debugTextLength, 
       debugTextFormat, 
-      (FLOAT)gameState.clientAreaWidth, 
-      (FLOAT)gameState.clientAreaHeight, 
+      (FLOAT)frame.clientAreaWidth, 
+      (FLOAT)frame.clientAreaHeight, 
       &debugTextLayout
     );
     d2Context->DrawTextLayout({5.f, 5.f}, debugTextLayout, debugTextBrush);
   #endif
 
   d2Context->EndDraw();
+}
+
+void D3D11Renderer::present()
+{
   UINT presentFlags = 0;
   swapChain->Present(1, presentFlags);
 }
@@ -2,20 +2,43 @@
 #define WIN32_LEAN_AND_MEAN
 #include <windows.h>
 
+#include <AssetLoader.hpp>
 #include <Exception.hpp>
+#include <FileWatcher.hpp>
 
-#include "GameState.hpp"
+#include "RenderFrame.hpp"
 
+/**
+ * @brief Draws the render frames of the game. After it was created, it has to be used from one thread only,
+ * e.g. the RenderThread.
+ */
 class D3D11Renderer {
 public:
   DECLARE_AND_DEFINE_SIMPLE_EXCEPTION(InitializeException)
   DECLARE_AND_DEFINE_SIMPLE_EXCEPTION(Exception)
 
-  explicit D3D11Renderer(HWND window);
+  /**
+   * @brief Starts reading the shader files with assetLoader while the device is created.
+   */
+  D3D11Renderer(HWND window, De::AssetLoader& assetLoader);
   D3D11Renderer(const D3D11Renderer& other) = delete;
   D3D11Renderer(const D3D11Renderer&& other) = delete;
   ~D3D11Renderer() = default;
 
+#ifdef DAR_DEBUG
+  /**
+   * @brief Recompiles the HLSL sources in DAR_SHADER_SOURCE_DIRECTORY in the background when they change.
+   * The new shaders replace the old ones at the start of the next render, the old ones stay if compilation fails.
+   */
+  void watchShaderSources(De::FileWatcher& fileWatcher);
+#endif
+  /**
+   * @brief Called by render when the client area of the frame differs from the last one.
+   */
   void onWindowResize(int clientAreaWidth, int clientAreaHeight);
-  void render(const GameState& gameState);
+  /**
+   * @brief Applies the mesh updates of the frame, then executes its commands in order.
+   */
+  void render(const RenderFrame& frame);
+  void present();
 };
@@ -5,359 +5,49 @@
 #include <cstdlib>
 #include <ctime>
 
-static constexpr Vec3i tetracubePositions[][4] = {
-  {{-1, 0, 0}, { 0, 0, 0}, { 1, 0, 0}, {2, 0, 0}}, // I
-  {{ 0, 0, 0}, { 1, 0, 0}, { 0, 0, 1}, {1, 0, 1}}, // O
-  {{ 0, 0, 0}, {-1, 0, 1}, { 0, 0, 1}, {1, 0, 1}}, // T
-  {{-1, 0, 0}, {-1, 0, 1}, { 0, 0, 1}, {1, 0, 1}}, // L
-  {{ 1, 0, 0}, {-1, 0, 1}, { 0, 0, 1}, {1, 0, 1}}, // J
-  {{-1, 0, 0}, { 0, 0, 0}, { 0, 0, 1}, {1, 0, 1}}, // S
-  {{ 0, 0, 0}, { 1, 0, 0}, {-1, 0, 1}, {0, 0, 1}}, // Z
-  {{ 0, 0, 0}, { 0, 0, 1}, { 1, 0, 1}, {0, 1, 1}}, // B
-  {{ 0, 0, 0}, { 0, 0, 1}, { 1, 0, 1}, {0, 1, 0}}, // D
-  {{ 0, 0, 0}, { 0, 0, 1}, { 1, 0, 1}, {1, 1, 1}}  // F
-};
-static constexpr Vec3i tetracubeOrigin = {1, 0, 0};
-static const CubeClass cubeClasses[] = {
-  {ColorRgbaf{  0.f,   1.f,   1.f, 1.f}},
-  {ColorRgbaf{  1.f,   1.f,   0.f, 1.f}},
-  {ColorRgbaf{  1.f,   0.f,   1.f, 1.f}},
-  {ColorRgbaf{  1.f,  0.5f,   0.f, 1.f}},
-  {ColorRgbaf{  0.f,   0.f,   1.f, 1.f}},
-  {ColorRgbaf{  0.f,   1.f,   0.f, 1.f}},
-  {ColorRgbaf{  1.f,   0.f,   0.f, 1.f}},
-  {ColorRgbaf{ 0.5f, 0.19f,   0.f, 1.f}},
-  {ColorRgbaf{0.25f, 0.25f, 0.25f, 1.f}},
-  {ColorRgbaf{0.77f, 0.77f, 0.77f, 1.f}}
-};
-struct TetracubeTransformation
-{
-  Vec3i movement[4];
-  Mat3f rotation[6];
-};
-static const TetracubeTransformation tetracubeTransformationsByQuadrant[4] = {
-  {{{ 1, 0, 0 }, { -1, 0, 0 }, { 0, 0, 1 }, { 0, 0, -1 }}, // left, right, down, up
-  {
-    Mat3f::rotationZ(-Pi / 2.f), // q
-    Mat3f::rotationX(-Pi / 2.f), // w
-    Mat3f::rotationZ( Pi / 2.f), // e
-    Mat3f::rotationY(-Pi / 2.f), // a
-    Mat3f::rotationX( Pi / 2.f), // s
-    Mat3f::rotationY( Pi / 2.f)  // d
-  }},
-  {{{ 0, 0, -1 }, { 0, 0, 1 }, { 1, 0, 0 }, { -1, 0, 0 }},
-  {
-    Mat3f::rotationX(-Pi / 2.f),
-    Mat3f::rotationZ( Pi / 2.f),
-    Mat3f::rotationX( Pi / 2.f),
-    Mat3f::rotationY(-Pi / 2.f),
-    Mat3f::rotationZ(-Pi / 2.f),
-    Mat3f::rotationY( Pi / 2.f)
-  }},
-  {{{ -1, 0, 0 }, { 1, 0, 0 }, { 0, 0, -1 }, { 0, 0, 1 }},
-  {
-    Mat3f::rotationZ( Pi / 2.f),
-    Mat3f::rotationX( Pi / 2.f),
-    Mat3f::rotationZ(-Pi / 2.f),
-    Mat3f::rotationY(-Pi / 2.f),
-    Mat3f::rotationX(-Pi / 2.f),
-    Mat3f::rotationY( Pi / 2.f)
-  }},
-  {{{ 0, 0, 1 }, { 0, 0, -1 }, { -1, 0, 0 }, { 1, 0, 0 }},
-  {
-    Mat3f::rotationX( Pi / 2.f),
-    Mat3f::rotationZ(-Pi / 2.f),
-    Mat3f::rotationX(-Pi / 2.f),
-    Mat3f::rotationY(-Pi / 2.f),
-    Mat3f::rotationZ( Pi / 2.f),
-    Mat3f::rotationY( Pi / 2.f)
-  }}
+#include "Profiler.hpp"
+
+static const GameModule::HostServices hostServices = {
+  []() { return &De::Log::detail::getThreadBuffer(); },
+  [](De::Log::detail::ThreadBuffer& buffer, uint32_t recordSize) { return De::Log::detail::beginRecord(buffer, recordSize); },
+  []() { De::Log::flush(); },
+
+  &De::Profiler::detail::captureId,
+  // The names point into the module, which is gone after a reload while the capture still holds them.
+  [](const char* name, uint64_t begin, uint64_t end, uint32_t captureId) {
+    De::Profiler::detail::record(De::Profiler::internName(name), begin, end, captureId);
+  },
+
+  // The host's global allocation functions count the module's allocations under the subsystem of the update.
+  [](size_t size) { return ::operator new(size); },
+  [](size_t size, std::align_val_t alignment) { return ::operator new(size, alignment); },
+  [](void* memory) { ::operator delete(memory); },
+  [](void* memory, std::align_val_t alignment) { ::operator delete(memory, alignment); },
+  [](De::LinearArena& arena, size_t size, size_t alignment) { return arena.allocate(size, alignment); }
 };
 
 Game::Game()
+  : module(GameModule::fileName, [this](De::Library& library) {
+      updateFunction = reinterpret_cast<GameModule::UpdateFunction>(library.loadFunction(GameModule::updateFunctionName));
+    })
 {
+  // The module shares the C runtime, seeding it here keeps the random sequence going across reloads.
   std::srand((unsigned int)std::time(0));
 }
 
-static void updateCamera(const GameState& lastState, GameState* nextState)
-{
-  nextState->camera = lastState.camera;
-
-  if(lastState.input.mouse.right.isDown && nextState->input.mouse.right.isDown) {
-    int dX = nextState->input.cursorPosition.x - lastState.input.cursorPosition.x;
-    if(dX != 0) {
-      float normalizedDx = float(dX) / nextState->clientAreaWidth;
-      float dTheta = normalizedDx * 2 * Pi;
-      nextState->camera.rotateTheta(dTheta);
-    }
-
-    int dY = nextState->input.cursorPosition.y - lastState.input.cursorPosition.y;
-    if(dY != 0) {
-      float normalizedDy = float(dY) / nextState->clientAreaHeight;
-      float dPhi = -normalizedDy * 2 * Pi;
-      nextState->camera.rotatePhi(dPhi);
-    }
-  }
-
-  nextState->camera.zoom(nextState->input.mouse.dWheel);
-}
-static void updatePlayingSpace(const GameState& lastState, GameState* nextState)
+#ifdef DAR_DEBUG
+void Game::watchModule(De::FileWatcher& fileWatcher)
 {
-  nextState->playingSpace = lastState.playingSpace;
+  module.watch(fileWatcher);
 }
-static void spawnTetracube(Tetracube* tetracube)
-{
-  int tetracubeIndex = std::rand() % arrayCount(cubeClasses);
-  std::copy(
-    tetracubePositions[tetracubeIndex], tetracubePositions[tetracubeIndex] + 4,
-    tetracube->positions
-  );
-  Vec3i translationToCenter = {
-    (int)std::floor(GameState::gridSize.x / 2.f) - 2,
-    GameState::gridSize.y + 1,
-    (int)std::floor(GameState::gridSize.z / 2.f) - 1
-  };
-  tetracube->translation = tetracubeOrigin + translationToCenter;
 
-  tetracube->cubeClassIndex = (PlayingSpace::ValueType)tetracubeIndex;
-}
-static void tryToMoveTetracube(Tetracube* tetracube, const Vec3i& moveBy, const PlayingSpace& playingSpace)
+void Game::reloadModuleIfChanged()
 {
-  bool canMove = true;
-  for(const Vec3i& position : tetracube->positions) {
-    Vec3i movedBy = position + tetracube->translation + moveBy;
-    if(!playingSpace.isInside(movedBy.x, 0, movedBy.z) ||
-      (playingSpace.isInside(movedBy) && playingSpace.at(movedBy) >= 0)) {
-      canMove = false;
-      break;
-    }
-  }
-  if(canMove) {
-    tetracube->translation += moveBy;
-  }
-}
-static void tryToRotateTetracube(Tetracube* tetracube, const Mat3f& rotation, const PlayingSpace& playingSpace)
-{
-  bool canRotate = true;
-  Vec3i rotatedPositions[4];
-  for(int i = 0; i < 4; ++i) {
-    rotatedPositions[i] = toVec3iRounded(toVec3f(tetracube->positions[i]) * rotation);
-    const Vec3i translatedRotatedPosition = rotatedPositions[i] + tetracube->translation;
-    const bool isInside = playingSpace.isInside(translatedRotatedPosition);
-    if(isInside && playingSpace.at(translatedRotatedPosition) >= 0) {
-      canRotate = false;
-      break;
-    } else if(!playingSpace.isInside(
-      translatedRotatedPosition.x, 
-      std::min(0, translatedRotatedPosition.y)/*Ignore y above playing space*/, 
-      translatedRotatedPosition.z)) {
-      canRotate = false;
-      break;
-    }
-  }
-  if(canRotate) {
-    std::copy(rotatedPositions, rotatedPositions + arrayCount(rotatedPositions), tetracube->positions);
-  }
-}
-static bool canClearRow(const PlayingSpace& playingSpace, int rowToClear)
-{
-  for(int x = 0; x < GameState::gridSize.x; ++x) {
-    for(int z = 0; z < GameState::gridSize.z; ++z) {
-      if(playingSpace.at(x, rowToClear, z) == PlayingSpace::emptyValue) {
-        return false;
-      }
-    }
-  }
-  return true;
-}
-static void clearRow(PlayingSpace* playingSpace, int rowToClear) 
-{
-  for(int row = rowToClear; row < GameState::gridSize.y - 1; ++row) {
-    for(int x = 0; x < GameState::gridSize.x; ++x) {
-      for(int z = 0; z < GameState::gridSize.z; ++z) {
-        playingSpace->at(x, row, z) = playingSpace->at(x, row + 1, z);
-      }
-    }
-  }
-  for(int x = 0; x < GameState::gridSize.x; ++x) {
-    for(int z = 0; z < GameState::gridSize.z; ++z) {
-      playingSpace->at(x, GameState::gridSize.y - 1, z) = PlayingSpace::emptyValue;
-    }
-  }
-}
-static void checkForRowClear(GameState* state, int* rowsToCheck, int rowsToCheckCount)
-{
-  std::sort(rowsToCheck, rowsToCheck + rowsToCheckCount);
-  int rowsCleared = 0;
-  for(int i = 0; i < rowsToCheckCount; ++i) {
-    const int rowToClear = rowsToCheck[i] - rowsCleared;
-    if(canClearRow(state->playingSpace, rowToClear)) {
-      clearRow(&state->playingSpace, rowToClear);
-      ++rowsCleared;
-    }
-  }
-}
-static void checkForRowClear(GameState* state, const Tetracube& droppedTetracube)
-{
-  int rowsToCheck[arrayCount(droppedTetracube.positions)];
-  int rowsToCheckCount = 0;
-  for(const Vec3i& position : droppedTetracube.positions) {
-    int* rowsToCheckEnd = rowsToCheck + rowsToCheckCount;
-    const int row = position.y + droppedTetracube.translation.y;
-    const bool alreadyContaisRow = std::find(rowsToCheck, rowsToCheckEnd, row) != rowsToCheckEnd;
-    if(!alreadyContaisRow) {
-      rowsToCheck[rowsToCheckCount++] = row;
-    }
-  }
-  checkForRowClear(state, rowsToCheck, rowsToCheckCount);
-}
-static void updateCurrentTetracube(const GameState& lastState, GameState* nextState)
-{
-  nextState->currentTetracube = lastState.currentTetracube;
-
-  if(nextState->phase == GameState::Phase::Playing) {
-    nextState->currentTetracubeFallingSpeed = lastState.currentTetracubeFallingSpeed;
-    nextState->currentTetracubeDTimeLeftover = lastState.currentTetracubeDTimeLeftover + nextState->dTime;;
-
-    bool collisionHappened;
-    do {
-      collisionHappened = false;
-      const bool shouldSpawnTetracube = nextState->events.count(Event::TetracubeDropped) != 0 ||
-        lastState.events.count(Event::GameStarted) != 0;
-      if(shouldSpawnTetracube) {
-        spawnTetracube(&nextState->currentTetracube);
-      }
-      else {
-        Tetracube* currentTetracube = &nextState->currentTetracube;
-        const int cameraQuadrant = int((clampAngle(nextState->camera.getTheta() + Pi / 4.f)) / (Pi / 2.f));
-        const TetracubeTransformation& transformation = tetracubeTransformationsByQuadrant[cameraQuadrant];
-        if(nextState->input.keyboard.left.pressedDown) {
-          tryToMoveTetracube(currentTetracube, transformation.movement[0], nextState->playingSpace);
-        } else if(nextState->input.keyboard.right.pressedDown) {
-          tryToMoveTetracube(currentTetracube, transformation.movement[1], nextState->playingSpace);
-        } else if(nextState->input.keyboard.down.pressedDown) {
-          tryToMoveTetracube(currentTetracube, transformation.movement[2], nextState->playingSpace);
-        } else if(nextState->input.keyboard.up.pressedDown) {
-          tryToMoveTetracube(currentTetracube, transformation.movement[3], nextState->playingSpace);
-        }
-        if(nextState->input.keyboard.q.pressedDown) {
-          tryToRotateTetracube(currentTetracube, transformation.rotation[0], nextState->playingSpace);
-        } else if(nextState->input.keyboard.w.pressedDown) {
-          tryToRotateTetracube(currentTetracube, transformation.rotation[1], nextState->playingSpace);
-        } else if(nextState->input.keyboard.e.pressedDown) {
-          tryToRotateTetracube(currentTetracube, transformation.rotation[2], nextState->playingSpace);
-        } else if(nextState->input.keyboard.a.pressedDown) {
-          tryToRotateTetracube(currentTetracube, transformation.rotation[3], nextState->playingSpace);
-        } else if(nextState->input.keyboard.s.pressedDown) {
-          tryToRotateTetracube(currentTetracube, transformation.rotation[4], nextState->playingSpace);
-        } else if(nextState->input.keyboard.d.pressedDown) {
-          tryToRotateTetracube(currentTetracube, transformation.rotation[5], nextState->playingSpace);
-        }
-      }
-
-      Tetracube* currentTetracube = &nextState->currentTetracube;
-
-      assert(nextState->currentTetracubeFallingSpeed != 0.f);
-      float fallingSpeedInverse = 1.f / nextState->currentTetracubeFallingSpeed;
-      int toMove = int(nextState->currentTetracubeDTimeLeftover / fallingSpeedInverse);
-      if(toMove > 0) {
-        int moveBy;
-        for(moveBy = 1; moveBy <= toMove; ++moveBy) {
-          for(const Vec3i& position : currentTetracube->positions) {
-            Vec3i newPosition = position + currentTetracube->translation;
-            newPosition.y -= moveBy;
-            if(nextState->playingSpace.isInside(newPosition) &&
-              nextState->playingSpace.at(newPosition) >= 0 ||
-              newPosition.y == PlayingSpace::emptyValue) {
-              collisionHappened = true;
-              nextState->events.emplace(Event::TetracubeDropped, Event());
-              goto collisionCheckEnd;
-            }
-          }
-        }
-        collisionCheckEnd:
-        --moveBy;
-        currentTetracube->translation.y -= moveBy;
-        for(Vec3i& position : currentTetracube->positions) {
-          Vec3i translatedPosition = position + currentTetracube->translation;
-          if(collisionHappened) {
-            if(nextState->playingSpace.isInside(translatedPosition)) {
-              nextState->playingSpace.at(translatedPosition) = currentTetracube->cubeClassIndex;
-            } else {
-              nextState->events.emplace(Event::GameLost, Event());
-              logInfo("Lose condition triggered.");
-              return;
-            }
-          }
-        }
-        if(collisionHappened) {
-          checkForRowClear(nextState, *currentTetracube);
-        }
-        nextState->currentTetracubeDTimeLeftover -= moveBy * fallingSpeedInverse;
-        nextState->currentTetracubeDTimeLeftover = std::max(nextState->currentTetracubeDTimeLeftover, 0.f);
-      }
-    } while(collisionHappened);
-
-    if(nextState->input.keyboard.space.pressedDown) {
-      Tetracube* currentTetracube = &nextState->currentTetracube;
-      int toMove = 0;
-      while(true) {
-        for(const Vec3i& position : currentTetracube->positions) {
-          Vec3i nextPosition = position + currentTetracube->translation;
-          nextPosition.y = nextPosition.y - toMove - 1;
-          bool isBlockedByACube = (nextState->playingSpace.isInside(nextPosition) && nextState->playingSpace.at(nextPosition) >= 0);
-          if(nextPosition.y < 0 || isBlockedByACube) {
-            goto dropDistanceCalculationEnd;
-          }
-        }
-        ++toMove;
-      }
-      dropDistanceCalculationEnd:
-      currentTetracube->translation.y -= toMove;
-
-      bool loseConditionTriggered = false;
-      for(const Vec3i& position : currentTetracube->positions) {
-        Vec3i translatedPosition = position + currentTetracube->translation;
-        if(!nextState->playingSpace.isInside(translatedPosition)) {
-          loseConditionTriggered = true;
-        }
-      }
-
-      nextState->events.emplace(Event::TetracubeDropped, Event());
-      if(loseConditionTriggered) {
-        logInfo("Lose condition triggered.");
-        nextState->events.emplace(Event::GameLost, Event());
-        return;
-      } else {
-        for(const Vec3i& position : currentTetracube->positions) {
-          Vec3i translatedPosition = position + currentTetracube->translation;
-          nextState->playingSpace.at(translatedPosition) = currentTetracube->cubeClassIndex;
-        }
-        checkForRowClear(nextState, *currentTetracube);
-        spawnTetracube(currentTetracube);
-      }
-    }
-  }
-}
-static void updateCubeClasses(const GameState& lastState, GameState* nextState)
-{
-  nextState->cubeClasses = cubeClasses;
-  nextState->cubeClassCount = arrayCount(cubeClasses);
-}
-static void updateGamePhase(const GameState& lastState, GameState* nextState)
-{
-  if(lastState.events.count(Event::GameLost) > 0) {
-    nextState->phase = GameState::Phase::GameLost;
-  } else {
-    nextState->phase = lastState.phase;
-  }
+  module.reloadIfChanged();
 }
+#endif
 
 void Game::update(const GameState& lastState, GameState* nextState)
 {
-  updateGamePhase(lastState, nextState);
-  updateCamera(lastState, nextState);
-  updatePlayingSpace(lastState, nextState);
-  updateCurrentTetracube(lastState, nextState);
-  updateCubeClasses(lastState, nextState);
-}
\ No newline at end of file
+  updateFunction(hostServices, lastState, nextState);
+}
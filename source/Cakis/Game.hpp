@@ -1,10 +1,35 @@
 #pragma once
 
+#include <FileWatcher.hpp>
+#include <ReloadableLibrary.hpp>
+
+#include "GameModule.hpp"
 #include "GameState.hpp"
 
+/**
+ * @brief Runs the game logic of the game module.
+ */
 class Game
 {
 public:
+  /**
+   * @throws De::Exception if the game module can't be loaded.
+   */
   Game();
+
+#ifdef DAR_DEBUG
+  /**
+   * @brief Reloads the game module when the build replaces it, the game states carry over.
+   */
+  void watchModule(De::FileWatcher& fileWatcher);
+  /**
+   * @brief Call it between updates.
+   */
+  void reloadModuleIfChanged();
+#endif
   void update(const GameState& lastState, GameState* nextState);
-};
\ No newline at end of file
+
+private:
+  GameModule::UpdateFunction updateFunction = nullptr;
+  De::ReloadableLibrary module;
+};
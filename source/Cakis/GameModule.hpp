@@ -0,0 +1,47 @@
+#pragma once
+
+#include "GameState.hpp"
+
+/**
+ * Interface of the game module, the shared library with the game logic.
+ * In debug builds it is reloaded when it is rebuilt, so all state has to live in GameState, which the host owns.
+ * The module's globals start over with every reload and the pointers it stores in GameState are only valid
+ * until the next update.
+ */
+#if defined(_WIN32)
+#define DAR_GAME_MODULE_EXPORT extern "C" __declspec(dllexport)
+#else
+#define DAR_GAME_MODULE_EXPORT extern "C" __attribute__((visibility("default")))
+#endif
+
+namespace GameModule
+{
+#if defined(_WIN32)
+  constexpr const char* fileName = "CakisGame.dll";
+#else
+  constexpr const char* fileName = "./libCakisGame.so";
+#endif
+
+  /**
+   * @brief Core services of the host. The module doesn't link Core, its logs, allocations and profile scopes
+   * go through these to the host's logger, allocation counts and captures.
+   */
+  struct HostServices
+  {
+    De::Log::detail::ThreadBuffer* (*getLogThreadBuffer)();
+    unsigned char* (*beginLogRecord)(De::Log::detail::ThreadBuffer& buffer, uint32_t recordSize);
+    void (*flushLog)();
+
+    const std::atomic<uint32_t>* profilerCaptureId;
+    void (*recordProfileScope)(const char* name, uint64_t begin, uint64_t end, uint32_t captureId);
+
+    void* (*allocate)(size_t size);
+    void* (*allocateAligned)(size_t size, std::align_val_t alignment);
+    void (*deallocate)(void* memory);
+    void (*deallocateAligned)(void* memory, std::align_val_t alignment);
+    void* (*allocateFromArena)(De::LinearArena& arena, size_t size, size_t alignment);
+  };
+
+  using UpdateFunction = void (*)(const HostServices& host, const GameState& lastState, GameState* nextState);
+  constexpr const char* updateFunctionName = "gameUpdate";
+}
@@ -1,9 +1,11 @@
 #pragma once
 
-#include <unordered_map>
+#include <algorithm>
+#include <cstdint>
 
 #include <DarMath.hpp>
 #include <Color.hpp>
+#include <Memory.hpp>
 
 struct Mouse
 {
@@ -33,6 +35,7 @@ struct Keyboard
   Key down;
   Key up;
   Key F1;
+  Key F2;
   Key rightAlt;
   Key space;
   Key q, w, e;
@@ -56,6 +59,52 @@ struct Event
   };
 };
 
+/**
+ * @brief Events raised during one frame. They are allocated from the frame arena,
+ * which keeps them valid for the next frame, when the state is read as the last state.
+ */
+class Events
+{
+public:
+  void setArena(De::FrameArena* arena) noexcept { this->arena = arena; }
+
+  void emplace(Event::Type type, const Event& event)
+  {
+    assert(arena);
+    if(size == capacity) {
+      const int newCapacity = std::max(2 * capacity, 8);
+      Entry* newEntries = arena->getCurrent().allocateArray<Entry>(newCapacity);
+      std::copy_n(entries, size, newEntries);
+      entries = newEntries;
+      capacity = newCapacity;
+    }
+    entries[size++] = { type, event };
+  }
+  int count(Event::Type type) const noexcept
+  {
+    return (int)std::count_if(entries, entries + size, [type](const Entry& entry) { return entry.type == type; });
+  }
+  // The memory is given back when the frame arena is reset.
+  void clear() noexcept
+  {
+    entries = nullptr;
+    size = 0;
+    capacity = 0;
+  }
+
+private:
+  struct Entry
+  {
+    Event::Type type;
+    Event event;
+  };
+
+  De::FrameArena* arena = nullptr;
+  Entry* entries = nullptr;
+  int size = 0;
+  int capacity = 0;
+};
+
 struct CubeClass
 {
   ColorRgbaf color;
@@ -79,11 +128,13 @@ public:
     : PlayingSpace(other.size)
   {
     std::copy(other.begin(), other.end(), begin());
+    generation = other.generation;
   };
   PlayingSpace(PlayingSpace&& other) noexcept
     : size(other.size)
     , count(other.count)
     , values(other.values)
+    , generation(other.generation)
   {
     other.values = nullptr;
   };
@@ -96,6 +147,7 @@ public:
     }
     count = rhs.count;
     std::copy(rhs.begin(), rhs.end(), begin());
+    generation = rhs.generation;
     return *this;
   }
   PlayingSpace& operator=(PlayingSpace&& rhs) noexcept
@@ -103,6 +155,7 @@ public:
     size = rhs.size;
     count = rhs.count;
     values = rhs.values;
+    generation = rhs.generation;
     rhs.values = nullptr;
     return *this;
   }
@@ -120,26 +173,38 @@ public:
     return *(begin() + x + z*size.x + y*size.x*size.z); 
   }
   ValueType at(const Vec3i& position) const noexcept { return at(position.x, position.y, position.z); }
-  ValueType& at(int x, int y, int z) noexcept 
-  { 
+  void set(int x, int y, int z, ValueType value) noexcept
+  {
     assert(isInside(x, y, z));
-    return *(begin() + x + z*size.x + y*size.x*size.z);; 
+    ValueType& cell = *(begin() + x + z*size.x + y*size.x*size.z);
+    if(cell != value) {
+      cell = value;
+      ++generation;
+    }
   }
-  ValueType& at(const Vec3i& position) noexcept { return at(position.x, position.y, position.z); }
-  ValueType* begin() noexcept { return values; }
+  void set(const Vec3i& position, ValueType value) noexcept { set(position.x, position.y, position.z, value); }
   const ValueType* begin() const noexcept { return values; }
-  ValueType* end() noexcept { return values + count; }
   const ValueType* end() const noexcept { return values + count; }
 
   const Vec3i& getSize() const noexcept { return size; }
   const int getCount() const noexcept { return count; }
+  /**
+   * @brief Increases whenever a cell changes and is copied along with the cells,
+   * so equal generations of a playing space and its copy mean equal cells.
+   */
+  uint32_t getGeneration() const noexcept { return generation; }
 
 private:
   static int calculateCount(const Vec3i& size) noexcept { return size.x * size.y * size.z; }
 
+  // Cells change through set only, which keeps the generation up to date.
+  ValueType* begin() noexcept { return values; }
+  ValueType* end() noexcept { return values + count; }
+
   Vec3i size;
   int count;
   ValueType* values;
+  uint32_t generation = 0;
 };
 
 struct Tetracube
@@ -153,7 +218,7 @@ struct GameState
 {
   Input input;
 
-  std::unordered_multimap<Event::Type, Event> events;
+  Events events;
 
   enum class Phase
   {
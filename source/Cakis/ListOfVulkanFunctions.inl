@@ -37,6 +37,7 @@ INSTANCE_LEVEL_VULKAN_FUNCTION_FROM_EXTENSION(vkGetPhysicalDeviceSurfacePresentM
 INSTANCE_LEVEL_VULKAN_FUNCTION_FROM_EXTENSION(vkDestroySurfaceKHR)
 #ifdef DAR_DEBUG
 INSTANCE_LEVEL_VULKAN_FUNCTION_FROM_EXTENSION(vkCreateDebugUtilsMessengerEXT)
+INSTANCE_LEVEL_VULKAN_FUNCTION_FROM_EXTENSION(vkDestroyDebugUtilsMessengerEXT)
 #endif
 
 #ifdef VK_USE_PLATFORM_WIN32_KHR
@@ -0,0 +1,339 @@
+#define DAR_MODULE_NAME "RenderFrame"
+
+#include "RenderFrame.hpp"
+
+#include <algorithm>
+#include <vector>
+
+#include <DarEngine.hpp>
+#include <Profiler.hpp>
+
+namespace
+{
+  constexpr float verticalFieldOfView = 74.f;
+  constexpr float nearPlane = 1.f;
+  constexpr float farPlane = 100.f;
+  constexpr ColorRgbaf clearColor = { 0.2f, 0.2f, 0.2f, 1.f };
+  // The camera circles around the center of the playing space.
+  constexpr Vec3f cameraTarget = { GameState::gridSize.x / 2.f, GameState::gridSize.y / 2.f, GameState::gridSize.z / 2.f };
+
+  struct Grid
+  {
+    Mat4f transformation;
+    RenderMesh::Type mesh;
+  };
+  constexpr Grid grids[] = {
+    { Mat4f::rotationX(degreesToRadians(90)), RenderMesh::BottomGrid },
+    { Mat4f::rotationY(degreesToRadians(-90)), RenderMesh::SideGrid }, // Left.
+    { toMat4f(Mat3f::rotationY(degreesToRadians(-90)) * Mat4x3f::translation((float)GameState::gridSize.x, 0.f, 0.f)), RenderMesh::SideGrid }, // Right.
+    { Mat4f::identity(), RenderMesh::FrontGrid },
+    { Mat4f::translation(0.f, 0.f, (float)GameState::gridSize.z), RenderMesh::FrontGrid } // Back.
+  };
+  static_assert(grids[0].transformation[1][2] == 1.f && grids[0].transformation[2][1] == -1.f, "Bottom grid has to lie exactly in the xz plane.");
+  static_assert(grids[2].transformation[0][2] == 1.f && grids[2].transformation[2][0] == -1.f, "Right grid has to lie exactly in the zy plane.");
+}
+
+void generateGridVertices(RenderMesh::Type mesh, Vec2f* output) noexcept
+{
+  const Vec2i size = getGridSize(mesh);
+  int gridVertexIndex = 0;
+  // Vertical lines
+  for(int i = 0; i <= size.x; ++i) {
+    output[gridVertexIndex++] = { (float)i, 0.f };
+    output[gridVertexIndex++] = { (float)i, (float)size.y };
+  }
+  // Horizontal lines
+  for(int i = 0; i <= size.y; ++i) {
+    output[gridVertexIndex++] = { 0.f, (float)i };
+    output[gridVertexIndex++] = { (float)size.x, (float)i };
+  }
+}
+
+class RenderFrameBuilder::Impl
+{
+public:
+  Impl();
+
+  void updateCubeMesh(const PlayingSpace& playingSpace, De::RenderQueue& queue);
+  void pushCubes(const GameState& gameState, const Mat4f& viewProjection, De::RenderQueue& queue);
+  void pushGrids(const Mat4f& viewProjection, De::RenderQueue& queue);
+  void updatePalette(const GameState& gameState, RenderFrame& frame);
+
+private:
+  bool hasCubeChunkChanged(const PlayingSpace& playingSpace, int chunkIndex) const;
+
+  CubeMesher cubeMesher;
+  std::vector<CubeMesher::Vertex> cubeMeshVertices;
+  std::vector<uint32_t> cubeMeshIndices;
+  std::vector<CubeMesher::Vertex> tetracubeMeshVertices;
+  std::vector<uint32_t> tetracubeMeshIndices;
+  // The playing space the mesh was built from.
+  PlayingSpace meshedPlayingSpace{ GameState::gridSize };
+  bool isCubeMeshValid = false;
+  int updatedCubeChunkCount = 0;
+  const CubeClass* paletteCubeClasses = nullptr;
+  struct CubeChunks
+  {
+    float centerX[cubeChunkCount];
+    float centerY[cubeChunkCount];
+    float centerZ[cubeChunkCount];
+    float extentX[cubeChunkCount];
+    float extentY[cubeChunkCount];
+    float extentZ[cubeChunkCount];
+    Vec3i begin[cubeChunkCount];
+    Vec3i end[cubeChunkCount];
+    // Used part of the slot of the chunk in the cube indices.
+    uint32_t indexCount[cubeChunkCount];
+    uint8_t isVisible[cubeChunkCount];
+  } cubeChunks;
+};
+
+RenderFrameBuilder::Impl::Impl()
+{
+  int chunkIndex = 0;
+  for(int y = 0; y < cubeChunkCounts.y; ++y) {
+    for(int z = 0; z < cubeChunkCounts.z; ++z) {
+      for(int x = 0; x < cubeChunkCounts.x; ++x) {
+        // Chunks at the far sides are cut off by the grid.
+        const Vec3i begin = { x * cubeChunkSize.x, y * cubeChunkSize.y, z * cubeChunkSize.z };
+        const Vec3i end = {
+          std::min(begin.x + cubeChunkSize.x, GameState::gridSize.x),
+          std::min(begin.y + cubeChunkSize.y, GameState::gridSize.y),
+          std::min(begin.z + cubeChunkSize.z, GameState::gridSize.z)
+        };
+        cubeChunks.begin[chunkIndex] = begin;
+        cubeChunks.end[chunkIndex] = end;
+        cubeChunks.centerX[chunkIndex] = (begin.x + end.x) / 2.f;
+        cubeChunks.centerY[chunkIndex] = (begin.y + end.y) / 2.f;
+        cubeChunks.centerZ[chunkIndex] = (begin.z + end.z) / 2.f;
+        cubeChunks.extentX[chunkIndex] = (end.x - begin.x) / 2.f;
+        cubeChunks.extentY[chunkIndex] = (end.y - begin.y) / 2.f;
+        cubeChunks.extentZ[chunkIndex] = (end.z - begin.z) / 2.f;
+        cubeChunks.indexCount[chunkIndex] = 0;
+        ++chunkIndex;
+      }
+    }
+  }
+  // Reserved for the worst case, building frames doesn't allocate.
+  cubeMeshVertices.reserve(maxCubeChunkVertexCount);
+  cubeMeshIndices.reserve(maxCubeChunkIndexCount);
+  tetracubeMeshVertices.reserve(tetracubeCubeCount * CubeMesher::calculateMaxVertexCount(1));
+  tetracubeMeshIndices.reserve(tetracubeCubeCount * CubeMesher::calculateMaxIndexCount(1));
+}
+
+/**
+ * @brief Whether a cell of the chunk or next to it differs from the meshed playing space. The neighbours count
+ * because the faces of the chunk are culled against them.
+ */
+bool RenderFrameBuilder::Impl::hasCubeChunkChanged(const PlayingSpace& playingSpace, int chunkIndex) const
+{
+  const Vec3i& size = playingSpace.getSize();
+  const Vec3i& chunkBegin = cubeChunks.begin[chunkIndex];
+  const Vec3i& chunkEnd = cubeChunks.end[chunkIndex];
+  const Vec3i begin = { std::max(chunkBegin.x - 1, 0), std::max(chunkBegin.y - 1, 0), std::max(chunkBegin.z - 1, 0) };
+  const Vec3i end = { std::min(chunkEnd.x + 1, size.x), std::min(chunkEnd.y + 1, size.y), std::min(chunkEnd.z + 1, size.z) };
+  for(int y = begin.y; y < end.y; ++y) {
+    for(int z = begin.z; z < end.z; ++z) {
+      for(int x = begin.x; x < end.x; ++x) {
+        if(playingSpace.at(x, y, z) != meshedPlayingSpace.at(x, y, z)) {
+          return true;
+        }
+      }
+    }
+  }
+  return false;
+}
+
+/**
+ * @brief Meshes the chunks that changed since the last call into mesh updates of their slots. Returns right away
+ * while the generation of the playing space stays the same.
+ */
+void RenderFrameBuilder::Impl::updateCubeMesh(const PlayingSpace& playingSpace, De::RenderQueue& queue)
+{
+  updatedCubeChunkCount = 0;
+  if(isCubeMeshValid && playingSpace.getGeneration() == meshedPlayingSpace.getGeneration()) {
+    return;
+  }
+  DAR_PROFILE_SCOPE("RenderFrameBuilder::updateCubeMesh");
+
+  for(int chunkIndex = 0; chunkIndex < cubeChunkCount; ++chunkIndex) {
+    if(isCubeMeshValid && !hasCubeChunkChanged(playingSpace, chunkIndex)) {
+      continue;
+    }
+    cubeMeshVertices.clear();
+    cubeMeshIndices.clear();
+    cubeMesher.mesh(playingSpace, cubeChunks.begin[chunkIndex], cubeChunks.end[chunkIndex], cubeMeshVertices, cubeMeshIndices);
+    cubeChunks.indexCount[chunkIndex] = (uint32_t)cubeMeshIndices.size();
+    ++updatedCubeChunkCount;
+    if(cubeMeshIndices.empty()) {
+      continue;
+    }
+    queue.push(De::MeshUpdate{
+      RenderMesh::Cubes,
+      uint32_t(chunkIndex * maxCubeChunkVertexCount),
+      (uint32_t)cubeMeshVertices.size(),
+      queue.copy(cubeMeshVertices.data(), cubeMeshVertices.size()),
+      uint32_t(chunkIndex * maxCubeChunkIndexCount),
+      (uint32_t)cubeMeshIndices.size(),
+      queue.copy(cubeMeshIndices.data(), cubeMeshIndices.size())
+    });
+  }
+  meshedPlayingSpace = playingSpace;
+  isCubeMeshValid = true;
+}
+
+void RenderFrameBuilder::Impl::pushCubes(const GameState& gameState, const Mat4f& viewProjection, De::RenderQueue& queue)
+{
+  DAR_PROFILE_SCOPE("RenderFrameBuilder::pushCubes");
+  constexpr Vec3f cubeCenterOffset = { 0.5f, 0.5f, 0.5f };
+  constexpr float cubeBoundingSphereRadius = 0.8660254f; // sqrt(3) / 2
+
+  assert(gameState.playingSpace.getSize() == GameState::gridSize);
+  updateCubeMesh(gameState.playingSpace, queue);
+
+  const Mat4f* constants = queue.copy(&viewProjection, 1);
+  const Frustum frustum = Frustum::fromViewProjectionD3d(viewProjection);
+  testAabbsAgainstFrustum(
+    cubeChunks.centerX, cubeChunks.centerY, cubeChunks.centerZ,
+    cubeChunks.extentX, cubeChunks.extentY, cubeChunks.extentZ, cubeChunkCount,
+    frustum,
+    cubeChunks.isVisible
+  );
+  const Vec3f eyePosition = gameState.camera.toCartesian(cameraTarget);
+  int visibleChunkCount = 0;
+  uint32_t triangleCount = 0;
+  for(int chunkIndex = 0; chunkIndex < cubeChunkCount; ++chunkIndex) {
+    if(!cubeChunks.isVisible[chunkIndex] || cubeChunks.indexCount[chunkIndex] == 0) {
+      continue;
+    }
+    ++visibleChunkCount;
+    triangleCount += cubeChunks.indexCount[chunkIndex] / 3;
+    // Front to back, nearer chunks hide more of the farther ones before they're shaded.
+    const Vec3f center = { cubeChunks.centerX[chunkIndex], cubeChunks.centerY[chunkIndex], cubeChunks.centerZ[chunkIndex] };
+    const Vec3f toCenter = center - eyePosition;
+    queue.push(De::RenderCommand{
+      De::RenderQueue::makeSortKey(RenderLayer::Opaque, RenderPipeline::Cube, RenderMesh::Cubes, De::RenderQueue::toDepthKey(dot(toCenter, toCenter))),
+      RenderPipeline::Cube,
+      RenderMesh::Cubes,
+      uint32_t(chunkIndex * maxCubeChunkIndexCount),
+      cubeChunks.indexCount[chunkIndex],
+      // Indices of a chunk start at its first vertex.
+      chunkIndex * maxCubeChunkVertexCount,
+      constants,
+      sizeof(*constants)
+    });
+  }
+
+  // The visible cubes are packed to the front, the first indices of the tetracube mesh cover them.
+  tetracubeMeshVertices.clear();
+  tetracubeMeshIndices.clear();
+  int visibleCubeCount = 0;
+  const Tetracube& tetracube = gameState.currentTetracube;
+  for(const Vec3i& position : tetracube.positions) {
+    const Vec3i cubePosition = position + tetracube.translation;
+    if(intersects(frustum, Sphere{ toVec3f(cubePosition) + cubeCenterOffset, cubeBoundingSphereRadius })) {
+      CubeMesher::appendCube(cubePosition, tetracube.cubeClassIndex, tetracubeMeshVertices, tetracubeMeshIndices);
+      ++visibleCubeCount;
+    }
+  }
+  if(visibleCubeCount > 0) {
+    queue.push(De::MeshUpdate{
+      RenderMesh::Tetracube,
+      0,
+      (uint32_t)tetracubeMeshVertices.size(),
+      queue.copy(tetracubeMeshVertices.data(), tetracubeMeshVertices.size()),
+      0,
+      0,
+      nullptr
+    });
+    queue.push(De::RenderCommand{
+      De::RenderQueue::makeSortKey(RenderLayer::Opaque, RenderPipeline::Cube, RenderMesh::Tetracube, 0),
+      RenderPipeline::Cube,
+      RenderMesh::Tetracube,
+      0,
+      (uint32_t)tetracubeMeshIndices.size(),
+      0,
+      constants,
+      sizeof(*constants)
+    });
+  }
+
+  debugText(
+    L"Cube chunks %d / %d, updated %d, triangles %u, tetracube cubes %d",
+    visibleChunkCount, cubeChunkCount, updatedCubeChunkCount, triangleCount, visibleCubeCount
+  );
+}
+
+void RenderFrameBuilder::Impl::pushGrids(const Mat4f& viewProjection, De::RenderQueue& queue)
+{
+  for(const Grid& grid : grids) {
+    const Mat4f transformation = grid.transformation * viewProjection;
+    const Mat4f* constants = queue.copy(&transformation, 1);
+    queue.push(De::RenderCommand{
+      De::RenderQueue::makeSortKey(RenderLayer::Lines, RenderPipeline::Grid, grid.mesh, 0),
+      RenderPipeline::Grid,
+      grid.mesh,
+      0,
+      (uint32_t)calculateGridVertexCount(grid.mesh),
+      0,
+      constants,
+      sizeof(*constants)
+    });
+  }
+}
+
+/**
+ * @brief Copies the colors of the cube classes, the game module that owns them may be reloaded while the frame is rendered.
+ */
+void RenderFrameBuilder::Impl::updatePalette(const GameState& gameState, RenderFrame& frame)
+{
+  int cubeClassCount = gameState.cubeClassCount;
+  if(cubeClassCount > maxCubeClassCount) {
+    if(gameState.cubeClasses != paletteCubeClasses) {
+      logWarning("%d cube classes, only the first %d get their colors.", cubeClassCount, maxCubeClassCount);
+    }
+    cubeClassCount = maxCubeClassCount;
+  }
+  paletteCubeClasses = gameState.cubeClasses;
+  for(int i = 0; i < cubeClassCount; ++i) {
+    frame.cubeClassColors[i] = gameState.cubeClasses[i].color;
+  }
+}
+
+RenderFrameBuilder::RenderFrameBuilder()
+  : pImpl(std::make_unique<Impl>())
+{}
+
+RenderFrameBuilder::~RenderFrameBuilder() = default;
+
+const RenderFrame& RenderFrameBuilder::build(const GameState& gameState, De::LinearArena& arena)
+{
+  DAR_PROFILE_SCOPE("RenderFrameBuilder::build");
+  RenderFrame& frame = *arena.allocateArray<RenderFrame>(1);
+  frame.queue.reset(arena);
+  frame.clientAreaWidth = gameState.clientAreaWidth;
+  frame.clientAreaHeight = gameState.clientAreaHeight;
+  frame.clearColor = clearColor;
+  frame.switchWireframe = gameState.input.keyboard.F1.pressedDown;
+  pImpl->updatePalette(gameState, frame);
+
+  const float aspectRatio = gameState.clientAreaHeight > 0 ? (float)gameState.clientAreaWidth / gameState.clientAreaHeight : 1.f;
+  const Mat4f projection = Mat4f::perspectiveProjectionD3d(degreesToRadians(verticalFieldOfView), aspectRatio, nearPlane, farPlane);
+  const Mat4x3f view = gameState.camera.calculateView(cameraTarget);
+  const Mat4f viewProjection = view * projection;
+
+  pImpl->pushCubes(gameState, viewProjection, frame.queue);
+  pImpl->pushGrids(viewProjection, frame.queue);
+  frame.queue.sort();
+  debugText(L"Render commands %d, mesh updates %d", frame.queue.getCommandCount(), frame.queue.getMeshUpdateCount());
+
+#ifdef DAR_DEBUG
+  // The main thread starts the text of the next frame while this one is rendered.
+  frame.debugText = frame.queue.copy(_debugText, _debugTextLength);
+  frame.debugTextLength = _debugTextLength;
+#else
+  frame.debugText = nullptr;
+  frame.debugTextLength = 0;
+#endif
+  return frame;
+}
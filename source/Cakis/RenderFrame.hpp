@@ -0,0 +1,137 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+
+#include <Color.hpp>
+#include <DarMath.hpp>
+#include <Memory.hpp>
+#include <RenderQueue.hpp>
+
+#include "CubeMesher.hpp"
+#include "GameState.hpp"
+
+/**
+ * @brief Pipelines the commands of a RenderFrame refer to, every backend creates them at start.
+ */
+struct RenderPipeline
+{
+  enum Type : uint16_t
+  {
+    // Triangles of CubeMesher::Vertex, constants are the view projection, colors come from the frame palette.
+    Cube = 0,
+    // Lines of Vec2f in the grid plane, constants are the grid transformation times the view projection.
+    Grid,
+    Count
+  };
+};
+
+/**
+ * @brief Meshes the commands of a RenderFrame refer to. The grids are static, the backend creates them with
+ * generateGridVertices. The cube meshes change through the mesh updates of the frames.
+ */
+struct RenderMesh
+{
+  enum Type : uint16_t
+  {
+    // Settled cubes, every cube chunk has a fixed slot of maxCubeChunkVertexCount vertices and maxCubeChunkIndexCount indices.
+    Cubes = 0,
+    // Vertices of up to tetracubeCubeCount cubes, rewritten every frame. The indices are those of
+    // CubeMesher::appendCube called tetracubeCubeCount times, they never change.
+    Tetracube,
+    // Grid in x and z.
+    BottomGrid,
+    // Grid in z and y.
+    SideGrid,
+    // Grid in x and y.
+    FrontGrid,
+    Count
+  };
+};
+
+struct RenderLayer
+{
+  enum Type : uint8_t
+  {
+    Opaque = 0,
+    // Drawn over the opaque geometry, e.g. the grids.
+    Lines
+  };
+};
+
+// Cubes are meshed and culled in chunks of the playing space, so that a changed chunk is meshed and uploaded alone.
+constexpr Vec3i cubeChunkSize = { 4, 4, 4 };
+constexpr Vec3i cubeChunkCounts = {
+  (GameState::gridSize.x + cubeChunkSize.x - 1) / cubeChunkSize.x,
+  (GameState::gridSize.y + cubeChunkSize.y - 1) / cubeChunkSize.y,
+  (GameState::gridSize.z + cubeChunkSize.z - 1) / cubeChunkSize.z
+};
+constexpr int cubeChunkCount = cubeChunkCounts.x * cubeChunkCounts.y * cubeChunkCounts.z;
+constexpr int cubeChunkCellCount = cubeChunkSize.x * cubeChunkSize.y * cubeChunkSize.z;
+constexpr int maxCubeChunkVertexCount = CubeMesher::calculateMaxVertexCount(cubeChunkCellCount);
+constexpr int maxCubeChunkIndexCount = CubeMesher::calculateMaxIndexCount(cubeChunkCellCount);
+constexpr int tetracubeCubeCount = sizeof(Tetracube::positions) / sizeof(Tetracube::positions[0]);
+// Has to match the size of cubeClassColors in the cube shaders.
+constexpr int maxCubeClassCount = 16;
+
+/**
+ * @return Cells of the grid along its two axes.
+ */
+constexpr Vec2i getGridSize(RenderMesh::Type mesh) noexcept
+{
+  return mesh == RenderMesh::BottomGrid ? Vec2i{ GameState::gridSize.x, GameState::gridSize.z } :
+    mesh == RenderMesh::SideGrid ? Vec2i{ GameState::gridSize.z, GameState::gridSize.y } :
+    Vec2i{ GameState::gridSize.x, GameState::gridSize.y };
+}
+constexpr int calculateGridVertexCount(RenderMesh::Type mesh) noexcept
+{
+  return 2 * (getGridSize(mesh).x + 1 + getGridSize(mesh).y + 1);
+}
+/**
+ * @brief Writes the lines of a grid mesh, two vertices per line.
+ * @param output Room for calculateGridVertexCount(mesh) vertices.
+ */
+void generateGridVertices(RenderMesh::Type mesh, Vec2f* output) noexcept;
+
+/**
+ * @brief Everything a backend needs to draw a frame of the game. It and all it points to live in a frame arena.
+ */
+struct RenderFrame
+{
+  // Sorted, with the mesh updates to apply before the commands.
+  De::RenderQueue queue;
+  // The backend resizes its targets when they change.
+  int clientAreaWidth;
+  int clientAreaHeight;
+  ColorRgbaf clearColor;
+  // Colors of the cube classes, looked up by the cube class in the cube vertices.
+  ColorRgbaf cubeClassColors[maxCubeClassCount];
+  // Toggles wireframe rendering in debug builds.
+  bool switchWireframe;
+  // Copy of the debug text of the frame, empty in release builds.
+  const wchar_t* debugText;
+  int debugTextLength;
+};
+
+/**
+ * @brief Records the render frames of game states on the thread that updates the game: meshes the cube chunks that
+ * changed, culls the chunks and the cubes of the tetracube against the view frustum and pushes the draws of the cubes
+ * and the grids. Constants are in D3D clip space, where 0 <= z <= w.
+ */
+class RenderFrameBuilder
+{
+public:
+  RenderFrameBuilder();
+  RenderFrameBuilder(const RenderFrameBuilder& other) = delete;
+  RenderFrameBuilder& operator=(const RenderFrameBuilder& rhs) = delete;
+  ~RenderFrameBuilder();
+
+  /**
+   * @param arena Holds the frame until the backend rendered it.
+   */
+  const RenderFrame& build(const GameState& gameState, De::LinearArena& arena);
+
+private:
+  class Impl;
+  std::unique_ptr<Impl> pImpl;
+};
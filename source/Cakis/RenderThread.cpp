@@ -0,0 +1,150 @@
+#define DAR_MODULE_NAME "RenderThread"
+
+#include "RenderThread.hpp"
+
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+#include <Clock.hpp>
+#include <DarEngine.hpp>
+#include <Memory.hpp>
+#include <Profiler.hpp>
+
+class RenderThread::Impl
+{
+public:
+  Impl(RenderFunction render, PresentFunction present);
+  ~Impl();
+
+  FrameTimes submit(const RenderFrame& frame);
+  void wait();
+
+private:
+  void run();
+  // Requires the lock, rethrows on the calling thread.
+  void waitUntilIdle(std::unique_lock<std::mutex>& lock);
+
+  RenderFunction render;
+  PresentFunction present;
+  std::mutex mutex;
+  std::condition_variable frameSubmitted;
+  std::condition_variable frameRendered;
+  const RenderFrame* pendingFrame = nullptr;
+  bool isRendering = false;
+  bool isStopping = false;
+  std::exception_ptr exception;
+  FrameTimes renderedFrameTimes;
+  std::thread thread;
+};
+
+RenderThread::Impl::Impl(RenderFunction render, PresentFunction present)
+  : render(std::move(render))
+  , present(std::move(present))
+  , thread(&Impl::run, this)
+{}
+
+RenderThread::Impl::~Impl()
+{
+  {
+    std::unique_lock lock(mutex);
+    frameRendered.wait(lock, [this]() { return !pendingFrame && !isRendering; });
+    isStopping = true;
+  }
+  frameSubmitted.notify_one();
+  thread.join();
+  if(exception) {
+    logError("Rendering of the last frame failed.");
+  }
+}
+
+void RenderThread::Impl::waitUntilIdle(std::unique_lock<std::mutex>& lock)
+{
+  DAR_PROFILE_SCOPE("RenderThread::wait");
+  frameRendered.wait(lock, [this]() { return !pendingFrame && !isRendering; });
+  if(exception) {
+    std::rethrow_exception(std::exchange(exception, nullptr));
+  }
+}
+
+RenderThread::FrameTimes RenderThread::Impl::submit(const RenderFrame& frame)
+{
+  FrameTimes times;
+  {
+    std::unique_lock lock(mutex);
+    waitUntilIdle(lock);
+    times = renderedFrameTimes;
+    pendingFrame = &frame;
+  }
+  frameSubmitted.notify_one();
+  return times;
+}
+
+void RenderThread::Impl::wait()
+{
+  std::unique_lock lock(mutex);
+  waitUntilIdle(lock);
+}
+
+void RenderThread::Impl::run()
+{
+  De::Profiler::setThreadName("Render");
+  // Counted like the rendering on the main thread was, the frame loop asserts on it with -assertNoFrameAllocations.
+  DAR_ALLOCATION_SCOPE(Renderer);
+  for(;;) {
+    const RenderFrame* frame;
+    {
+      std::unique_lock lock(mutex);
+      frameSubmitted.wait(lock, [this]() { return pendingFrame || isStopping; });
+      if(!pendingFrame) {
+        break;
+      }
+      frame = std::exchange(pendingFrame, nullptr);
+      isRendering = true;
+    }
+
+    std::exception_ptr renderException;
+    FrameTimes times;
+    try {
+      int64_t time = De::Clock::now();
+      {
+        DAR_PROFILE_SCOPE("RenderThread::render");
+        render(*frame);
+      }
+      times.renderSeconds = De::Clock::measureSecondsSince(&time);
+      {
+        DAR_PROFILE_SCOPE("RenderThread::present");
+        present();
+      }
+      times.presentSeconds = De::Clock::measureSecondsSince(&time);
+    } catch(...) {
+      renderException = std::current_exception();
+    }
+
+    {
+      std::lock_guard lock(mutex);
+      isRendering = false;
+      exception = std::move(renderException);
+      renderedFrameTimes = times;
+    }
+    frameRendered.notify_all();
+  }
+}
+
+RenderThread::RenderThread(RenderFunction render, PresentFunction present)
+  : pImpl(std::make_unique<Impl>(std::move(render), std::move(present)))
+{}
+
+RenderThread::~RenderThread() = default;
+
+RenderThread::FrameTimes RenderThread::submit(const RenderFrame& frame)
+{
+  return pImpl->submit(frame);
+}
+
+void RenderThread::wait()
+{
+  pImpl->wait();
+}
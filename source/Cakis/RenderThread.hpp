@@ -0,0 +1,53 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+
+#include "RenderFrame.hpp"
+
+/**
+ * @brief Renders frames on a thread of its own while the next frame is simulated. One frame is rendered at a time,
+ * so a frame has to stay valid until the next one was submitted, e.g. by living in the current frame arena.
+ * The backend is only used from this thread after it was created.
+ */
+class RenderThread
+{
+public:
+  using RenderFunction = std::function<void(const RenderFrame& frame)>;
+  using PresentFunction = std::function<void()>;
+  /**
+   * @brief Time the render thread spent on a frame, measured there and handed back with the next submit.
+   */
+  struct FrameTimes
+  {
+    double renderSeconds = 0.;
+    double presentSeconds = 0.;
+  };
+
+  /**
+   * @param present Called after render for every frame that rendered without an exception.
+   */
+  RenderThread(RenderFunction render, PresentFunction present);
+  RenderThread(const RenderThread& other) = delete;
+  RenderThread& operator=(const RenderThread& rhs) = delete;
+  /**
+   * @brief Renders the submitted frame, then stops the thread.
+   */
+  ~RenderThread();
+
+  /**
+   * @brief Waits until the previous frame was rendered and presented, then starts rendering frame.
+   * @return Times of the previous frame, zero before the first one.
+   * @throws The exception that escaped the rendering of the previous frame.
+   */
+  FrameTimes submit(const RenderFrame& frame);
+  /**
+   * @brief Waits until the submitted frame was rendered.
+   * @throws The exception that escaped its rendering.
+   */
+  void wait();
+
+private:
+  class Impl;
+  std::unique_ptr<Impl> pImpl;
+};
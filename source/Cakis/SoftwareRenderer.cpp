@@ -0,0 +1,676 @@
+#define DAR_MODULE_NAME "SoftwareRenderer"
+
+#include "SoftwareRenderer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include <DarEngine.hpp>
+#include <Profiler.hpp>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+  #define DAR_SOFTWARE_RENDERER_SSE
+  #include <emmintrin.h>
+#endif
+
+namespace
+{
+  // Same as Grid.ps.hlsl.
+  constexpr ColorRgbaf gridColor = { 0.75f, 0.75f, 0.75f, 1.f };
+  // Triangles set up by one job.
+  constexpr int setupGrainSize = 256;
+
+  uint32_t packColor(const ColorRgbaf& color) noexcept
+  {
+    const auto toByte = [](float value) { return uint32_t(std::clamp(value, 0.f, 1.f) * 255.f + 0.5f); };
+    return toByte(color.r) | toByte(color.g) << 8 | toByte(color.b) << 16 | toByte(color.a) << 24;
+  }
+
+  float smoothstep(float edge0, float edge1, float x) noexcept
+  {
+    const float t = std::clamp((x - edge0) / (edge1 - edge0), 0.f, 1.f);
+    return t * t * (3.f - 2.f * t);
+  }
+
+  /**
+   * @brief Linear function of the screen position. Always evaluated as a * x + (b * y + c), negating a, b and c
+   * then negates the result exactly, which keeps the edges shared by two triangles free of gaps.
+   */
+  struct Plane
+  {
+    float a, b, c;
+
+    float at(float x, float y) const noexcept { return a * x + (b * y + c); }
+  };
+
+  struct ClipVertex
+  {
+    Vec4f position;
+    Vec3f gridPosition;
+  };
+
+  struct Triangle
+  {
+    // Edge i is opposite of vertex i and positive inside, divided by the area it's the barycentric coordinate i.
+    Plane edges[3];
+    // Bit i is set if pixel centers exactly on edge i belong to the triangle (top-left rule).
+    int topLeftMask;
+    Plane depth;
+    // 1 / w and gridPosition / w interpolate linearly in screen space.
+    Plane inverseW;
+    Plane gridPositionOverW[3];
+    ColorRgbaf color;
+    int minX, minY, maxX, maxY;
+  };
+
+  struct Line
+  {
+    // Pixels in x and y, depth in z.
+    Vec3f begin;
+    Vec3f end;
+    int minX, minY, maxX, maxY;
+  };
+
+  /**
+   * @brief Clips the polygon to z >= 0, the near plane of the D3D clip space.
+   * @return Vertex count of the clipped polygon, 0 if nothing is in front of the near plane.
+   */
+  int clipAgainstNearPlane(const ClipVertex (&polygon)[3], ClipVertex (&clipped)[4]) noexcept
+  {
+    int count = 0;
+    for(int i = 0; i < 3; ++i) {
+      const ClipVertex& a = polygon[i];
+      const ClipVertex& b = polygon[(i + 1) % 3];
+      const bool isAInside = a.position.z >= 0.f;
+      if(isAInside) {
+        clipped[count++] = a;
+      }
+      if(isAInside != (b.position.z >= 0.f)) {
+        const float t = a.position.z / (a.position.z - b.position.z);
+        clipped[count++] = { a.position + t * (b.position - a.position), lerp(a.gridPosition, b.gridPosition, t) };
+      }
+    }
+    return count;
+  }
+
+  bool isOutsideOfOneSide(const ClipVertex& a, const ClipVertex& b, const ClipVertex& c) noexcept
+  {
+    const auto isOutside = [&](auto getDistance) {
+      return getDistance(a.position) < 0.f && getDistance(b.position) < 0.f && getDistance(c.position) < 0.f;
+    };
+    return isOutside([](const Vec4f& p) { return p.w + p.x; }) || isOutside([](const Vec4f& p) { return p.w - p.x; }) ||
+      isOutside([](const Vec4f& p) { return p.w + p.y; }) || isOutside([](const Vec4f& p) { return p.w - p.y; }) ||
+      isOutside([](const Vec4f& p) { return p.z; }) || isOutside([](const Vec4f& p) { return p.w - p.z; });
+  }
+
+  Vec3f toScreen(const Vec4f& position, int width, int height) noexcept
+  {
+    const float inverseW = 1.f / position.w;
+    return {
+      (position.x * inverseW * 0.5f + 0.5f) * width,
+      (0.5f - position.y * inverseW * 0.5f) * height,
+      position.z * inverseW
+    };
+  }
+
+  /**
+   * @return false if the triangle is back facing, degenerate or covers no pixel center.
+   */
+  bool setUpTriangle(
+    const ClipVertex& v0,
+    const ClipVertex& v1,
+    const ClipVertex& v2,
+    const ColorRgbaf& color,
+    int width,
+    int height,
+    Triangle* triangle
+  ) noexcept
+  {
+    const ClipVertex* vertices[3] = { &v0, &v1, &v2 };
+    Vec3f screen[3];
+    float inverseW[3];
+    for(int i = 0; i < 3; ++i) {
+      screen[i] = toScreen(vertices[i]->position, width, height);
+      inverseW[i] = 1.f / vertices[i]->position.w;
+    }
+    // Front faces are clockwise on screen, as in D3D11Renderer. With y pointing down their area is positive.
+    const float area = (screen[1].x - screen[0].x) * (screen[2].y - screen[0].y) -
+      (screen[1].y - screen[0].y) * (screen[2].x - screen[0].x);
+    if(!(area > 0.f)) {
+      return false;
+    }
+
+    // Pixel centers are at half integers.
+    const float minX = std::min({ screen[0].x, screen[1].x, screen[2].x });
+    const float maxX = std::max({ screen[0].x, screen[1].x, screen[2].x });
+    const float minY = std::min({ screen[0].y, screen[1].y, screen[2].y });
+    const float maxY = std::max({ screen[0].y, screen[1].y, screen[2].y });
+    triangle->minX = std::max(int(std::ceil(minX - 0.5f)), 0);
+    triangle->maxX = std::min(int(std::floor(maxX - 0.5f)), width - 1);
+    triangle->minY = std::max(int(std::ceil(minY - 0.5f)), 0);
+    triangle->maxY = std::min(int(std::floor(maxY - 0.5f)), height - 1);
+    if(triangle->minX > triangle->maxX || triangle->minY > triangle->maxY) {
+      return false;
+    }
+
+    triangle->topLeftMask = 0;
+    for(int i = 0; i < 3; ++i) {
+      const Vec3f& from = screen[(i + 1) % 3];
+      const Vec3f& to = screen[(i + 2) % 3];
+      // Computed from the same end of the edge for both triangles sharing it, so that they get exact opposites.
+      const bool isSwapped = from.x > to.x || (from.x == to.x && from.y > to.y);
+      const Vec3f& p = isSwapped ? to : from;
+      const Vec3f& q = isSwapped ? from : to;
+      Plane edge{ p.y - q.y, q.x - p.x, 0.f };
+      edge.c = -(edge.a * p.x + edge.b * p.y);
+      triangle->edges[i] = isSwapped ? Plane{ -edge.a, -edge.b, -edge.c } : edge;
+
+      const float dx = to.x - from.x;
+      const float dy = to.y - from.y;
+      if(dy < 0.f || (dy == 0.f && dx > 0.f)) {
+        triangle->topLeftMask |= 1 << i;
+      }
+    }
+
+    const float inverseArea = 1.f / area;
+    const auto interpolate = [&](const float (&values)[3]) {
+      Plane plane{ 0.f, 0.f, 0.f };
+      for(int i = 0; i < 3; ++i) {
+        const float weight = values[i] * inverseArea;
+        plane.a += weight * triangle->edges[i].a;
+        plane.b += weight * triangle->edges[i].b;
+        plane.c += weight * triangle->edges[i].c;
+      }
+      return plane;
+    };
+    triangle->depth = interpolate({ screen[0].z, screen[1].z, screen[2].z });
+    triangle->inverseW = interpolate(inverseW);
+    triangle->gridPositionOverW[0] = interpolate({
+      v0.gridPosition.x * inverseW[0], v1.gridPosition.x * inverseW[1], v2.gridPosition.x * inverseW[2]
+    });
+    triangle->gridPositionOverW[1] = interpolate({
+      v0.gridPosition.y * inverseW[0], v1.gridPosition.y * inverseW[1], v2.gridPosition.y * inverseW[2]
+    });
+    triangle->gridPositionOverW[2] = interpolate({
+      v0.gridPosition.z * inverseW[0], v1.gridPosition.z * inverseW[1], v2.gridPosition.z * inverseW[2]
+    });
+    triangle->color = color;
+    return true;
+  }
+
+  /**
+   * @brief Same as Cube.ps.hlsl, darkens the borders of every cell.
+   */
+  uint32_t shadeCube(const Triangle& triangle, float x, float y) noexcept
+  {
+    constexpr float colorThresholdMin = 0.3f;
+    constexpr float colorThresholdMax = 0.4f;
+    const float w = 1.f / triangle.inverseW.at(x, y);
+    float stepSum = 0.f;
+    for(const Plane& gridPositionOverW : triangle.gridPositionOverW) {
+      const float gridPosition = gridPositionOverW.at(x, y) * w;
+      const float cellPosition = gridPosition - std::floor(gridPosition) - 0.5f;
+      stepSum += smoothstep(colorThresholdMin, colorThresholdMax, std::abs(cellPosition));
+    }
+    const float modifier = 1.f - smoothstep(1.75f, 2.f, stepSum);
+    const ColorRgbaf& color = triangle.color;
+    return packColor({ modifier * color.r, modifier * color.g, modifier * color.b, modifier * color.a });
+  }
+
+  /**
+   * @brief Tests the pixels x to x + 3 of a row against the triangle and the depth buffer and writes the depth
+   * of those that pass.
+   * @return Bit i set if pixel x + i passed.
+   */
+  int testQuad(const Triangle& triangle, int x, float pixelY, float* depthRow) noexcept
+  {
+#ifdef DAR_SOFTWARE_RENDERER_SSE
+    const __m128 pixelX = _mm_add_ps(_mm_set1_ps(float(x)), _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f));
+    const __m128 zero = _mm_setzero_ps();
+    const auto evaluate = [&](const Plane& plane) {
+      return _mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.a), pixelX), _mm_set1_ps(plane.b * pixelY + plane.c));
+    };
+    __m128 isInside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+    for(int i = 0; i < 3; ++i) {
+      const __m128 edge = evaluate(triangle.edges[i]);
+      __m128 isCovered = _mm_cmpgt_ps(edge, zero);
+      if(triangle.topLeftMask & (1 << i)) {
+        isCovered = _mm_or_ps(isCovered, _mm_cmpeq_ps(edge, zero));
+      }
+      isInside = _mm_and_ps(isInside, isCovered);
+    }
+    if(_mm_movemask_ps(isInside) == 0) {
+      return 0;
+    }
+    const __m128 depth = evaluate(triangle.depth);
+    const __m128 oldDepth = _mm_loadu_ps(depthRow + x);
+    isInside = _mm_and_ps(isInside, _mm_cmplt_ps(depth, oldDepth));
+    _mm_storeu_ps(depthRow + x, _mm_or_ps(_mm_and_ps(isInside, depth), _mm_andnot_ps(isInside, oldDepth)));
+    return _mm_movemask_ps(isInside);
+#else
+    int mask = 0;
+    for(int lane = 0; lane < 4; ++lane) {
+      const float pixelX = float(x + lane) + 0.5f;
+      bool isInside = true;
+      for(int i = 0; i < 3 && isInside; ++i) {
+        const float edge = triangle.edges[i].at(pixelX, pixelY);
+        isInside = edge > 0.f || (edge == 0.f && (triangle.topLeftMask & (1 << i)));
+      }
+      const float depth = triangle.depth.at(pixelX, pixelY);
+      if(isInside && depth < depthRow[x + lane]) {
+        depthRow[x + lane] = depth;
+        mask |= 1 << lane;
+      }
+    }
+    return mask;
+#endif
+  }
+
+}
+
+class SoftwareRenderer::Impl
+{
+public:
+  Impl(int width, int height, De::JobSystem& jobSystem);
+
+  void resize(int newWidth, int newHeight);
+  void render(const RenderFrame& frame);
+
+  int width = 0;
+  int height = 0;
+  // Rows are padded to whole tiles.
+  int stride = 0;
+  std::vector<uint32_t> colors;
+
+private:
+  /**
+   * @brief Copy of a mesh of the render frames, the cube meshes keep their vertices in clip space as well.
+   */
+  struct Mesh
+  {
+    std::vector<CubeMesher::Vertex> cubeVertices;
+    std::vector<ClipVertex> clipVertices;
+    std::vector<Vec2f> gridVertices;
+    std::vector<uint32_t> indices;
+  };
+  /**
+   * @brief Command of the cube pipeline, its triangles follow those of the previous ones.
+   */
+  struct CubeDraw
+  {
+    const De::RenderCommand* command;
+    int firstTriangle;
+  };
+
+  void applyMeshUpdates(const De::RenderQueue& queue);
+  void setUpTriangles(const De::RenderQueue& queue, const ColorRgbaf (&cubeClassColors)[maxCubeClassCount]);
+  void setUpLines(const De::RenderQueue& queue);
+  void binIntoTiles();
+  void rasterizeTile(int tileIndex);
+  void rasterizeTriangle(const Triangle& triangle, int tileX, int tileY);
+  void rasterizeLine(const Line& line, int tileX, int tileY);
+
+  De::JobSystem& jobSystem;
+  int tileCountX = 0;
+  int tileCountY = 0;
+  std::vector<float> depths;
+  uint32_t packedClearColor = 0;
+
+  Mesh meshes[RenderMesh::Count];
+  std::vector<CubeDraw> cubeDraws;
+  // Triangles of each setup job, in the order of the commands and their indices.
+  std::vector<std::vector<Triangle>> rangeTriangles;
+  int rangeCount = 0;
+  std::vector<Line> lines;
+  std::vector<std::vector<const Triangle*>> tileTriangles;
+  std::vector<std::vector<const Line*>> tileLines;
+};
+
+SoftwareRenderer::Impl::Impl(int width, int height, De::JobSystem& jobSystem)
+  : jobSystem(jobSystem)
+{
+  Mesh& cubes = meshes[RenderMesh::Cubes];
+  cubes.cubeVertices.resize(size_t(cubeChunkCount) * maxCubeChunkVertexCount);
+  cubes.clipVertices.resize(cubes.cubeVertices.size());
+  cubes.indices.resize(size_t(cubeChunkCount) * maxCubeChunkIndexCount);
+
+  // The cubes of the tetracube are indexed alike, only their vertices change.
+  Mesh& tetracube = meshes[RenderMesh::Tetracube];
+  for(int i = 0; i < tetracubeCubeCount; ++i) {
+    CubeMesher::appendCube({}, 0, tetracube.cubeVertices, tetracube.indices);
+  }
+  tetracube.clipVertices.resize(tetracube.cubeVertices.size());
+
+  for(const RenderMesh::Type mesh : { RenderMesh::BottomGrid, RenderMesh::SideGrid, RenderMesh::FrontGrid }) {
+    meshes[mesh].gridVertices.resize(calculateGridVertexCount(mesh));
+    generateGridVertices(mesh, meshes[mesh].gridVertices.data());
+  }
+
+  resize(width, height);
+}
+
+void SoftwareRenderer::Impl::resize(int newWidth, int newHeight)
+{
+  width = std::max(newWidth, 1);
+  height = std::max(newHeight, 1);
+  tileCountX = (width + tileSize - 1) / tileSize;
+  tileCountY = (height + tileSize - 1) / tileSize;
+  stride = tileCountX * tileSize;
+  colors.assign(size_t(stride) * tileCountY * tileSize, packedClearColor);
+  depths.assign(colors.size(), 1.f);
+  tileTriangles.resize(size_t(tileCountX) * tileCountY);
+  tileLines.resize(tileTriangles.size());
+}
+
+void SoftwareRenderer::Impl::applyMeshUpdates(const De::RenderQueue& queue)
+{
+  DAR_PROFILE_SCOPE("SoftwareRenderer::applyMeshUpdates");
+  for(int i = 0; i < queue.getMeshUpdateCount(); ++i) {
+    const De::MeshUpdate& update = queue.getMeshUpdates()[i];
+    Mesh& mesh = meshes[update.mesh];
+    assert(update.firstVertex + update.vertexCount <= mesh.cubeVertices.size());
+    assert(update.firstIndex + update.indexCount <= mesh.indices.size());
+    std::copy_n(static_cast<const CubeMesher::Vertex*>(update.vertices), update.vertexCount, &mesh.cubeVertices[update.firstVertex]);
+    std::copy_n(update.indices, update.indexCount, mesh.indices.data() + update.firstIndex);
+  }
+}
+
+void SoftwareRenderer::Impl::setUpTriangles(const De::RenderQueue& queue, const ColorRgbaf (&cubeClassColors)[maxCubeClassCount])
+{
+  DAR_PROFILE_SCOPE("SoftwareRenderer::setUpTriangles");
+  cubeDraws.clear();
+  int triangleCount = 0;
+  for(const De::RenderCommand& command : queue) {
+    if(command.pipeline == RenderPipeline::Cube) {
+      cubeDraws.push_back({ &command, triangleCount });
+      triangleCount += int(command.elementCount / 3);
+    }
+  }
+
+  // The vertices a command uses are transformed with its constants. Commands of a mesh share their constants,
+  // the chunks of the cubes draw from slots of their own.
+  jobSystem.parallelFor(0, int(cubeDraws.size()), 1, [&](int begin, int end) {
+    for(int i = begin; i < end; ++i) {
+      const De::RenderCommand& command = *cubeDraws[i].command;
+      if(command.elementCount == 0) {
+        continue;
+      }
+      Mesh& mesh = meshes[command.mesh];
+      const Mat4f& viewProjection = *static_cast<const Mat4f*>(command.constants);
+      const uint32_t* commandIndices = &mesh.indices[command.firstElement];
+      const auto [firstVertex, lastVertex] = std::minmax_element(commandIndices, commandIndices + command.elementCount);
+      for(uint32_t vertexIndex = *firstVertex + command.baseVertex; vertexIndex <= *lastVertex + command.baseVertex; ++vertexIndex) {
+        const CubeMesher::Vertex& vertex = mesh.cubeVertices[vertexIndex];
+        const Vec3f gridPosition = { float(vertex.x), float(vertex.y), float(vertex.z) };
+        mesh.clipVertices[vertexIndex] = { Vec4f{ gridPosition.x, gridPosition.y, gridPosition.z, 1.f } * viewProjection, gridPosition };
+      }
+    }
+  });
+
+  rangeCount = (triangleCount + setupGrainSize - 1) / setupGrainSize;
+  if(int(rangeTriangles.size()) < rangeCount) {
+    rangeTriangles.resize(rangeCount);
+  }
+  jobSystem.parallelFor(0, rangeCount, 1, [&](int rangeBegin, int rangeEnd) {
+    for(int range = rangeBegin; range < rangeEnd; ++range) {
+      std::vector<Triangle>& triangles = rangeTriangles[range];
+      triangles.clear();
+      const int begin = range * setupGrainSize;
+      const int end = std::min(begin + setupGrainSize, triangleCount);
+      // Last draw that starts at or before the first triangle of the range.
+      auto draw = std::upper_bound(cubeDraws.begin(), cubeDraws.end(), begin, [](int triangle, const CubeDraw& draw) {
+        return triangle < draw.firstTriangle;
+      }) - 1;
+      for(int triangleIndex = begin; triangleIndex < end; ++triangleIndex) {
+        while(triangleIndex >= draw->firstTriangle + int(draw->command->elementCount / 3)) {
+          ++draw;
+        }
+        const De::RenderCommand& command = *draw->command;
+        const Mesh& mesh = meshes[command.mesh];
+        const uint32_t* triangleIndices = &mesh.indices[command.firstElement + size_t(triangleIndex - draw->firstTriangle) * 3];
+        const uint32_t vertexIndices[3] = {
+          triangleIndices[0] + command.baseVertex, triangleIndices[1] + command.baseVertex, triangleIndices[2] + command.baseVertex
+        };
+        const ClipVertex polygon[3] = {
+          mesh.clipVertices[vertexIndices[0]], mesh.clipVertices[vertexIndices[1]], mesh.clipVertices[vertexIndices[2]]
+        };
+        if(isOutsideOfOneSide(polygon[0], polygon[1], polygon[2])) {
+          continue;
+        }
+        const int cubeClassIndex = mesh.cubeVertices[vertexIndices[0]].cubeClassIndex;
+        assert(cubeClassIndex >= 0 && cubeClassIndex < maxCubeClassCount);
+        const ColorRgbaf& color = cubeClassColors[cubeClassIndex];
+
+        ClipVertex clipped[4];
+        const int clippedCount = clipAgainstNearPlane(polygon, clipped);
+        for(int i = 1; i + 1 < clippedCount; ++i) {
+          Triangle triangle;
+          if(setUpTriangle(clipped[0], clipped[i], clipped[i + 1], color, width, height, &triangle)) {
+            triangles.push_back(triangle);
+          }
+        }
+      }
+    }
+  });
+}
+
+void SoftwareRenderer::Impl::setUpLines(const De::RenderQueue& queue)
+{
+  DAR_PROFILE_SCOPE("SoftwareRenderer::setUpLines");
+  lines.clear();
+  for(const De::RenderCommand& command : queue) {
+    if(command.pipeline != RenderPipeline::Grid) {
+      continue;
+    }
+    // Grid vertices lie in the xy plane of the grid, the constants place it in the view.
+    const Mat4f& transformation = *static_cast<const Mat4f*>(command.constants);
+    const std::vector<Vec2f>& vertices = meshes[command.mesh].gridVertices;
+    for(uint32_t i = command.firstElement; i + 1 < command.firstElement + command.elementCount; i += 2) {
+      Vec4f begin = Vec4f{ vertices[i].x, vertices[i].y, 0.f, 1.f } * transformation;
+      Vec4f end = Vec4f{ vertices[i + 1].x, vertices[i + 1].y, 0.f, 1.f } * transformation;
+      if(begin.z < 0.f && end.z < 0.f) {
+        continue;
+      }
+      if(begin.z < 0.f || end.z < 0.f) {
+        const float t = begin.z / (begin.z - end.z);
+        (begin.z < 0.f ? begin : end) = begin + t * (end - begin);
+      }
+      Line line{ toScreen(begin, width, height), toScreen(end, width, height), 0, 0, 0, 0 };
+      line.minX = std::max(int(std::floor(std::min(line.begin.x, line.end.x))), 0);
+      line.maxX = std::min(int(std::floor(std::max(line.begin.x, line.end.x))), width - 1);
+      line.minY = std::max(int(std::floor(std::min(line.begin.y, line.end.y))), 0);
+      line.maxY = std::min(int(std::floor(std::max(line.begin.y, line.end.y))), height - 1);
+      if(line.minX <= line.maxX && line.minY <= line.maxY) {
+        lines.push_back(line);
+      }
+    }
+  }
+}
+
+void SoftwareRenderer::Impl::binIntoTiles()
+{
+  DAR_PROFILE_SCOPE("SoftwareRenderer::binIntoTiles");
+  for(std::vector<const Triangle*>& bin : tileTriangles) {
+    bin.clear();
+  }
+  for(std::vector<const Line*>& bin : tileLines) {
+    bin.clear();
+  }
+  // In submission order, so that triangles at equal depth resolve the same way in every tile.
+  for(int range = 0; range < rangeCount; ++range) {
+    for(const Triangle& triangle : rangeTriangles[range]) {
+      for(int tileY = triangle.minY / tileSize; tileY <= triangle.maxY / tileSize; ++tileY) {
+        for(int tileX = triangle.minX / tileSize; tileX <= triangle.maxX / tileSize; ++tileX) {
+          tileTriangles[size_t(tileY) * tileCountX + tileX].push_back(&triangle);
+        }
+      }
+    }
+  }
+  for(const Line& line : lines) {
+    for(int tileY = line.minY / tileSize; tileY <= line.maxY / tileSize; ++tileY) {
+      for(int tileX = line.minX / tileSize; tileX <= line.maxX / tileSize; ++tileX) {
+        tileLines[size_t(tileY) * tileCountX + tileX].push_back(&line);
+      }
+    }
+  }
+}
+
+void SoftwareRenderer::Impl::rasterizeTriangle(const Triangle& triangle, int tileX, int tileY)
+{
+  // Quads start at multiples of 4, tiles and rows are multiples of 4 wide, so a quad never leaves the tile.
+  const int beginX = std::max(triangle.minX, tileX) & ~3;
+  const int endX = std::min(triangle.maxX + 1, tileX + tileSize);
+  const int beginY = std::max(triangle.minY, tileY);
+  const int endY = std::min(triangle.maxY + 1, tileY + tileSize);
+  for(int y = beginY; y < endY; ++y) {
+    const float pixelY = float(y) + 0.5f;
+    uint32_t* colorRow = &colors[size_t(y) * stride];
+    float* depthRow = &depths[size_t(y) * stride];
+    for(int x = beginX; x < endX; x += 4) {
+      const int mask = testQuad(triangle, x, pixelY, depthRow);
+      for(int lane = 0; lane < 4; ++lane) {
+        if(mask & (1 << lane)) {
+          colorRow[x + lane] = shadeCube(triangle, float(x + lane) + 0.5f, pixelY);
+        }
+      }
+    }
+  }
+}
+
+void SoftwareRenderer::Impl::rasterizeLine(const Line& line, int tileX, int tileY)
+{
+  // One pixel per column or row along the longer axis, at the pixel centers.
+  const bool isXMajor = std::abs(line.end.x - line.begin.x) >= std::abs(line.end.y - line.begin.y);
+  const float majorBegin = isXMajor ? line.begin.x : line.begin.y;
+  const float majorEnd = isXMajor ? line.end.x : line.end.y;
+  if(majorBegin == majorEnd) {
+    return;
+  }
+  const int tileMajor = isXMajor ? tileX : tileY;
+  const int majorLimit = isXMajor ? width : height;
+  const int tileMinor = isXMajor ? tileY : tileX;
+  const int minorLimit = std::min(tileMinor + tileSize, isXMajor ? height : width);
+  const uint32_t color = packColor(gridColor);
+
+  const int first = std::max(int(std::ceil(std::min(majorBegin, majorEnd) - 0.5f)), tileMajor);
+  const int last = std::min({ int(std::floor(std::max(majorBegin, majorEnd) - 0.5f)), tileMajor + tileSize - 1, majorLimit - 1 });
+  for(int major = first; major <= last; ++major) {
+    const float t = (float(major) + 0.5f - majorBegin) / (majorEnd - majorBegin);
+    const float minorPosition = isXMajor ? line.begin.y + t * (line.end.y - line.begin.y) : line.begin.x + t * (line.end.x - line.begin.x);
+    const int minor = int(std::floor(minorPosition));
+    if(minor < tileMinor || minor >= minorLimit) {
+      continue;
+    }
+    const size_t pixelIndex = isXMajor ? size_t(minor) * stride + major : size_t(major) * stride + minor;
+    const float depth = line.begin.z + t * (line.end.z - line.begin.z);
+    if(depth < depths[pixelIndex]) {
+      depths[pixelIndex] = depth;
+      colors[pixelIndex] = color;
+    }
+  }
+}
+
+void SoftwareRenderer::Impl::rasterizeTile(int tileIndex)
+{
+  const int tileX = (tileIndex % tileCountX) * tileSize;
+  const int tileY = (tileIndex / tileCountX) * tileSize;
+  for(int y = tileY; y < tileY + tileSize; ++y) {
+    std::fill_n(&colors[size_t(y) * stride + tileX], tileSize, packedClearColor);
+    std::fill_n(&depths[size_t(y) * stride + tileX], tileSize, 1.f);
+  }
+  for(const Triangle* triangle : tileTriangles[tileIndex]) {
+    rasterizeTriangle(*triangle, tileX, tileY);
+  }
+  for(const Line* line : tileLines[tileIndex]) {
+    rasterizeLine(*line, tileX, tileY);
+  }
+}
+
+void SoftwareRenderer::Impl::render(const RenderFrame& frame)
+{
+  DAR_PROFILE_SCOPE("SoftwareRenderer::render");
+  packedClearColor = packColor(frame.clearColor);
+  applyMeshUpdates(frame.queue);
+  setUpTriangles(frame.queue, frame.cubeClassColors);
+  setUpLines(frame.queue);
+  binIntoTiles();
+
+  DAR_PROFILE_SCOPE("SoftwareRenderer::rasterize");
+  jobSystem.parallelFor(0, tileCountX * tileCountY, 1, [this](int begin, int end) {
+    for(int tileIndex = begin; tileIndex < end; ++tileIndex) {
+      rasterizeTile(tileIndex);
+    }
+  });
+}
+
+SoftwareRenderer::SoftwareRenderer(int width, int height, De::JobSystem& jobSystem)
+  : pImpl(std::make_unique<Impl>(width, height, jobSystem))
+{}
+
+SoftwareRenderer::~SoftwareRenderer() = default;
+
+void SoftwareRenderer::onWindowResize(int clientAreaWidth, int clientAreaHeight)
+{
+  pImpl->resize(clientAreaWidth, clientAreaHeight);
+}
+
+void SoftwareRenderer::render(const RenderFrame& frame)
+{
+  // The framebuffer is at least one pixel, e.g. while the window is minimized.
+  if(std::max(frame.clientAreaWidth, 1) != pImpl->width || std::max(frame.clientAreaHeight, 1) != pImpl->height) {
+    pImpl->resize(frame.clientAreaWidth, frame.clientAreaHeight);
+  }
+  pImpl->render(frame);
+}
+
+int SoftwareRenderer::getWidth() const noexcept
+{
+  return pImpl->width;
+}
+
+int SoftwareRenderer::getHeight() const noexcept
+{
+  return pImpl->height;
+}
+
+uint32_t SoftwareRenderer::getPixel(int x, int y) const noexcept
+{
+  assert(x >= 0 && x < pImpl->width && y >= 0 && y < pImpl->height);
+  return pImpl->colors[size_t(y) * pImpl->stride + x];
+}
+
+bool SoftwareRenderer::writeScreenshot(const char* fileName) const
+{
+  FILE* file = nullptr;
+#ifdef _WIN32
+  if(fopen_s(&file, fileName, "wb") != 0) {
+    file = nullptr;
+  }
+#else
+  file = fopen(fileName, "wb");
+#endif
+  if(!file) {
+    logError("Failed to open %s for writing.", fileName);
+    return false;
+  }
+  const int width = pImpl->width;
+  const int height = pImpl->height;
+  bool isWritten = fprintf(file, "P6\n%d %d\n255\n", width, height) > 0;
+  std::vector<uint8_t> row(size_t(width) * 3);
+  for(int y = 0; y < height && isWritten; ++y) {
+    for(int x = 0; x < width; ++x) {
+      const uint32_t color = getPixel(x, y);
+      row[size_t(x) * 3] = uint8_t(color);
+      row[size_t(x) * 3 + 1] = uint8_t(color >> 8);
+      row[size_t(x) * 3 + 2] = uint8_t(color >> 16);
+    }
+    isWritten = fwrite(row.data(), 1, row.size(), file) == row.size();
+  }
+  isWritten = fclose(file) == 0 && isWritten;
+  if(!isWritten) {
+    logError("Failed to write %s.", fileName);
+  }
+  return isWritten;
+}
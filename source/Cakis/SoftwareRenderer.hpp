@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+
+#include <JobSystem.hpp>
+
+#include "RenderFrame.hpp"
+
+/**
+ * @brief Renders the render frames of RenderFrameBuilder on the CPU into a framebuffer in memory, for machines without
+ * a GPU or a window, e.g. to compare frames against reference images.
+ * Triangles are set up in parallel, binned into the screen tiles they overlap and the tiles are rasterized
+ * in parallel, 4 pixels at a time with SSE. The image matches D3D11Renderer apart from multisampling and debug text.
+ */
+class SoftwareRenderer
+{
+public:
+  static constexpr int tileSize = 64;
+
+  /**
+   * @param jobSystem Runs the triangle setup and the tiles, render has to be called from a thread it takes jobs from.
+   */
+  SoftwareRenderer(int width, int height, De::JobSystem& jobSystem);
+  SoftwareRenderer(const SoftwareRenderer& other) = delete;
+  SoftwareRenderer& operator=(const SoftwareRenderer& rhs) = delete;
+  ~SoftwareRenderer();
+
+  void onWindowResize(int clientAreaWidth, int clientAreaHeight);
+  /**
+   * @brief Resizes the framebuffer to the client area of the frame if it differs.
+   */
+  void render(const RenderFrame& frame);
+
+  int getWidth() const noexcept;
+  int getHeight() const noexcept;
+  /**
+   * @return Pixel of the last frame, 8 bits per channel with red in the lowest byte.
+   */
+  uint32_t getPixel(int x, int y) const noexcept;
+  /**
+   * @brief Writes the last frame as binary PPM.
+   * @return false if the file can't be written, the error is logged.
+   */
+  bool writeScreenshot(const char* fileName) const;
+
+private:
+  class Impl;
+  std::unique_ptr<Impl> pImpl;
+};
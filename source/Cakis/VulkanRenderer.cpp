@@ -2,7 +2,11 @@
 
 #include "VulkanRenderer.h"
 
+#include <cstdio>
+#include <cstring>
+#include <future>
 #include <memory>
+#include <string>
 #include <vector>
 #include <set>
 #include <algorithm>
@@ -10,7 +14,9 @@
 #include <sstream>
 #include <array>
 
+#ifdef _WIN32
 #define VK_USE_PLATFORM_WIN32_KHR
+#endif
 #define VK_NO_PROTOTYPES
 #include "vulkan.h"
 
@@ -18,8 +24,14 @@
 #include <DarEngine.hpp>
 #include <DarMath.hpp>
 #include <Exception.hpp>
+#include <AssetLoader.hpp>
 #include <File.hpp>
-#include "GameState.hpp"
+#include <FileWatcher.hpp>
+#include <Library.hpp>
+#include <Profiler.hpp>
+#include <TlsfAllocator.hpp>
+#include "CubeMesher.hpp"
+#include "RenderFrame.hpp"
 
 namespace 
 {
@@ -30,17 +42,16 @@ namespace
   const char* const * layers = nullptr;
   uint32_t layerCount = 0;
 #endif
-  static const char* requiredInstanceExtensions[] = {
-    VK_KHR_SURFACE_EXTENSION_NAME
 #ifdef _WIN32
-    , VK_KHR_WIN32_SURFACE_EXTENSION_NAME
-#endif
-#ifdef DAR_DEBUG 
-    , VK_EXT_DEBUG_UTILS_EXTENSION_NAME
+  const char* const vulkanLibraryName = "vulkan-1.dll";
+#else
+  const char* const vulkanLibraryName = "libvulkan.so.1";
 #endif
-  };
+  // Offscreen there is no surface, so the extensions for one are left out.
+  bool isOffscreen = false;
+  std::vector<const char*> requiredInstanceExtensions;
 
-#define _resultToStringCase(error) case error: sprintf_s(string, stringLength, #error); break;
+#define _resultToStringCase(error) case error: snprintf(string, stringLength, #error); break;
 static void resultToString(VkResult error, char* string, int stringLength)
 {
   switch(error) {
@@ -55,7 +66,7 @@ static void resultToString(VkResult error, char* string, int stringLength)
     _resultToStringCase(VK_ERROR_DEVICE_LOST) 
     _resultToStringCase(VK_ERROR_SURFACE_LOST_KHR) 
     _resultToStringCase(VK_ERROR_NATIVE_WINDOW_IN_USE_KHR)
-    default: sprintf_s(string, stringLength, "unkown result");
+    default: snprintf(string, stringLength, "unkown result");
   }
 }
 
@@ -89,12 +100,17 @@ static bool _checkResultImpl(VkResult result, const char* parentFunction, int li
 #define DEVICE_LEVEL_VULKAN_FUNCTION_FROM_EXTENSION(name) PFN_##name name{nullptr};
 #include "ListOfVulkanFunctions.inl"
 
+std::unique_ptr<De::Library> vulkanLibrary;
 VkInstance instance = nullptr;
+#ifdef DAR_DEBUG
+VkDebugUtilsMessengerEXT messenger = nullptr;
+#endif
 std::vector<VkExtensionProperties> availableInstanceExtensions;
 const De::ApplicationInfo applicationInfo = {}; 
 const VkAllocationCallbacks* allocator = nullptr;
 VkPhysicalDevice physicalDevice = nullptr;
 VkPhysicalDeviceProperties physicalDeviceProperties = {};
+VkPhysicalDeviceFeatures physicalDeviceFeatures = {};
 VkPhysicalDeviceMemoryProperties physicalDeviceMemoryProperties = {};
 VkDevice device = nullptr;
 
@@ -106,63 +122,128 @@ struct SwapChainImageContext
   VkImage image;
   VkImageView imageView;
   VkFramebuffer frameBuffer;
-  VkCommandBuffer commandBuffer;
-  VkFence fence;
-
-  VkBuffer squareUniformBuffer;
-  VkDescriptorSet squareUniformBufferDescriptorSet;
 };
-VkDeviceMemory squareUniformBufferMemory = nullptr;
-uint8_t* squareUniformBufferMappedData;
-VkDeviceSize squareUniformBufferMemoryOffset = 0;
 SwapChainImageContext* swapChainImageContexts = nullptr;
 uint32_t swapChainImageCount = 0;
-VkDescriptorPool descriptorPool = nullptr;
+// Set by render when it acquired a swap chain image, present hands it over.
+bool isSwapChainImageAcquired = false;
+uint32_t acquiredSwapChainImageIndex = 0;
+bool isSwapChainSuboptimal = false;
+
+// Buffers and linear images must not share a page of bufferImageGranularity with optimal images.
+enum MemoryKind : uint8_t
+{
+  LinearMemory = 0,
+  OptimalMemory
+};
+
+/**
+ * @brief Range of a block of device memory, from DeviceMemoryAllocator.
+ */
+struct MemoryAllocation
+{
+  VkDeviceMemory memory;
+  VkDeviceSize offset;
+  // Start of the range if the memory is host visible, otherwise nullptr.
+  uint8_t* mappedData;
+  uint32_t blockIndex;
+  De::TlsfAllocator::Handle handle;
+};
+
+// Resolve target without a swap chain, copied into the readback buffer by readPixels.
+struct OffscreenImage
+{
+  VkImage image;
+  MemoryAllocation imageMemory;
+  VkImageView imageView;
+  VkFramebuffer frameBuffer;
+  VkBuffer readbackBuffer;
+  MemoryAllocation readbackBufferMemory;
+  const uint32_t* readbackData;
+  // Its layout is undefined until a frame was rendered into it.
+  bool isRendered;
+} offscreenImage = {};
+
 constexpr int maxFramesInFlight = 2;
-VkSemaphore swapChainImageAvailableSemaphores[maxFramesInFlight];
-VkSemaphore swapChainImageRenderFinishedSemaphores[maxFramesInFlight];
-VkFence swapChainImagesInFlightFences[maxFramesInFlight];
+// The CPU records a frame while the device renders the previous one, everything written per frame exists per frame in flight.
+struct FrameContext
+{
+  VkCommandBuffer commandBuffer;
+  // Signaled when the device finished the frame, its slots in the frame slot buffers are free again then.
+  VkFence fence;
+  VkSemaphore swapChainImageAvailableSemaphore;
+  VkSemaphore swapChainImageRenderFinishedSemaphore;
+};
+FrameContext frameContexts[maxFramesInFlight];
+
+/**
+ * @brief Host visible buffer, mapped for its lifetime, with a slot of slotSize bytes per frame in flight.
+ */
+struct FrameSlotBuffer
+{
+  VkBuffer buffer;
+  MemoryAllocation memory;
+  uint8_t* mappedData;
+  VkDeviceSize slotSize;
+};
+// Colors of the cube classes, read by the cube vertex shader with a dynamic offset to the slot of the frame.
+FrameSlotBuffer paletteBuffer = {};
+// Source of the copies into the static meshes, room for all cube chunks at once like in the first frame.
+FrameSlotBuffer stagingBuffer = {};
+struct CubePalette
+{
+  ColorRgbaf cubeClassColors[maxCubeClassCount];
+};
+
+struct Mesh
+{
+  VkBuffer vertexBuffer;
+  MemoryAllocation vertexBufferMemory;
+  // VK_NULL_HANDLE for meshes that are drawn without indices, e.g. the grids.
+  VkBuffer indexBuffer;
+  MemoryAllocation indexBufferMemory;
+  uint32_t vertexStride;
+  // Rewritten every frame through the host instead of copies, the vertex buffer is a FrameSlotBuffer then.
+  bool isDynamic;
+  uint8_t* mappedVertices;
+  VkDeviceSize vertexSlotSize;
+};
+Mesh meshes[RenderMesh::Count];
+// Every command has its constants, which are pushed when they differ from those of the previous command.
+constexpr uint32_t maxConstantsSize = sizeof(Mat4f);
 
 VkCommandPool graphicsCommandPool = nullptr;
 uint32_t graphicsQueueFamilyIndex = UINT32_MAX;
 VkQueue graphicsQueue = nullptr;
 VkQueue transferQueue = nullptr;
 VkQueue presentQueue = nullptr;
+VkFormat resolveFormat = VK_FORMAT_UNDEFINED;
 VkRenderPass renderPass = nullptr;
-VkDescriptorSetLayout squareUniformBufferDescriptorSetLayout = nullptr;
+VkDescriptorSetLayout paletteDescriptorSetLayout = nullptr;
+VkDescriptorPool descriptorPool = nullptr;
+VkDescriptorSet paletteDescriptorSet = nullptr;
+// Shared by all pipelines, so that the palette and the pushed constants stay bound when the pipeline changes.
 VkPipelineLayout pipelineLayout = nullptr;
-VkPipeline graphicsPipeline = nullptr;
+VkPipeline pipelines[RenderPipeline::Count] = {};
+#ifdef DAR_DEBUG
+bool isWireframe = false;
+#endif
 uint64_t renderCount = 0;
+Vec2i clientAreaSize = {};
+// Multisampled, resolved into the swap chain image or the offscreen image at the end of the render pass.
 struct RenderTarget
 {
   VkImage colorImage;
-  VkDeviceMemory colorImageMemory;
+  MemoryAllocation colorImageMemory;
   VkImageView colorImageView;
+  VkImage depthImage;
+  MemoryAllocation depthImageMemory;
+  VkImageView depthImageView;
   VkSampleCountFlagBits sampleCount;
+  VkFormat depthFormat;
+  VkExtent2D extent;
 } renderTarget = {};
 
-struct SquareVertex {
-  Vec2f position;
-  Vec3f color;
-};
-struct SquareData {
-  const SquareVertex vertices[4] = {
-    {{-0.5f, -0.5f}, {1.0f, 0.0f, 0.0f}},
-    {{ 0.5f, -0.5f}, {0.0f, 1.0f, 0.0f}},
-    {{ 0.5f,  0.5f}, {0.0f, 0.0f, 1.0f}},
-    {{-0.5f,  0.5f}, {1.0f, 1.0f, 1.0f}}
-  };
-  const uint16_t indices[6] = {
-    0, 1, 2,
-    2, 3, 0
-  };
-} squareData;
-VkBuffer squareDataBuffer = nullptr;
-VkDeviceMemory squareDataBufferMemory = nullptr;
-struct SquareUniformBufferData {
-  Mat4f transform;
-};
-
 uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties)
 {
   for(uint32_t i = 0; i < physicalDeviceMemoryProperties.memoryTypeCount; i++) {
@@ -174,6 +255,191 @@ uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties)
   throw VulkanRenderer::Exception("Memory type not found.");
 }
 
+/**
+ * @brief Sub-allocates buffers and images from large blocks of device memory with a TlsfAllocator per block,
+ * so that the count of memory objects stays far below maxMemoryAllocationCount. Host visible blocks stay mapped.
+ */
+class DeviceMemoryAllocator
+{
+public:
+  MemoryAllocation allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, MemoryKind kind)
+  {
+    const uint32_t memoryTypeIndex = findMemoryType(requirements.memoryTypeBits, properties);
+    De::TlsfAllocator::Allocation allocation;
+    for(uint32_t i = 0; i < blocks.size(); ++i) {
+      Block* block = blocks[i].get();
+      if(block && block->memoryTypeIndex == memoryTypeIndex && 
+        block->allocator.allocate(requirements.size, requirements.alignment, kind, &allocation)) {
+        return makeAllocation(i, allocation);
+      }
+    }
+
+    // Resources larger than a block get a block of their own.
+    const VkDeviceSize blockSize = std::max(calculatePreferredBlockSize(memoryTypeIndex), requirements.size);
+    VkMemoryAllocateInfo memoryAllocateInfo;
+    memoryAllocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    memoryAllocateInfo.pNext = nullptr;
+    memoryAllocateInfo.allocationSize = blockSize;
+    memoryAllocateInfo.memoryTypeIndex = memoryTypeIndex;
+    VkDeviceMemory memory;
+    checkResult(vkAllocateMemory(device, &memoryAllocateInfo, allocator, &memory));
+    void* mappedData = nullptr;
+    if(physicalDeviceMemoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+      const VkResult result = vkMapMemory(device, memory, 0, VK_WHOLE_SIZE, 0, &mappedData);
+      if(result != VK_SUCCESS) {
+        vkFreeMemory(device, memory, allocator);
+        checkResult(result);
+      }
+    }
+
+    uint32_t blockIndex = 0;
+    while(blockIndex < blocks.size() && blocks[blockIndex]) {
+      ++blockIndex;
+    }
+    if(blockIndex == blocks.size()) {
+      blocks.emplace_back();
+    }
+    blocks[blockIndex] = std::make_unique<Block>(
+      memory, 
+      static_cast<uint8_t*>(mappedData), 
+      memoryTypeIndex, 
+      blockSize, 
+      physicalDeviceProperties.limits.bufferImageGranularity
+    );
+    ++blockCount;
+    // An empty block fits anything up to its size, its first range starts at 0.
+    if(!blocks[blockIndex]->allocator.allocate(requirements.size, requirements.alignment, kind, &allocation)) {
+      throw VulkanRenderer::Exception("Failed to allocate from a new device memory block.");
+    }
+    return makeAllocation(blockIndex, allocation);
+  }
+
+  /**
+   * @brief Gives the range back, does nothing for an allocation that is all zero.
+   */
+  void deallocate(MemoryAllocation& allocation) noexcept
+  {
+    if(!allocation.memory) {
+      return;
+    }
+    std::unique_ptr<Block>& block = blocks[allocation.blockIndex];
+    block->allocator.deallocate(allocation.handle);
+    allocation = {};
+    // Keeps one block per memory type, so that short-lived buffers, e.g. for staging, don't allocate blocks every time.
+    if(block->allocator.isEmpty()) {
+      const bool hasOtherBlock = std::any_of(blocks.begin(), blocks.end(), [&block](const std::unique_ptr<Block>& other) {
+        return other && other != block && other->memoryTypeIndex == block->memoryTypeIndex;
+      });
+      if(hasOtherBlock) {
+        vkFreeMemory(device, block->memory, allocator);
+        block.reset();
+        --blockCount;
+      }
+    }
+  }
+
+  void logStatistics() const
+  {
+    logInfo(
+      "%u device memory blocks of at most %u memory objects.", 
+      blockCount, 
+      physicalDeviceProperties.limits.maxMemoryAllocationCount
+    );
+    for(uint32_t memoryTypeIndex = 0; memoryTypeIndex < physicalDeviceMemoryProperties.memoryTypeCount; ++memoryTypeIndex) {
+      int typeBlockCount = 0;
+      int allocationCount = 0;
+      int freeRangeCount = 0;
+      VkDeviceSize size = 0;
+      VkDeviceSize usedSize = 0;
+      VkDeviceSize largestFreeSize = 0;
+      for(const std::unique_ptr<Block>& block : blocks) {
+        if(block && block->memoryTypeIndex == memoryTypeIndex) {
+          const De::TlsfAllocator::Statistics statistics = block->allocator.getStatistics();
+          ++typeBlockCount;
+          allocationCount += statistics.allocationCount;
+          freeRangeCount += statistics.freeRangeCount;
+          size += block->allocator.getSize();
+          usedSize += statistics.usedSize;
+          largestFreeSize = std::max(largestFreeSize, statistics.largestFreeSize);
+        }
+      }
+      if(typeBlockCount == 0) {
+        continue;
+      }
+      // Share of the free memory that a single allocation can't get.
+      const VkDeviceSize freeSize = size - usedSize;
+      const double fragmentation = freeSize > 0 ? 1. - double(largestFreeSize) / double(freeSize) : 0.;
+      logInfo(
+        "Memory type %u: %d blocks, %llu of %llu KiB used by %d allocations, %d free ranges, %.1f%% fragmented.",
+        memoryTypeIndex,
+        typeBlockCount,
+        static_cast<unsigned long long>(usedSize / 1024),
+        static_cast<unsigned long long>(size / 1024),
+        allocationCount,
+        freeRangeCount,
+        fragmentation * 100.
+      );
+    }
+  }
+
+  /**
+   * @brief Frees the blocks, all allocations have to be deallocated before.
+   */
+  void cleanup() noexcept
+  {
+    for(std::unique_ptr<Block>& block : blocks) {
+      if(block) {
+        assert(block->allocator.isEmpty());
+        vkFreeMemory(device, block->memory, allocator);
+      }
+    }
+    blocks.clear();
+    blockCount = 0;
+  }
+
+private:
+  struct Block
+  {
+    Block(VkDeviceMemory memory, uint8_t* mappedData, uint32_t memoryTypeIndex, VkDeviceSize size, VkDeviceSize granularity)
+      : memory(memory)
+      , mappedData(mappedData)
+      , memoryTypeIndex(memoryTypeIndex)
+      , allocator(size, granularity)
+    {}
+
+    VkDeviceMemory memory;
+    uint8_t* mappedData;
+    uint32_t memoryTypeIndex;
+    De::TlsfAllocator allocator;
+  };
+
+  static VkDeviceSize calculatePreferredBlockSize(uint32_t memoryTypeIndex)
+  {
+    // Small heaps, e.g. host visible device memory, would be used up by a few blocks.
+    constexpr VkDeviceSize largeBlockSize = VkDeviceSize(64) << 20;
+    const uint32_t heapIndex = physicalDeviceMemoryProperties.memoryTypes[memoryTypeIndex].heapIndex;
+    const VkDeviceSize heapSize = physicalDeviceMemoryProperties.memoryHeaps[heapIndex].size;
+    return heapSize <= (VkDeviceSize(1) << 30) ? heapSize / 8 : largeBlockSize;
+  }
+
+  MemoryAllocation makeAllocation(uint32_t blockIndex, const De::TlsfAllocator::Allocation& allocation) const
+  {
+    const Block& block = *blocks[blockIndex];
+    MemoryAllocation result;
+    result.memory = block.memory;
+    result.offset = allocation.offset;
+    result.mappedData = block.mappedData ? block.mappedData + allocation.offset : nullptr;
+    result.blockIndex = blockIndex;
+    result.handle = allocation.handle;
+    return result;
+  }
+
+  // Null where a block was freed, the index of a block stays valid for its allocations.
+  std::vector<std::unique_ptr<Block>> blocks;
+  uint32_t blockCount = 0;
+};
+DeviceMemoryAllocator deviceMemory;
+
 class CommandRecorder
 {
 public:
@@ -249,48 +515,59 @@ private:
   VkCommandBuffer commandBuffer;
 };
 
+VkBuffer createBuffer(VkDeviceSize size, VkBufferUsageFlags usage)
+{
+  VkBufferCreateInfo bufferInfo;
+  bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+  bufferInfo.pNext = nullptr;
+  bufferInfo.flags = 0;
+  bufferInfo.size = size;
+  bufferInfo.usage = usage;
+  bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+  bufferInfo.queueFamilyIndexCount = 0;
+  bufferInfo.pQueueFamilyIndices = nullptr;
+  VkBuffer buffer;
+  checkResult(vkCreateBuffer(device, &bufferInfo, allocator, &buffer));
+  return buffer;
+}
+/**
+ * @brief Allocates the memory of buffer from deviceMemory and binds it.
+ */
+MemoryAllocation allocateBufferMemory(VkBuffer buffer, VkMemoryPropertyFlags properties)
+{
+  VkMemoryRequirements memoryRequirements;
+  vkGetBufferMemoryRequirements(device, buffer, &memoryRequirements);
+
+  MemoryAllocation bufferMemory = deviceMemory.allocate(memoryRequirements, properties, LinearMemory);
+  checkResult(vkBindBufferMemory(device, buffer, bufferMemory.memory, bufferMemory.offset));
+  return bufferMemory;
+}
+void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer* buffer, MemoryAllocation* bufferMemory)
+{
+  *buffer = createBuffer(size, usage);
+  *bufferMemory = allocateBufferMemory(*buffer, properties);
+}
+
 class Buffer
 {
 public:
   Buffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties)
   {
-    VkBufferCreateInfo bufferInfo;
-    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-    bufferInfo.pNext = nullptr;
-    bufferInfo.flags = 0;
-    bufferInfo.size = size;
-    bufferInfo.usage = usage;
-    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-    bufferInfo.queueFamilyIndexCount = 0;
-    bufferInfo.pQueueFamilyIndices = nullptr;
-    checkResult(vkCreateBuffer(device, &bufferInfo, allocator, &buffer));
-
-    VkMemoryRequirements memoryRequirements;
-    vkGetBufferMemoryRequirements(device, buffer, &memoryRequirements);
-
-    VkMemoryAllocateInfo memoryAllocateInfo;
-    memoryAllocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    memoryAllocateInfo.pNext = nullptr;
-    memoryAllocateInfo.allocationSize = memoryRequirements.size;
-    memoryAllocateInfo.memoryTypeIndex = findMemoryType(memoryRequirements.memoryTypeBits, properties);
-    checkResult(vkAllocateMemory(device, &memoryAllocateInfo, allocator, &memory));
-
-    checkResult(vkBindBufferMemory(device, buffer, memory, 0));
+    createBuffer(size, usage, properties, &buffer, &memory);
   }
   Buffer(const Buffer& other) = delete;
   Buffer(Buffer&& other) = delete;
   ~Buffer()
   {
     vkDestroyBuffer(device, buffer, allocator);
-    vkFreeMemory(device, memory, allocator);
+    deviceMemory.deallocate(memory);
   }
 
   void write(const void* srcData, size_t size)
   {
-    void* bufferData;
-    checkResult(vkMapMemory(device, memory, 0, size, 0, &bufferData));
-    memcpy(bufferData, srcData, size);
-    vkUnmapMemory(device, memory);
+    // Host visible blocks stay mapped.
+    assert(memory.mappedData);
+    memcpy(memory.mappedData, srcData, size);
   }
 
   void copyTo(VkCommandBuffer commandBuffer, VkBuffer dstBuffer, VkDeviceSize size)
@@ -304,7 +581,7 @@ public:
 
 private:
   VkBuffer buffer;
-  VkDeviceMemory memory;
+  MemoryAllocation memory;
 };
 
 class StagingBuffer : public Buffer
@@ -315,43 +592,6 @@ public:
   {}
 };
 
-VkBuffer createBuffer(VkDeviceSize size, VkBufferUsageFlags usage)
-{
-  VkBufferCreateInfo bufferInfo;
-  bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-  bufferInfo.pNext = nullptr;
-  bufferInfo.flags = 0;
-  bufferInfo.size = size;
-  bufferInfo.usage = usage;
-  bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-  bufferInfo.queueFamilyIndexCount = 0;
-  bufferInfo.pQueueFamilyIndices = nullptr;
-  VkBuffer buffer;
-  checkResult(vkCreateBuffer(device, &bufferInfo, allocator, &buffer));
-  return buffer;
-}
-VkDeviceMemory createBufferMemory(VkBuffer buffer, int bufferCount, VkMemoryPropertyFlags properties)
-{
-  VkMemoryRequirements memoryRequirements;
-  vkGetBufferMemoryRequirements(device, buffer, &memoryRequirements);
-
-  VkMemoryAllocateInfo memoryAllocateInfo;
-  memoryAllocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-  memoryAllocateInfo.pNext = nullptr;
-  memoryAllocateInfo.allocationSize = memoryRequirements.size * bufferCount;
-  memoryAllocateInfo.memoryTypeIndex = findMemoryType(memoryRequirements.memoryTypeBits, properties);
-  VkDeviceMemory bufferMemory;
-  checkResult(vkAllocateMemory(device, &memoryAllocateInfo, allocator, &bufferMemory));
-  return bufferMemory;
-
-}
-void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer* buffer, VkDeviceMemory* bufferMemory)
-{
-  *buffer = createBuffer(size, usage);
-  *bufferMemory = createBufferMemory(*buffer, 1, properties);
-  checkResult(vkBindBufferMemory(device, *buffer, *bufferMemory, 0));
-}
-
 void create2DImage(
   uint32_t width, 
   uint32_t height, 
@@ -362,7 +602,7 @@ void create2DImage(
   VkMemoryPropertyFlags memoryProperties,
   VkImageAspectFlags aspectMask,
   VkImage* image,
-  VkDeviceMemory* imageMemory,
+  MemoryAllocation* imageMemory,
   VkImageView* imageView
 )
 {
@@ -385,14 +625,8 @@ void create2DImage(
 
   VkMemoryRequirements memoryRequirements;
   vkGetImageMemoryRequirements(device, *image, &memoryRequirements);
-  VkMemoryAllocateInfo memoryInfo;
-  memoryInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-  memoryInfo.pNext = nullptr;
-  memoryInfo.allocationSize = memoryRequirements.size;
-  memoryInfo.memoryTypeIndex = findMemoryType(memoryRequirements.memoryTypeBits, memoryProperties);
-  checkResult(vkAllocateMemory(device, &memoryInfo, nullptr, imageMemory));
-
-  checkResult(vkBindImageMemory(device, *image, *imageMemory, 0));
+  *imageMemory = deviceMemory.allocate(memoryRequirements, memoryProperties, OptimalMemory);
+  checkResult(vkBindImageMemory(device, *image, imageMemory->memory, imageMemory->offset));
 
   VkImageViewCreateInfo viewInfo;
   viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
@@ -425,6 +659,7 @@ uint32_t selectUniversalQueueFamily(VkPhysicalDevice physicalDevice)
       //&& familyProperties.queueFlags & VK_QUEUE_COMPUTE_BIT 
       && familyProperties.queueFlags & VK_QUEUE_TRANSFER_BIT)
     {
+      if(isOffscreen) return i;
       VkBool32 presentationSupported = false;
       checkResult(vkGetPhysicalDeviceSurfaceSupportKHR(physicalDevice, i, presentationSurface, &presentationSupported));
       if(presentationSupported) return i;
@@ -501,6 +736,16 @@ static VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(
 
 void initInstance()
 {
+  requiredInstanceExtensions.clear();
+  if(!isOffscreen) {
+    requiredInstanceExtensions.push_back(VK_KHR_SURFACE_EXTENSION_NAME);
+#ifdef _WIN32
+    requiredInstanceExtensions.push_back(VK_KHR_WIN32_SURFACE_EXTENSION_NAME);
+#endif
+  }
+#ifdef DAR_DEBUG
+  requiredInstanceExtensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
+#endif
   enumarateAvailableInstanceExtensions();
   checkInstanceExtensionsAvailability();
     
@@ -532,8 +777,8 @@ void initInstance()
 	createInfo.pApplicationInfo = &vkApplicationInfo;
   createInfo.enabledLayerCount = layerCount;
   createInfo.ppEnabledLayerNames = layers;
-	createInfo.enabledExtensionCount = arrayCount(requiredInstanceExtensions);
-	createInfo.ppEnabledExtensionNames = requiredInstanceExtensions;
+	createInfo.enabledExtensionCount = uint32_t(requiredInstanceExtensions.size());
+	createInfo.ppEnabledExtensionNames = requiredInstanceExtensions.data();
   checkResult(vkCreateInstance(&createInfo, allocator, &instance));
 
   #define INSTANCE_LEVEL_VULKAN_FUNCTION(name)	\
@@ -542,20 +787,21 @@ void initInstance()
 	{	\
 		throw VulkanRenderer::Exception{std::string("could not load vulkan function ") + std::string(#name) };	\
 	}
+  // Offscreen the surface extensions aren't enabled, their functions stay null.
   #define INSTANCE_LEVEL_VULKAN_FUNCTION_FROM_EXTENSION(name)	\
 	name = (PFN_##name)vkGetInstanceProcAddr( instance, #name ); \
-  if(!name)	\
+  if(!name && !isOffscreen)	\
 	{	\
 		throw VulkanRenderer::Exception{std::string("could not load vulkan function ") + std::string(#name) };	\
 	}
   #include "ListOfVulkanFunctions.inl"
 
   #ifdef DAR_DEBUG
-    VkDebugUtilsMessengerEXT messenger = nullptr;
     checkResult(vkCreateDebugUtilsMessengerEXT(instance, &messengerCreateInfo, allocator, &messenger));
   #endif
 }
 
+#ifdef _WIN32
 void initializePresentationSurface(HWND window)
 {
   VkWin32SurfaceCreateInfoKHR surfaceCreateInfo{};
@@ -565,12 +811,17 @@ void initializePresentationSurface(HWND window)
   checkResult(vkCreateWin32SurfaceKHR(instance, &surfaceCreateInfo, allocator, &presentationSurface));
   assert(presentationSurface != nullptr);
 }
+#endif
 
 VkPhysicalDevice findSuitablePhysicalDevice()
 {
   uint32_t devicesCount{};
   checkResult(vkEnumeratePhysicalDevices(instance, &devicesCount, nullptr));
+  if(devicesCount == 0) {
+    throw VulkanRenderer::InitializeException("No Vulkan device found.");
+  }
   VkPhysicalDevice physicalDevices[8];
+  devicesCount = std::min(devicesCount, uint32_t(arrayCount(physicalDevices)));
   checkResult(vkEnumeratePhysicalDevices(instance, &devicesCount, physicalDevices));
   //for(VkPhysicalDevice physicalDevice : vkPhysicalDevices)
   //{
@@ -599,6 +850,7 @@ void initializePhysicalDevice()
 {
   physicalDevice = findSuitablePhysicalDevice();
   vkGetPhysicalDeviceProperties(physicalDevice, &physicalDeviceProperties);
+  vkGetPhysicalDeviceFeatures(physicalDevice, &physicalDeviceFeatures);
   vkGetPhysicalDeviceMemoryProperties(physicalDevice, &physicalDeviceMemoryProperties);
 }
 
@@ -612,6 +864,19 @@ VkSampleCountFlagBits selectSampleCount()
   return VK_SAMPLE_COUNT_1_BIT;
 }
 
+VkFormat selectDepthFormat()
+{
+  // D16 has to be supported, the others are more precise.
+  for(const VkFormat format : { VK_FORMAT_D32_SFLOAT, VK_FORMAT_X8_D24_UNORM_PACK32, VK_FORMAT_D16_UNORM }) {
+    VkFormatProperties formatProperties;
+    vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &formatProperties);
+    if(formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT) {
+      return format;
+    }
+  }
+  throw VulkanRenderer::InitializeException("No depth format supported.");
+}
+
 void loadDeviceCoreFunctions()
 {
   if(device)
@@ -647,14 +912,18 @@ void initDevice()
   info.enabledLayerCount = layerCount;
   info.ppEnabledLayerNames = layers;
   const char* extensions[] = {"VK_KHR_swapchain"};
-  info.ppEnabledExtensionNames = extensions;
-  info.enabledExtensionCount = arrayCount(extensions);
+  info.ppEnabledExtensionNames = isOffscreen ? nullptr : extensions;
+  info.enabledExtensionCount = isOffscreen ? 0 : arrayCount(extensions);
   VkPhysicalDeviceFeatures features{};
+  // Needed for wireframe rendering only.
+  features.fillModeNonSolid = physicalDeviceFeatures.fillModeNonSolid;
   info.pEnabledFeatures = &features;
   checkResult(vkCreateDevice(physicalDevice, &info, allocator, &device));
 
   loadDeviceCoreFunctions();
-  loadDeviceExtensionFunctions();
+  if(!isOffscreen) {
+    loadDeviceExtensionFunctions();
+  }
 
   vkGetDeviceQueue(device, queueInfo.queueFamilyIndex, 0, &graphicsQueue);
   transferQueue = graphicsQueue;
@@ -685,8 +954,11 @@ bool initSwapChain()
 
   swapChainInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
   swapChainInfo.surface = presentationSurface;
-  swapChainInfo.minImageCount = std::min(presentationSurfaceCapabalities.minImageCount + 1, presentationSurfaceCapabalities.maxImageCount);;
-  swapChainInfo.imageFormat = VK_FORMAT_B8G8R8A8_UNORM;
+  swapChainInfo.minImageCount = presentationSurfaceCapabalities.minImageCount + 1;
+  if(presentationSurfaceCapabalities.maxImageCount > 0) { // 0 stands for no limit
+    swapChainInfo.minImageCount = std::min(swapChainInfo.minImageCount, presentationSurfaceCapabalities.maxImageCount);
+  }
+  swapChainInfo.imageFormat = resolveFormat;
   swapChainInfo.imageColorSpace = VK_COLOR_SPACE_SRGB_NONLINEAR_KHR;
   assert(presentationSurfaceCapabalities.currentExtent.width != 0xFFFFFFFF); // if equals, the surface size (window size) is determined by the size of the image
   swapChainInfo.imageExtent = presentationSurfaceCapabalities.currentExtent;       // so at this line, we would have to get the image size different way
@@ -700,9 +972,12 @@ bool initSwapChain()
   swapChainInfo.clipped = true;
   if(!checkResult(vkCreateSwapchainKHR(device, &swapChainInfo, allocator, &swapChain))) return false;
 
+  renderTarget.extent = swapChainInfo.imageExtent;
+
   if(!checkResult(vkGetSwapchainImagesKHR(device, swapChain, &swapChainImageCount, nullptr))) return false;
-  swapChainImageContexts = new SwapChainImageContext[swapChainImageCount]();
   VkImage swapChainImages[32];
+  swapChainImageCount = std::min(swapChainImageCount, uint32_t(arrayCount(swapChainImages)));
+  swapChainImageContexts = new SwapChainImageContext[swapChainImageCount]();
   if(!checkResult(vkGetSwapchainImagesKHR(device, swapChain, &swapChainImageCount, swapChainImages))) return false;
   for(uint32_t i = 0; i < swapChainImageCount; ++i) {
     swapChainImageContexts[i].image = swapChainImages[i];
@@ -727,34 +1002,48 @@ bool initSwapChain()
 
 void initializeRenderPass()
 {
-  VkAttachmentDescription attachments[2];
-  // color attachment
+  VkAttachmentDescription attachments[3];
+  // color attachment, only its resolved samples are kept
   attachments[0].flags = 0;
-  attachments[0].format = swapChainInfo.imageFormat;
+  attachments[0].format = resolveFormat;
   attachments[0].samples = renderTarget.sampleCount;
   attachments[0].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-  attachments[0].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+  attachments[0].storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
   attachments[0].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
   attachments[0].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
   attachments[0].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
   attachments[0].finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-  // resolve attachment
+  // depth attachment
   attachments[1].flags = 0;
-  attachments[1].format = swapChainInfo.imageFormat;
-  attachments[1].samples = VK_SAMPLE_COUNT_1_BIT;
-  attachments[1].loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-  attachments[1].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+  attachments[1].format = renderTarget.depthFormat;
+  attachments[1].samples = renderTarget.sampleCount;
+  attachments[1].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+  attachments[1].storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
   attachments[1].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
   attachments[1].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
   attachments[1].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-  attachments[1].finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+  attachments[1].finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+  // resolve attachment, the swap chain image or the offscreen image
+  attachments[2].flags = 0;
+  attachments[2].format = resolveFormat;
+  attachments[2].samples = VK_SAMPLE_COUNT_1_BIT;
+  attachments[2].loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+  attachments[2].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+  attachments[2].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+  attachments[2].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+  attachments[2].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  attachments[2].finalLayout = isOffscreen ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
 
   VkAttachmentReference colorAttachmentRef;
   colorAttachmentRef.attachment = 0;
   colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
+  VkAttachmentReference depthAttachmentRef;
+  depthAttachmentRef.attachment = 1;
+  depthAttachmentRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
   VkAttachmentReference colorAttachmentResolveRef;
-  colorAttachmentResolveRef.attachment = 1;
+  colorAttachmentResolveRef.attachment = 2;
   colorAttachmentResolveRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
   VkSubpassDescription subpassDesc;
@@ -765,17 +1054,23 @@ void initializeRenderPass()
   subpassDesc.colorAttachmentCount = 1;
   subpassDesc.pColorAttachments = &colorAttachmentRef;
   subpassDesc.pResolveAttachments = &colorAttachmentResolveRef;
-  subpassDesc.pDepthStencilAttachment = nullptr;
+  subpassDesc.pDepthStencilAttachment = &depthAttachmentRef;
   subpassDesc.preserveAttachmentCount = 0;
   subpassDesc.pPreserveAttachments = nullptr;
 
+  // The targets are shared by the frames in flight, so the previous frame has to be done with them,
+  // offscreen including the copy of readPixels.
   VkSubpassDependency dependency;
   dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
   dependency.dstSubpass = 0;
-  dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-  dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-  dependency.srcAccessMask = 0;
-  dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+  dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | 
+    VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | 
+    VK_PIPELINE_STAGE_TRANSFER_BIT;
+  dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+  dependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+  dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | 
+    VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | 
+    VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
   dependency.dependencyFlags = 0;
 
   VkRenderPassCreateInfo renderPassInfo;
@@ -822,9 +1117,10 @@ void initializeDescriptorSetLayout()
 {
   VkDescriptorSetLayoutBinding binding;
   binding.binding = 0;
-  binding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+  binding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
   binding.descriptorCount = 1;
   binding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+  binding.pImmutableSamplers = nullptr;
 
   VkDescriptorSetLayoutCreateInfo info;
   info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
@@ -833,30 +1129,109 @@ void initializeDescriptorSetLayout()
   info.bindingCount = 1;
   info.pBindings = &binding;
 
-  checkResult(vkCreateDescriptorSetLayout(device, &info, nullptr, &squareUniformBufferDescriptorSetLayout));
-}
-
-void initializePipeline()
-{
-  std::vector<uint8_t> shaderCode;
-
-#define getShaderPath(shaderName) "shaders/" shaderName ".spv"
-  De::readEntireFile(getShaderPath("triangle.vert"), shaderCode);
-  ShaderModule squareVertexShader(reinterpret_cast<uint32_t*>(shaderCode.data()), shaderCode.size());
+  checkResult(vkCreateDescriptorSetLayout(device, &info, nullptr, &paletteDescriptorSetLayout));
 
-  De::readEntireFile(getShaderPath("triangle.frag"), shaderCode);
-  ShaderModule squareFragmentShader(reinterpret_cast<uint32_t*>(shaderCode.data()), shaderCode.size());
+  VkPushConstantRange pushConstantRange;
+  pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+  pushConstantRange.offset = 0;
+  pushConstantRange.size = maxConstantsSize;
 
   VkPipelineLayoutCreateInfo pipelineLayoutInfo;
   pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
   pipelineLayoutInfo.pNext = nullptr;
   pipelineLayoutInfo.flags = 0;
   pipelineLayoutInfo.setLayoutCount = 1;
-  pipelineLayoutInfo.pSetLayouts = &squareUniformBufferDescriptorSetLayout;
-  pipelineLayoutInfo.pushConstantRangeCount = 0;
-  pipelineLayoutInfo.pPushConstantRanges = nullptr;
+  pipelineLayoutInfo.pSetLayouts = &paletteDescriptorSetLayout;
+  pipelineLayoutInfo.pushConstantRangeCount = 1;
+  pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
 
   checkResult(vkCreatePipelineLayout(device, &pipelineLayoutInfo, allocator, &pipelineLayout));
+}
+
+#define getShaderPath(shaderName) "shaders/" shaderName ".spv"
+enum ShaderFile
+{
+  CubeVertexShaderFile = 0,
+  CubeFragmentShaderFile,
+  GridVertexShaderFile,
+  GridFragmentShaderFile,
+  ShaderFileCount
+};
+constexpr const char* shaderFileNames[ShaderFileCount] = { 
+  getShaderPath("cube.vert"), 
+  getShaderPath("cube.frag"), 
+  getShaderPath("grid.vert"), 
+  getShaderPath("grid.frag") 
+};
+// Requested when the renderer is created, kept for pipeline recreation.
+std::future<De::LoadedFile> shaderFileLoads[ShaderFileCount];
+De::LoadedFile shaderFiles[ShaderFileCount];
+
+#ifdef DAR_DEBUG
+// Read from disk rather than through the asset loader, whose archive holds the SPIR-V files of the last build.
+std::future<De::LoadedFile> shaderFileReloads[ShaderFileCount];
+
+De::LoadedFile readShaderFile(const std::string& fileName)
+{
+  const De::MappedFile file(fileName.c_str(), De::MappedFile::Access::Sequential);
+  De::LoadedFile result(file.getSize());
+  if(file.getSize() > 0) {
+    memcpy(result.getMutableData(), file.getData(), file.getSize());
+  }
+  return result;
+}
+
+void reloadShaderFile(const char* fileName)
+{
+  for(int i = 0; i < ShaderFileCount; ++i) {
+    if(_stricmp(fileName, shaderFileNames[i]) == 0) {
+      shaderFileReloads[i] = std::async(std::launch::async, readShaderFile, std::string(fileName));
+    }
+  }
+}
+
+/**
+ * @return true if any shader file was replaced.
+ */
+bool swapReloadedShaderFiles()
+{
+  constexpr uint32_t spirvMagicNumber = 0x07230203;
+  bool isAnyShaderFileReloaded = false;
+  for(int i = 0; i < ShaderFileCount; ++i) {
+    if(!shaderFileReloads[i].valid() || shaderFileReloads[i].wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+      continue;
+    }
+    try {
+      De::LoadedFile file = shaderFileReloads[i].get();
+      if(file.getSize() < sizeof(uint32_t) || file.getSize() % sizeof(uint32_t) != 0 ||
+        *reinterpret_cast<const uint32_t*>(file.getData()) != spirvMagicNumber) {
+        logError("Reloaded %s isn't SPIR-V, keeping the old shader.", shaderFileNames[i]);
+        continue;
+      }
+      shaderFiles[i] = std::move(file);
+      isAnyShaderFileReloaded = true;
+      logInfo("Reloaded %s.", shaderFileNames[i]);
+    } catch(const De::Exception& e) {
+      logError("Failed to reload %s: %s", shaderFileNames[i], e.what());
+    }
+  }
+  return isAnyShaderFileReloaded;
+}
+#endif
+
+VkPipeline createPipeline(
+  ShaderFile vertexShaderFileIndex, 
+  ShaderFile fragmentShaderFileIndex, 
+  const VkPipelineVertexInputStateCreateInfo& vertexInputStateInfo,
+  VkPrimitiveTopology topology
+)
+{
+  // Loaded files are aligned, as SPIR-V words have to be.
+  const De::LoadedFile& vertexShaderFile = shaderFiles[vertexShaderFileIndex];
+  ShaderModule vertexShader(reinterpret_cast<const uint32_t*>(vertexShaderFile.getData()), vertexShaderFile.getSize());
+
+  const De::LoadedFile& fragmentShaderFile = shaderFiles[fragmentShaderFileIndex];
+  ShaderModule fragmentShader(reinterpret_cast<const uint32_t*>(fragmentShaderFile.getData()), fragmentShaderFile.getSize());
 
   VkPipelineShaderStageCreateInfo shaderStageInfos[2];
 
@@ -864,7 +1239,7 @@ void initializePipeline()
   shaderStageInfos[0].pNext = nullptr;
   shaderStageInfos[0].flags = 0;
   shaderStageInfos[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
-  shaderStageInfos[0].module = squareVertexShader;
+  shaderStageInfos[0].module = vertexShader;
   shaderStageInfos[0].pName = "main";
   shaderStageInfos[0].pSpecializationInfo = nullptr;
 
@@ -872,55 +1247,34 @@ void initializePipeline()
   shaderStageInfos[1].pNext = nullptr;
   shaderStageInfos[1].flags = 0;
   shaderStageInfos[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-  shaderStageInfos[1].module = squareFragmentShader;
+  shaderStageInfos[1].module = fragmentShader;
   shaderStageInfos[1].pName = "main";
   shaderStageInfos[1].pSpecializationInfo = nullptr;
 
-  VkVertexInputBindingDescription squareVertexInputBindingDescription;
-  squareVertexInputBindingDescription.binding = 0;
-  squareVertexInputBindingDescription.stride = sizeof(SquareVertex);
-  squareVertexInputBindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-  VkVertexInputAttributeDescription squareVertexInputAttributeDescriptions[] = {
-    {0, 0, VK_FORMAT_R32G32_SFLOAT, offsetof(SquareVertex, position)},
-    {1, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(SquareVertex, color)}
-  };
-
-  VkPipelineVertexInputStateCreateInfo vertexInputStateInfo;
-  vertexInputStateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-  vertexInputStateInfo.pNext = nullptr;
-  vertexInputStateInfo.flags = 0;
-  vertexInputStateInfo.vertexBindingDescriptionCount = 1;
-  vertexInputStateInfo.pVertexBindingDescriptions = &squareVertexInputBindingDescription;
-  vertexInputStateInfo.vertexAttributeDescriptionCount = arrayCount(squareVertexInputAttributeDescriptions);
-  vertexInputStateInfo.pVertexAttributeDescriptions = squareVertexInputAttributeDescriptions;
-
   VkPipelineInputAssemblyStateCreateInfo inputAssemblyStateInfo;
   inputAssemblyStateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
   inputAssemblyStateInfo.pNext = nullptr;
   inputAssemblyStateInfo.flags = 0;
-  inputAssemblyStateInfo.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+  inputAssemblyStateInfo.topology = topology;
   inputAssemblyStateInfo.primitiveRestartEnable = VK_FALSE;
 
-  VkViewport viewport;
-  viewport.x = 0.f;
-  viewport.y = 0.f;
-  viewport.width = static_cast<float>(swapChainInfo.imageExtent.width);
-  viewport.height = static_cast<float>(swapChainInfo.imageExtent.height);
-  viewport.minDepth = 0.f;
-  viewport.maxDepth = 1.f;
-
-  VkRect2D scissor;
-  scissor.offset = { 0, 0 };
-  scissor.extent = swapChainInfo.imageExtent;
-
+  // Viewport and scissor are dynamic, so the pipelines outlive resizes.
   VkPipelineViewportStateCreateInfo viewportStateInfo;
   viewportStateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
   viewportStateInfo.pNext = nullptr;
   viewportStateInfo.flags = 0;
   viewportStateInfo.viewportCount = 1;
-  viewportStateInfo.pViewports = &viewport;
+  viewportStateInfo.pViewports = nullptr;
   viewportStateInfo.scissorCount = 1;
-  viewportStateInfo.pScissors = &scissor;
+  viewportStateInfo.pScissors = nullptr;
+
+  const VkDynamicState dynamicStates[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+  VkPipelineDynamicStateCreateInfo dynamicStateInfo;
+  dynamicStateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+  dynamicStateInfo.pNext = nullptr;
+  dynamicStateInfo.flags = 0;
+  dynamicStateInfo.dynamicStateCount = arrayCount(dynamicStates);
+  dynamicStateInfo.pDynamicStates = dynamicStates;
 
   VkPipelineRasterizationStateCreateInfo rasterizerStateInfo;
   rasterizerStateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
@@ -929,7 +1283,13 @@ void initializePipeline()
   rasterizerStateInfo.depthClampEnable = VK_FALSE;
   rasterizerStateInfo.rasterizerDiscardEnable = VK_FALSE;
   rasterizerStateInfo.polygonMode = VK_POLYGON_MODE_FILL;
+#ifdef DAR_DEBUG
+  if(isWireframe) {
+    rasterizerStateInfo.polygonMode = VK_POLYGON_MODE_LINE;
+  }
+#endif
   rasterizerStateInfo.cullMode = VK_CULL_MODE_BACK_BIT;
+  // The shaders flip y, so the triangles wind like in D3D11Renderer.
   rasterizerStateInfo.frontFace = VK_FRONT_FACE_CLOCKWISE;
   rasterizerStateInfo.depthBiasEnable = VK_FALSE;
   rasterizerStateInfo.depthBiasConstantFactor = 0.f;
@@ -948,6 +1308,17 @@ void initializePipeline()
   multisampleStateInfo.alphaToCoverageEnable = VK_FALSE;
   multisampleStateInfo.alphaToOneEnable = VK_FALSE;
 
+  // Like the default depth stencil state of D3D11.
+  VkPipelineDepthStencilStateCreateInfo depthStencilStateInfo{};
+  depthStencilStateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+  depthStencilStateInfo.depthTestEnable = VK_TRUE;
+  depthStencilStateInfo.depthWriteEnable = VK_TRUE;
+  depthStencilStateInfo.depthCompareOp = VK_COMPARE_OP_LESS;
+  depthStencilStateInfo.depthBoundsTestEnable = VK_FALSE;
+  depthStencilStateInfo.stencilTestEnable = VK_FALSE;
+  depthStencilStateInfo.minDepthBounds = 0.f;
+  depthStencilStateInfo.maxDepthBounds = 1.f;
+
   VkPipelineColorBlendAttachmentState colorBlendAttachmentState;
   colorBlendAttachmentState.blendEnable = VK_FALSE;
   colorBlendAttachmentState.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
@@ -986,163 +1357,188 @@ void initializePipeline()
   pipelineInfo.pViewportState = &viewportStateInfo;
   pipelineInfo.pRasterizationState = &rasterizerStateInfo;
   pipelineInfo.pMultisampleState = &multisampleStateInfo;
-  pipelineInfo.pDepthStencilState = nullptr;
+  pipelineInfo.pDepthStencilState = &depthStencilStateInfo;
   pipelineInfo.pColorBlendState = &colorBlendStateInfo;
-  pipelineInfo.pDynamicState = nullptr;
+  pipelineInfo.pDynamicState = &dynamicStateInfo;
   pipelineInfo.layout = pipelineLayout;
   pipelineInfo.renderPass = renderPass;
   pipelineInfo.subpass = 0;
   pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
   pipelineInfo.basePipelineIndex = 0;
 
-  checkResult(vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, allocator, &graphicsPipeline));
+  VkPipeline pipeline = VK_NULL_HANDLE;
+  checkResult(vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, allocator, &pipeline));
+  return pipeline;
 }
 
-void initializeUniformBuffers()
+void initializePipelines()
 {
-  constexpr VkDeviceSize bufferSize = sizeof(SquareUniformBufferData);
-
-  for(uint32_t i = 0; i < swapChainImageCount; ++i) {
-    swapChainImageContexts[i].squareUniformBuffer = createBuffer(
-      bufferSize,
-      VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT
-    );
+  for(int i = 0; i < ShaderFileCount; ++i) {
+    if(shaderFileLoads[i].valid()) {
+      shaderFiles[i] = shaderFileLoads[i].get();
+    }
   }
 
-  VkMemoryRequirements memoryRequirements;
-  vkGetBufferMemoryRequirements(device, swapChainImageContexts[0].squareUniformBuffer, &memoryRequirements);
-  squareUniformBufferMemoryOffset = memoryRequirements.size;
+  VkVertexInputBindingDescription cubeVertexInputBindingDescription;
+  cubeVertexInputBindingDescription.binding = 0;
+  cubeVertexInputBindingDescription.stride = sizeof(CubeMesher::Vertex);
+  cubeVertexInputBindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+  VkVertexInputAttributeDescription cubeVertexInputAttributeDescriptions[] = {
+    {0, 0, VK_FORMAT_R8G8B8A8_SINT, 0}
+  };
+  VkPipelineVertexInputStateCreateInfo cubeVertexInputStateInfo;
+  cubeVertexInputStateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+  cubeVertexInputStateInfo.pNext = nullptr;
+  cubeVertexInputStateInfo.flags = 0;
+  cubeVertexInputStateInfo.vertexBindingDescriptionCount = 1;
+  cubeVertexInputStateInfo.pVertexBindingDescriptions = &cubeVertexInputBindingDescription;
+  cubeVertexInputStateInfo.vertexAttributeDescriptionCount = arrayCount(cubeVertexInputAttributeDescriptions);
+  cubeVertexInputStateInfo.pVertexAttributeDescriptions = cubeVertexInputAttributeDescriptions;
+  pipelines[RenderPipeline::Cube] = createPipeline(
+    CubeVertexShaderFile, 
+    CubeFragmentShaderFile, 
+    cubeVertexInputStateInfo, 
+    VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST
+  );
 
-  squareUniformBufferMemory = createBufferMemory(
-    swapChainImageContexts[0].squareUniformBuffer, 
-    swapChainImageCount, 
-    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+  VkVertexInputBindingDescription gridVertexInputBindingDescription;
+  gridVertexInputBindingDescription.binding = 0;
+  gridVertexInputBindingDescription.stride = sizeof(Vec2f);
+  gridVertexInputBindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+  VkVertexInputAttributeDescription gridVertexInputAttributeDescriptions[] = {
+    {0, 0, VK_FORMAT_R32G32_SFLOAT, 0}
+  };
+  VkPipelineVertexInputStateCreateInfo gridVertexInputStateInfo = cubeVertexInputStateInfo;
+  gridVertexInputStateInfo.pVertexBindingDescriptions = &gridVertexInputBindingDescription;
+  gridVertexInputStateInfo.vertexAttributeDescriptionCount = arrayCount(gridVertexInputAttributeDescriptions);
+  gridVertexInputStateInfo.pVertexAttributeDescriptions = gridVertexInputAttributeDescriptions;
+  pipelines[RenderPipeline::Grid] = createPipeline(
+    GridVertexShaderFile, 
+    GridFragmentShaderFile, 
+    gridVertexInputStateInfo, 
+    VK_PRIMITIVE_TOPOLOGY_LINE_LIST
   );
+}
 
-  for(uint32_t i = 0; i < swapChainImageCount; ++i) {
-    checkResult(vkBindBufferMemory(
-      device, 
-      swapChainImageContexts[i].squareUniformBuffer, 
-      squareUniformBufferMemory, 
-      i * squareUniformBufferMemoryOffset
-    ));
-  }
-
-  checkResult(vkMapMemory(
-    device,
-    squareUniformBufferMemory,
-    0,
-    memoryRequirements.size * swapChainImageCount,
-    0,
-    reinterpret_cast<void**>(&squareUniformBufferMappedData)
-  ));
+void cleanupPipelines()
+{
+  for(VkPipeline& pipeline : pipelines) {
+    vkDestroyPipeline(device, pipeline, allocator);
+    pipeline = VK_NULL_HANDLE;
+  }
 }
 
-void initializeSwapChainFramebuffers()
+#ifdef DAR_DEBUG
+void recreatePipelines()
 {
-  VkFramebufferCreateInfo framebufferInfo;
-  framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-  framebufferInfo.pNext = nullptr;
-  framebufferInfo.flags = 0;
-  framebufferInfo.renderPass = renderPass;
-  framebufferInfo.width = swapChainInfo.imageExtent.width;
-  framebufferInfo.height = swapChainInfo.imageExtent.height;
-  framebufferInfo.layers = 1;
-  for(uint32_t i = 0; i < swapChainImageCount; ++i) {
-    VkImageView attachments[] = { renderTarget.colorImageView, swapChainImageContexts[i].imageView};
-    framebufferInfo.attachmentCount = arrayCount(attachments);
-    framebufferInfo.pAttachments = attachments;
-    checkResult(vkCreateFramebuffer(device, &framebufferInfo, allocator, &swapChainImageContexts[i].frameBuffer));
+  if(vkDeviceWaitIdle(device) != VK_SUCCESS) {
+    logError("Failed to wait for device idle before recreating the pipelines.");
+  }
+  cleanupPipelines();
+  initializePipelines();
+}
+
+void switchWireframe()
+{
+  if(!physicalDeviceFeatures.fillModeNonSolid) {
+    logWarning("The device can't render wireframes.");
+    return;
   }
+  isWireframe = !isWireframe;
+  recreatePipelines();
 }
+#endif
 
 void initializeCommandPool()
 {
   VkCommandPoolCreateInfo poolInfo;
   poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
   poolInfo.pNext = nullptr;
-  poolInfo.flags = 0;
+  // The command buffers of the frames are recorded anew every time they are used.
+  poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
   poolInfo.queueFamilyIndex = graphicsQueueFamilyIndex;
 
   checkResult(vkCreateCommandPool(device, &poolInfo, allocator, &graphicsCommandPool));
 }
 
-void initializeRenderTarget()
+/**
+ * @brief Submits a command buffer to the graphics queue and waits until it was executed, for work outside of frames.
+ */
+void submitAndWait(VkCommandBuffer commandBuffer)
 {
-  renderTarget.sampleCount = selectSampleCount();
-  create2DImage(
-    swapChainInfo.imageExtent.width, 
-    swapChainInfo.imageExtent.height, 
-    swapChainInfo.imageFormat, 
-    1, 
-    renderTarget.sampleCount,
-    VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, 
-    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-    VK_IMAGE_ASPECT_COLOR_BIT,
-    &renderTarget.colorImage,
-    &renderTarget.colorImageMemory,
-    &renderTarget.colorImageView
-  );
-}
-
-void initializeCommandBuffers()
-{
-  VkCommandBufferAllocateInfo allocateInfo;
-  allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-  allocateInfo.pNext = nullptr;
-  allocateInfo.commandPool = graphicsCommandPool;
-  allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-  allocateInfo.commandBufferCount = swapChainImageCount;
-  VkCommandBuffer swapChainCommandBuffers[32];
-  checkResult(vkAllocateCommandBuffers(device, &allocateInfo, swapChainCommandBuffers));
-  for(uint32_t i = 0; i < swapChainImageCount; ++i) {
-    swapChainImageContexts[i].commandBuffer = swapChainCommandBuffers[i];
-  }
+  VkSubmitInfo submitInfo{};
+  submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+  submitInfo.commandBufferCount = 1;
+  submitInfo.pCommandBuffers = &commandBuffer;
 
-  VkRenderPassBeginInfo renderPassBeginInfo;
-  renderPassBeginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-  renderPassBeginInfo.pNext = nullptr;
-  renderPassBeginInfo.renderPass = renderPass;
-  renderPassBeginInfo.renderArea.offset = { 0, 0 };
-  renderPassBeginInfo.renderArea.extent = swapChainInfo.imageExtent;
-  VkClearValue clearColor;
-  clearColor.color = { 0.2f, 0.2f, 0.2f, 1.0f };
-  clearColor.depthStencil = {};
-  renderPassBeginInfo.clearValueCount = 1;
-  renderPassBeginInfo.pClearValues = &clearColor;
-  for(uint32_t i = 0; i < swapChainImageCount; ++i) {
-    SwapChainImageContext& context = swapChainImageContexts[i];
-    VkCommandBuffer commandBuffer = context.commandBuffer;
+  checkResult(vkQueueSubmit(transferQueue, 1, &submitInfo, VK_NULL_HANDLE));
+  checkResult(vkQueueWaitIdle(transferQueue));
+}
 
-    CommandRecorder commandRecorder(commandBuffer);
+void recordMemoryBarrier(
+  VkCommandBuffer commandBuffer, 
+  VkPipelineStageFlags srcStageMask, 
+  VkAccessFlags srcAccessMask, 
+  VkPipelineStageFlags dstStageMask, 
+  VkAccessFlags dstAccessMask
+)
+{
+  VkMemoryBarrier barrier;
+  barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  barrier.pNext = nullptr;
+  barrier.srcAccessMask = srcAccessMask;
+  barrier.dstAccessMask = dstAccessMask;
+  vkCmdPipelineBarrier(commandBuffer, srcStageMask, dstStageMask, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+}
 
-    renderPassBeginInfo.framebuffer = context.frameBuffer;
-    RenderPassRecorder renderPassRecorder(commandBuffer, renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+void createFrameSlotBuffer(VkDeviceSize slotSize, VkBufferUsageFlags usage, FrameSlotBuffer* result)
+{
+  result->slotSize = slotSize;
+  createBuffer(
+    slotSize * maxFramesInFlight, 
+    usage, 
+    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+    &result->buffer,
+    &result->memory
+  );
+  result->mappedData = result->memory.mappedData;
+}
 
-    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
+void cleanupFrameSlotBuffer(FrameSlotBuffer& buffer)
+{
+  vkDestroyBuffer(device, buffer.buffer, allocator);
+  deviceMemory.deallocate(buffer.memory);
+  buffer = {};
+}
 
-    const VkDeviceSize offset = offsetof(SquareData, vertices);
-    vkCmdBindVertexBuffers(commandBuffer, 0, 1, &squareDataBuffer, &offset);
+/**
+ * @brief Creates a device local buffer and copies data into it through a staging buffer.
+ */
+void createStaticBuffer(const void* data, VkDeviceSize size, VkBufferUsageFlags usage, VkBuffer* buffer, MemoryAllocation* bufferMemory)
+{
+  createBuffer(size, usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, buffer, bufferMemory);
 
-    vkCmdBindIndexBuffer(commandBuffer, squareDataBuffer, offsetof(SquareData, indices), VK_INDEX_TYPE_UINT16);
+  StagingBuffer stagingBuffer(size);
+  stagingBuffer.write(data, size);
 
-    vkCmdBindDescriptorSets(
-      commandBuffer, 
-      VK_PIPELINE_BIND_POINT_GRAPHICS, 
-      pipelineLayout, 
-      0, 
-      1, 
-      &context.squareUniformBufferDescriptorSet, 
-      0, 
-      nullptr
-    );
+  PrimaryCommandBuffer commandBuffer(graphicsCommandPool);
+  {
+    CommandRecorder recorder(commandBuffer, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
 
-    vkCmdDrawIndexed(commandBuffer, arrayCount(squareData.indices), 1, 0, 0, 0);
+    stagingBuffer.copyTo(commandBuffer, *buffer, size);
   }
+  submitAndWait(commandBuffer);
 }
 
-void initializeSyncObjects()
+void initializeFrameContexts()
 {
+  VkCommandBufferAllocateInfo allocateInfo;
+  allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+  allocateInfo.pNext = nullptr;
+  allocateInfo.commandPool = graphicsCommandPool;
+  allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+  allocateInfo.commandBufferCount = 1;
+
   VkSemaphoreCreateInfo semaphoreInfo;
   semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
   semaphoreInfo.pNext = nullptr;
@@ -1153,140 +1549,261 @@ void initializeSyncObjects()
   fenceInfo.pNext = nullptr;
   fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
 
-  for(int i = 0; i < maxFramesInFlight; ++i) {
-    checkResult(vkCreateSemaphore(device, &semaphoreInfo, allocator, swapChainImageAvailableSemaphores + i));
-    checkResult(vkCreateSemaphore(device, &semaphoreInfo, allocator, swapChainImageRenderFinishedSemaphores + i));
-    checkResult(vkCreateFence(device, &fenceInfo, allocator, swapChainImagesInFlightFences + i));
+  for(FrameContext& context : frameContexts) {
+    checkResult(vkAllocateCommandBuffers(device, &allocateInfo, &context.commandBuffer));
+    checkResult(vkCreateFence(device, &fenceInfo, allocator, &context.fence));
+    checkResult(vkCreateSemaphore(device, &semaphoreInfo, allocator, &context.swapChainImageAvailableSemaphore));
+    checkResult(vkCreateSemaphore(device, &semaphoreInfo, allocator, &context.swapChainImageRenderFinishedSemaphore));
   }
-}
 
-void initializeSquareBuffers()
-{
-  constexpr VkDeviceSize vertexBufferSize = sizeof(squareData.vertices);
-  constexpr VkDeviceSize indexBufferSize = sizeof(squareData.indices);
-  constexpr VkDeviceSize bufferSize = sizeof(squareData);
-  createBuffer(
-    bufferSize, 
-    VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-    &squareDataBuffer, 
-    &squareDataBufferMemory
+  // Dynamic uniform buffer offsets have to be multiples of the alignment.
+  const VkDeviceSize uniformAlignment = physicalDeviceProperties.limits.minUniformBufferOffsetAlignment;
+  const VkDeviceSize paletteSlotSize = (sizeof(CubePalette) + uniformAlignment - 1) / uniformAlignment * uniformAlignment;
+  createFrameSlotBuffer(paletteSlotSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, &paletteBuffer);
+  createFrameSlotBuffer(
+    cubeChunkCount * (maxCubeChunkVertexCount * sizeof(CubeMesher::Vertex) + maxCubeChunkIndexCount * sizeof(uint32_t)),
+    VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+    &stagingBuffer
   );
-
-  StagingBuffer squareDataStagingBuffer(bufferSize);
-  squareDataStagingBuffer.write(&squareData, bufferSize);
-
-  PrimaryCommandBuffer commandBuffer(graphicsCommandPool);
-  {
-    CommandRecorder recorder(commandBuffer, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
-
-    squareDataStagingBuffer.copyTo(commandBuffer, squareDataBuffer, bufferSize);
-  }
-
-  VkSubmitInfo submitInfo{};
-  submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-  submitInfo.commandBufferCount = 1;
-  VkCommandBuffer commandBufferHandle = commandBuffer;
-  submitInfo.pCommandBuffers = &commandBufferHandle;
-
-  vkQueueSubmit(transferQueue, 1, &submitInfo, VK_NULL_HANDLE);
-  vkQueueWaitIdle(transferQueue);
 }
 
-void initializeSquareUniformBufferDescriptors()
+void initializeDescriptors()
 {
   VkDescriptorPoolSize poolSize;
-  poolSize.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-  poolSize.descriptorCount = swapChainImageCount;
+  poolSize.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+  poolSize.descriptorCount = 1;
 
   VkDescriptorPoolCreateInfo poolInfo;
   poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
   poolInfo.pNext = nullptr;
   poolInfo.flags = 0;
-  poolInfo.maxSets = swapChainImageCount;
+  poolInfo.maxSets = 1;
   poolInfo.poolSizeCount = 1;
   poolInfo.pPoolSizes = &poolSize;
   checkResult(vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool));
 
-  VkDescriptorSetLayout layouts[16];
-  std::fill_n(layouts, swapChainImageCount, squareUniformBufferDescriptorSetLayout);
   VkDescriptorSetAllocateInfo setAllocateInfo;
   setAllocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
   setAllocateInfo.pNext = nullptr;
   setAllocateInfo.descriptorPool = descriptorPool;
-  setAllocateInfo.descriptorSetCount = swapChainImageCount;
-  setAllocateInfo.pSetLayouts = layouts;
-  VkDescriptorSet descriptorSets[16];
-  checkResult(vkAllocateDescriptorSets(device, &setAllocateInfo, descriptorSets));
+  setAllocateInfo.descriptorSetCount = 1;
+  setAllocateInfo.pSetLayouts = &paletteDescriptorSetLayout;
+  checkResult(vkAllocateDescriptorSets(device, &setAllocateInfo, &paletteDescriptorSet));
 
+  // The offset of the slot of a frame is added when the set is bound.
   VkDescriptorBufferInfo bufferInfo;
+  bufferInfo.buffer = paletteBuffer.buffer;
   bufferInfo.offset = 0;
-  bufferInfo.range = sizeof(SquareUniformBufferData);
+  bufferInfo.range = sizeof(CubePalette);
   VkWriteDescriptorSet setWriteInfo;
   setWriteInfo.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
   setWriteInfo.pNext = nullptr;
+  setWriteInfo.dstSet = paletteDescriptorSet;
   setWriteInfo.dstBinding = 0;
   setWriteInfo.dstArrayElement = 0;
   setWriteInfo.descriptorCount = 1;
-  setWriteInfo.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+  setWriteInfo.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+  setWriteInfo.pImageInfo = nullptr;
   setWriteInfo.pBufferInfo = &bufferInfo;
-
-  for(uint32_t i = 0; i < swapChainImageCount; ++i) {
-    SwapChainImageContext& context = swapChainImageContexts[i];
-    context.squareUniformBufferDescriptorSet = descriptorSets[i];
-    bufferInfo.buffer = context.squareUniformBuffer;
-    setWriteInfo.dstSet = context.squareUniformBufferDescriptorSet;
-    vkUpdateDescriptorSets(device, 1, &setWriteInfo, 0, nullptr);
-  }
+  setWriteInfo.pTexelBufferView = nullptr;
+  vkUpdateDescriptorSets(device, 1, &setWriteInfo, 0, nullptr);
 }
 
-void cleanupSwapChainContext()
+void initializeMeshes()
 {
-  VkCommandBuffer swapChainCommandBuffers[32];
-  for(uint32_t i = 0; i < swapChainImageCount; ++i) {
-    swapChainCommandBuffers[i] = swapChainImageContexts[i].commandBuffer;
-  }
-  vkFreeCommandBuffers(device, graphicsCommandPool, swapChainImageCount, swapChainCommandBuffers);
+  // Cube chunks have fixed slots, the mesh updates of the frames are copied into them.
+  Mesh& cubes = meshes[RenderMesh::Cubes];
+  cubes.vertexStride = sizeof(CubeMesher::Vertex);
+  createBuffer(
+    cubeChunkCount * maxCubeChunkVertexCount * sizeof(CubeMesher::Vertex),
+    VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+    &cubes.vertexBuffer,
+    &cubes.vertexBufferMemory
+  );
+  createBuffer(
+    cubeChunkCount * maxCubeChunkIndexCount * sizeof(uint32_t),
+    VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+    &cubes.indexBuffer,
+    &cubes.indexBufferMemory
+  );
 
-  for(uint32_t i = 0; i < swapChainImageCount; ++i) {
-    vkDestroyFramebuffer(device, swapChainImageContexts[i].frameBuffer, allocator);
-    vkDestroyImageView(device, swapChainImageContexts[i].imageView, allocator);
+  // The cubes of the tetracube are indexed alike, only their vertices change.
+  std::vector<CubeMesher::Vertex> tetracubeVertices;
+  std::vector<uint32_t> tetracubeIndices;
+  for(int i = 0; i < tetracubeCubeCount; ++i) {
+    CubeMesher::appendCube({}, 0, tetracubeVertices, tetracubeIndices);
   }
+  Mesh& tetracube = meshes[RenderMesh::Tetracube];
+  tetracube.vertexStride = sizeof(CubeMesher::Vertex);
+  tetracube.isDynamic = true;
+  FrameSlotBuffer tetracubeVertexBuffer;
+  createFrameSlotBuffer(
+    tetracubeVertices.size() * sizeof(CubeMesher::Vertex), 
+    VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, 
+    &tetracubeVertexBuffer
+  );
+  tetracube.vertexBuffer = tetracubeVertexBuffer.buffer;
+  tetracube.vertexBufferMemory = tetracubeVertexBuffer.memory;
+  tetracube.mappedVertices = tetracubeVertexBuffer.mappedData;
+  tetracube.vertexSlotSize = tetracubeVertexBuffer.slotSize;
+  createStaticBuffer(
+    tetracubeIndices.data(), 
+    tetracubeIndices.size() * sizeof(uint32_t), 
+    VK_BUFFER_USAGE_INDEX_BUFFER_BIT, 
+    &tetracube.indexBuffer, 
+    &tetracube.indexBufferMemory
+  );
 
-  vkDestroyImageView(device, renderTarget.colorImageView, nullptr);
-  vkDestroyImage(device, renderTarget.colorImage, nullptr);
-  vkFreeMemory(device, renderTarget.colorImageMemory, nullptr);
-
-  vkDestroyPipeline(device, graphicsPipeline, allocator);
-  vkDestroyPipelineLayout(device, pipelineLayout, allocator);
+  for(const RenderMesh::Type gridMesh : { RenderMesh::BottomGrid, RenderMesh::SideGrid, RenderMesh::FrontGrid }) {
+    std::vector<Vec2f> vertices(calculateGridVertexCount(gridMesh));
+    generateGridVertices(gridMesh, vertices.data());
+    Mesh& grid = meshes[gridMesh];
+    grid.vertexStride = sizeof(Vec2f);
+    createStaticBuffer(
+      vertices.data(), 
+      vertices.size() * sizeof(Vec2f), 
+      VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, 
+      &grid.vertexBuffer, 
+      &grid.vertexBufferMemory
+    );
+  }
+}
 
-  for(uint32_t i = 0; i < swapChainImageCount; ++i) {
-    vkDestroyBuffer(device, swapChainImageContexts[i].squareUniformBuffer, nullptr);
+void cleanupMeshes()
+{
+  for(Mesh& mesh : meshes) {
+    vkDestroyBuffer(device, mesh.vertexBuffer, allocator);
+    deviceMemory.deallocate(mesh.vertexBufferMemory);
+    vkDestroyBuffer(device, mesh.indexBuffer, allocator);
+    deviceMemory.deallocate(mesh.indexBufferMemory);
+    mesh = {};
   }
-  vkFreeMemory(device, squareUniformBufferMemory, nullptr);
+}
 
-  vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+void initializeRenderTarget()
+{
+  create2DImage(
+    renderTarget.extent.width, 
+    renderTarget.extent.height, 
+    resolveFormat, 
+    1, 
+    renderTarget.sampleCount,
+    VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, 
+    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+    VK_IMAGE_ASPECT_COLOR_BIT,
+    &renderTarget.colorImage,
+    &renderTarget.colorImageMemory,
+    &renderTarget.colorImageView
+  );
+  create2DImage(
+    renderTarget.extent.width, 
+    renderTarget.extent.height, 
+    renderTarget.depthFormat, 
+    1, 
+    renderTarget.sampleCount,
+    VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, 
+    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+    VK_IMAGE_ASPECT_DEPTH_BIT,
+    &renderTarget.depthImage,
+    &renderTarget.depthImageMemory,
+    &renderTarget.depthImageView
+  );
+}
 
-  vkDestroyRenderPass(device, renderPass, allocator);
+VkFramebuffer createFramebuffer(VkImageView resolveImageView)
+{
+  VkImageView attachments[] = { renderTarget.colorImageView, renderTarget.depthImageView, resolveImageView };
+  VkFramebufferCreateInfo framebufferInfo;
+  framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+  framebufferInfo.pNext = nullptr;
+  framebufferInfo.flags = 0;
+  framebufferInfo.renderPass = renderPass;
+  framebufferInfo.attachmentCount = arrayCount(attachments);
+  framebufferInfo.pAttachments = attachments;
+  framebufferInfo.width = renderTarget.extent.width;
+  framebufferInfo.height = renderTarget.extent.height;
+  framebufferInfo.layers = 1;
+  VkFramebuffer framebuffer = VK_NULL_HANDLE;
+  checkResult(vkCreateFramebuffer(device, &framebufferInfo, allocator, &framebuffer));
+  return framebuffer;
+}
+
+void initializeOffscreenImage()
+{
+  create2DImage(
+    renderTarget.extent.width, 
+    renderTarget.extent.height, 
+    resolveFormat, 
+    1, 
+    VK_SAMPLE_COUNT_1_BIT,
+    VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, 
+    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+    VK_IMAGE_ASPECT_COLOR_BIT,
+    &offscreenImage.image,
+    &offscreenImage.imageMemory,
+    &offscreenImage.imageView
+  );
+  createBuffer(
+    VkDeviceSize(renderTarget.extent.width) * renderTarget.extent.height * sizeof(uint32_t),
+    VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+    &offscreenImage.readbackBuffer,
+    &offscreenImage.readbackBufferMemory
+  );
+  offscreenImage.readbackData = reinterpret_cast<const uint32_t*>(offscreenImage.readbackBufferMemory.mappedData);
+  offscreenImage.isRendered = false;
+}
 
-  vkDestroySwapchainKHR(device, swapChain, allocator);
+void cleanupSwapChainContext()
+{
+  if(isOffscreen) {
+    vkDestroyFramebuffer(device, offscreenImage.frameBuffer, allocator);
+    vkDestroyImageView(device, offscreenImage.imageView, nullptr);
+    vkDestroyImage(device, offscreenImage.image, nullptr);
+    deviceMemory.deallocate(offscreenImage.imageMemory);
+    vkDestroyBuffer(device, offscreenImage.readbackBuffer, allocator);
+    deviceMemory.deallocate(offscreenImage.readbackBufferMemory);
+    offscreenImage = {};
+  } else {
+    for(uint32_t i = 0; i < swapChainImageCount; ++i) {
+      vkDestroyFramebuffer(device, swapChainImageContexts[i].frameBuffer, allocator);
+      vkDestroyImageView(device, swapChainImageContexts[i].imageView, allocator);
+    }
+    vkDestroySwapchainKHR(device, swapChain, allocator);
+    swapChain = nullptr;
+    delete[] swapChainImageContexts;
+    swapChainImageContexts = nullptr;
+    swapChainImageCount = 0;
+  }
 
-  delete[] swapChainImageContexts;
+  vkDestroyImageView(device, renderTarget.colorImageView, nullptr);
+  vkDestroyImage(device, renderTarget.colorImage, nullptr);
+  deviceMemory.deallocate(renderTarget.colorImageMemory);
+  vkDestroyImageView(device, renderTarget.depthImageView, nullptr);
+  vkDestroyImage(device, renderTarget.depthImage, nullptr);
+  deviceMemory.deallocate(renderTarget.depthImageMemory);
 }
 
+/**
+ * @brief Creates the images that depend on the size of the client area. Offscreen renderTarget.extent has to be set.
+ */
 void initializeSwapChainContext()
 {
+  if(isOffscreen) {
+    initializeOffscreenImage();
+    initializeRenderTarget();
+    offscreenImage.frameBuffer = createFramebuffer(offscreenImage.imageView);
+    return;
+  }
   if(!initSwapChain()) {
     throw VulkanRenderer::Exception("Failed to initialize swapChain.");
   }
   initializeRenderTarget();
-  initializeRenderPass();
-  initializeDescriptorSetLayout();
-  initializePipeline();
-  initializeUniformBuffers();
-  initializeSquareUniformBufferDescriptors();
-  initializeSwapChainFramebuffers();
-  initializeCommandBuffers();
+  for(uint32_t i = 0; i < swapChainImageCount; ++i) {
+    swapChainImageContexts[i].frameBuffer = createFramebuffer(swapChainImageContexts[i].imageView);
+  }
 }
 
 void recreateSwapChainContext()
@@ -1299,99 +1816,367 @@ void recreateSwapChainContext()
   initializeSwapChainContext();
 }
 
-void updateUniformBuffer(uint32_t swapChainImageIndex, float dTime)
+/**
+ * @brief Writes the mesh updates of the frame, dynamic meshes through their slot of the frame and static meshes
+ * with copies from the staging buffer, recorded before the render pass.
+ */
+void applyMeshUpdates(VkCommandBuffer commandBuffer, const De::RenderQueue& queue, uint32_t frameIndex)
 {
-  SquareUniformBufferData bufferData;
-  bufferData.transform = Mat4f::translation({0.25f, 0.25f, 0.f}) * Mat4f::rotationZ(Pi / 8);
+  DAR_PROFILE_SCOPE("applyMeshUpdates");
+  const VkDeviceSize stagingSlotOffset = frameIndex * stagingBuffer.slotSize;
+  VkDeviceSize stagingSize = 0;
+  bool isCopying = false;
+  for(int i = 0; i < queue.getMeshUpdateCount(); ++i) {
+    const De::MeshUpdate& update = queue.getMeshUpdates()[i];
+    const Mesh& mesh = meshes[update.mesh];
+    const VkDeviceSize verticesSize = VkDeviceSize(update.vertexCount) * mesh.vertexStride;
+    if(mesh.isDynamic) {
+      // A dynamic mesh is rewritten from its first vertex.
+      assert(update.firstVertex == 0 && update.indexCount == 0 && verticesSize <= mesh.vertexSlotSize);
+      memcpy(mesh.mappedVertices + frameIndex * mesh.vertexSlotSize, update.vertices, verticesSize);
+      continue;
+    }
+    const VkDeviceSize indicesSize = VkDeviceSize(update.indexCount) * sizeof(uint32_t);
+    if(stagingSize + verticesSize + indicesSize > stagingBuffer.slotSize) {
+      logError("The mesh updates of the frame don't fit into the staging buffer.");
+      break;
+    }
+    if(!isCopying) {
+      // The previous frames may still draw from the ranges that are overwritten.
+      recordMemoryBarrier(commandBuffer, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 0, VK_PIPELINE_STAGE_TRANSFER_BIT, 0);
+      isCopying = true;
+    }
+    uint8_t* staging = stagingBuffer.mappedData + stagingSlotOffset;
+    if(verticesSize > 0) {
+      memcpy(staging + stagingSize, update.vertices, verticesSize);
+      const VkBufferCopy copy{ stagingSlotOffset + stagingSize, VkDeviceSize(update.firstVertex) * mesh.vertexStride, verticesSize };
+      vkCmdCopyBuffer(commandBuffer, stagingBuffer.buffer, mesh.vertexBuffer, 1, &copy);
+      stagingSize += verticesSize;
+    }
+    if(indicesSize > 0) {
+      memcpy(staging + stagingSize, update.indices, indicesSize);
+      const VkBufferCopy copy{ stagingSlotOffset + stagingSize, VkDeviceSize(update.firstIndex) * sizeof(uint32_t), indicesSize };
+      vkCmdCopyBuffer(commandBuffer, stagingBuffer.buffer, mesh.indexBuffer, 1, &copy);
+      stagingSize += indicesSize;
+    }
+  }
+  if(isCopying) {
+    recordMemoryBarrier(
+      commandBuffer,
+      VK_PIPELINE_STAGE_TRANSFER_BIT, 
+      VK_ACCESS_TRANSFER_WRITE_BIT,
+      VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 
+      VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT
+    );
+  }
+}
 
-  constexpr VkDeviceSize bufferSize = sizeof(bufferData);
-  const VkDeviceSize offset = swapChainImageIndex * squareUniformBufferMemoryOffset;
-  memcpy(
-    squareUniformBufferMappedData + offset, 
-    &bufferData, 
-    bufferSize
-  );
+void bindMesh(VkCommandBuffer commandBuffer, const Mesh& mesh, uint32_t frameIndex)
+{
+  const VkDeviceSize vertexBufferOffset = mesh.isDynamic ? frameIndex * mesh.vertexSlotSize : 0;
+  vkCmdBindVertexBuffers(commandBuffer, 0, 1, &mesh.vertexBuffer, &vertexBufferOffset);
+  if(mesh.indexBuffer) {
+    vkCmdBindIndexBuffer(commandBuffer, mesh.indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+  }
 }
 
-} // anonymous namespace
+/**
+ * @brief Records the sorted commands, state is only set when it differs from the previous command.
+ */
+void executeCommands(VkCommandBuffer commandBuffer, const De::RenderQueue& queue, uint32_t frameIndex)
+{
+  DAR_PROFILE_SCOPE("executeCommands");
+  int boundPipeline = -1;
+  int boundMesh = -1;
+  const void* boundConstants = nullptr;
+  for(const De::RenderCommand& command : queue) {
+    if(command.pipeline != boundPipeline) {
+      vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines[command.pipeline]);
+      boundPipeline = command.pipeline;
+    }
+    if(command.mesh != boundMesh) {
+      bindMesh(commandBuffer, meshes[command.mesh], frameIndex);
+      boundMesh = command.mesh;
+    }
+    if(command.constants != boundConstants) {
+      assert(command.constantsSize <= maxConstantsSize && command.constantsSize % 4 == 0);
+      vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, command.constantsSize, command.constants);
+      boundConstants = command.constants;
+    }
+    if(meshes[command.mesh].indexBuffer) {
+      vkCmdDrawIndexed(commandBuffer, command.elementCount, 1, command.firstElement, command.baseVertex, 0);
+    } else {
+      vkCmdDraw(commandBuffer, command.elementCount, 1, command.firstElement, 0);
+    }
+  }
+}
+
+/**
+ * @brief Records the render pass of the frame into the framebuffer.
+ */
+void recordDrawing(VkCommandBuffer commandBuffer, const RenderFrame& frame, VkFramebuffer framebuffer, uint32_t frameIndex)
+{
+  VkClearValue clearValues[2];
+  clearValues[0].color = { { frame.clearColor.r, frame.clearColor.g, frame.clearColor.b, frame.clearColor.a } };
+  clearValues[1].depthStencil = { 1.f, 0 };
+  VkRenderPassBeginInfo renderPassBeginInfo;
+  renderPassBeginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+  renderPassBeginInfo.pNext = nullptr;
+  renderPassBeginInfo.renderPass = renderPass;
+  renderPassBeginInfo.framebuffer = framebuffer;
+  renderPassBeginInfo.renderArea.offset = { 0, 0 };
+  renderPassBeginInfo.renderArea.extent = renderTarget.extent;
+  renderPassBeginInfo.clearValueCount = arrayCount(clearValues);
+  renderPassBeginInfo.pClearValues = clearValues;
+  RenderPassRecorder renderPassRecorder(commandBuffer, renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+  VkViewport viewport;
+  viewport.x = 0.f;
+  viewport.y = 0.f;
+  viewport.width = static_cast<float>(renderTarget.extent.width);
+  viewport.height = static_cast<float>(renderTarget.extent.height);
+  viewport.minDepth = 0.f;
+  viewport.maxDepth = 1.f;
+  vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+  const VkRect2D scissor = { { 0, 0 }, renderTarget.extent };
+  vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+  const uint32_t paletteOffset = uint32_t(frameIndex * paletteBuffer.slotSize);
+  vkCmdBindDescriptorSets(
+    commandBuffer, 
+    VK_PIPELINE_BIND_POINT_GRAPHICS, 
+    pipelineLayout, 
+    0, 
+    1, 
+    &paletteDescriptorSet, 
+    1, 
+    &paletteOffset
+  );
+
+  executeCommands(commandBuffer, frame.queue, frameIndex);
+}
 
-VulkanRenderer::VulkanRenderer(HWND window)
+void loadVulkanLibrary()
 {
-  HMODULE vulkanLibrary = LoadLibrary("vulkan-1.dll");
-  if(!vulkanLibrary) {
-    throw Exception("Failed to load vulkan library.");
+  try {
+    vulkanLibrary = std::make_unique<De::Library>(vulkanLibraryName);
+  } catch(const De::Exception& e) {
+    throw VulkanRenderer::InitializeException(std::string("Failed to load vulkan library: ") + e.what());
   }
-  #define EXPORTED_VULKAN_FUNCTION(name) name = reinterpret_cast<PFN_##name>(GetProcAddress(vulkanLibrary, #name));
+  #define EXPORTED_VULKAN_FUNCTION(name) name = reinterpret_cast<PFN_##name>(vulkanLibrary->loadFunction(#name));
   #define GLOBAL_LEVEL_VULKAN_FUNCTION(name) name = reinterpret_cast<PFN_##name>(vkGetInstanceProcAddr(nullptr, #name));
   #include "ListOfVulkanFunctions.inl"
-  initInstance();
-
-  initializePresentationSurface(window);
+}
 
+/**
+ * @brief Creates everything after the presentation surface, the same with and without one.
+ */
+void initializeDeviceContext()
+{
   initializePhysicalDevice();
   initDevice();
   initializeCommandPool();
-  initializeSquareBuffers();
+  renderTarget.sampleCount = selectSampleCount();
+  renderTarget.depthFormat = selectDepthFormat();
+  initializeRenderPass();
+  initializeDescriptorSetLayout();
+  initializeFrameContexts();
+  initializeDescriptors();
+  initializeMeshes();
+  initializePipelines();
   initializeSwapChainContext();
-  initializeSyncObjects();
+  renderCount = 0;
+  deviceMemory.logStatistics();
+}
+
+} // anonymous namespace
+
+#ifdef _WIN32
+VulkanRenderer::VulkanRenderer(HWND window, De::AssetLoader& assetLoader)
+{
+  assetLoader.readBatch(shaderFileNames, ShaderFileCount, shaderFileLoads);
+
+  isOffscreen = false;
+  resolveFormat = VK_FORMAT_B8G8R8A8_UNORM;
+  loadVulkanLibrary();
+  initInstance();
+
+  initializePresentationSurface(window);
+
+  initializeDeviceContext();
+  clientAreaSize = { int(renderTarget.extent.width), int(renderTarget.extent.height) };
+}
+#endif
+
+VulkanRenderer::VulkanRenderer(int width, int height, De::AssetLoader& assetLoader)
+{
+  assetLoader.readBatch(shaderFileNames, ShaderFileCount, shaderFileLoads);
+
+  isOffscreen = true;
+  // Red in the lowest byte when read back, like the pixels of SoftwareRenderer.
+  resolveFormat = VK_FORMAT_R8G8B8A8_UNORM;
+  renderTarget.extent = { uint32_t(width), uint32_t(height) };
+  loadVulkanLibrary();
+  initInstance();
+
+  initializeDeviceContext();
+  clientAreaSize = { width, height };
+}
+
+VulkanRenderer::~VulkanRenderer()
+{
+  if(vkDeviceWaitIdle(device) != VK_SUCCESS) {
+    logError("Failed to wait for device idle before destroying the renderer.");
+  }
+  cleanupSwapChainContext();
+  cleanupPipelines();
+  cleanupMeshes();
+  vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+  vkDestroyPipelineLayout(device, pipelineLayout, allocator);
+  vkDestroyDescriptorSetLayout(device, paletteDescriptorSetLayout, nullptr);
+  cleanupFrameSlotBuffer(paletteBuffer);
+  cleanupFrameSlotBuffer(stagingBuffer);
+  for(FrameContext& context : frameContexts) {
+    vkDestroySemaphore(device, context.swapChainImageAvailableSemaphore, allocator);
+    vkDestroySemaphore(device, context.swapChainImageRenderFinishedSemaphore, allocator);
+    vkDestroyFence(device, context.fence, allocator);
+    context = {};
+  }
+  // Frees the command buffers of the frames as well.
+  vkDestroyCommandPool(device, graphicsCommandPool, allocator);
+  vkDestroyRenderPass(device, renderPass, allocator);
+  deviceMemory.cleanup();
+  vkDestroyDevice(device, allocator);
+  device = nullptr;
+  if(presentationSurface) {
+    vkDestroySurfaceKHR(instance, presentationSurface, allocator);
+    presentationSurface = nullptr;
+  }
+#ifdef DAR_DEBUG
+  vkDestroyDebugUtilsMessengerEXT(instance, messenger, allocator);
+  messenger = nullptr;
+#endif
+  vkDestroyInstance(instance, allocator);
+  instance = nullptr;
+  vulkanLibrary.reset();
 }
 
 void VulkanRenderer::onWindowResize(int clientAreaWidth, int clientAreaHeight)
 {
+  clientAreaSize = { clientAreaWidth, clientAreaHeight };
+  // The swap chain takes the size of the surface.
+  renderTarget.extent = { uint32_t(clientAreaWidth), uint32_t(clientAreaHeight) };
   recreateSwapChainContext();
 }
 
-void VulkanRenderer::render(const GameState& gameState)
+#ifdef DAR_DEBUG
+void VulkanRenderer::watchShaders(De::FileWatcher& fileWatcher)
 {
-  uint32_t syncIndex = renderCount % maxFramesInFlight;
+  fileWatcher.subscribe("shaders", ".spv", reloadShaderFile);
+}
+#endif
 
-  if(vkWaitForFences(device, 1, &swapChainImagesInFlightFences[syncIndex], VK_TRUE, UINT64_MAX) != VK_SUCCESS) {
-    logError("Failed to wait for a image in flight fence with index %u.", syncIndex);
+void VulkanRenderer::render(const RenderFrame& frame)
+{
+  isSwapChainImageAcquired = false;
+  // Nothing to render into while the window is minimized, or if no swap chain image could be acquired.
+  // The frame is still submitted, its mesh updates are only sent once and the static meshes would miss them.
+  bool isDrawing = frame.clientAreaWidth > 0 && frame.clientAreaHeight > 0;
+  if(isDrawing && (frame.clientAreaWidth != clientAreaSize.x || frame.clientAreaHeight != clientAreaSize.y)) {
+    onWindowResize(frame.clientAreaWidth, frame.clientAreaHeight);
   }
 
-  uint32_t imageIndex;
-  VkSemaphore swapChainImageAvailableSemaphore = swapChainImageAvailableSemaphores[syncIndex];
-  VkResult result = vkAcquireNextImageKHR(device, swapChain, UINT64_MAX, swapChainImageAvailableSemaphore, VK_NULL_HANDLE, &imageIndex);
-  bool isSwapChainSuboptimal = false;
-  if(result == VK_SUBOPTIMAL_KHR) {
-    logWarning("Suboptimal swap chain detected after acquiring next swap chain image.");
-    isSwapChainSuboptimal = true;
-  } else if(result == VK_ERROR_OUT_OF_DATE_KHR) {
-    logError("Failed to acquire next swap chain image because swap chain is out of date.");
-    recreateSwapChainContext();
-    return;
-  } else if(result != VK_SUCCESS) {
-    logError("Failed to acquire next swap chain image.");
-    return;
+  #ifdef DAR_DEBUG
+    if(swapReloadedShaderFiles()) {
+      recreatePipelines();
+    }
+    if(frame.switchWireframe) {
+      switchWireframe();
+    }
+  #endif
+
+  const uint32_t frameIndex = renderCount % maxFramesInFlight;
+  FrameContext& context = frameContexts[frameIndex];
+
+  {
+    DAR_PROFILE_SCOPE("VulkanRenderer::waitForFrame");
+    if(vkWaitForFences(device, 1, &context.fence, VK_TRUE, UINT64_MAX) != VK_SUCCESS) {
+      logError("Failed to wait for the fence of frame %u.", frameIndex);
+    }
   }
 
-  if(swapChainImageContexts[imageIndex].fence) {
-    if(vkWaitForFences(device, 1, &swapChainImageContexts[imageIndex].fence, VK_TRUE, UINT64_MAX) != VK_SUCCESS) {
-      logError("Failed to wait for a swapchain image fence with index %u.", imageIndex);
+  VkFramebuffer framebuffer = offscreenImage.frameBuffer;
+  if(isDrawing && !isOffscreen) {
+    VkResult result = vkAcquireNextImageKHR(
+      device, 
+      swapChain, 
+      UINT64_MAX, 
+      context.swapChainImageAvailableSemaphore, 
+      VK_NULL_HANDLE, 
+      &acquiredSwapChainImageIndex
+    );
+    if(result == VK_SUBOPTIMAL_KHR) {
+      logWarning("Suboptimal swap chain detected after acquiring next swap chain image.");
+      isSwapChainSuboptimal = true;
+    } else if(result == VK_ERROR_OUT_OF_DATE_KHR) {
+      logError("Failed to acquire next swap chain image because swap chain is out of date.");
+      recreateSwapChainContext();
+      isDrawing = false;
+    } else if(result != VK_SUCCESS) {
+      logError("Failed to acquire next swap chain image.");
+      isDrawing = false;
+    }
+    if(isDrawing) {
+      framebuffer = swapChainImageContexts[acquiredSwapChainImageIndex].frameBuffer;
     }
   }
-  swapChainImageContexts[imageIndex].fence = swapChainImagesInFlightFences[syncIndex];
-  
-  updateUniformBuffer(imageIndex, gameState.dTime);
+  if(vkResetFences(device, 1, &context.fence) != VK_SUCCESS) {
+    logError("Failed to reset the fence of frame %u.", frameIndex);
+  }
+
+  CubePalette& palette = *reinterpret_cast<CubePalette*>(paletteBuffer.mappedData + frameIndex * paletteBuffer.slotSize);
+  memcpy(palette.cubeClassColors, frame.cubeClassColors, sizeof(palette.cubeClassColors));
 
+  {
+    CommandRecorder commandRecorder(context.commandBuffer, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+
+    applyMeshUpdates(context.commandBuffer, frame.queue, frameIndex);
+    if(isDrawing) {
+      recordDrawing(context.commandBuffer, frame, framebuffer, frameIndex);
+    }
+  }
+
+  // Without drawing there is no acquired image to wait for or to hand over to present.
+  const bool isPresenting = isDrawing && !isOffscreen;
   VkSubmitInfo submitInfo;
   submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
   submitInfo.pNext = nullptr;
-  submitInfo.waitSemaphoreCount = 1;
-  submitInfo.pWaitSemaphores = &swapChainImageAvailableSemaphore;
   VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
+  submitInfo.waitSemaphoreCount = isPresenting ? 1 : 0;
+  submitInfo.pWaitSemaphores = &context.swapChainImageAvailableSemaphore;
   submitInfo.pWaitDstStageMask = waitStages;
   submitInfo.commandBufferCount = 1;
-  submitInfo.pCommandBuffers = &swapChainImageContexts[imageIndex].commandBuffer;
-  VkSemaphore swapChainImageRenderFinishedSemaphore = swapChainImageRenderFinishedSemaphores[syncIndex];
-  submitInfo.signalSemaphoreCount = 1;
-  submitInfo.pSignalSemaphores = &swapChainImageRenderFinishedSemaphore;
-
-  if(vkResetFences(device, 1, &swapChainImageContexts[imageIndex].fence) != VK_SUCCESS) {
-    logError("Failed to reset a swapchain image fence with index %u.", imageIndex);
+  submitInfo.pCommandBuffers = &context.commandBuffer;
+  submitInfo.signalSemaphoreCount = isPresenting ? 1 : 0;
+  submitInfo.pSignalSemaphores = &context.swapChainImageRenderFinishedSemaphore;
+  checkResult(vkQueueSubmit(graphicsQueue, 1, &submitInfo, context.fence));
+
+  isSwapChainImageAcquired = isPresenting;
+  if(isDrawing) {
+    offscreenImage.isRendered = isOffscreen;
   }
+  ++renderCount;
+}
 
-  checkResult(vkQueueSubmit(graphicsQueue, 1, &submitInfo, swapChainImageContexts[imageIndex].fence));
+void VulkanRenderer::present()
+{
+  if(!isSwapChainImageAcquired) {
+    return;
+  }
+  isSwapChainImageAcquired = false;
+  // The semaphore of the frame that render submitted last.
+  VkSemaphore swapChainImageRenderFinishedSemaphore = 
+    frameContexts[(renderCount - 1) % maxFramesInFlight].swapChainImageRenderFinishedSemaphore;
 
   VkPresentInfoKHR presentInfo;
   presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
@@ -1400,10 +2185,10 @@ void VulkanRenderer::render(const GameState& gameState)
   presentInfo.pWaitSemaphores = &swapChainImageRenderFinishedSemaphore;
   presentInfo.swapchainCount = 1;
   presentInfo.pSwapchains = &swapChain;
-  presentInfo.pImageIndices = &imageIndex;
+  presentInfo.pImageIndices = &acquiredSwapChainImageIndex;
   presentInfo.pResults = nullptr;
 
-  result = vkQueuePresentKHR(presentQueue, &presentInfo);
+  VkResult result = vkQueuePresentKHR(presentQueue, &presentInfo);
   if(result == VK_SUBOPTIMAL_KHR) {
     logWarning("Suboptimal swap chain detected after presenting swap chain image.");
     isSwapChainSuboptimal = true;
@@ -1414,10 +2199,66 @@ void VulkanRenderer::render(const GameState& gameState)
     logError("Failed to present swapchain image.");
   }
 
-  ++renderCount;
-
   if(isSwapChainSuboptimal) {
     logInfo("Recreating swap chain because it is suboptimal.");
+    isSwapChainSuboptimal = false;
     recreateSwapChainContext();
   }
-}
\ No newline at end of file
+}
+
+int VulkanRenderer::getWidth() const noexcept
+{
+  return int(renderTarget.extent.width);
+}
+
+int VulkanRenderer::getHeight() const noexcept
+{
+  return int(renderTarget.extent.height);
+}
+
+void VulkanRenderer::readPixels(uint32_t* output)
+{
+  assert(isOffscreen);
+  const size_t pixelCount = size_t(renderTarget.extent.width) * renderTarget.extent.height;
+  if(!offscreenImage.isRendered) {
+    logWarning("Nothing was rendered into the offscreen image yet.");
+    std::fill_n(output, pixelCount, 0u);
+    return;
+  }
+
+  PrimaryCommandBuffer commandBuffer(graphicsCommandPool);
+  {
+    CommandRecorder recorder(commandBuffer, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+
+    // The render pass left the image in VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL.
+    recordMemoryBarrier(
+      commandBuffer, 
+      VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, 
+      VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, 
+      VK_PIPELINE_STAGE_TRANSFER_BIT, 
+      VK_ACCESS_TRANSFER_READ_BIT
+    );
+    VkBufferImageCopy region;
+    region.bufferOffset = 0;
+    region.bufferRowLength = 0;
+    region.bufferImageHeight = 0;
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.mipLevel = 0;
+    region.imageSubresource.baseArrayLayer = 0;
+    region.imageSubresource.layerCount = 1;
+    region.imageOffset = { 0, 0, 0 };
+    region.imageExtent = { renderTarget.extent.width, renderTarget.extent.height, 1 };
+    vkCmdCopyImageToBuffer(
+      commandBuffer, 
+      offscreenImage.image, 
+      VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, 
+      offscreenImage.readbackBuffer, 
+      1, 
+      &region
+    );
+    recordMemoryBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_HOST_BIT, VK_ACCESS_HOST_READ_BIT);
+  }
+  submitAndWait(commandBuffer);
+
+  memcpy(output, offscreenImage.readbackData, pixelCount * sizeof(uint32_t));
+}
@@ -1,21 +1,68 @@
 #pragma once
+#ifdef _WIN32
 #define WIN32_LEAN_AND_MEAN
 #include <windows.h>
+#endif
 
+#include <cstdint>
+
+#include <AssetLoader.hpp>
 #include <Exception.hpp>
+#include <FileWatcher.hpp>
 
-#include "GameState.hpp"
+#include "RenderFrame.hpp"
 
+/**
+ * @brief Draws the render frames of the game like D3D11Renderer, apart from the debug text. Without a window it
+ * renders into an offscreen image, e.g. on Linux through lavapipe or SwiftShader on machines without a GPU.
+ * Its state is global, only one can exist at a time. After it was created, it has to be used from one thread only,
+ * e.g. the RenderThread.
+ */
 class VulkanRenderer {
 public:
   DECLARE_AND_DEFINE_SIMPLE_EXCEPTION(InitializeException)
   DECLARE_AND_DEFINE_SIMPLE_EXCEPTION(Exception)
 
-  explicit VulkanRenderer(HWND window);
+#ifdef _WIN32
+  /**
+   * @brief Starts reading the SPIR-V files with assetLoader while the device is created.
+   */
+  VulkanRenderer(HWND window, De::AssetLoader& assetLoader);
+#endif
+  /**
+   * @brief Renders offscreen into an image of width x height, without a surface or a swap chain.
+   */
+  VulkanRenderer(int width, int height, De::AssetLoader& assetLoader);
   VulkanRenderer(const VulkanRenderer& other) = delete;
   VulkanRenderer(const VulkanRenderer&& other) = delete;
-  ~VulkanRenderer() = default;
+  ~VulkanRenderer();
 
+#ifdef DAR_DEBUG
+  /**
+   * @brief Rebuilds the pipelines when glslc rewrites the SPIR-V files in the shaders directory.
+   * The files are read in the background, the pipelines are recreated at the start of the next render.
+   */
+  void watchShaders(De::FileWatcher& fileWatcher);
+#endif
+  /**
+   * @brief Called by render when the client area of the frame differs from the last one.
+   */
   void onWindowResize(int clientAreaWidth, int clientAreaHeight);
-  void render(const GameState& gameState);
-};
\ No newline at end of file
+  /**
+   * @brief Applies the mesh updates of the frame, then executes its commands in order and resolves the
+   * multisampled target into the swap chain image or the offscreen image.
+   */
+  void render(const RenderFrame& frame);
+  /**
+   * @brief Presents the image of the last render, does nothing offscreen.
+   */
+  void present();
+
+  int getWidth() const noexcept;
+  int getHeight() const noexcept;
+  /**
+   * @brief Copies the offscreen image of the last render, waits until the device finished it.
+   * @param output Room for getWidth() * getHeight() pixels, 8 bits per channel with red in the lowest byte.
+   */
+  void readPixels(uint32_t* output);
+};
@@ -1,18 +1,31 @@
 #define DAR_MODULE_NAME "Win32"
 
 #include <exception>
+#include <optional>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <utility>
 
 #define WIN32_LEAN_AND_MEAN
 #include <windows.h>
 #include <windowsx.h>
-#include <Psapi.h>
 
+#include "AssetLoader.hpp"
 #include "Audio.hpp"
+#include "Clock.hpp"
 #include "DarEngine.hpp"
 #include "D3D11Renderer.hpp"
+#include "FileWatcher.hpp"
+#include "FramePacer.hpp"
+#include "FrameStatistics.hpp"
 #include "Game.hpp"
 #include "GameState.hpp"
+#include "Memory.hpp"
+#include "Profiler.hpp"
+#include "RenderFrame.hpp"
+#include "RenderThread.hpp"
+#include "ResourceSampler.hpp"
 #include "VulkanRenderer.h"
 
 #define VK_Q 0x51
@@ -38,15 +51,30 @@ namespace
   int clientAreaWidth = GetSystemMetrics(SM_CXSCREEN);
   int clientAreaHeight = GetSystemMetrics(SM_CYSCREEN);
   HWND window = nullptr;
-  HANDLE process = nullptr;
   WINDOWPLACEMENT windowPosition = {sizeof(windowPosition)};
   const char* gameName = "Demo";
-  int processorCount = 0;
   GameStates gameStates;
   GameState* lastGameState = nullptr;
   GameState* nextGameState = nullptr;
   int frameCount = 0;
-  D3D11Renderer* rendererPtr = nullptr;
+  // Pressing F2 captures a profile of the next frames.
+  constexpr int profiledFrameCount = 120;
+  constexpr const char* profileFileName = "profile.json";
+  int profiledFramesLeft = 0;
+  De::FrameStatistics frameStatistics;
+  constexpr const char* frameStatisticsFileName = "frame_statistics.csv";
+  // Sampled in every build, the summary file helps to tell whether hitches come with page faults or preemption.
+  constexpr double resourceSamplePeriod = 0.5;
+  constexpr const char* resourceUsageFileName = "resource_usage.csv";
+  constexpr const char* assetArchiveFileName = "assets.pak";
+  // Transient data of a frame, e.g. events and render commands, lives here and is freed two frames later.
+  constexpr size_t frameArenaCapacity = 1 << 20;
+  De::FrameArena frameArena(frameArenaCapacity);
+  // With -assertNoFrameAllocations on the command line, any allocation on the general heap
+  // by the main thread after the warm-up frames is an error.
+  constexpr int allocationWarmUpFrameCount = 60;
+  bool assertNoFrameAllocations = false;
+  De::AllocationTracking::Counts frameAllocationCounts[De::AllocationTracking::SubsystemCount] = {};
 
   LRESULT CALLBACK WindowProc(
     HWND   windowHandle,
@@ -61,11 +89,9 @@ namespace
         int newClientAreaWidth = LOWORD(lParam);
         int newClientAreaHeight = HIWORD(lParam);
         if(newClientAreaWidth != clientAreaWidth || newClientAreaHeight != clientAreaHeight) {
+          // The renderer resizes its targets on the render thread when a frame of the new size arrives.
           clientAreaWidth = newClientAreaWidth;
           clientAreaHeight = newClientAreaHeight;
-          if(rendererPtr) {
-            rendererPtr->onWindowResize(clientAreaWidth, clientAreaHeight);
-          }
         }
       }
       break;
@@ -107,6 +133,9 @@ namespace
           case VK_F1:
             nextGameState->input.keyboard.F1.pressedDown = true;
           break;
+          case VK_F2:
+            nextGameState->input.keyboard.F2.pressedDown = true;
+          break;
           case VK_MENU:
             nextGameState->input.keyboard.rightAlt.pressedDown = true;
           break;
@@ -153,6 +182,9 @@ namespace
         case VK_F1:
           nextGameState->input.keyboard.F1.pressedUp = true;
           break;
+        case VK_F2:
+          nextGameState->input.keyboard.F2.pressedUp = true;
+          break;
         case VK_MENU:
           nextGameState->input.keyboard.rightAlt.pressedUp = true;
           break;
@@ -201,49 +233,112 @@ namespace
   }
 }
 
-static void debugShowResourcesUsage()
+static void debugShowResourcesUsage(const De::ResourceSnapshot& resourceUsage)
 {
 #ifdef DAR_DEBUG
-  // from https://stackoverflow.com/a/64166/9178254
-
-  // CPU
-  static ULARGE_INTEGER lastCPU = {}, lastSysCPU = {}, lastUserCPU = {};
-  static double percent = 0.;
-  static DWORD lastCheckTimeMs = 0;
-  DWORD currentTimeMs = GetTickCount();
-  if((currentTimeMs - lastCheckTimeMs) > 1000) {
-    ULARGE_INTEGER now, sys, user;
-    GetSystemTimeAsFileTime((LPFILETIME)&now);
-    FILETIME fileTime;
-    GetProcessTimes(process, &fileTime, &fileTime, (LPFILETIME)&sys, (LPFILETIME)&user);
-    percent = double((sys.QuadPart - lastSysCPU.QuadPart) +
-        (user.QuadPart - lastUserCPU.QuadPart));
-    percent /= double(now.QuadPart - lastCPU.QuadPart);
-    percent /= double(processorCount);
-    percent *= 100;
-    lastCPU = now;
-    lastUserCPU = user;
-    lastSysCPU = sys;
-    lastCheckTimeMs = currentTimeMs;
+  constexpr double bytesPerMB = double(1 << 20);
+  const double perSecond = resourceUsage.sampledSeconds > 0. ? 1. / resourceUsage.sampledSeconds : 0.;
+  debugText(L"CPU %.f%%", resourceUsage.cpuPercent);
+  debugText(L"Virtual memory %.f MB", double(resourceUsage.virtualBytes) / bytesPerMB);
+  debugText(L"Physical memory %.f MB / %.f MB", 
+    double(resourceUsage.residentBytes) / bytesPerMB, 
+    double(resourceUsage.physicalMemoryBytes) / bytesPerMB
+  );
+  debugText(L"Page faults %.f/s", double(resourceUsage.pageFaults) * perSecond);
+  for(int i = 0; i < resourceUsage.threadCount; ++i) {
+    const De::ResourceSnapshot::Thread& thread = resourceUsage.threads[i];
+    debugText(L"  %S %llu: CPU %.f%%, page faults %.f/s, context switches %.f/s", 
+      thread.name,
+      (unsigned long long)thread.id,
+      thread.cpuPercent,
+      double(thread.pageFaults) * perSecond,
+      double(thread.voluntaryContextSwitches + thread.involuntaryContextSwitches) * perSecond
+    );
   }
-  debugText(L"CPU %.f%%", percent);
-
-  // Memory
-  MEMORYSTATUSEX memoryStatus;
-  memoryStatus.dwLength = sizeof(MEMORYSTATUSEX);
-  GlobalMemoryStatusEx(&memoryStatus);
-  DWORDLONG totalVirtualMemoryMB = memoryStatus.ullTotalPageFile / (1ull << 20ull);
-  DWORDLONG totalPhysicalMemoryMB = memoryStatus.ullTotalPhys / (1ull << 20ull);
-  PROCESS_MEMORY_COUNTERS_EX processMemoryCounters;
-  GetProcessMemoryInfo(process, (PROCESS_MEMORY_COUNTERS*)&processMemoryCounters, sizeof(processMemoryCounters));
-  SIZE_T virtualMemoryUsedByGameMB = processMemoryCounters.PrivateUsage / (1ull << 20ull);
-  SIZE_T physicalMemoryUsedByGameMB = processMemoryCounters.WorkingSetSize / (1ull << 20ull);
-  debugText(L"Virtual memory %llu MB / %llu MB", virtualMemoryUsedByGameMB, totalVirtualMemoryMB);
-  debugText(L"Physical memory %llu MB / %llu MB", physicalMemoryUsedByGameMB, totalPhysicalMemoryMB);
+#endif
+}
 
+static void debugShowFrameStatistics()
+{
+#ifdef DAR_DEBUG
+  for(int metric = 0; metric < De::FrameStatistics::MetricCount; ++metric) {
+    const De::FrameStatistics::Summary& summary = frameStatistics.getSummary(De::FrameStatistics::Metric(metric));
+    debugText(
+      L"%S p50 %.2f / p95 %.2f / p99 %.2f / max %.2f ms", 
+      De::FrameStatistics::getMetricName(De::FrameStatistics::Metric(metric)),
+      summary.p50 / 1000.,
+      summary.p95 / 1000.,
+      summary.p99 / 1000.,
+      summary.max / 1000.
+    );
+  }
 #endif
 }
 
+/**
+ * @brief Remembers the allocations of the frame per subsystem. The frame loop itself counts as Platform,
+ * General are the allocations of other threads and before the loop.
+ */
+static void checkFrameAllocations(const De::AllocationTracking::Counts (&frameStartCounts)[De::AllocationTracking::SubsystemCount])
+{
+  using namespace De::AllocationTracking;
+  bool allocated = false;
+  for(int subsystem = 0; subsystem < SubsystemCount; ++subsystem) {
+    const Counts counts = getCounts(Subsystem(subsystem));
+    frameAllocationCounts[subsystem] = {
+      counts.allocationCount - frameStartCounts[subsystem].allocationCount,
+      counts.byteCount - frameStartCounts[subsystem].byteCount
+    };
+    if(subsystem != General && frameAllocationCounts[subsystem].allocationCount > 0) {
+      allocated = true;
+    }
+  }
+  if(assertNoFrameAllocations && frameCount >= allocationWarmUpFrameCount && allocated) {
+    for(int subsystem = Platform; subsystem < SubsystemCount; ++subsystem) {
+      if(frameAllocationCounts[subsystem].allocationCount > 0) {
+        logError("Frame %d: %s allocated %llu times, %llu bytes.",
+          frameCount,
+          getSubsystemName(Subsystem(subsystem)),
+          (unsigned long long)frameAllocationCounts[subsystem].allocationCount,
+          (unsigned long long)frameAllocationCounts[subsystem].byteCount
+        );
+      }
+    }
+    assert(!"Allocation on the general heap in steady state.");
+  }
+}
+
+static void debugShowFrameAllocations()
+{
+#ifdef DAR_DEBUG
+  using namespace De::AllocationTracking;
+  for(int subsystem = 0; subsystem < SubsystemCount; ++subsystem) {
+    debugText(
+      L"%S allocations %llu / %llu B",
+      getSubsystemName(Subsystem(subsystem)),
+      (unsigned long long)frameAllocationCounts[subsystem].allocationCount,
+      (unsigned long long)frameAllocationCounts[subsystem].byteCount
+    );
+  }
+  debugText(L"Frame arena %zu / %zu B", frameArena.getPrevious().getPeakUsedSize(), frameArena.getPrevious().getCapacity());
+#endif
+}
+
+static void updateProfileCapture(const Keyboard& keyboard)
+{
+  if(profiledFramesLeft > 0) {
+    if(--profiledFramesLeft == 0) {
+      De::Profiler::stopCapture();
+      if(De::Profiler::writeChromeTrace(profileFileName)) {
+        logInfo("Profile of %d frames written to %s.", profiledFrameCount, profileFileName);
+      }
+    }
+  } else if(keyboard.F2.pressedDown) {
+    De::Profiler::startCapture();
+    profiledFramesLeft = profiledFrameCount;
+  }
+}
+
 static void showErrorMessageBox(const char* text, const char* caption) 
 {
   MessageBoxA(window, text, caption, MB_OK | MB_ICONERROR);
@@ -261,6 +356,28 @@ static Vec2i getCursorPosition()
   return mousePosition;
 }
 
+/**
+ * @return The value of -frameRate on the command line, otherwise the refresh rate of the display.
+ */
+static double getTargetFrameRate(const char* commandLine)
+{
+  constexpr double defaultFrameRate = 60.;
+  if(const char* argument = strstr(commandLine, "-frameRate ")) {
+    const double frameRate = atof(argument + strlen("-frameRate "));
+    if(frameRate > 0.) {
+      return frameRate;
+    }
+    logWarning("Invalid -frameRate, using the refresh rate of the display.");
+  }
+  DEVMODEA displayMode{};
+  displayMode.dmSize = sizeof(displayMode);
+  // 0 and 1 stand for the default rate of the hardware.
+  if(!EnumDisplaySettingsA(nullptr, ENUM_CURRENT_SETTINGS, &displayMode) || displayMode.dmDisplayFrequency <= 1) {
+    return defaultFrameRate;
+  }
+  return double(displayMode.dmDisplayFrequency);
+}
+
 int WINAPI WinMain(
   HINSTANCE instanceHandle,
   HINSTANCE hPrevInstance, // always zero
@@ -269,11 +386,8 @@ int WINAPI WinMain(
 )
 try
 {
-  process = GetCurrentProcess();
-
-  SYSTEM_INFO sysInfo;
-  GetSystemInfo(&sysInfo);
-  processorCount = sysInfo.dwNumberOfProcessors;
+  assertNoFrameAllocations = strstr(commandLine, "-assertNoFrameAllocations") != nullptr;
+  De::Profiler::setThreadName("Main");
 
   WNDCLASS windowClass{};
   windowClass.lpfnWndProc = &WindowProc;
@@ -310,15 +424,55 @@ try
     return -1;
   }
 
-  D3D11Renderer renderer(window);
-  rendererPtr = &renderer;
+  De::AssetLoader assetLoader;
+  logInfo("Loading assets with %s.", assetLoader.getBackendName());
+  // Packed by the build, without it the loose files are read.
+  assetLoader.mountArchive(assetArchiveFileName);
 
-  Audio audio;
+  // Both draw the same render frames, -vulkan selects the Vulkan backend.
+  std::optional<D3D11Renderer> d3d11Renderer;
+  std::optional<VulkanRenderer> vulkanRenderer;
+  RenderThread::RenderFunction render;
+  RenderThread::PresentFunction present;
+
+#ifdef DAR_DEBUG
+  // Notified by the system, checking it each frame costs an atomic load.
+  De::FileWatcher fileWatcher;
+#endif
+
+  if(strstr(commandLine, "-vulkan")) {
+    VulkanRenderer& renderer = vulkanRenderer.emplace(window, assetLoader);
+#ifdef DAR_DEBUG
+    renderer.watchShaders(fileWatcher);
+#endif
+    render = [&renderer](const RenderFrame& frame) { renderer.render(frame); };
+    present = [&renderer]() { renderer.present(); };
+  } else {
+    D3D11Renderer& renderer = d3d11Renderer.emplace(window, assetLoader);
+#ifdef DAR_DEBUG
+    renderer.watchShaderSources(fileWatcher);
+#endif
+    render = [&renderer](const RenderFrame& frame) { renderer.render(frame); };
+    present = [&renderer]() { renderer.present(); };
+  }
+
+  Audio audio(assetLoader);
 
   Game game;
+#ifdef DAR_DEBUG
+  game.watchModule(fileWatcher);
+#endif
+
+  RenderFrameBuilder renderFrameBuilder;
+  // From here on the renderer is only used by the render thread, a frame is rendered while the next one is simulated.
+  RenderThread renderThread(std::move(render), std::move(present));
 
   ShowWindow(window, SW_SHOWNORMAL);
 
+  for(int i = 0; i < 2; ++i) {
+    gameStates.getNextState(i)->events.setArena(&frameArena);
+  }
+
   Vec2i cursorPosition = getCursorPosition();
   lastGameState = gameStates.getLastState(frameCount);
   lastGameState->input.cursorPosition = cursorPosition;
@@ -326,10 +480,13 @@ try
   lastGameState->phase = GameState::Phase::Playing;
   nextGameState = gameStates.getNextState(frameCount);
 
-  LARGE_INTEGER counterFrequency;
-  QueryPerformanceFrequency(&counterFrequency);
-  LARGE_INTEGER lastCounterValue;
-  QueryPerformanceCounter(&lastCounterValue);
+  frameStatistics.openSummaryFile(frameStatisticsFileName);
+  De::ResourceSampler resourceSampler(resourceSamplePeriod, resourceUsageFileName);
+
+  // Frames start at the display refresh rate or at -frameRate <frames per second>, the loop sleeps in between.
+  De::FramePacer framePacer(1. / getTargetFrameRate(commandLine));
+  logInfo("Pacing frames at %.2f ms.", framePacer.getFramePeriod() * 1000.);
+  int64_t lastFrameTime = De::Clock::now();
 
   MSG message{};
   while (message.message != WM_QUIT) {
@@ -338,27 +495,70 @@ try
       DispatchMessageA(&message);
     } else {
       // process frame
+      const double pacingSeconds = framePacer.waitForNextFrame();
+      DAR_PROFILE_SCOPE("WinMain::frame");
+      DAR_ALLOCATION_SCOPE(Platform);
+      De::AllocationTracking::Counts frameStartCounts[De::AllocationTracking::SubsystemCount];
+      for(int subsystem = 0; subsystem < De::AllocationTracking::SubsystemCount; ++subsystem) {
+        frameStartCounts[subsystem] = De::AllocationTracking::getCounts(De::AllocationTracking::Subsystem(subsystem));
+      }
 
       nextGameState->input.cursorPosition = getCursorPosition();
       nextGameState->clientAreaWidth = clientAreaWidth;
       nextGameState->clientAreaHeight = clientAreaHeight;
 
-      LARGE_INTEGER currentCounterValue;
-      QueryPerformanceCounter(&currentCounterValue);
-      nextGameState->dTime = (float)(currentCounterValue.QuadPart - lastCounterValue.QuadPart) / counterFrequency.QuadPart;
-      lastCounterValue = currentCounterValue;
+      const double frameSeconds = De::Clock::measureSecondsSince(&lastFrameTime);
+      nextGameState->dTime = (float)frameSeconds;
+      frameStatistics.record(De::FrameStatistics::Frame, frameSeconds);
+      frameStatistics.record(De::FrameStatistics::Pacing, pacingSeconds);
+      int64_t phaseTime = lastFrameTime;
 
       debugResetText();
       debugText(L"%.3f s / %d fps", nextGameState->dTime, (int)(1.f / nextGameState->dTime));
-      debugShowResourcesUsage();
+      debugShowFrameStatistics();
+      debugShowResourcesUsage(resourceSampler.getLatestSnapshot());
+      debugShowFrameAllocations();
+
+#ifdef DAR_DEBUG
+      fileWatcher.dispatchChanges();
+      game.reloadModuleIfChanged();
+#endif
+
+      {
+        DAR_ALLOCATION_SCOPE(Game);
+        game.update(*lastGameState, nextGameState);
+      }
+      frameStatistics.record(De::FrameStatistics::Simulation, De::Clock::measureSecondsSince(&phaseTime));
+
+      {
+        DAR_ALLOCATION_SCOPE(Renderer);
+        const RenderFrame& renderFrame = renderFrameBuilder.build(*nextGameState, frameArena.getCurrent());
+        frameStatistics.record(De::FrameStatistics::Record, De::Clock::measureSecondsSince(&phaseTime));
+
+        // Waits for the render thread to finish the last frame, including its present. That also keeps the arena
+        // of the last frame from being reset while it's read.
+        const RenderThread::FrameTimes renderedFrameTimes = renderThread.submit(renderFrame);
+        frameStatistics.record(De::FrameStatistics::RenderWait, De::Clock::measureSecondsSince(&phaseTime));
+        // Of the last frame, the first submit has none yet.
+        if(frameCount > 0) {
+          frameStatistics.record(De::FrameStatistics::Render, renderedFrameTimes.renderSeconds);
+          frameStatistics.record(De::FrameStatistics::Present, renderedFrameTimes.presentSeconds);
+        }
+      }
+
+      {
+        DAR_ALLOCATION_SCOPE(Audio);
+        audio.update(*nextGameState);
+      }
 
-      game.update(*lastGameState, nextGameState);
+      frameStatistics.endFrame();
 
-      renderer.render(*nextGameState);
+      updateProfileCapture(nextGameState->input.keyboard);
 
-      audio.update(*nextGameState);
+      checkFrameAllocations(frameStartCounts);
 
       ++frameCount;
+      frameArena.endFrame();
 
       lastGameState = gameStates.getLastState(frameCount);
       nextGameState = gameStates.getNextState(frameCount);
@@ -0,0 +1,17 @@
+#version 450
+
+const float colorThresholdMin = 0.3;
+const float colorThresholdMax = 0.4;
+
+layout(location = 0) in vec3 gridPosition;
+layout(location = 1) flat in vec4 color;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+  // Merged faces span several cells, the borders are drawn around every cell of them.
+  vec3 cellPosition = fract(gridPosition) - 0.5;
+  vec3 borderSteps = smoothstep(colorThresholdMin, colorThresholdMax, abs(cellPosition));
+  float modifier = 1.0 - smoothstep(1.75, 2.0, borderSteps.x + borderSteps.y + borderSteps.z);
+  outColor = modifier * color;
+}
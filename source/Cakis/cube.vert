@@ -0,0 +1,25 @@
+#version 450
+
+// Mat4f is row major, the vertices are multiplied from the left like in Cube.vs.hlsl.
+layout(push_constant) uniform CubeConstants {
+  layout(row_major) mat4 viewProjection;
+};
+
+// Colors of the cube classes, the size has to match maxCubeClassCount in RenderFrame.hpp.
+layout(set = 0, binding = 0) uniform CubePalette {
+  vec4 cubeClassColors[16];
+};
+
+// Grid position in xyz and the cube class in w, see CubeMesher::Vertex.
+layout(location = 0) in ivec4 packedVertex;
+
+layout(location = 0) out vec3 gridPosition;
+layout(location = 1) flat out vec4 color;
+
+void main() {
+  gridPosition = vec3(packedVertex.xyz);
+  gl_Position = vec4(gridPosition, 1.0) * viewProjection;
+  // The constants are in D3D clip space, where y points up.
+  gl_Position.y = -gl_Position.y;
+  color = cubeClassColors[packedVertex.w];
+}
@@ -0,0 +1,7 @@
+#version 450
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+  outColor = vec4(0.75, 0.75, 0.75, 1.0);
+}
@@ -0,0 +1,14 @@
+#version 450
+
+// Mat4f is row major, the vertices are multiplied from the left like in Grid.vs.hlsl.
+layout(push_constant) uniform GridConstants {
+  layout(row_major) mat4 transform;
+};
+
+layout(location = 0) in vec2 position;
+
+void main() {
+  gl_Position = vec4(position, 0.0, 1.0) * transform;
+  // The constants are in D3D clip space, where y points up.
+  gl_Position.y = -gl_Position.y;
+}
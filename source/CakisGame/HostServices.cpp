@@ -0,0 +1,87 @@
+#include "HostServices.hpp"
+
+#include <Profiler.hpp>
+
+// Definitions of the Core functions the module's code calls, forwarded to the host.
+// A copy of Core in the module would start its own logger thread, count allocations nobody reads
+// and record profile scopes into captures nobody writes.
+
+static const GameModule::HostServices* hostServices = nullptr;
+
+void useHostServices(const GameModule::HostServices& host) noexcept
+{
+  hostServices = &host;
+  // Read by the module's profile scopes, a capture that starts during an update begins with the next one.
+  De::Profiler::detail::captureId.store(host.profilerCaptureId->load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+namespace De::Log
+{
+  void flush()
+  {
+    hostServices->flushLog();
+  }
+
+  namespace detail
+  {
+    // The module's thread_local owner shares the buffer the host's owner registered for the thread.
+    ThreadBuffer* registerThread()
+    {
+      return hostServices->getLogThreadBuffer();
+    }
+    void unregisterThread(ThreadBuffer* buffer) noexcept
+    {}
+    unsigned char* beginRecord(ThreadBuffer& buffer, uint32_t recordSize) noexcept
+    {
+      return hostServices->beginLogRecord(buffer, recordSize);
+    }
+  }
+}
+
+namespace De::Profiler::detail
+{
+  std::atomic<uint32_t> captureId{ 0 };
+
+  void record(const char* name, uint64_t begin, uint64_t end, uint32_t captureId) noexcept
+  {
+    hostServices->recordProfileScope(name, begin, end, captureId);
+  }
+}
+
+void* De::LinearArena::allocate(size_t size, size_t alignment)
+{
+  return hostServices->allocateFromArena(*this, size, alignment);
+}
+
+// Memory the module allocates is freed by the host and the other way around, e.g. the playing space of a game state.
+void* operator new(size_t size) { return hostServices->allocate(size); }
+void* operator new[](size_t size) { return hostServices->allocate(size); }
+void* operator new(size_t size, std::align_val_t alignment) { return hostServices->allocateAligned(size, alignment); }
+void* operator new[](size_t size, std::align_val_t alignment) { return hostServices->allocateAligned(size, alignment); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+  try {
+    return hostServices->allocate(size);
+  } catch(...) {
+    return nullptr;
+  }
+}
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+  try {
+    return hostServices->allocate(size);
+  } catch(...) {
+    return nullptr;
+  }
+}
+
+void operator delete(void* memory) noexcept { hostServices->deallocate(memory); }
+void operator delete[](void* memory) noexcept { hostServices->deallocate(memory); }
+void operator delete(void* memory, size_t) noexcept { hostServices->deallocate(memory); }
+void operator delete[](void* memory, size_t) noexcept { hostServices->deallocate(memory); }
+void operator delete(void* memory, const std::nothrow_t&) noexcept { hostServices->deallocate(memory); }
+void operator delete[](void* memory, const std::nothrow_t&) noexcept { hostServices->deallocate(memory); }
+void operator delete(void* memory, std::align_val_t alignment) noexcept { hostServices->deallocateAligned(memory, alignment); }
+void operator delete[](void* memory, std::align_val_t alignment) noexcept { hostServices->deallocateAligned(memory, alignment); }
+void operator delete(void* memory, size_t, std::align_val_t alignment) noexcept { hostServices->deallocateAligned(memory, alignment); }
+void operator delete[](void* memory, size_t, std::align_val_t alignment) noexcept { hostServices->deallocateAligned(memory, alignment); }
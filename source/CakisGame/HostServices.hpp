@@ -0,0 +1,9 @@
+#pragma once
+
+#include "GameModule.hpp"
+
+/**
+ * @brief Routes the module's logs, allocations and profile scopes to the host until the next call.
+ * Call it first thing in every export, the module code runs only inside calls from the host.
+ */
+void useHostServices(const GameModule::HostServices& host) noexcept;
@@ -0,0 +1,224 @@
+#define DAR_MODULE_NAME "AssetArchive"
+
+#include "AssetArchive.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#include "DarEngine.hpp"
+#include "Exception.hpp"
+#include "Lz4.hpp"
+
+namespace De
+{
+  static char normalizeCharacter(char character) noexcept
+  {
+    if(character == '\\') {
+      return '/';
+    }
+    if(character >= 'A' && character <= 'Z') {
+      return character - 'A' + 'a';
+    }
+    return character;
+  }
+
+  uint64_t AssetArchive::hashName(const char* name) noexcept
+  {
+    uint64_t hash = 14695981039346656037ull;
+    for(; *name; ++name) {
+      hash ^= (uint8_t)normalizeCharacter(*name);
+      hash *= 1099511628211ull;
+    }
+    return hash;
+  }
+
+  std::string AssetArchive::normalizeName(const char* name)
+  {
+    std::string result(name);
+    std::transform(result.begin(), result.end(), result.begin(), normalizeCharacter);
+    return result;
+  }
+
+  AssetArchive::AssetArchive(const char* fileName)
+    : file(fileName, MappedFile::Access::Sequential)
+  {
+    const ConstByteSpan data = file.getSpan();
+    auto invalid = [fileName](const char* reason) {
+      return Exception(std::string("Invalid asset archive ") + fileName + ": " + reason);
+    };
+    if(data.size() < sizeof(AssetArchiveHeader)) {
+      throw invalid("too small");
+    }
+    const AssetArchiveHeader& header = *reinterpret_cast<const AssetArchiveHeader*>(data.data());
+    if(memcmp(header.magic, AssetArchiveHeader::magicValue, sizeof(header.magic)) != 0) {
+      throw invalid("wrong magic");
+    }
+    if(header.version != AssetArchiveHeader::currentVersion) {
+      throw invalid("unsupported version");
+    }
+    const uint64_t indexEnd = sizeof(AssetArchiveHeader) + uint64_t(header.entryCount) * sizeof(Entry);
+    if(indexEnd > header.namesOffset || header.namesOffset > data.size() || header.namesSize > data.size() - header.namesOffset ||
+      header.namesSize == 0 || data.data()[header.namesOffset + header.namesSize - 1] != '\0') {
+      throw invalid("index out of bounds");
+    }
+    entries = reinterpret_cast<const Entry*>(data.data() + sizeof(AssetArchiveHeader));
+    entryCount = header.entryCount;
+    names = reinterpret_cast<const char*>(data.data() + header.namesOffset);
+    // Validated once, so that lookups and reads don't have to.
+    for(const Entry& entry : *this) {
+      if(entry.offset > data.size() || entry.storedSize > data.size() - entry.offset || entry.nameOffset >= header.namesSize) {
+        throw invalid("entry out of bounds");
+      }
+      if(!entry.isCompressed() && entry.storedSize != entry.size) {
+        throw invalid("entry size mismatch");
+      }
+    }
+    if(!std::is_sorted(begin(), end(), [](const Entry& a, const Entry& b) { return a.nameHash < b.nameHash; })) {
+      throw invalid("index isn't sorted");
+    }
+  }
+
+  const AssetArchive::Entry* AssetArchive::find(const char* name) const noexcept
+  {
+    const uint64_t hash = hashName(name);
+    const Entry* entry = std::lower_bound(begin(), end(), hash, [](const Entry& entry, uint64_t hash) { return entry.nameHash < hash; });
+    for(; entry != end() && entry->nameHash == hash; ++entry) {
+      const char* storedName = getName(*entry);
+      const char* requestedName = name;
+      while(*storedName && *storedName == normalizeCharacter(*requestedName)) {
+        ++storedName;
+        ++requestedName;
+      }
+      if(*storedName == '\0' && *requestedName == '\0') {
+        return entry;
+      }
+    }
+    return nullptr;
+  }
+
+  bool AssetArchive::extract(const Entry& entry, uint8_t* destination) const noexcept
+  {
+    const ConstByteSpan storedData = getStoredData(entry);
+    if(entry.isCompressed()) {
+      return Lz4::decompress(storedData.data(), storedData.size(), destination, (size_t)entry.size);
+    }
+    if(!storedData.empty()) {
+      memcpy(destination, storedData.data(), storedData.size());
+    }
+    return true;
+  }
+
+  AssetArchiveWriter::AssetArchiveWriter(uint32_t entryAlignment)
+    : entryAlignment(entryAlignment)
+  {
+    assert(entryAlignment > 0 && (entryAlignment & (entryAlignment - 1)) == 0);
+  }
+
+  bool AssetArchiveWriter::add(const char* name, ConstByteSpan data, bool compress)
+  {
+    PendingEntry entry;
+    entry.name = AssetArchive::normalizeName(name);
+    entry.nameHash = AssetArchive::hashName(name);
+    for(const PendingEntry& other : entries) {
+      if(other.nameHash == entry.nameHash && other.name == entry.name) {
+        return false;
+      }
+    }
+    entry.size = data.size();
+    entry.isCompressed = false;
+    if(compress && !data.empty()) {
+      std::vector<uint8_t> compressed(Lz4::getMaxCompressedSize(data.size()));
+      const size_t compressedSize = Lz4::compress(data.data(), data.size(), compressed.data(), compressed.size());
+      if(compressedSize <= data.size() - data.size() / 16) {
+        compressed.resize(compressedSize);
+        entry.storedData = std::move(compressed);
+        entry.isCompressed = true;
+      }
+    }
+    if(!entry.isCompressed) {
+      entry.storedData.assign(data.begin(), data.end());
+    }
+    entries.push_back(std::move(entry));
+    return true;
+  }
+
+  void AssetArchiveWriter::write(const char* fileName) const
+  {
+    std::vector<const PendingEntry*> sortedEntries;
+    for(const PendingEntry& entry : entries) {
+      sortedEntries.push_back(&entry);
+    }
+    std::sort(sortedEntries.begin(), sortedEntries.end(), [](const PendingEntry* a, const PendingEntry* b) {
+      return a->nameHash != b->nameHash ? a->nameHash < b->nameHash : a->name < b->name;
+    });
+
+    std::vector<char> names;
+    std::vector<AssetArchiveEntry> index;
+    for(const PendingEntry* entry : sortedEntries) {
+      AssetArchiveEntry indexEntry{};
+      indexEntry.nameHash = entry->nameHash;
+      indexEntry.storedSize = entry->storedData.size();
+      indexEntry.size = entry->size;
+      indexEntry.nameOffset = (uint32_t)names.size();
+      indexEntry.flags = entry->isCompressed ? (uint32_t)AssetArchiveEntry::Lz4Compressed : (uint32_t)0;
+      names.insert(names.end(), entry->name.begin(), entry->name.end());
+      names.push_back('\0');
+      index.push_back(indexEntry);
+    }
+    if(names.empty()) {
+      names.push_back('\0');
+    }
+
+    auto align = [this](uint64_t offset) { return (offset + entryAlignment - 1) & ~uint64_t(entryAlignment - 1); };
+    AssetArchiveHeader header{};
+    memcpy(header.magic, AssetArchiveHeader::magicValue, sizeof(header.magic));
+    header.version = AssetArchiveHeader::currentVersion;
+    header.entryCount = (uint32_t)index.size();
+    header.entryAlignment = entryAlignment;
+    header.namesOffset = sizeof(header) + index.size() * sizeof(AssetArchiveEntry);
+    header.namesSize = names.size();
+    // Entries follow in index order, so that loading them in that order reads the file front to back.
+    uint64_t offset = align(header.namesOffset + header.namesSize);
+    for(AssetArchiveEntry& indexEntry : index) {
+      indexEntry.offset = offset;
+      offset = align(offset + indexEntry.storedSize);
+    }
+
+    FILE* file = nullptr;
+#ifdef _WIN32
+    if(fopen_s(&file, fileName, "wb") != 0) {
+      file = nullptr;
+    }
+#else
+    file = fopen(fileName, "wb");
+#endif
+    if(!file) {
+      throw Exception(std::string("Failed to open archive for writing: ") + fileName);
+    }
+    static const uint8_t padding[4096] = {};
+    uint64_t position = 0;
+    auto writeBytes = [&](const void* data, size_t size) {
+      if(size > 0 && fwrite(data, 1, size, file) != size) {
+        fclose(file);
+        throw Exception(std::string("Failed to write archive: ") + fileName);
+      }
+      position += size;
+    };
+    auto writePadding = [&](uint64_t targetPosition) {
+      while(position < targetPosition) {
+        writeBytes(padding, (size_t)std::min<uint64_t>(targetPosition - position, sizeof(padding)));
+      }
+    };
+    writeBytes(&header, sizeof(header));
+    writeBytes(index.data(), index.size() * sizeof(AssetArchiveEntry));
+    writeBytes(names.data(), names.size());
+    for(size_t i = 0; i < index.size(); ++i) {
+      writePadding(index[i].offset);
+      writeBytes(sortedEntries[i]->storedData.data(), sortedEntries[i]->storedData.size());
+    }
+    if(fclose(file) != 0) {
+      throw Exception(std::string("Failed to write archive: ") + fileName);
+    }
+  }
+}
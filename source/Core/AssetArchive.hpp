@@ -0,0 +1,132 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "File.hpp"
+
+namespace De
+{
+  /**
+   * Archive layout, little endian:
+   * header, index sorted by name hash, zero terminated names, entries aligned to entryAlignment.
+   * Names are stored normalized, lowercase with forward slashes, and compared the same way on lookup.
+   */
+  struct AssetArchiveHeader
+  {
+    static constexpr char magicValue[4] = { 'D', 'P', 'A', 'K' };
+    static constexpr uint32_t currentVersion = 1;
+
+    char magic[4];
+    uint32_t version;
+    uint32_t entryCount;
+    uint32_t entryAlignment;
+    uint64_t namesOffset;
+    uint64_t namesSize;
+  };
+  static_assert(sizeof(AssetArchiveHeader) == 32, "The header is part of the file format.");
+
+  struct AssetArchiveEntry
+  {
+    enum Flags : uint32_t
+    {
+      Lz4Compressed = 1 << 0
+    };
+
+    bool isCompressed() const noexcept { return (flags & Lz4Compressed) != 0; }
+
+    uint64_t nameHash;
+    uint64_t offset;
+    uint64_t storedSize;
+    uint64_t size;
+    uint32_t nameOffset;
+    uint32_t flags;
+  };
+  static_assert(sizeof(AssetArchiveEntry) == 40, "Entries are part of the file format.");
+
+  /**
+   * @brief Read-only archive mapped into memory once. Lookups are binary searches over the mapped index
+   * and don't make system calls, uncompressed entries are used in place.
+   */
+  class AssetArchive
+  {
+  public:
+    using Entry = AssetArchiveEntry;
+
+    /**
+     * @brief FNV-1a of the normalized name.
+     */
+    static uint64_t hashName(const char* name) noexcept;
+    static std::string normalizeName(const char* name);
+
+    /**
+     * @throws De::Exception if the file can't be mapped or isn't a valid archive.
+     */
+    explicit AssetArchive(const char* fileName);
+
+    /**
+     * @return nullptr if there is no entry with that name.
+     */
+    const Entry* find(const char* name) const noexcept;
+    const char* getName(const Entry& entry) const noexcept { return names + entry.nameOffset; }
+    /**
+     * @brief The entry as stored, compressed entries have to be extracted.
+     */
+    ConstByteSpan getStoredData(const Entry& entry) const noexcept
+    {
+      return file.getSpan().subspan((size_t)entry.offset, (size_t)entry.storedSize);
+    }
+    /**
+     * @param destination Receives entry.size bytes.
+     * @return false if a compressed entry is corrupted.
+     */
+    bool extract(const Entry& entry, uint8_t* destination) const noexcept;
+
+    const Entry* begin() const noexcept { return entries; }
+    const Entry* end() const noexcept { return entries + entryCount; }
+    size_t getEntryCount() const noexcept { return entryCount; }
+
+  private:
+    MappedFile file;
+    const Entry* entries = nullptr;
+    size_t entryCount = 0;
+    const char* names = nullptr;
+  };
+
+  /**
+   * @brief Builds archives at build time.
+   */
+  class AssetArchiveWriter
+  {
+  public:
+    /**
+     * @param entryAlignment Power of 2, at least 64 keeps entries usable in place by FMOD and Vulkan.
+     */
+    explicit AssetArchiveWriter(uint32_t entryAlignment = 64);
+
+    /**
+     * @param compress Stores the entry LZ4 compressed if that saves at least 1/16 of its size.
+     * @return false if an entry with the same normalized name was already added.
+     */
+    bool add(const char* name, ConstByteSpan data, bool compress);
+    /**
+     * @throws De::Exception if the file can't be written.
+     */
+    void write(const char* fileName) const;
+
+  private:
+    struct PendingEntry
+    {
+      std::string name;
+      uint64_t nameHash;
+      uint64_t size;
+      bool isCompressed;
+      std::vector<uint8_t> storedData;
+    };
+
+    uint32_t entryAlignment;
+    std::vector<PendingEntry> entries;
+  };
+}
@@ -0,0 +1,451 @@
+#define DAR_MODULE_NAME "AssetLoader"
+
+#include "AssetLoader.hpp"
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "AssetArchive.hpp"
+#include "DarEngine.hpp"
+#include "Exception.hpp"
+#include "Profiler.hpp"
+
+#if defined(__linux__)
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "detail/LinuxIoUring.hpp"
+#endif
+
+namespace De
+{
+  LoadedFile::LoadedFile(size_t size)
+    : ownedData(static_cast<uint8_t*>(::operator new(std::max<size_t>(size, 1), std::align_val_t(alignment))))
+    , size(size)
+  {
+    data = ownedData;
+  }
+
+  LoadedFile LoadedFile::view(ConstByteSpan data) noexcept
+  {
+    LoadedFile result;
+    result.data = data.data();
+    result.size = data.size();
+    return result;
+  }
+
+  LoadedFile::LoadedFile(LoadedFile&& other) noexcept
+    : data(std::exchange(other.data, nullptr))
+    , ownedData(std::exchange(other.ownedData, nullptr))
+    , size(std::exchange(other.size, 0))
+  {}
+
+  LoadedFile& LoadedFile::operator=(LoadedFile&& rhs) noexcept
+  {
+    if(this != &rhs) {
+      if(ownedData) {
+        ::operator delete(ownedData, std::align_val_t(alignment));
+      }
+      data = std::exchange(rhs.data, nullptr);
+      ownedData = std::exchange(rhs.ownedData, nullptr);
+      size = std::exchange(rhs.size, 0);
+    }
+    return *this;
+  }
+
+  LoadedFile::~LoadedFile()
+  {
+    if(ownedData) {
+      ::operator delete(ownedData, std::align_val_t(alignment));
+    }
+  }
+
+  uint8_t* LoadedFile::getMutableData() noexcept
+  {
+    assert(!isView());
+    return ownedData;
+  }
+
+  namespace
+  {
+    struct Request
+    {
+      std::string fileName;
+      // Either the promise or the callback is used.
+      std::promise<LoadedFile> promise;
+      AssetLoader::Callback callback;
+
+      LoadedFile file;
+      // Set if the file is in the mounted archive.
+      const AssetArchive* archive = nullptr;
+      const AssetArchive::Entry* archiveEntry = nullptr;
+#if defined(__linux__)
+      int descriptor = -1;
+      size_t readSize = 0;
+      iovec buffer;
+#endif
+    };
+
+    void complete(Request& request, const char* error)
+    {
+      if(error) {
+        logError("Failed to read %s: %s", request.fileName.c_str(), error);
+        if(request.callback) {
+          request.callback(request.fileName.c_str(), nullptr);
+        } else {
+          request.promise.set_exception(std::make_exception_ptr(Exception("Failed to read " + request.fileName + ": " + error)));
+        }
+      } else {
+        if(request.callback) {
+          request.callback(request.fileName.c_str(), &request.file);
+        } else {
+          request.promise.set_value(std::move(request.file));
+        }
+      }
+    }
+
+    void readFromArchive(Request& request)
+    {
+      DAR_PROFILE_SCOPE("AssetLoader::readFromArchive");
+      const AssetArchive::Entry& entry = *request.archiveEntry;
+      if(!entry.isCompressed()) {
+        request.file = LoadedFile::view(request.archive->getStoredData(entry));
+        complete(request, nullptr);
+        return;
+      }
+      request.file = LoadedFile((size_t)entry.size);
+      if(!request.archive->extract(entry, request.file.getMutableData())) {
+        complete(request, "archive entry is corrupted");
+        return;
+      }
+      complete(request, nullptr);
+    }
+
+    void readBlocking(Request& request)
+    {
+      if(request.archiveEntry) {
+        readFromArchive(request);
+        return;
+      }
+      DAR_PROFILE_SCOPE("AssetLoader::readBlocking");
+      std::ifstream file(request.fileName, std::ios::ate | std::ios::binary);
+      if(!file.is_open()) {
+        complete(request, "can't open file");
+        return;
+      }
+      request.file = LoadedFile((size_t)file.tellg());
+      file.seekg(0);
+      if(!file.read(reinterpret_cast<char*>(request.file.getMutableData()), request.file.getSize())) {
+        complete(request, "read failed");
+        return;
+      }
+      complete(request, nullptr);
+    }
+  }
+
+  class AssetLoader::Impl
+  {
+  public:
+    explicit Impl(int workerCount)
+    {
+#if defined(__linux__)
+      try {
+        ioUring = std::make_unique<LinuxIoUring>(ioUringEntryCount);
+        wakeEvent = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+        if(wakeEvent == -1) {
+          throw Exception(std::string("eventfd failed: ") + strerror(errno));
+        }
+        backendName = "io_uring";
+        threads.emplace_back([this]() { runIoUring(); });
+        return;
+      } catch(const Exception& e) {
+        logWarning("io_uring unavailable, reading with worker threads instead. %s", e.what());
+        ioUring.reset();
+      }
+#endif
+      backendName = "worker threads";
+      for(int i = 0; i < std::max(workerCount, 1); ++i) {
+        threads.emplace_back([this]() { runWorker(); });
+      }
+    }
+    Impl(const Impl& other) = delete;
+    Impl& operator=(const Impl& rhs) = delete;
+    ~Impl()
+    {
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+      }
+      wakeUp();
+      for(std::thread& thread : threads) {
+        thread.join();
+      }
+#if defined(__linux__)
+      if(wakeEvent != -1) {
+        close(wakeEvent);
+      }
+#endif
+    }
+
+    bool mountArchive(const char* fileName)
+    {
+      try {
+        archive = std::make_unique<AssetArchive>(fileName);
+      } catch(const Exception& e) {
+        logError("Failed to mount archive %s: %s", fileName, e.what());
+        return false;
+      }
+      return true;
+    }
+
+    void enqueue(std::unique_ptr<Request>* requests, size_t count)
+    {
+      for(size_t i = 0; i < count; ++i) {
+        if(archive) {
+          requests[i]->archiveEntry = archive->find(requests[i]->fileName.c_str());
+          requests[i]->archive = requests[i]->archiveEntry ? archive.get() : nullptr;
+        }
+      }
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        for(size_t i = 0; i < count; ++i) {
+          queue.push_back(std::move(requests[i]));
+        }
+      }
+      wakeUp();
+    }
+
+    const char* getBackendName() const noexcept { return backendName; }
+
+  private:
+#if defined(__linux__)
+    static constexpr unsigned ioUringEntryCount = 64;
+    // Larger reads are split.
+    static constexpr size_t maxReadSize = 1 << 30;
+    // user_data of the poll on wakeEvent, requests are identified by their address.
+    static constexpr uint64_t wakeUserData = 0;
+#endif
+
+    void wakeUp()
+    {
+#if defined(__linux__)
+      if(ioUring) {
+        const uint64_t value = 1;
+        ssize_t written = write(wakeEvent, &value, sizeof(value));
+        (void)written;
+        return;
+      }
+#endif
+      wake.notify_all();
+    }
+
+    void runWorker()
+    {
+      Profiler::setThreadName("AssetLoader");
+      for(;;) {
+        std::unique_ptr<Request> request;
+        {
+          std::unique_lock<std::mutex> lock(mutex);
+          wake.wait(lock, [this]() { return stopping || !queue.empty(); });
+          if(queue.empty()) {
+            return;
+          }
+          request = std::move(queue.front());
+          queue.pop_front();
+        }
+        readBlocking(*request);
+      }
+    }
+
+#if defined(__linux__)
+    /**
+     * @brief Opens the file and allocates its buffer on the first call, submits a read of the rest of the file.
+     * @return false if the submission queue is full.
+     */
+    bool submitRead(std::unique_ptr<Request>& request)
+    {
+      if(request->archiveEntry) {
+        readFromArchive(*request);
+        request.reset();
+        return true;
+      }
+      if(request->descriptor == -1) {
+        // open and fstat are synchronous, they rarely block for long compared to the read.
+        request->descriptor = open(request->fileName.c_str(), O_RDONLY | O_CLOEXEC);
+        if(request->descriptor == -1) {
+          complete(*request, strerror(errno));
+          request.reset();
+          return true;
+        }
+        struct stat status;
+        if(fstat(request->descriptor, &status) != 0) {
+          finish(request, strerror(errno));
+          return true;
+        }
+        request->file = LoadedFile((size_t)status.st_size);
+        if(status.st_size == 0) {
+          finish(request, nullptr);
+          return true;
+        }
+      }
+      io_uring_sqe* entry = ioUring->getSubmissionEntry();
+      if(!entry) {
+        return false;
+      }
+      request->buffer.iov_base = request->file.getMutableData() + request->readSize;
+      request->buffer.iov_len = std::min(request->file.getSize() - request->readSize, maxReadSize);
+      entry->opcode = IORING_OP_READV;
+      entry->fd = request->descriptor;
+      entry->addr = (uint64_t)(uintptr_t)&request->buffer;
+      entry->len = 1;
+      entry->off = request->readSize;
+      entry->user_data = (uint64_t)(uintptr_t)request.release();
+      ++inFlightCount;
+      return true;
+    }
+
+    void finish(std::unique_ptr<Request>& request, const char* error)
+    {
+      close(request->descriptor);
+      request->descriptor = -1;
+      complete(*request, error);
+      request.reset();
+    }
+
+    void runIoUring()
+    {
+      Profiler::setThreadName("AssetLoader");
+      std::deque<std::unique_ptr<Request>> pending;
+      bool isWakeArmed = false;
+      for(;;) {
+        if(!isWakeArmed) {
+          if(io_uring_sqe* entry = ioUring->getSubmissionEntry()) {
+            entry->opcode = IORING_OP_POLL_ADD;
+            entry->fd = wakeEvent;
+            entry->poll_events = POLLIN;
+            entry->user_data = wakeUserData;
+            isWakeArmed = true;
+          }
+        }
+
+        bool isStopping;
+        {
+          std::lock_guard<std::mutex> lock(mutex);
+          for(std::unique_ptr<Request>& request : queue) {
+            pending.push_back(std::move(request));
+          }
+          queue.clear();
+          isStopping = stopping;
+        }
+
+        while(!pending.empty()) {
+          if(!submitRead(pending.front())) {
+            break;
+          }
+          pending.pop_front();
+        }
+        if(isStopping && pending.empty() && inFlightCount == 0) {
+          return;
+        }
+
+        DAR_PROFILE_SCOPE("AssetLoader::wait");
+        const int result = ioUring->submitAndWait(1);
+        if(result < 0) {
+          logError("io_uring_enter failed: %s", strerror(-result));
+        }
+        ioUring->forEachCompletion([&](const io_uring_cqe& completion) {
+          if(completion.user_data == wakeUserData) {
+            uint64_t value;
+            ssize_t readBytes = ::read(wakeEvent, &value, sizeof(value));
+            (void)readBytes;
+            isWakeArmed = false;
+            return;
+          }
+          std::unique_ptr<Request> request(reinterpret_cast<Request*>((uintptr_t)completion.user_data));
+          --inFlightCount;
+          if(completion.res < 0) {
+            finish(request, strerror(-completion.res));
+          } else if(completion.res == 0) {
+            finish(request, "file is shorter than its size");
+          } else {
+            request->readSize += (size_t)completion.res;
+            if(request->readSize < request->file.getSize()) {
+              pending.push_front(std::move(request));
+            } else {
+              finish(request, nullptr);
+            }
+          }
+        });
+      }
+    }
+
+    std::unique_ptr<LinuxIoUring> ioUring;
+    int wakeEvent = -1;
+    int inFlightCount = 0;
+#endif
+
+    const char* backendName = nullptr;
+    std::unique_ptr<AssetArchive> archive;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<std::unique_ptr<Request>> queue;
+    bool stopping = false;
+    std::vector<std::thread> threads;
+  };
+
+  AssetLoader::AssetLoader(int workerCount)
+    : pImpl(std::make_unique<Impl>(workerCount))
+  {}
+
+  AssetLoader::~AssetLoader() = default;
+
+  std::future<LoadedFile> AssetLoader::read(const char* fileName)
+  {
+    std::future<LoadedFile> future;
+    readBatch(&fileName, 1, &future);
+    return future;
+  }
+
+  void AssetLoader::read(const char* fileName, Callback callback)
+  {
+    std::unique_ptr<Request> request = std::make_unique<Request>();
+    request->fileName = fileName;
+    request->callback = std::move(callback);
+    pImpl->enqueue(&request, 1);
+  }
+
+  void AssetLoader::readBatch(const char* const* fileNames, size_t count, std::future<LoadedFile>* futures)
+  {
+    std::vector<std::unique_ptr<Request>> requests(count);
+    for(size_t i = 0; i < count; ++i) {
+      requests[i] = std::make_unique<Request>();
+      requests[i]->fileName = fileNames[i];
+      futures[i] = requests[i]->promise.get_future();
+    }
+    pImpl->enqueue(requests.data(), count);
+  }
+
+  bool AssetLoader::mountArchive(const char* fileName)
+  {
+    return pImpl->mountArchive(fileName);
+  }
+
+  const char* AssetLoader::getBackendName() const noexcept
+  {
+    return pImpl->getBackendName();
+  }
+}
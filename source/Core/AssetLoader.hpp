@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+
+#include "File.hpp"
+
+namespace De
+{
+  /**
+   * @brief Contents of a file read by the AssetLoader.
+   * The data is aligned to alignment, which is enough for SPIR-V and for FMOD banks loaded in place.
+   * Files stored uncompressed in a mounted archive are views into the read-only archive mapping, only getData gives access to them.
+   */
+  class LoadedFile
+  {
+  public:
+    static constexpr size_t alignment = 64;
+
+    LoadedFile() noexcept = default;
+    explicit LoadedFile(size_t size);
+    /**
+     * @brief Doesn't own the data, which has to outlive the returned object.
+     */
+    static LoadedFile view(ConstByteSpan data) noexcept;
+    LoadedFile(const LoadedFile& other) = delete;
+    LoadedFile(LoadedFile&& other) noexcept;
+    LoadedFile& operator=(const LoadedFile& rhs) = delete;
+    LoadedFile& operator=(LoadedFile&& rhs) noexcept;
+    ~LoadedFile();
+
+    ConstByteSpan getSpan() const noexcept { return { data, size }; }
+    const uint8_t* getData() const noexcept { return data; }
+    /**
+     * @brief For filling a file created with a size. Asserts that the file isn't a view.
+     */
+    uint8_t* getMutableData() noexcept;
+    size_t getSize() const noexcept { return size; }
+    bool isView() const noexcept { return data != ownedData; }
+
+  private:
+    const uint8_t* data = nullptr;
+    /**
+     * @brief Same as data if the file owns it, nullptr for views.
+     */
+    uint8_t* ownedData = nullptr;
+    size_t size = 0;
+  };
+
+  /**
+   * @brief Reads whole files in the background, so that subsystems can initialize while their data streams in.
+   * On Linux the reads go through io_uring, elsewhere or if io_uring is unavailable through a pool of worker threads.
+   * Files found in a mounted archive are taken from it instead, compressed ones are decompressed on a loader thread.
+   * The destructor waits for all requested reads.
+   */
+  class AssetLoader
+  {
+  public:
+    /**
+     * @brief Called on a loader thread when a read completed. file is nullptr if the read failed, the error is logged.
+     * Callbacks should be short, they delay the other reads.
+     */
+    using Callback = std::function<void(const char* fileName, LoadedFile* file)>;
+
+    /**
+     * @param workerCount Threads reading files if io_uring isn't used.
+     */
+    explicit AssetLoader(int workerCount = 2);
+    AssetLoader(const AssetLoader& other) = delete;
+    AssetLoader& operator=(const AssetLoader& rhs) = delete;
+    ~AssetLoader();
+
+    /**
+     * @return Future that throws De::Exception from get if the file couldn't be read.
+     */
+    std::future<LoadedFile> read(const char* fileName);
+    void read(const char* fileName, Callback callback);
+    /**
+     * @brief Requests all files at once, which lets io_uring submit them with a single system call.
+     * @param futures Receives a future per file.
+     */
+    void readBatch(const char* const* fileNames, size_t count, std::future<LoadedFile>* futures);
+
+    /**
+     * @brief Serves later reads of files contained in the archive from it. Call it before reading anything.
+     * The archive stays mapped as long as the loader exists.
+     * @return false if the archive couldn't be opened, the error is logged.
+     */
+    bool mountArchive(const char* fileName);
+
+    const char* getBackendName() const noexcept;
+
+  private:
+    class Impl;
+    std::unique_ptr<Impl> pImpl;
+  };
+}
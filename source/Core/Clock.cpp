@@ -0,0 +1,51 @@
+#include "Clock.hpp"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#elif defined(__linux__)
+#include <time.h>
+#else
+#include <chrono>
+#endif
+
+namespace De
+{
+  namespace Clock
+  {
+#ifdef _WIN32
+    namespace
+    {
+      int64_t queryFrequency() noexcept
+      {
+        LARGE_INTEGER frequency;
+        QueryPerformanceFrequency(&frequency);
+        return frequency.QuadPart;
+      }
+    }
+
+    int64_t now() noexcept
+    {
+      static const int64_t counterFrequency = queryFrequency();
+      LARGE_INTEGER counter;
+      QueryPerformanceCounter(&counter);
+      // Split to keep the multiplication from overflowing, the counter runs at 10 MHz on current systems.
+      const int64_t seconds = counter.QuadPart / counterFrequency;
+      const int64_t remainder = counter.QuadPart % counterFrequency;
+      return seconds * 1000000000 + remainder * 1000000000 / counterFrequency;
+    }
+#elif defined(__linux__)
+    int64_t now() noexcept
+    {
+      timespec time;
+      clock_gettime(CLOCK_MONOTONIC, &time);
+      return int64_t(time.tv_sec) * 1000000000 + int64_t(time.tv_nsec);
+    }
+#else
+    int64_t now() noexcept
+    {
+      return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+#endif
+  }
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+
+namespace De
+{
+  /**
+   * @brief Monotonic high resolution clock, QueryPerformanceCounter on Windows and clock_gettime(CLOCK_MONOTONIC)
+   * on Linux. Unlike Profiler::readTimestamp it is in nanoseconds without calibration.
+   */
+  namespace Clock
+  {
+    /**
+     * @return Nanoseconds since an unspecified point, never decreasing.
+     */
+    int64_t now() noexcept;
+
+    inline double toSeconds(int64_t nanoseconds) noexcept { return double(nanoseconds) * 1e-9; }
+    inline int64_t fromSeconds(double seconds) noexcept { return int64_t(seconds * 1e9); }
+
+    /**
+     * @return Seconds since *time, which is set to now.
+     */
+    inline double measureSecondsSince(int64_t* time) noexcept
+    {
+      const int64_t currentTime = now();
+      const double seconds = toSeconds(currentTime - *time);
+      *time = currentTime;
+      return seconds;
+    }
+  }
+}
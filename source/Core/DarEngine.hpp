@@ -10,26 +10,14 @@ using byte = unsigned char;
 #ifdef _WIN32
 #define WIN32_LEAN_AND_MEAN
 #include <windows.h>
-
-  #define logError(message, ...) \
-  { \
-    char stringBuffer[1024]; \
-    _snprintf_s(stringBuffer, sizeof(stringBuffer), "[ERROR][" DAR_MODULE_NAME "] " message "\n", __VA_ARGS__); \
-    OutputDebugStringA(stringBuffer); \
-  }
-  #define logWarning(message, ...) \
-  { \
-    char stringBuffer[1024]; \
-    _snprintf_s(stringBuffer, sizeof(stringBuffer), "[WARN][" DAR_MODULE_NAME "] " message "\n", __VA_ARGS__); \
-    OutputDebugStringA(stringBuffer); \
-  }
-  #define logInfo(message, ...) \
-  { \
-    char stringBuffer[1024]; \
-    _snprintf_s(stringBuffer, sizeof(stringBuffer), "[INFO][" DAR_MODULE_NAME "] " message "\n", __VA_ARGS__); \
-    OutputDebugStringA(stringBuffer); \
-  }
 #endif
+
+#include "Log.hpp"
+
+// Formatting happens on the logging thread, arguments have to be arithmetic, enums, pointers or strings.
+#define logError(message, ...) De::Log::write("[ERROR][" DAR_MODULE_NAME "] " message "\n", ##__VA_ARGS__)
+#define logWarning(message, ...) De::Log::write("[WARN][" DAR_MODULE_NAME "] " message "\n", ##__VA_ARGS__)
+#define logInfo(message, ...) De::Log::write("[INFO][" DAR_MODULE_NAME "] " message "\n", ##__VA_ARGS__)
 #define logVariable(variable, format) logInfo(#variable " = " format, variable)
 
 #define arrayCount(arr) (sizeof(arr) / sizeof(arr[0]))
@@ -39,6 +27,7 @@ using byte = unsigned char;
   #define assert(condition) \
     if(!(condition)) { \
       logError("Assertion failed: %s", #condition); \
+      De::Log::flush(); \
       *(int*)0 = 0; \
     }
 
@@ -1,5 +1,20 @@
 #include "DarMath.hpp"
 
+#include <atomic>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+  #define DAR_MATH_X86
+  #include <immintrin.h>
+  #ifdef _MSC_VER
+    #include <intrin.h>
+    #define DAR_TARGET_AVX
+  #else
+    #include <cpuid.h>
+    #define DAR_TARGET_AVX __attribute__((target("avx")))
+  #endif
+#endif
+
 Vec3f operator*(const Vec3f& left, const Mat3f& right) noexcept
 {
   return
@@ -9,16 +24,6 @@ Vec3f operator*(const Vec3f& left, const Mat3f& right) noexcept
     left.x*right[0][2] + left.y*right[1][2] + left.z*right[2][2]
   };
 }
-Vec4f operator*(const Vec4f& left, const Mat4f& right) noexcept
-{
-  return
-  {
-    left.x*right[0][0] + left.y*right[1][0] + left.z*right[2][0] + left.w*right[3][0],
-    left.x*right[0][1] + left.y*right[1][1] + left.z*right[2][1] + left.w*right[3][1],
-    left.x*right[0][2] + left.y*right[1][2] + left.z*right[2][2] + left.w*right[3][2],
-    left.x*right[0][3] + left.y*right[1][3] + left.z*right[2][3] + left.w*right[3][3],
-  };
-}
 Vec4f operator*(const Vec4f& left, const Mat4x3f& right) noexcept
 {
   return
@@ -46,27 +51,6 @@ Mat3f operator*(const Mat3f& left, const Mat3f& right) noexcept
     left[2][0] * right[0][2] + left[2][1] * right[1][2] + left[2][2] * right[2][2]
   };
 }
-Mat4x3f operator*(const Mat3f& left, const Mat4x3f& right) noexcept
-{
-  return
-  {
-    left[0][0]*right[0][0] + left[0][1]*right[1][0] + left[0][2]*right[2][0],
-    left[0][0]*right[0][1] + left[0][1]*right[1][1] + left[0][2]*right[2][1],
-    left[0][0]*right[0][2] + left[0][1]*right[1][2] + left[0][2]*right[2][2],
-
-    left[1][0]*right[0][0] + left[1][1]*right[1][0] + left[1][2]*right[2][0],
-    left[1][0]*right[0][1] + left[1][1]*right[1][1] + left[1][2]*right[2][1],
-    left[1][0]*right[0][2] + left[1][1]*right[1][2] + left[1][2]*right[2][2],
-
-    left[2][0]*right[0][0] + left[2][1]*right[1][0] + left[2][2]*right[2][0],
-    left[2][0]*right[0][1] + left[2][1]*right[1][1] + left[2][2]*right[2][1],
-    left[2][0]*right[0][2] + left[2][1]*right[1][2] + left[2][2]*right[2][2],
-
-    right[3][0],
-    right[3][1],
-    right[3][2],
-  };
-}
 Mat4x3f operator*(const Mat4x3f& left, const Mat3f& right) noexcept
 {
   return
@@ -109,7 +93,46 @@ Mat4x3f operator*(const Mat4x3f& left, const Mat4x3f& right) noexcept
     left[3][0]*right[0][2] + left[3][1]*right[1][2] + left[3][2]*right[2][2] + right[3][2]
   };
 }
-Mat4f operator*(const Mat4x3f& left, const Mat4f& right) noexcept
+Mat4f operator*(const Mat4f& left, const Mat4x3f& right) noexcept
+{
+  return
+  {
+    left[0][0]*right[0][0] + left[0][1]*right[1][0] + left[0][2]*right[2][0] + left[0][3]*right[3][0],
+    left[0][0]*right[0][1] + left[0][1]*right[1][1] + left[0][2]*right[2][1] + left[0][3]*right[3][1],
+    left[0][0]*right[0][2] + left[0][1]*right[1][2] + left[0][2]*right[2][2] + left[0][3]*right[3][2],
+    left[0][3],
+
+    left[1][0]*right[0][0] + left[1][1]*right[1][0] + left[1][2]*right[2][0] + left[1][3]*right[3][0],
+    left[1][0]*right[0][1] + left[1][1]*right[1][1] + left[1][2]*right[2][1] + left[1][3]*right[3][1],
+    left[1][0]*right[0][2] + left[1][1]*right[1][2] + left[1][2]*right[2][2] + left[1][3]*right[3][2],
+    left[1][3],
+
+    left[2][0]*right[0][0] + left[2][1]*right[1][0] + left[2][2]*right[2][0] + left[2][3]*right[3][0],
+    left[2][0]*right[0][1] + left[2][1]*right[1][1] + left[2][2]*right[2][1] + left[2][3]*right[3][1],
+    left[2][0]*right[0][2] + left[2][1]*right[1][2] + left[2][2]*right[2][2] + left[2][3]*right[3][2],
+    left[2][3],
+
+    left[3][0]*right[0][0] + left[3][1]*right[1][0] + left[3][2]*right[2][0] + left[3][3]*right[3][0],
+    left[3][0]*right[0][1] + left[3][1]*right[1][1] + left[3][2]*right[2][1] + left[3][3]*right[3][1],
+    left[3][0]*right[0][2] + left[3][1]*right[1][2] + left[3][2]*right[2][2] + left[3][3]*right[3][2],
+    left[3][3]
+  };
+}
+
+// Kernels for products whose right side is a Mat4f. Those map onto 4 wide registers, one row per register.
+// SIMD kernels use the same order of operations and no FMA, so their results are bitwise equal to the scalar ones.
+
+static Vec4f multiplyScalar(const Vec4f& left, const Mat4f& right) noexcept
+{
+  return
+  {
+    left.x*right[0][0] + left.y*right[1][0] + left.z*right[2][0] + left.w*right[3][0],
+    left.x*right[0][1] + left.y*right[1][1] + left.z*right[2][1] + left.w*right[3][1],
+    left.x*right[0][2] + left.y*right[1][2] + left.z*right[2][2] + left.w*right[3][2],
+    left.x*right[0][3] + left.y*right[1][3] + left.z*right[2][3] + left.w*right[3][3],
+  };
+}
+static Mat4f multiplyScalar(const Mat4x3f& left, const Mat4f& right) noexcept
 {
   return
   {
@@ -134,53 +157,340 @@ Mat4f operator*(const Mat4x3f& left, const Mat4f& right) noexcept
     left[3][0]*right[0][3] + left[3][1]*right[1][3] + left[3][2]*right[2][3] + right[3][3]
   };
 }
-Mat4f operator*(const Mat4f& left, const Mat4x3f& right) noexcept
+static Mat4f multiplyScalar(const Mat4f& left, const Mat4f& right) noexcept
 {
   return
   {
     left[0][0]*right[0][0] + left[0][1]*right[1][0] + left[0][2]*right[2][0] + left[0][3]*right[3][0],
     left[0][0]*right[0][1] + left[0][1]*right[1][1] + left[0][2]*right[2][1] + left[0][3]*right[3][1],
     left[0][0]*right[0][2] + left[0][1]*right[1][2] + left[0][2]*right[2][2] + left[0][3]*right[3][2],
-    left[0][3],
+    left[0][0]*right[0][3] + left[0][1]*right[1][3] + left[0][2]*right[2][3] + left[0][3]*right[3][3],
 
     left[1][0]*right[0][0] + left[1][1]*right[1][0] + left[1][2]*right[2][0] + left[1][3]*right[3][0],
     left[1][0]*right[0][1] + left[1][1]*right[1][1] + left[1][2]*right[2][1] + left[1][3]*right[3][1],
     left[1][0]*right[0][2] + left[1][1]*right[1][2] + left[1][2]*right[2][2] + left[1][3]*right[3][2],
-    left[1][3],
+    left[1][0]*right[0][3] + left[1][1]*right[1][3] + left[1][2]*right[2][3] + left[1][3]*right[3][3],
 
     left[2][0]*right[0][0] + left[2][1]*right[1][0] + left[2][2]*right[2][0] + left[2][3]*right[3][0],
     left[2][0]*right[0][1] + left[2][1]*right[1][1] + left[2][2]*right[2][1] + left[2][3]*right[3][1],
     left[2][0]*right[0][2] + left[2][1]*right[1][2] + left[2][2]*right[2][2] + left[2][3]*right[3][2],
-    left[2][3],
+    left[2][0]*right[0][3] + left[2][1]*right[1][3] + left[2][2]*right[2][3] + left[2][3]*right[3][3],
 
     left[3][0]*right[0][0] + left[3][1]*right[1][0] + left[3][2]*right[2][0] + left[3][3]*right[3][0],
     left[3][0]*right[0][1] + left[3][1]*right[1][1] + left[3][2]*right[2][1] + left[3][3]*right[3][1],
     left[3][0]*right[0][2] + left[3][1]*right[1][2] + left[3][2]*right[2][2] + left[3][3]*right[3][2],
-    left[3][3]
+    left[3][0]*right[0][3] + left[3][1]*right[1][3] + left[3][2]*right[2][3] + left[3][3]*right[3][3]
   };
 }
-Mat4f operator*(const Mat4f& left, const Mat4f& right) noexcept
+
+#ifdef DAR_MATH_X86
+/**
+ * @brief Computes two result rows at once, rows are only 16 byte aligned so unaligned 256 bit loads are used.
+ */
+DAR_TARGET_AVX static inline __m256 multiplyTwoRowsAvx(const float* leftRows, const Mat4f& right) noexcept
 {
-  return
+  const __m256 left = _mm256_loadu_ps(leftRows);
+  __m256 result = _mm256_mul_ps(_mm256_permute_ps(left, 0x00), _mm256_broadcast_ps((const __m128*)right[0]));
+  result = _mm256_add_ps(result, _mm256_mul_ps(_mm256_permute_ps(left, 0x55), _mm256_broadcast_ps((const __m128*)right[1])));
+  result = _mm256_add_ps(result, _mm256_mul_ps(_mm256_permute_ps(left, 0xAA), _mm256_broadcast_ps((const __m128*)right[2])));
+  return _mm256_add_ps(result, _mm256_mul_ps(_mm256_permute_ps(left, 0xFF), _mm256_broadcast_ps((const __m128*)right[3])));
+}
+DAR_TARGET_AVX static Mat4f multiplyAvx(const Mat4f& left, const Mat4f& right) noexcept
+{
+  Mat4f result;
+  _mm256_storeu_ps(result[0], multiplyTwoRowsAvx(left[0], right));
+  _mm256_storeu_ps(result[2], multiplyTwoRowsAvx(left[2], right));
+  _mm256_zeroupper();
+  return result;
+}
+
+static SimdLevel detectSimdLevel() noexcept
+{
+  unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+#ifdef _MSC_VER
+  int cpuInfo[4];
+  __cpuid(cpuInfo, 1);
+  ecx = (unsigned int)cpuInfo[2];
+#else
+  if(!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+    return SimdLevel::Scalar;
+  }
+#endif
+  constexpr unsigned int osxsaveBit = 1u << 27;
+  constexpr unsigned int avxBit = 1u << 28;
+  if((ecx & osxsaveBit) && (ecx & avxBit)) {
+    // The OS has to save the YMM registers on context switch too.
+#ifdef _MSC_VER
+    const unsigned long long xcr0 = _xgetbv(0);
+#else
+    unsigned int xcr0Low, xcr0High;
+    __asm__("xgetbv" : "=a"(xcr0Low), "=d"(xcr0High) : "c"(0));
+    const unsigned long long xcr0 = xcr0Low;
+#endif
+    if((xcr0 & 0x6) == 0x6) {
+      return SimdLevel::Avx;
+    }
+  }
+  return SimdLevel::Scalar;
+}
+#else
+static SimdLevel detectSimdLevel() noexcept
+{
+  return SimdLevel::Scalar;
+}
+#endif
+
+namespace
+{
+  // Constant initialized to the scalar kernel, so operators work during dynamic initialization of other translation
+  // units too. Atomic since setSimdLevel may store while other threads multiply, loads are relaxed because every
+  // kernel gives the same results.
+  std::atomic<SimdLevel> simdLevel{ SimdLevel::Scalar };
+  std::atomic<Mat4f (*)(const Mat4f&, const Mat4f&) noexcept> multiplyMat4fMat4f{ &multiplyScalar };
+
+  SimdLevel useKernels(SimdLevel level) noexcept
   {
-    left[0][0]*right[0][0] + left[0][1]*right[1][0] + left[0][2]*right[2][0] + left[0][3]*right[3][0],
-    left[0][0]*right[0][1] + left[0][1]*right[1][1] + left[0][2]*right[2][1] + left[0][3]*right[3][1],
-    left[0][0]*right[0][2] + left[0][1]*right[1][2] + left[0][2]*right[2][2] + left[0][3]*right[3][2],
-    left[0][0]*right[0][3] + left[0][1]*right[1][3] + left[0][2]*right[2][3] + left[0][3]*right[3][3],
+    // Only kernels that beat the scalar code, which the compiler vectorizes itself, are dispatched. SSE kernels of
+    // Vec4f, Mat4x3f and Mat4f products measured as slow or slower, so there is no Sse level.
+    Mat4f (*mat4fMat4f)(const Mat4f&, const Mat4f&) noexcept = &multiplyScalar;
+#ifdef DAR_MATH_X86
+    if(level >= SimdLevel::Avx) {
+      mat4fMat4f = &multiplyAvx;
+    }
+#endif
+    multiplyMat4fMat4f.store(mat4fMat4f, std::memory_order_relaxed);
+    simdLevel.store(level, std::memory_order_relaxed);
+    return level;
+  }
 
-    left[1][0]*right[0][0] + left[1][1]*right[1][0] + left[1][2]*right[2][0] + left[1][3]*right[3][0],
-    left[1][0]*right[0][1] + left[1][1]*right[1][1] + left[1][2]*right[2][1] + left[1][3]*right[3][1],
-    left[1][0]*right[0][2] + left[1][1]*right[1][2] + left[1][2]*right[2][2] + left[1][3]*right[3][2],
-    left[1][0]*right[0][3] + left[1][1]*right[1][3] + left[1][2]*right[2][3] + left[1][3]*right[3][3],
+  // Resolved once during static initialization, before main starts any thread.
+  const SimdLevel initialSimdLevel = useKernels(detectSimdLevel());
+}
 
-    left[2][0]*right[0][0] + left[2][1]*right[1][0] + left[2][2]*right[2][0] + left[2][3]*right[3][0],
-    left[2][0]*right[0][1] + left[2][1]*right[1][1] + left[2][2]*right[2][1] + left[2][3]*right[3][1],
-    left[2][0]*right[0][2] + left[2][1]*right[1][2] + left[2][2]*right[2][2] + left[2][3]*right[3][2],
-    left[2][0]*right[0][3] + left[2][1]*right[1][3] + left[2][2]*right[2][3] + left[2][3]*right[3][3],
+SimdLevel getSimdLevel() noexcept
+{
+  return simdLevel.load(std::memory_order_relaxed);
+}
+SimdLevel setSimdLevel(SimdLevel level) noexcept
+{
+  return useKernels(std::min(level, detectSimdLevel()));
+}
 
-    left[3][0]*right[0][0] + left[3][1]*right[1][0] + left[3][2]*right[2][0] + left[3][3]*right[3][0],
-    left[3][0]*right[0][1] + left[3][1]*right[1][1] + left[3][2]*right[2][1] + left[3][3]*right[3][1],
-    left[3][0]*right[0][2] + left[3][1]*right[1][2] + left[3][2]*right[2][2] + left[3][3]*right[3][2],
-    left[3][0]*right[0][3] + left[3][1]*right[1][3] + left[3][2]*right[2][3] + left[3][3]*right[3][3]
+Vec4f operator*(const Vec4f& left, const Mat4f& right) noexcept
+{
+  return multiplyScalar(left, right);
+}
+Mat4f operator*(const Mat4x3f& left, const Mat4f& right) noexcept
+{
+  return multiplyScalar(left, right);
+}
+Mat4f operator*(const Mat4f& left, const Mat4f& right) noexcept
+{
+  return multiplyMat4fMat4f.load(std::memory_order_relaxed)(left, right);
+}
+
+void transformPoints(
+  const float* __restrict x, const float* __restrict y, const float* __restrict z, int count,
+  const Mat4f& matrix,
+  float* __restrict outX, float* __restrict outY, float* __restrict outZ, float* __restrict outW
+) noexcept
+{
+  const Mat4f m = matrix;
+  for(int i = 0; i < count; ++i) {
+    outX[i] = x[i]*m[0][0] + y[i]*m[1][0] + z[i]*m[2][0] + m[3][0];
+    outY[i] = x[i]*m[0][1] + y[i]*m[1][1] + z[i]*m[2][1] + m[3][1];
+    outZ[i] = x[i]*m[0][2] + y[i]*m[1][2] + z[i]*m[2][2] + m[3][2];
+    outW[i] = x[i]*m[0][3] + y[i]*m[1][3] + z[i]*m[2][3] + m[3][3];
+  }
+}
+void transform(
+  const float* __restrict x, const float* __restrict y, const float* __restrict z, const float* __restrict w, int count,
+  const Mat4f& matrix,
+  float* __restrict outX, float* __restrict outY, float* __restrict outZ, float* __restrict outW
+) noexcept
+{
+  const Mat4f m = matrix;
+  for(int i = 0; i < count; ++i) {
+    outX[i] = x[i]*m[0][0] + y[i]*m[1][0] + z[i]*m[2][0] + w[i]*m[3][0];
+    outY[i] = x[i]*m[0][1] + y[i]*m[1][1] + z[i]*m[2][1] + w[i]*m[3][1];
+    outZ[i] = x[i]*m[0][2] + y[i]*m[1][2] + z[i]*m[2][2] + w[i]*m[3][2];
+    outW[i] = x[i]*m[0][3] + y[i]*m[1][3] + z[i]*m[2][3] + w[i]*m[3][3];
+  }
+}
+void concatenateTranslations(
+  const float* __restrict x, const float* __restrict y, const float* __restrict z, int count,
+  const Mat4f& right,
+  Mat4f* __restrict output
+) noexcept
+{
+  // Upper 3 rows of a translation are identity, so only the last row depends on the translation.
+  const Mat4f r = right;
+  for(int i = 0; i < count; ++i) {
+    std::memcpy(output[i].values, r.values, 3 * sizeof(r.values[0]));
+    float* lastRow = output[i][3];
+    lastRow[0] = x[i]*r[0][0] + y[i]*r[1][0] + z[i]*r[2][0] + r[3][0];
+    lastRow[1] = x[i]*r[0][1] + y[i]*r[1][1] + z[i]*r[2][1] + r[3][1];
+    lastRow[2] = x[i]*r[0][2] + y[i]*r[1][2] + z[i]*r[2][2] + r[3][2];
+    lastRow[3] = x[i]*r[0][3] + y[i]*r[1][3] + z[i]*r[2][3] + r[3][3];
+  }
+}
+void testPointsAgainstPlanes(
+  const float* __restrict x, const float* __restrict y, const float* __restrict z, int count,
+  const Vec4f* planes, int planeCount, float radius,
+  uint8_t* __restrict output
+) noexcept
+{
+  std::fill_n(output, count, uint8_t(1));
+  // Plane by plane, so the inner loop is branchless over points.
+  for(int p = 0; p < planeCount; ++p) {
+    const Vec4f plane = planes[p];
+    const float d = plane.w + radius;
+    for(int i = 0; i < count; ++i) {
+      const float distance = x[i]*plane.x + y[i]*plane.y + z[i]*plane.z + d;
+      output[i] &= uint8_t(distance >= 0.f);
+    }
+  }
+}
+Frustum Frustum::fromViewProjectionD3d(const Mat4f& viewProjection) noexcept
+{
+  // Gribb & Hartmann, with row vectors the planes are combinations of columns instead of rows.
+  const Mat4f& m = viewProjection;
+  const Vec4f columns[4] = {
+    { m[0][0], m[1][0], m[2][0], m[3][0] },
+    { m[0][1], m[1][1], m[2][1], m[3][1] },
+    { m[0][2], m[1][2], m[2][2], m[3][2] },
+    { m[0][3], m[1][3], m[2][3], m[3][3] }
   };
+  Frustum result;
+  result.planes[Left] = columns[3] + columns[0];
+  result.planes[Right] = columns[3] - columns[0];
+  result.planes[Bottom] = columns[3] + columns[1];
+  result.planes[Top] = columns[3] - columns[1];
+  result.planes[Near] = columns[2];
+  result.planes[Far] = columns[3] - columns[2];
+  // Normalized, so that the planes give distances and can be compared against radii.
+  for(Vec4f& plane : result.planes) {
+    plane = plane * (1.f / length(Vec3f{ plane.x, plane.y, plane.z }));
+  }
+  return result;
+}
+void testAabbsAgainstFrustum(
+  const float* centerX, const float* centerY, const float* centerZ,
+  const float* extentX, const float* extentY, const float* extentZ, int count,
+  const Frustum& frustum,
+  uint8_t* output
+) noexcept
+{
+  // Same as testPointsAgainstPlanes, with the box projected onto the plane normal as radius.
+  Vec4f absNormals[Frustum::PlaneCount];
+  for(int p = 0; p < Frustum::PlaneCount; ++p) {
+    const Vec4f& plane = frustum.planes[p];
+    absNormals[p] = { std::abs(plane.x), std::abs(plane.y), std::abs(plane.z), 0.f };
+  }
+  int i = 0;
+#ifdef DAR_MATH_X86
+  // 4 boxes at a time against all planes.
+  const __m128 zero = _mm_setzero_ps();
+  for(; i + 4 <= count; i += 4) {
+    const __m128 cx = _mm_loadu_ps(centerX + i);
+    const __m128 cy = _mm_loadu_ps(centerY + i);
+    const __m128 cz = _mm_loadu_ps(centerZ + i);
+    const __m128 ex = _mm_loadu_ps(extentX + i);
+    const __m128 ey = _mm_loadu_ps(extentY + i);
+    const __m128 ez = _mm_loadu_ps(extentZ + i);
+    __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+    for(int p = 0; p < Frustum::PlaneCount; ++p) {
+      const Vec4f& plane = frustum.planes[p];
+      const Vec4f& absNormal = absNormals[p];
+      __m128 distance = _mm_mul_ps(cx, _mm_set1_ps(plane.x));
+      distance = _mm_add_ps(distance, _mm_mul_ps(cy, _mm_set1_ps(plane.y)));
+      distance = _mm_add_ps(distance, _mm_mul_ps(cz, _mm_set1_ps(plane.z)));
+      distance = _mm_add_ps(distance, _mm_set1_ps(plane.w));
+      __m128 radius = _mm_mul_ps(ex, _mm_set1_ps(absNormal.x));
+      radius = _mm_add_ps(radius, _mm_mul_ps(ey, _mm_set1_ps(absNormal.y)));
+      radius = _mm_add_ps(radius, _mm_mul_ps(ez, _mm_set1_ps(absNormal.z)));
+      inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(distance, radius), zero));
+    }
+    const int mask = _mm_movemask_ps(inside);
+    output[i] = uint8_t(mask & 1);
+    output[i + 1] = uint8_t((mask >> 1) & 1);
+    output[i + 2] = uint8_t((mask >> 2) & 1);
+    output[i + 3] = uint8_t((mask >> 3) & 1);
+  }
+#endif
+  for(; i < count; ++i) {
+    bool inside = true;
+    for(int p = 0; p < Frustum::PlaneCount; ++p) {
+      const Vec4f& plane = frustum.planes[p];
+      const Vec4f& absNormal = absNormals[p];
+      const float distance = centerX[i]*plane.x + centerY[i]*plane.y + centerZ[i]*plane.z + plane.w;
+      const float radius = extentX[i]*absNormal.x + extentY[i]*absNormal.y + extentZ[i]*absNormal.z;
+      inside &= distance + radius >= 0.f;
+    }
+    output[i] = uint8_t(inside);
+  }
+}
+void slerpFast(const QuatfArrays& from, const QuatfArrays& to, const float* t, int count, const QuatfArrays& output) noexcept
+{
+  int i = 0;
+#ifdef DAR_MATH_X86
+  // Same as the single quaternion version, 4 quaternions at a time. 
+  // Written with intrinsics, std::sqrt keeps compilers from vectorizing because of errno.
+  const __m128 half = _mm_set1_ps(0.5f);
+  const __m128 one = _mm_set1_ps(1.f);
+  const __m128 signMask = _mm_set1_ps(-0.f);
+  for(; i + 4 <= count; i += 4) {
+    const __m128 fromX = _mm_loadu_ps(from.x + i);
+    const __m128 fromY = _mm_loadu_ps(from.y + i);
+    const __m128 fromZ = _mm_loadu_ps(from.z + i);
+    const __m128 fromS = _mm_loadu_ps(from.s + i);
+    const __m128 toX = _mm_loadu_ps(to.x + i);
+    const __m128 toY = _mm_loadu_ps(to.y + i);
+    const __m128 toZ = _mm_loadu_ps(to.z + i);
+    const __m128 toS = _mm_loadu_ps(to.s + i);
+    const __m128 ti = _mm_loadu_ps(t + i);
+
+    __m128 cosTheta = _mm_mul_ps(fromX, toX);
+    cosTheta = _mm_add_ps(cosTheta, _mm_mul_ps(fromY, toY));
+    cosTheta = _mm_add_ps(cosTheta, _mm_mul_ps(fromZ, toZ));
+    cosTheta = _mm_add_ps(cosTheta, _mm_mul_ps(fromS, toS));
+    const __m128 cosThetaSign = _mm_and_ps(cosTheta, signMask);
+    const __m128 d = _mm_andnot_ps(signMask, cosTheta);
+    __m128 a = _mm_sub_ps(_mm_set1_ps(3.55645f), _mm_mul_ps(d, _mm_set1_ps(1.43519f)));
+    a = _mm_add_ps(_mm_set1_ps(-3.2452f), _mm_mul_ps(d, a));
+    a = _mm_add_ps(_mm_set1_ps(1.0904f), _mm_mul_ps(d, a));
+    __m128 b = _mm_add_ps(_mm_set1_ps(-1.06021f), _mm_mul_ps(d, _mm_set1_ps(0.215638f)));
+    b = _mm_add_ps(_mm_set1_ps(0.848013f), _mm_mul_ps(d, b));
+    const __m128 tMinusHalf = _mm_sub_ps(ti, half);
+    const __m128 k = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(a, tMinusHalf), tMinusHalf), b);
+    const __m128 correctedT = _mm_add_ps(ti, _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(ti, tMinusHalf), _mm_sub_ps(ti, one)), k));
+    const __m128 wq1 = _mm_sub_ps(one, correctedT);
+    const __m128 wq2 = _mm_xor_ps(correctedT, cosThetaSign);
+
+    const __m128 x = _mm_add_ps(_mm_mul_ps(wq1, fromX), _mm_mul_ps(wq2, toX));
+    const __m128 y = _mm_add_ps(_mm_mul_ps(wq1, fromY), _mm_mul_ps(wq2, toY));
+    const __m128 z = _mm_add_ps(_mm_mul_ps(wq1, fromZ), _mm_mul_ps(wq2, toZ));
+    const __m128 s = _mm_add_ps(_mm_mul_ps(wq1, fromS), _mm_mul_ps(wq2, toS));
+    __m128 lengthSquared = _mm_mul_ps(x, x);
+    lengthSquared = _mm_add_ps(lengthSquared, _mm_mul_ps(y, y));
+    lengthSquared = _mm_add_ps(lengthSquared, _mm_mul_ps(z, z));
+    lengthSquared = _mm_add_ps(lengthSquared, _mm_mul_ps(s, s));
+    const __m128 lengthInverse = _mm_div_ps(one, _mm_sqrt_ps(lengthSquared));
+    _mm_storeu_ps(output.x + i, _mm_mul_ps(x, lengthInverse));
+    _mm_storeu_ps(output.y + i, _mm_mul_ps(y, lengthInverse));
+    _mm_storeu_ps(output.z + i, _mm_mul_ps(z, lengthInverse));
+    _mm_storeu_ps(output.s + i, _mm_mul_ps(s, lengthInverse));
+  }
+#endif
+  for(; i < count; ++i) {
+    const Quatf result = slerpFast(
+      Quatf{ { from.x[i], from.y[i], from.z[i] }, from.s[i] }, 
+      Quatf{ { to.x[i], to.y[i], to.z[i] }, to.s[i] }, 
+      t[i]
+    );
+    output.x[i] = result.v.x;
+    output.y[i] = result.v.y;
+    output.z[i] = result.v.z;
+    output.s[i] = result.s;
+  }
 }
\ No newline at end of file
@@ -5,12 +5,32 @@
  */
 
 #include <algorithm>
+#include <cfloat>
 #include <cmath>
+#include <cstdint>
 
 #include "DarEngine.hpp"
 
 constexpr float Pi = 3.14159265358979323846f;
 
+/**
+ * @brief Instruction set used by the matrix multiplication kernels, only Mat4f * Mat4f has a kernel besides the scalar one.
+ * Detected from CPU features during static initialization, falls back to Scalar on unsupported CPUs.
+ * Results are bitwise equal at every level.
+ */
+enum class SimdLevel
+{
+  Scalar = 0,
+  Avx
+};
+SimdLevel getSimdLevel() noexcept;
+/**
+ * @brief Forces kernels of a specific level, e.g. for comparing them in benchmarks and tests. 
+ * Meant for startup, multiplications that run meanwhile on other threads may use either level.
+ * @return Level actually used, which is lower than requested if the CPU doesn't support it.
+ */
+SimdLevel setSimdLevel(SimdLevel level) noexcept;
+
 struct Vec2f
 {
   float x, y;
@@ -86,7 +106,7 @@ constexpr inline Vec3f lerp(const Vec3f& v1, const Vec3f& v2, float t) noexcept
 {
   return lerp(v1, v2, t, 1.f - t);
 }
-struct Vec4f
+struct alignas(16) Vec4f
 {
   float x, y, z, w;
 };
@@ -235,6 +255,91 @@ constexpr inline float radiansToDegrees(float radians) noexcept
   return radians * 180.f / Pi;
 }
 
+/**
+ * @brief Domain of constexprSin and constexprCos.
+ */
+constexpr float maxTrigonometryRadians = 1048576.f;
+
+namespace detail
+{
+  constexpr double halfPi = 1.57079632679489661923;
+
+  /**
+   * @return Distance between x and the next representable float away from zero.
+   */
+  constexpr double ulp(float x) noexcept
+  {
+    double magnitude = x < 0.f ? -double(x) : double(x);
+    double result = 1.401298464324817e-45; // Smallest denormal.
+    double exponentStart = 1.1754943508222875e-38; // Smallest normal.
+    if(magnitude >= exponentStart) {
+      result = 1.1920928955078125e-07; // 2^-23, ulp in [1, 2).
+      double power = 1.;
+      while(magnitude >= 2. * power) {
+        power *= 2.;
+        result *= 2.;
+      }
+      while(magnitude < power) {
+        power *= 0.5;
+        result *= 0.5;
+      }
+    }
+    return result;
+  }
+  /**
+   * @brief Taylor series, accurate to double precision for |x| <= Pi / 4.
+   */
+  constexpr double sinReduced(double x) noexcept
+  {
+    double xx = x * x;
+    return x * (1. - xx / 6. * (1. - xx / 20. * (1. - xx / 42. * (1. - xx / 72. * (1. - xx / 110. * (1. - xx / 156. * (1. - xx / 210.)))))));
+  }
+  constexpr double cosReduced(double x) noexcept
+  {
+    double xx = x * x;
+    return 1. - xx / 2. * (1. - xx / 12. * (1. - xx / 30. * (1. - xx / 56. * (1. - xx / 90. * (1. - xx / 132. * (1. - xx / 182.))))));
+  }
+  /**
+   * @param quadrantOffset 0 for sin, 1 for cos.
+   */
+  constexpr float sinQuadrant(float radians, long long quadrantOffset) noexcept
+  {
+    // Clamped, so that the quadrant fits into a long long.
+    radians = radians < -maxTrigonometryRadians ? -maxTrigonometryRadians : radians;
+    radians = radians > maxTrigonometryRadians ? maxTrigonometryRadians : radians;
+    double quotient = double(radians) / halfPi;
+    long long quadrant = (long long)(quotient >= 0. ? quotient + 0.5 : quotient - 0.5);
+    double reduced = (double(radians) - quadrant*halfPi);
+    // The float nearest to a multiple of Pi/2 (like Pi / 2.f or degreesToRadians(90)) gives exactly 0, 1 or -1.
+    if((reduced < 0. ? -reduced : reduced) <= 0.5 * ulp(radians)) {
+      reduced = 0.;
+    }
+    switch(((quadrant + quadrantOffset) % 4 + 4) % 4) {
+      case 0: return float(sinReduced(reduced));
+      case 1: return float(cosReduced(reduced));
+      case 2: return float(-sinReduced(reduced));
+      default: return float(-cosReduced(reduced));
+    }
+  }
+}
+/**
+ * @brief Usable in constant expressions, at runtime prefer std::sin.
+ * Within 0.53 ulp of the exact sine for |radians| <= maxTrigonometryRadians, except that the float nearest to a multiple
+ * of Pi/2 gives exactly 0, 1 or -1 where the exact sine differs by up to half an ulp of radians.
+ * Larger radians are clamped.
+ */
+constexpr inline float constexprSin(float radians) noexcept
+{
+  return detail::sinQuadrant(radians, 0);
+}
+/**
+ * @brief Usable in constant expressions, at runtime prefer std::cos. Same accuracy and domain as constexprSin.
+ */
+constexpr inline float constexprCos(float radians) noexcept
+{
+  return detail::sinQuadrant(radians, 1);
+}
+
 struct Mat3f
 {
   constexpr static Mat3f identity() noexcept
@@ -246,36 +351,42 @@ struct Mat3f
       {0.0f, 0.0f, 1.0f}
     }};
   }
-  static Mat3f rotationX(float radians) noexcept
+  constexpr static Mat3f rotationX(float radians) noexcept
   {
+    const float c = constexprCos(radians);
+    const float s = constexprSin(radians);
     return
     {{
-     {1.f,           0.f,          0.f},
-     {0.f,  cos(radians), sin(radians)},
-     {0.f, -sin(radians), cos(radians)}
+     {1.f, 0.f, 0.f},
+     {0.f,  c,   s },
+     {0.f, -s,   c }
     }};
   }
-  static Mat3f rotationY(float radians) noexcept
+  constexpr static Mat3f rotationY(float radians) noexcept
   {
+    const float c = constexprCos(radians);
+    const float s = constexprSin(radians);
     return
     {{
-     {cos(radians), 0.f, -sin(radians)},
-     {         0.f, 1.f,           0.f},
-     {sin(radians), 0.f,  cos(radians)},
+     { c,  0.f, -s },
+     {0.f, 1.f, 0.f},
+     { s,  0.f,  c },
     }};
   }
-  static Mat3f rotationZ(float radians) noexcept
+  constexpr static Mat3f rotationZ(float radians) noexcept
   {
+    const float c = constexprCos(radians);
+    const float s = constexprSin(radians);
     return
     {{
-     { cos(radians), sin(radians), 0.f},
-     {-sin(radians), cos(radians), 0.f},
-     {          0.f,          0.f, 1.f},
+     { c,   s,  0.f},
+     {-s,   c,  0.f},
+     {0.f, 0.f, 1.f},
     }};
   }
 
-  float* operator[](int index) noexcept { return values[index]; }
-  const float* operator[](int index) const noexcept { return values[index]; }
+  constexpr float* operator[](int index) noexcept { return values[index]; }
+  constexpr const float* operator[](int index) const noexcept { return values[index]; }
 
   float values[3][3];
 };
@@ -284,7 +395,7 @@ Mat3f operator*(const Mat3f& left, const Mat3f& right) noexcept;
 /**
  * @brief Optimization for Matrices where last column is 0.f, 0.f, 0.f, 1.f
  */
-struct Mat4x3f
+struct alignas(16) Mat4x3f
 {
   constexpr static Mat4x3f identity() noexcept
   {
@@ -310,34 +421,40 @@ struct Mat4x3f
   {
     return translation(by.x, by.y, by.z);
   }
-  static Mat4x3f rotationX(float radians) noexcept
+  constexpr static Mat4x3f rotationX(float radians) noexcept
   {
+    const float c = constexprCos(radians);
+    const float s = constexprSin(radians);
     return
     { {
-     {1.f,           0.f,          0.f},
-     {0.f,  cos(radians), sin(radians)},
-     {0.f, -sin(radians), cos(radians)},
-     {0.f,           0.f,          0.f}
+     {1.f, 0.f, 0.f},
+     {0.f,  c,   s },
+     {0.f, -s,   c },
+     {0.f, 0.f, 0.f}
     } };
   }
-  static Mat4x3f rotationY(float radians) noexcept
+  constexpr static Mat4x3f rotationY(float radians) noexcept
   {
+    const float c = constexprCos(radians);
+    const float s = constexprSin(radians);
     return
     { {
-     {cos(radians), 0.f, -sin(radians)},
-     {         0.f, 1.f,           0.f},
-     {sin(radians), 0.f,  cos(radians)},
-     {         0.f, 0.f,           0.f}
+     { c,  0.f, -s },
+     {0.f, 1.f, 0.f},
+     { s,  0.f,  c },
+     {0.f, 0.f, 0.f}
     } };
   }
-  static Mat4x3f rotationZ(float radians) noexcept
+  constexpr static Mat4x3f rotationZ(float radians) noexcept
   {
+    const float c = constexprCos(radians);
+    const float s = constexprSin(radians);
     return
     { {
-     { cos(radians), sin(radians), 0.f},
-     {-sin(radians), cos(radians), 0.f},
-     {          0.f,          0.f, 1.f},
-     {          0.f,          0.f, 0.f}
+     { c,   s,  0.f},
+     {-s,   c,  0.f},
+     {0.f, 0.f, 1.f},
+     {0.f, 0.f, 0.f}
     } };
   }
   static Mat4x3f lookAt(const Vec3f& eyePosition, const Vec3f& focusPosition, const Vec3f& upDirection) noexcept
@@ -370,16 +487,36 @@ struct Mat4x3f
     } };
   }
 
-  float* operator[](int index) noexcept { return values[index]; }
-  const float* operator[](int index) const noexcept { return values[index]; }
+  constexpr float* operator[](int index) noexcept { return values[index]; }
+  constexpr const float* operator[](int index) const noexcept { return values[index]; }
 
   float values[4][3];
 };
 Vec4f operator*(const Vec4f& left, const Mat4x3f& right) noexcept;
-Mat4x3f operator*(const Mat3f& left, const Mat4x3f& right) noexcept;
+constexpr inline Mat4x3f operator*(const Mat3f& left, const Mat4x3f& right) noexcept
+{
+  return
+  {
+    left[0][0]*right[0][0] + left[0][1]*right[1][0] + left[0][2]*right[2][0],
+    left[0][0]*right[0][1] + left[0][1]*right[1][1] + left[0][2]*right[2][1],
+    left[0][0]*right[0][2] + left[0][1]*right[1][2] + left[0][2]*right[2][2],
+
+    left[1][0]*right[0][0] + left[1][1]*right[1][0] + left[1][2]*right[2][0],
+    left[1][0]*right[0][1] + left[1][1]*right[1][1] + left[1][2]*right[2][1],
+    left[1][0]*right[0][2] + left[1][1]*right[1][2] + left[1][2]*right[2][2],
+
+    left[2][0]*right[0][0] + left[2][1]*right[1][0] + left[2][2]*right[2][0],
+    left[2][0]*right[0][1] + left[2][1]*right[1][1] + left[2][2]*right[2][1],
+    left[2][0]*right[0][2] + left[2][1]*right[1][2] + left[2][2]*right[2][2],
+
+    right[3][0],
+    right[3][1],
+    right[3][2],
+  };
+}
 Mat4x3f operator*(const Mat4x3f& left, const Mat3f& right) noexcept;
 Mat4x3f operator*(const Mat4x3f& left, const Mat4x3f& right) noexcept;
-struct Mat4f
+struct alignas(16) Mat4f
 {
   constexpr static Mat4f identity() noexcept
   {
@@ -405,34 +542,40 @@ struct Mat4f
   {
     return translation(by.x, by.y, by.z);
   }
-  static Mat4f rotationX(float radians) noexcept
+  constexpr static Mat4f rotationX(float radians) noexcept
   {
+    const float c = constexprCos(radians);
+    const float s = constexprSin(radians);
     return 
     {{
-      {1.f,           0.f,          0.f, 0.f},
-      {0.f,  cos(radians), sin(radians), 0.f},
-      {0.f, -sin(radians), cos(radians), 0.f},
-      {0.f,           0.f,          0.f, 1.f}
+      {1.f, 0.f, 0.f, 0.f},
+      {0.f,  c,   s,  0.f},
+      {0.f, -s,   c,  0.f},
+      {0.f, 0.f, 0.f, 1.f}
     }};
   }
-  static Mat4f rotationY(float radians) noexcept
+  constexpr static Mat4f rotationY(float radians) noexcept
   {
+    const float c = constexprCos(radians);
+    const float s = constexprSin(radians);
     return
     {{
-      {cos(radians), 0.f, -sin(radians), 0.f},
-      {         0.f, 1.f,           0.f, 0.f},
-      {sin(radians), 0.f,  cos(radians), 0.f},
-      {         0.f, 0.f,           0.f, 1.f}
+      { c,  0.f, -s,  0.f},
+      {0.f, 1.f, 0.f, 0.f},
+      { s,  0.f,  c,  0.f},
+      {0.f, 0.f, 0.f, 1.f}
     }};
   }
-  static Mat4f rotationZ(float radians) noexcept
+  constexpr static Mat4f rotationZ(float radians) noexcept
   {
+    const float c = constexprCos(radians);
+    const float s = constexprSin(radians);
     return
     { {
-      { cos(radians), sin(radians), 0.f, 0.f},
-      {-sin(radians), cos(radians), 0.f, 0.f},
-      {          0.f,          0.f, 1.f, 0.f},
-      {          0.f,          0.f, 0.f, 1.f}
+      { c,   s,  0.f, 0.f},
+      {-s,   c,  0.f, 0.f},
+      {0.f, 0.f, 1.f, 0.f},
+      {0.f, 0.f, 0.f, 1.f}
     } };
   }
   static Mat4f perspectiveProjectionD3d(
@@ -487,8 +630,8 @@ struct Mat4f
     }};
   }
 
-  float* operator[](int index) noexcept {return values[index];}
-  const float* operator[](int index) const noexcept {return values[index];}
+  constexpr float* operator[](int index) noexcept {return values[index];}
+  constexpr const float* operator[](int index) const noexcept {return values[index];}
 
   float values[4][4];
 };
@@ -496,7 +639,7 @@ Vec4f operator*(const Vec4f& left, const Mat4f& right) noexcept;
 Mat4f operator*(const Mat4x3f& left, const Mat4f& right) noexcept;
 Mat4f operator*(const Mat4f& left, const Mat4x3f& right) noexcept;
 Mat4f operator*(const Mat4f& left, const Mat4f& right) noexcept;
-inline Mat4f toMat4f(const Mat4x3f& m) noexcept 
+constexpr inline Mat4f toMat4f(const Mat4x3f& m) noexcept
 {
   return
   {
@@ -507,6 +650,119 @@ inline Mat4f toMat4f(const Mat4x3f& m) noexcept
   };
 }
 
+// Batch functions working on structure of arrays, 
+// so that the compiler can vectorize across elements instead of within one.
+
+/**
+ * @brief Transforms count points (w = 1.f) by matrix.
+ */
+void transformPoints(
+  const float* x, const float* y, const float* z, int count, 
+  const Mat4f& matrix, 
+  float* outX, float* outY, float* outZ, float* outW
+) noexcept;
+/**
+ * @brief Transforms count vectors by matrix.
+ */
+void transform(
+  const float* x, const float* y, const float* z, const float* w, int count,
+  const Mat4f& matrix,
+  float* outX, float* outY, float* outZ, float* outW
+) noexcept;
+/**
+ * @brief Computes Mat4f::translation(x[i], y[i], z[i]) * right for count translations.
+ */
+void concatenateTranslations(
+  const float* x, const float* y, const float* z, int count,
+  const Mat4f& right,
+  Mat4f* output
+) noexcept;
+/**
+ * @param planes Planes as a, b, c, d where a*x + b*y + c*z + d >= 0 is the inner side.
+ * @param radius Distance a point can be outside a plane and still count as inside, 0.f for exact points.
+ * @param output 1 for points inside all planes, 0 otherwise.
+ */
+void testPointsAgainstPlanes(
+  const float* x, const float* y, const float* z, int count,
+  const Vec4f* planes, int planeCount, float radius,
+  uint8_t* output
+) noexcept;
+
+// Culling
+
+struct Aabb
+{
+  Vec3f min;
+  Vec3f max;
+};
+struct Sphere
+{
+  Vec3f center;
+  float radius;
+};
+/**
+ * @brief Planes as a, b, c, d where a*x + b*y + c*z + d is the signed distance to the plane 
+ * and >= 0 is the inner side, same as testPointsAgainstPlanes expects them.
+ */
+struct Frustum
+{
+  enum PlaneIndex { Left = 0, Right, Bottom, Top, Near, Far, PlaneCount };
+
+  /**
+   * @brief Extracts the planes in the space the matrix transforms from, e.g. world space for view * projection.
+   * @param viewProjection Projection into D3D clip space, where 0 <= z <= w.
+   */
+  static Frustum fromViewProjectionD3d(const Mat4f& viewProjection) noexcept;
+
+  Vec4f planes[PlaneCount];
+};
+constexpr inline float signedDistance(const Vec4f& plane, const Vec3f& point) noexcept
+{
+  return plane.x*point.x + plane.y*point.y + plane.z*point.z + plane.w;
+}
+/**
+ * @return false only if sphere is completely outside of frustum. 
+ * Spheres near the frustum corners can be outside and still return true.
+ */
+inline bool intersects(const Frustum& frustum, const Sphere& sphere) noexcept
+{
+  for(const Vec4f& plane : frustum.planes) {
+    if(signedDistance(plane, sphere.center) < -sphere.radius) {
+      return false;
+    }
+  }
+  return true;
+}
+/**
+ * @return false only if aabb is completely outside of frustum.
+ * Boxes near the frustum corners can be outside and still return true.
+ */
+inline bool intersects(const Frustum& frustum, const Aabb& aabb) noexcept
+{
+  for(const Vec4f& plane : frustum.planes) {
+    // The corner furthest along the plane normal.
+    const Vec3f corner = {
+      plane.x >= 0.f ? aabb.max.x : aabb.min.x,
+      plane.y >= 0.f ? aabb.max.y : aabb.min.y,
+      plane.z >= 0.f ? aabb.max.z : aabb.min.z
+    };
+    if(signedDistance(plane, corner) < 0.f) {
+      return false;
+    }
+  }
+  return true;
+}
+/**
+ * @brief Batch version of intersects(const Frustum&, const Aabb&) for boxes given by their centers and half extents.
+ * @param output 1 for boxes intersecting frustum, 0 otherwise.
+ */
+void testAabbsAgainstFrustum(
+  const float* centerX, const float* centerY, const float* centerZ,
+  const float* extentX, const float* extentY, const float* extentZ, int count,
+  const Frustum& frustum,
+  uint8_t* output
+) noexcept;
+
 struct Quatf
 {
   Vec3f v;
@@ -604,15 +860,59 @@ inline Quatf rlerp(const Quatf& q1, const Quatf& q2, float t) noexcept
   return normalized({lerp(q1.v, q2.v, t, oneMinusT), oneMinusT*q1.s + t*q2.s});
 }
 /**
- * @brief Spherical linear interpolation. More accurate than rlerp, but slower.
+ * @brief Spherical linear interpolation along the shorter arc. More accurate than rlerp, but slower.
+ * Rotations differ from exact slerp by less than 1e-5 radians.
+ * @param q1, q2 Have to be normalized.
  */
 inline Quatf slerp(const Quatf& q1, const Quatf& q2, float t) noexcept
 {
-  float theta = acos(dot(q1, q2));
-  float wq1 = sin(1.f - t)*theta / sin(theta);
-  float wq2 = sin(t)*theta / sin(theta);
+  float cosTheta = dot(q1, q2);
+  // q and -q represent the same rotation, pick the one closer to q1 so that the shorter arc is taken.
+  const float q2Sign = cosTheta < 0.f ? -1.f : 1.f;
+  cosTheta *= q2Sign;
+  if(cosTheta > 0.9995f) {
+    // sin(theta) approaches zero, but the arc is short enough for lerp to be indistinguishable.
+    return rlerp(q1, q2Sign*q2, t);
+  }
+  const float theta = std::acos(cosTheta);
+  const float sinThetaInverse = 1.f / std::sqrt(1.f - cosTheta*cosTheta);
+  const float wq1 = std::sin((1.f - t)*theta) * sinThetaInverse;
+  const float wq2 = std::sin(t*theta) * sinThetaInverse * q2Sign;
   return wq1*q1 + wq2*q2;
 }
+/**
+ * @brief Approximation of slerp without trigonometric functions, lerp with t corrected by a polynomial fitted to slerp.
+ * Rotations differ from slerp by less than 1e-3 radians, compared to 0.15 radians of plain rlerp.
+ * From https://zeux.io/2015/07/23/approximating-slerp/
+ * @param q1, q2 Have to be normalized.
+ */
+inline Quatf slerpFast(const Quatf& q1, const Quatf& q2, float t) noexcept
+{
+  const float cosTheta = dot(q1, q2);
+  const float d = std::abs(cosTheta);
+  const float a = 1.0904f + d*(-3.2452f + d*(3.55645f - d*1.43519f));
+  const float b = 0.848013f + d*(-1.06021f + d*0.215638f);
+  const float k = a*(t - 0.5f)*(t - 0.5f) + b;
+  const float correctedT = t + t*(t - 0.5f)*(t - 1.f)*k;
+  const float wq1 = 1.f - correctedT;
+  const float wq2 = cosTheta < 0.f ? -correctedT : correctedT;
+  return normalized(wq1*q1 + wq2*q2);
+}
+/**
+ * @brief Quaternions stored as structure of arrays, element i is {{x[i], y[i], z[i]}, s[i]}.
+ */
+struct QuatfArrays
+{
+  float* x;
+  float* y;
+  float* z;
+  float* s;
+};
+/**
+ * @brief slerpFast of count quaternion pairs, vectorized across elements. 
+ * Output may alias from or to, they aren't modified otherwise.
+ */
+void slerpFast(const QuatfArrays& from, const QuatfArrays& to, const float* t, int count, const QuatfArrays& output) noexcept;
 
 /**
  * @brief Object that tracks it's target and moves on a sphere around it.
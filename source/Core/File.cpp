@@ -1,44 +1,141 @@
 #include "File.hpp"
 
 #include <fstream>
+#include <utility>
 
 #include "Exception.hpp"
 
 #ifdef _WIN32
 #define WIN32_LEAN_AND_MEAN
 #include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 namespace De
 {
   void readEntireFile(const char* fileName, std::vector<uint8_t>& buffer)
   {
-    /*HANDLE file = CreateFileA(fileName, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    std::ifstream file(fileName, std::ios::ate | std::ios::binary);
+    if(!file.is_open()) {
+      throw Exception(std::string("Failed to open file: ") + fileName);
+    }
+
+    const size_t fileSize = file.tellg();
+    buffer.resize(fileSize);
+
+    file.seekg(0);
+    file.read(reinterpret_cast<char*>(buffer.data()), buffer.size());
+  }
+
+#ifdef _WIN32
+  MappedFile::MappedFile(const char* fileName, Access access)
+  {
+    DWORD flags = FILE_ATTRIBUTE_NORMAL;
+    if(access == Access::Sequential) {
+      flags = FILE_FLAG_SEQUENTIAL_SCAN;
+    } else if(access == Access::Random) {
+      flags = FILE_FLAG_RANDOM_ACCESS;
+    }
+    HANDLE file = CreateFileA(fileName, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, flags, nullptr);
     if(file == INVALID_HANDLE_VALUE) {
-      throw Exception(std::string("Failed to load shader file ") + fileName);
+      throw Exception(std::string("Failed to open file: ") + fileName);
     }
     LARGE_INTEGER fileSize;
     if(!GetFileSizeEx(file, &fileSize)) {
       CloseHandle(file);
-      throw Exception(std::string("Failed to get file size of shader file ") + fileName);
+      throw Exception(std::string("Failed to get size of file: ") + fileName);
     }
-    buffer.reserve(fileSize.QuadPart);
-    DWORD bytesRead;
-    if(!ReadFile(file, buffer.data(), (DWORD)fileSize.QuadPart, &bytesRead, nullptr)) {
+    if(fileSize.QuadPart == 0) {
       CloseHandle(file);
-      throw Exception(std::string("Failed to read shader file ") + fileName);
+      isEmptyFile = true;
+      return;
     }
-    buffer.resize(bytesRead);
-    CloseHandle(file);*/
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);
+    if(!mapping) {
+      throw Exception(std::string("Failed to create file mapping: ") + fileName);
+    }
+    // The view keeps the mapping alive.
+    void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+    if(!view) {
+      throw Exception(std::string("Failed to map file: ") + fileName);
+    }
+    data = static_cast<const uint8_t*>(view);
+    size = (size_t)fileSize.QuadPart;
+  }
 
-    std::ifstream file(fileName, std::ios::ate | std::ios::binary);
-    if(!file.is_open()) {
+  void MappedFile::unmap() noexcept
+  {
+    if(data) {
+      UnmapViewOfFile(data);
+    }
+  }
+#else
+  MappedFile::MappedFile(const char* fileName, Access access)
+  {
+    const int file = open(fileName, O_RDONLY | O_CLOEXEC);
+    if(file == -1) {
       throw Exception(std::string("Failed to open file: ") + fileName);
     }
+    struct stat fileStatus;
+    if(fstat(file, &fileStatus) != 0) {
+      close(file);
+      throw Exception(std::string("Failed to get size of file: ") + fileName);
+    }
+    if(fileStatus.st_size == 0) {
+      close(file);
+      isEmptyFile = true;
+      return;
+    }
+    const size_t fileSize = (size_t)fileStatus.st_size;
+    // The mapping keeps the file referenced after it is closed.
+    void* mapping = mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, file, 0);
+    close(file);
+    if(mapping == MAP_FAILED) {
+      throw Exception(std::string("Failed to map file: ") + fileName);
+    }
+    if(access == Access::Sequential) {
+      madvise(mapping, fileSize, MADV_SEQUENTIAL);
+      madvise(mapping, fileSize, MADV_WILLNEED);
+    } else if(access == Access::Random) {
+      madvise(mapping, fileSize, MADV_RANDOM);
+    }
+    data = static_cast<const uint8_t*>(mapping);
+    size = fileSize;
+  }
 
-    const size_t fileSize = file.tellg();
-    buffer.resize(fileSize);
+  void MappedFile::unmap() noexcept
+  {
+    if(data) {
+      munmap(const_cast<uint8_t*>(data), size);
+    }
+  }
+#endif
 
-    file.seekg(0);
-    file.read(reinterpret_cast<char*>(buffer.data()), buffer.size());
+  MappedFile::MappedFile(MappedFile&& other) noexcept
+    : data(std::exchange(other.data, nullptr))
+    , size(std::exchange(other.size, 0))
+    , isEmptyFile(std::exchange(other.isEmptyFile, false))
+  {}
+
+  MappedFile& MappedFile::operator=(MappedFile&& rhs) noexcept
+  {
+    if(this != &rhs) {
+      unmap();
+      data = std::exchange(rhs.data, nullptr);
+      size = std::exchange(rhs.size, 0);
+      isEmptyFile = std::exchange(rhs.isEmptyFile, false);
+    }
+    return *this;
+  }
+
+  MappedFile::~MappedFile()
+  {
+    unmap();
   }
 }
-#endif
\ No newline at end of file
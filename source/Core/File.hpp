@@ -1,8 +1,76 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <vector>
 
 namespace De
 {
   void readEntireFile(const char* fileName, std::vector<uint8_t>& buffer);
-}
\ No newline at end of file
+
+  /**
+   * @brief Non-owning view of read-only bytes.
+   */
+  class ConstByteSpan
+  {
+  public:
+    constexpr ConstByteSpan() noexcept = default;
+    constexpr ConstByteSpan(const uint8_t* data, size_t size) noexcept
+      : pointer(data)
+      , count(size)
+    {}
+
+    constexpr const uint8_t* data() const noexcept { return pointer; }
+    constexpr size_t size() const noexcept { return count; }
+    constexpr bool empty() const noexcept { return count == 0; }
+    constexpr const uint8_t* begin() const noexcept { return pointer; }
+    constexpr const uint8_t* end() const noexcept { return pointer + count; }
+    constexpr ConstByteSpan subspan(size_t offset, size_t size) const noexcept { return { pointer + offset, size }; }
+
+  private:
+    const uint8_t* pointer = nullptr;
+    size_t count = 0;
+  };
+
+  /**
+   * @brief Read-only memory mapping of a whole file. The contents are paged in on access,
+   * so nothing is copied and there is no size limit besides the address space.
+   * The data is aligned to the page size.
+   */
+  class MappedFile
+  {
+  public:
+    enum class Access
+    {
+      Normal,
+      // Read ahead aggressively, pages behind can be dropped early.
+      Sequential,
+      // Don't read ahead.
+      Random
+    };
+
+    MappedFile() noexcept = default;
+    /**
+     * @throws De::Exception if the file can't be opened or mapped.
+     */
+    explicit MappedFile(const char* fileName, Access access = Access::Normal);
+    MappedFile(const MappedFile& other) = delete;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(const MappedFile& rhs) = delete;
+    MappedFile& operator=(MappedFile&& rhs) noexcept;
+    ~MappedFile();
+
+    ConstByteSpan getSpan() const noexcept { return { data, size }; }
+    const uint8_t* getData() const noexcept { return data; }
+    size_t getSize() const noexcept { return size; }
+    bool isOpen() const noexcept { return data != nullptr || isEmptyFile; }
+
+  private:
+    void unmap() noexcept;
+
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+    // Empty files can't be mapped, but opening them succeeds.
+    bool isEmptyFile = false;
+  };
+}
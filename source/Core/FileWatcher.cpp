@@ -0,0 +1,477 @@
+#define DAR_MODULE_NAME "FileWatcher"
+
+#include "FileWatcher.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "DarEngine.hpp"
+#include "Exception.hpp"
+#include "Profiler.hpp"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#elif defined(__linux__)
+#include <cerrno>
+#include <cstring>
+
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace De
+{
+  namespace
+  {
+    using Clock = std::chrono::steady_clock;
+
+    char toLower(char character) noexcept
+    {
+      return character >= 'A' && character <= 'Z' ? character - 'A' + 'a' : character;
+    }
+
+    bool endsWith(const std::string& name, const std::string& lowercaseSuffix) noexcept
+    {
+      if(name.size() < lowercaseSuffix.size()) {
+        return false;
+      }
+      const size_t start = name.size() - lowercaseSuffix.size();
+      for(size_t i = 0; i < lowercaseSuffix.size(); ++i) {
+        if(toLower(name[start + i]) != lowercaseSuffix[i]) {
+          return false;
+        }
+      }
+      return true;
+    }
+  }
+
+  class FileWatcher::Impl
+  {
+  public:
+    Impl();
+    ~Impl();
+
+    bool subscribe(const char* directory, const char* suffix, Callback callback);
+    void dispatchChanges();
+
+  private:
+    struct Subscription
+    {
+      size_t directoryIndex;
+      std::string suffix;
+      Callback callback;
+    };
+
+    struct Change
+    {
+      size_t directoryIndex;
+      std::string fileName;
+      Clock::time_point time;
+    };
+
+    /**
+     * @return Index of the directory, -1 if it can't be watched.
+     */
+    int watchDirectory(const std::string& directory);
+    void addChange(size_t directoryIndex, std::string fileName);
+    void run();
+
+    // Only used by the thread calling subscribe and dispatchChanges.
+    std::vector<Subscription> subscriptions;
+    std::vector<Change> settledChanges;
+
+    std::mutex mutex;
+    std::vector<std::string> directories;
+    std::vector<Change> changes;
+    std::atomic<bool> hasChanges = false;
+
+#ifdef _WIN32
+    struct WatchedDirectory
+    {
+      HANDLE handle = INVALID_HANDLE_VALUE;
+      OVERLAPPED overlapped = {};
+      bool isReading = false;
+      alignas(DWORD) uint8_t buffer[16 * 1024];
+    };
+
+    bool readChanges(WatchedDirectory& directory);
+
+    std::vector<std::unique_ptr<WatchedDirectory>> watchedDirectories;
+    HANDLE stopEvent = nullptr;
+    // Signaled when a directory was added, the thread starts reading it.
+    HANDLE wakeEvent = nullptr;
+#elif defined(__linux__)
+    // Watch descriptor of each directory.
+    std::vector<int> watchDescriptors;
+    int inotifyFd = -1;
+    int stopFd = -1;
+#endif
+    std::thread thread;
+  };
+
+  int FileWatcher::Impl::watchDirectory(const std::string& directory)
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      for(size_t i = 0; i < directories.size(); ++i) {
+        if(directories[i] == directory) {
+          return (int)i;
+        }
+      }
+    }
+
+#ifdef _WIN32
+    if(watchedDirectories.size() >= MAXIMUM_WAIT_OBJECTS - 2) {
+      logError("Failed to watch %s, too many watched directories.", directory.c_str());
+      return -1;
+    }
+    auto watchedDirectory = std::make_unique<WatchedDirectory>();
+    watchedDirectory->handle = CreateFileA(
+      directory.c_str(),
+      FILE_LIST_DIRECTORY,
+      FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+      nullptr,
+      OPEN_EXISTING,
+      FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED,
+      nullptr
+    );
+    if(watchedDirectory->handle == INVALID_HANDLE_VALUE) {
+      logError("Failed to open %s for watching, error %lu.", directory.c_str(), GetLastError());
+      return -1;
+    }
+    watchedDirectory->overlapped.hEvent = CreateEventA(nullptr, FALSE, FALSE, nullptr);
+    if(!watchedDirectory->overlapped.hEvent) {
+      logError("Failed to create the event for watching %s.", directory.c_str());
+      CloseHandle(watchedDirectory->handle);
+      return -1;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    watchedDirectories.push_back(std::move(watchedDirectory));
+    directories.push_back(directory);
+    SetEvent(wakeEvent);
+    return (int)directories.size() - 1;
+#elif defined(__linux__)
+    const int watchDescriptor = inotify_add_watch(inotifyFd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_ONLYDIR);
+    if(watchDescriptor < 0) {
+      logError("Failed to watch %s: %s.", directory.c_str(), strerror(errno));
+      return -1;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    // Another spelling of a watched directory gets the same descriptor.
+    for(size_t i = 0; i < watchDescriptors.size(); ++i) {
+      if(watchDescriptors[i] == watchDescriptor) {
+        return (int)i;
+      }
+    }
+    watchDescriptors.push_back(watchDescriptor);
+    directories.push_back(directory);
+    return (int)directories.size() - 1;
+#else
+    logError("Failed to watch %s, file watching isn't supported on this platform.", directory.c_str());
+    return -1;
+#endif
+  }
+
+  bool FileWatcher::Impl::subscribe(const char* directory, const char* suffix, Callback callback)
+  {
+    std::string directoryName(directory);
+    while(directoryName.size() > 1 && (directoryName.back() == '/' || directoryName.back() == '\\')) {
+      directoryName.pop_back();
+    }
+    const int directoryIndex = watchDirectory(directoryName);
+    if(directoryIndex < 0) {
+      return false;
+    }
+    Subscription subscription{ (size_t)directoryIndex, suffix, std::move(callback) };
+    for(char& character : subscription.suffix) {
+      character = toLower(character);
+    }
+    subscriptions.push_back(std::move(subscription));
+    return true;
+  }
+
+  void FileWatcher::Impl::addChange(size_t directoryIndex, std::string fileName)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    const Clock::time_point now = Clock::now();
+    for(Change& change : changes) {
+      if(change.directoryIndex == directoryIndex && change.fileName == fileName) {
+        change.time = now;
+        return;
+      }
+    }
+    changes.push_back({ directoryIndex, std::move(fileName), now });
+    hasChanges.store(true, std::memory_order_release);
+  }
+
+  void FileWatcher::Impl::dispatchChanges()
+  {
+    if(!hasChanges.load(std::memory_order_acquire)) {
+      return;
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      const Clock::time_point settledTime = Clock::now() - std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(settleSeconds));
+      for(size_t i = 0; i < changes.size();) {
+        if(changes[i].time <= settledTime) {
+          settledChanges.push_back(std::move(changes[i]));
+          if(i + 1 < changes.size()) {
+            changes[i] = std::move(changes.back());
+          }
+          changes.pop_back();
+        } else {
+          ++i;
+        }
+      }
+      hasChanges.store(!changes.empty(), std::memory_order_relaxed);
+    }
+
+    std::string directory;
+    std::string path;
+    for(const Change& change : settledChanges) {
+      {
+        // Copied, directories may grow while the callbacks run.
+        std::lock_guard<std::mutex> lock(mutex);
+        directory = directories[change.directoryIndex];
+      }
+      path = directory + '/' + change.fileName;
+      // Callbacks may subscribe, which can reallocate subscriptions.
+      const size_t subscriptionCount = subscriptions.size();
+      for(size_t i = 0; i < subscriptionCount; ++i) {
+        if(subscriptions[i].directoryIndex == change.directoryIndex && endsWith(change.fileName, subscriptions[i].suffix)) {
+          Callback callback = subscriptions[i].callback;
+          callback(path.c_str());
+        }
+      }
+    }
+    settledChanges.clear();
+  }
+
+#ifdef _WIN32
+  FileWatcher::Impl::Impl()
+  {
+    stopEvent = CreateEventA(nullptr, TRUE, FALSE, nullptr);
+    wakeEvent = CreateEventA(nullptr, FALSE, FALSE, nullptr);
+    if(!stopEvent || !wakeEvent) {
+      if(stopEvent) {
+        CloseHandle(stopEvent);
+      }
+      if(wakeEvent) {
+        CloseHandle(wakeEvent);
+      }
+      throw Exception("Failed to create the file watcher events.");
+    }
+    thread = std::thread([this]() { run(); });
+  }
+
+  FileWatcher::Impl::~Impl()
+  {
+    SetEvent(stopEvent);
+    thread.join();
+    for(std::unique_ptr<WatchedDirectory>& directory : watchedDirectories) {
+      if(directory->isReading) {
+        // The read writes into the buffer until it is cancelled.
+        DWORD size;
+        CancelIoEx(directory->handle, &directory->overlapped);
+        GetOverlappedResult(directory->handle, &directory->overlapped, &size, TRUE);
+      }
+      CloseHandle(directory->overlapped.hEvent);
+      CloseHandle(directory->handle);
+    }
+    CloseHandle(wakeEvent);
+    CloseHandle(stopEvent);
+  }
+
+  bool FileWatcher::Impl::readChanges(WatchedDirectory& directory)
+  {
+    directory.isReading = ReadDirectoryChangesW(
+      directory.handle,
+      directory.buffer,
+      sizeof(directory.buffer),
+      FALSE,
+      FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME,
+      nullptr,
+      &directory.overlapped,
+      nullptr
+    ) != FALSE;
+    return directory.isReading;
+  }
+
+  void FileWatcher::Impl::run()
+  {
+    Profiler::setThreadName("FileWatcher");
+    std::vector<HANDLE> waitHandles;
+    std::vector<size_t> waitDirectoryIndices;
+    for(;;) {
+      waitHandles.assign({ stopEvent, wakeEvent });
+      waitDirectoryIndices.clear();
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        for(size_t i = 0; i < watchedDirectories.size(); ++i) {
+          WatchedDirectory& directory = *watchedDirectories[i];
+          if(!directory.isReading && !readChanges(directory)) {
+            logError("Failed to read changes of %s, error %lu.", directories[i].c_str(), GetLastError());
+            continue;
+          }
+          waitHandles.push_back(directory.overlapped.hEvent);
+          waitDirectoryIndices.push_back(i);
+        }
+      }
+
+      const DWORD result = WaitForMultipleObjects((DWORD)waitHandles.size(), waitHandles.data(), FALSE, INFINITE);
+      if(result == WAIT_OBJECT_0) {
+        return;
+      }
+      if(result == WAIT_OBJECT_0 + 1) {
+        continue;
+      }
+      if(result < WAIT_OBJECT_0 + 2 || result >= WAIT_OBJECT_0 + waitHandles.size()) {
+        logError("Failed to wait for file changes, error %lu.", GetLastError());
+        return;
+      }
+
+      const size_t directoryIndex = waitDirectoryIndices[result - WAIT_OBJECT_0 - 2];
+      WatchedDirectory* directory;
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        directory = watchedDirectories[directoryIndex].get();
+      }
+      directory->isReading = false;
+      DWORD size = 0;
+      if(!GetOverlappedResult(directory->handle, &directory->overlapped, &size, FALSE)) {
+        logError("Failed to get the changes of a watched directory, error %lu.", GetLastError());
+        continue;
+      }
+      if(size == 0) {
+        logWarning("Too many changes in a watched directory, some were lost.");
+        continue;
+      }
+      const uint8_t* entry = directory->buffer;
+      for(;;) {
+        const FILE_NOTIFY_INFORMATION& information = *reinterpret_cast<const FILE_NOTIFY_INFORMATION*>(entry);
+        if(information.Action == FILE_ACTION_ADDED || information.Action == FILE_ACTION_MODIFIED || information.Action == FILE_ACTION_RENAMED_NEW_NAME) {
+          const int nameLength = (int)(information.FileNameLength / sizeof(WCHAR));
+          const int size = WideCharToMultiByte(CP_UTF8, 0, information.FileName, nameLength, nullptr, 0, nullptr, nullptr);
+          std::string fileName(size, '\0');
+          WideCharToMultiByte(CP_UTF8, 0, information.FileName, nameLength, fileName.data(), size, nullptr, nullptr);
+          addChange(directoryIndex, std::move(fileName));
+        }
+        if(information.NextEntryOffset == 0) {
+          break;
+        }
+        entry += information.NextEntryOffset;
+      }
+    }
+  }
+#elif defined(__linux__)
+  FileWatcher::Impl::Impl()
+  {
+    inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if(inotifyFd < 0) {
+      throw Exception(std::string("Failed to initialize inotify: ") + strerror(errno));
+    }
+    stopFd = eventfd(0, EFD_CLOEXEC);
+    if(stopFd < 0) {
+      close(inotifyFd);
+      throw Exception(std::string("Failed to create the file watcher stop event: ") + strerror(errno));
+    }
+    thread = std::thread([this]() { run(); });
+  }
+
+  FileWatcher::Impl::~Impl()
+  {
+    const uint64_t value = 1;
+    if(write(stopFd, &value, sizeof(value)) != sizeof(value)) {
+      logError("Failed to stop the file watcher thread: %s.", strerror(errno));
+    }
+    thread.join();
+    close(stopFd);
+    close(inotifyFd);
+  }
+
+  void FileWatcher::Impl::run()
+  {
+    Profiler::setThreadName("FileWatcher");
+    alignas(inotify_event) char buffer[4096];
+    pollfd pollFds[2] = {
+      { inotifyFd, POLLIN, 0 },
+      { stopFd, POLLIN, 0 }
+    };
+    for(;;) {
+      if(poll(pollFds, 2, -1) < 0) {
+        if(errno == EINTR) {
+          continue;
+        }
+        logError("Failed to wait for file changes: %s.", strerror(errno));
+        return;
+      }
+      if(pollFds[1].revents != 0) {
+        return;
+      }
+      const ssize_t size = read(inotifyFd, buffer, sizeof(buffer));
+      if(size < 0) {
+        if(errno == EINTR || errno == EAGAIN) {
+          continue;
+        }
+        logError("Failed to read file changes: %s.", strerror(errno));
+        return;
+      }
+      for(const char* entry = buffer; entry < buffer + size;) {
+        const inotify_event& event = *reinterpret_cast<const inotify_event*>(entry);
+        entry += sizeof(inotify_event) + event.len;
+        if(event.mask & IN_Q_OVERFLOW) {
+          logWarning("Too many file changes, some were lost.");
+          continue;
+        }
+        if(event.len == 0 || (event.mask & IN_ISDIR)) {
+          continue;
+        }
+        int directoryIndex = -1;
+        {
+          std::lock_guard<std::mutex> lock(mutex);
+          for(size_t i = 0; i < watchDescriptors.size(); ++i) {
+            if(watchDescriptors[i] == event.wd) {
+              directoryIndex = (int)i;
+              break;
+            }
+          }
+        }
+        if(directoryIndex >= 0) {
+          addChange((size_t)directoryIndex, event.name);
+        }
+      }
+    }
+  }
+#else
+  FileWatcher::Impl::Impl() {}
+
+  FileWatcher::Impl::~Impl() {}
+
+  void FileWatcher::Impl::run() {}
+#endif
+
+  FileWatcher::FileWatcher()
+    : pImpl(std::make_unique<Impl>())
+  {}
+
+  FileWatcher::~FileWatcher() = default;
+
+  bool FileWatcher::subscribe(const char* directory, const char* suffix, Callback callback)
+  {
+    return pImpl->subscribe(directory, suffix, std::move(callback));
+  }
+
+  void FileWatcher::dispatchChanges()
+  {
+    pImpl->dispatchChanges();
+  }
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+
+namespace De
+{
+  /**
+   * @brief Notifies subsystems when files in watched directories are written, so that they can reload them.
+   * A background thread blocks on the operating system notifications, inotify on Linux and ReadDirectoryChangesW
+   * on Windows, so nothing is polled. Changes are reported once a file stopped changing for settleSeconds,
+   * editors and compilers often write a file in several steps.
+   * subscribe and dispatchChanges have to be called from the same thread, which runs the callbacks.
+   */
+  class FileWatcher
+  {
+  public:
+    static constexpr double settleSeconds = 0.1;
+
+    /**
+     * @param path Directory and file name as "directory/fileName", with directory as passed to subscribe.
+     */
+    using Callback = std::function<void(const char* path)>;
+
+    /**
+     * @throws De::Exception if the notifications can't be set up.
+     */
+    FileWatcher();
+    FileWatcher(const FileWatcher& other) = delete;
+    FileWatcher& operator=(const FileWatcher& rhs) = delete;
+    ~FileWatcher();
+
+    /**
+     * @brief Calls callback for files written in directory, not its subdirectories, whose name ends with suffix.
+     * @param suffix Compared case insensitively, an empty suffix matches every file.
+     * @return false if the directory can't be watched, the error is logged.
+     */
+    bool subscribe(const char* directory, const char* suffix, Callback callback);
+    /**
+     * @brief Runs the callbacks of settled changes. Call it once per frame, when nothing changed it only reads an atomic flag.
+     */
+    void dispatchChanges();
+
+  private:
+    class Impl;
+    std::unique_ptr<Impl> pImpl;
+  };
+}
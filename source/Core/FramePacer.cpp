@@ -0,0 +1,145 @@
+#define DAR_MODULE_NAME "FramePacer"
+
+#include "FramePacer.hpp"
+
+#include <cmath>
+#include <thread>
+
+#include "Clock.hpp"
+#include "DarEngine.hpp"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+#endif
+
+namespace De
+{
+  class FramePacer::Impl
+  {
+  public:
+    explicit Impl(double framePeriod);
+    ~Impl();
+
+    double waitForNextFrame();
+
+    int64_t framePeriod;
+
+  private:
+    static constexpr int64_t sleepDuration = 1000000;
+    // Weight of the latest sleep in the moving statistics.
+    static constexpr double sleepStatisticsWeight = 1. / 16.;
+
+    void sleepUntil(int64_t time);
+    void sleep();
+
+    int64_t nextFrameTime = 0;
+    // How long sleepDuration actually takes, in nanoseconds.
+    double sleepMean = 2. * sleepDuration;
+    double sleepVariance = 0.;
+#ifdef _WIN32
+    // Sleep waits for the next scheduler tick, up to 15.6 ms, a high resolution timer doesn't.
+    HANDLE timer = nullptr;
+#endif
+  };
+
+  FramePacer::Impl::Impl(double framePeriod)
+    : framePeriod(Clock::fromSeconds(framePeriod))
+  {
+#ifdef _WIN32
+    timer = CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+    if(!timer) {
+      logWarning("High resolution timers aren't supported (%lu), frames are paced with Sleep.", GetLastError());
+    }
+#endif
+  }
+
+  FramePacer::Impl::~Impl()
+  {
+#ifdef _WIN32
+    if(timer) {
+      CloseHandle(timer);
+    }
+#endif
+  }
+
+  double FramePacer::Impl::waitForNextFrame()
+  {
+    const int64_t start = Clock::now();
+    if(framePeriod <= 0) {
+      return 0.;
+    }
+    const int64_t frameTime = nextFrameTime;
+    if(start >= frameTime) {
+      // Late, a frame that took more than a whole period realigns the schedule instead of rushing the next ones.
+      nextFrameTime = start - frameTime > framePeriod ? start + framePeriod : frameTime + framePeriod;
+      return 0.;
+    }
+    sleepUntil(frameTime);
+    nextFrameTime = frameTime + framePeriod;
+    return Clock::toSeconds(Clock::now() - start);
+  }
+
+  void FramePacer::Impl::sleepUntil(int64_t time)
+  {
+    for(;;) {
+      const int64_t sleepStart = Clock::now();
+      const double sleepEstimate = sleepMean + std::sqrt(sleepVariance);
+      if(double(time - sleepStart) <= sleepEstimate) {
+        break;
+      }
+      sleep();
+      const double slept = double(Clock::now() - sleepStart);
+      const double deviation = slept - sleepMean;
+      sleepMean += sleepStatisticsWeight * deviation;
+      sleepVariance = (1. - sleepStatisticsWeight) * (sleepVariance + sleepStatisticsWeight * deviation * deviation);
+    }
+    // The remainder is shorter than a sleep usually takes.
+    while(Clock::now() < time) {
+      std::this_thread::yield();
+    }
+  }
+
+  void FramePacer::Impl::sleep()
+  {
+#ifdef _WIN32
+    if(timer) {
+      // Relative due time in 100 ns units.
+      LARGE_INTEGER dueTime;
+      dueTime.QuadPart = -(sleepDuration / 100);
+      if(SetWaitableTimer(timer, &dueTime, 0, nullptr, nullptr, false)) {
+        WaitForSingleObject(timer, INFINITE);
+        return;
+      }
+    }
+    Sleep(DWORD(sleepDuration / 1000000));
+#else
+    std::this_thread::sleep_for(std::chrono::nanoseconds(sleepDuration));
+#endif
+  }
+
+  FramePacer::FramePacer(double framePeriod)
+    : pImpl(std::make_unique<Impl>(framePeriod))
+  {}
+
+  FramePacer::~FramePacer() = default;
+
+  void FramePacer::setFramePeriod(double framePeriod) noexcept
+  {
+    pImpl->framePeriod = Clock::fromSeconds(framePeriod);
+  }
+
+  double FramePacer::getFramePeriod() const noexcept
+  {
+    return Clock::toSeconds(pImpl->framePeriod);
+  }
+
+  double FramePacer::waitForNextFrame()
+  {
+    return pImpl->waitForNextFrame();
+  }
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+
+namespace De
+{
+  /**
+   * @brief Starts frames a fixed period apart without keeping a core busy. It sleeps for most of the remaining
+   * time and spins for the rest, the spin covers how late the system has recently woken the thread up.
+   * A frame that took longer than the period starts the next one right away, missed frames aren't caught up.
+   */
+  class FramePacer
+  {
+  public:
+    /**
+     * @param framePeriod Seconds between frame starts, 0 doesn't wait.
+     */
+    explicit FramePacer(double framePeriod);
+    FramePacer(const FramePacer& other) = delete;
+    FramePacer& operator=(const FramePacer& rhs) = delete;
+    ~FramePacer();
+
+    void setFramePeriod(double framePeriod) noexcept;
+    double getFramePeriod() const noexcept;
+    /**
+     * @brief Returns when the period passed since the previous call returned.
+     * @return Seconds spent waiting.
+     */
+    double waitForNextFrame();
+
+  private:
+    class Impl;
+    std::unique_ptr<Impl> pImpl;
+  };
+}
@@ -0,0 +1,193 @@
+#define DAR_MODULE_NAME "FrameStatistics"
+
+#include "FrameStatistics.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include "DarEngine.hpp"
+
+namespace De
+{
+  static int findMostSignificantBit(uint64_t value) noexcept
+  {
+    int result = 0;
+    while(value >>= 1) {
+      ++result;
+    }
+    return result;
+  }
+
+  int Histogram::calculateIndex(uint64_t value) noexcept
+  {
+    if(value < linearCount) {
+      return (int)value;
+    }
+    // Each power of 2 above the linear range is split into subBucketCount equally sized buckets.
+    const int mostSignificantBit = findMostSignificantBit(value);
+    const int shift = mostSignificantBit - subBucketBits;
+    const int subBucket = (int)(value >> shift) - subBucketCount;
+    return linearCount + (mostSignificantBit - (subBucketBits + 1)) * subBucketCount + subBucket;
+  }
+  uint64_t Histogram::calculateHighestEquivalentValue(int index) noexcept
+  {
+    if(index < linearCount) {
+      return (uint64_t)index;
+    }
+    const int bucket = (index - linearCount) / subBucketCount;
+    const int subBucket = (index - linearCount) % subBucketCount;
+    const int shift = bucket + 1;
+    return ((uint64_t(subBucketCount + subBucket + 1)) << shift) - 1;
+  }
+
+  void Histogram::record(uint64_t value) noexcept
+  {
+    value = std::min(value, maxValue);
+    ++counts[calculateIndex(value)];
+    ++count;
+    max = std::max(max, value);
+    sum += value;
+  }
+  void Histogram::add(const Histogram& other) noexcept
+  {
+    for(int i = 0; i < indexCount; ++i) {
+      counts[i] += other.counts[i];
+    }
+    count += other.count;
+    max = std::max(max, other.max);
+    sum += other.sum;
+  }
+  void Histogram::reset() noexcept
+  {
+    std::fill_n(counts, indexCount, 0u);
+    count = 0;
+    max = 0;
+    sum = 0;
+  }
+  uint64_t Histogram::getValueAtPercentile(double percentile) const noexcept
+  {
+    if(count == 0) {
+      return 0;
+    }
+    percentile = std::clamp(percentile, 0., 100.);
+    const uint64_t rank = std::max<uint64_t>(1, (uint64_t)std::ceil(percentile / 100. * double(count)));
+    uint64_t countBelow = 0;
+    for(int i = 0; i < indexCount; ++i) {
+      countBelow += counts[i];
+      if(countBelow >= rank) {
+        return std::min(calculateHighestEquivalentValue(i), max);
+      }
+    }
+    return max;
+  }
+
+  const char* FrameStatistics::getMetricName(Metric metric) noexcept
+  {
+    switch(metric) {
+      case Frame: return "Frame";
+      case Simulation: return "Simulation";
+      case Record: return "Record";
+      case RenderWait: return "Render wait";
+      case Render: return "Render";
+      case Present: return "Present";
+      case Pacing: return "Pacing";
+      default: return "Invalid";
+    }
+  }
+
+  FrameStatistics::~FrameStatistics()
+  {
+    if(summaryFile) {
+      fclose(summaryFile);
+    }
+  }
+
+  bool FrameStatistics::openSummaryFile(const char* fileName)
+  {
+    if(summaryFile) {
+      fclose(summaryFile);
+      summaryFile = nullptr;
+    }
+#ifdef _WIN32
+    if(fopen_s(&summaryFile, fileName, "w") != 0) {
+      summaryFile = nullptr;
+    }
+#else
+    summaryFile = fopen(fileName, "w");
+#endif
+    if(!summaryFile) {
+      logError("Failed to open frame statistics summary file %s.", fileName);
+      return false;
+    }
+    fputs("time_s,metric,count,mean_ms,p50_ms,p95_ms,p99_ms,max_ms\n", summaryFile);
+    segmentsSinceSummaryWrite = 0;
+    summaryTime = 0.;
+    return true;
+  }
+
+  void FrameStatistics::record(Metric metric, double seconds) noexcept
+  {
+    const double microseconds = std::max(seconds, 0.) * 1e6;
+    segments[metric][currentSegment].record((uint64_t)std::llround(microseconds));
+    if(metric == Frame) {
+      currentSegmentDuration += seconds;
+    }
+  }
+
+  void FrameStatistics::endFrame()
+  {
+    if(currentSegmentDuration >= segmentDuration) {
+      completeSegment();
+    }
+  }
+
+  void FrameStatistics::completeSegment()
+  {
+    summaryTime += currentSegmentDuration;
+    for(int metric = 0; metric < MetricCount; ++metric) {
+      window.reset();
+      for(const Histogram& segment : segments[metric]) {
+        window.add(segment);
+      }
+      summaries[metric] = {
+        window.getCount(),
+        window.getMean(),
+        window.getValueAtPercentile(50.),
+        window.getValueAtPercentile(95.),
+        window.getValueAtPercentile(99.),
+        window.getMax()
+      };
+    }
+
+    // Summaries are written once per window, so that the lines don't overlap.
+    ++segmentsSinceSummaryWrite;
+    if(summaryFile && segmentsSinceSummaryWrite == segmentCount) {
+      writeSummaries();
+      segmentsSinceSummaryWrite = 0;
+    }
+
+    currentSegment = (currentSegment + 1) % segmentCount;
+    currentSegmentDuration = 0.;
+    for(int metric = 0; metric < MetricCount; ++metric) {
+      segments[metric][currentSegment].reset();
+    }
+  }
+
+  void FrameStatistics::writeSummaries()
+  {
+    for(int metric = 0; metric < MetricCount; ++metric) {
+      const Summary& summary = summaries[metric];
+      fprintf(summaryFile, "%.3f,%s,%llu,%.3f,%.3f,%.3f,%.3f,%.3f\n",
+        summaryTime,
+        getMetricName(Metric(metric)),
+        (unsigned long long)summary.count,
+        summary.mean / 1000.,
+        summary.p50 / 1000.,
+        summary.p95 / 1000.,
+        summary.p99 / 1000.,
+        summary.max / 1000.
+      );
+    }
+    fflush(summaryFile);
+  }
+}
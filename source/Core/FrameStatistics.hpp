@@ -0,0 +1,122 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+
+namespace De
+{
+  /**
+   * @brief Log-linear histogram in the style of HdrHistogram.
+   * Values below 256 are counted exactly, larger ones with less than 1% relative error.
+   */
+  class Histogram
+  {
+  public:
+    // Larger values are clamped.
+    static constexpr uint64_t maxValue = (1ull << 32) - 1;
+
+    void record(uint64_t value) noexcept;
+    void add(const Histogram& other) noexcept;
+    void reset() noexcept;
+
+    /**
+     * @param percentile In [0, 100].
+     * @return The highest value counted in the same bucket as the value at percentile, 0 if empty.
+     */
+    uint64_t getValueAtPercentile(double percentile) const noexcept;
+    uint64_t getMax() const noexcept { return max; }
+    uint64_t getCount() const noexcept { return count; }
+    double getMean() const noexcept { return count ? double(sum) / double(count) : 0.; }
+
+  private:
+    static constexpr int subBucketBits = 7;
+    static constexpr int subBucketCount = 1 << subBucketBits;
+    static constexpr int linearCount = 2 * subBucketCount;
+    static constexpr int indexCount = linearCount + (32 - (subBucketBits + 1)) * subBucketCount;
+
+    static int calculateIndex(uint64_t value) noexcept;
+    static uint64_t calculateHighestEquivalentValue(int index) noexcept;
+
+    uint32_t counts[indexCount] = {};
+    uint64_t count = 0;
+    uint64_t max = 0;
+    uint64_t sum = 0;
+  };
+
+  /**
+   * @brief Records frame phase times into histograms over a rolling window of the last few seconds.
+   * Times are kept in microseconds.
+   */
+  class FrameStatistics
+  {
+  public:
+    enum Metric
+    {
+      Frame = 0,
+      Simulation,
+      // Building the render frame of the game state.
+      Record,
+      // Waiting for the render thread to finish the last frame, the part of its Render and Present that didn't
+      // overlap with the simulation and recording of this frame.
+      RenderWait,
+      // Rendering the last frame on the render thread.
+      Render,
+      // Presenting the last frame on the render thread, including the wait for vsync or a free swap chain image.
+      Present,
+      // Time the frame pacer waited before the frame.
+      Pacing,
+      MetricCount
+    };
+    struct Summary
+    {
+      uint64_t count;
+      double mean;
+      uint64_t p50;
+      uint64_t p95;
+      uint64_t p99;
+      uint64_t max;
+    };
+    static constexpr double windowDuration = 5.;
+
+    static const char* getMetricName(Metric metric) noexcept;
+
+    FrameStatistics() = default;
+    FrameStatistics(const FrameStatistics& other) = delete;
+    FrameStatistics& operator=(const FrameStatistics& rhs) = delete;
+    ~FrameStatistics();
+
+    /**
+     * @brief Appends a line per metric to fileName every windowDuration seconds.
+     * @return false if the file couldn't be opened.
+     */
+    bool openSummaryFile(const char* fileName);
+
+    void record(Metric metric, double seconds) noexcept;
+    /**
+     * @brief Call once per frame after all metrics are recorded. The recorded frame times advance the window.
+     */
+    void endFrame();
+
+    /**
+     * @brief Statistics of the last completed window segments, updated twice per second.
+     */
+    const Summary& getSummary(Metric metric) const noexcept { return summaries[metric]; }
+
+  private:
+    static constexpr int segmentCount = 10;
+    static constexpr double segmentDuration = windowDuration / segmentCount;
+
+    void completeSegment();
+    void writeSummaries();
+
+    Histogram segments[MetricCount][segmentCount];
+    int currentSegment = 0;
+    double currentSegmentDuration = 0.;
+    int segmentsSinceSummaryWrite = 0;
+    Histogram window;
+    Summary summaries[MetricCount] = {};
+
+    FILE* summaryFile = nullptr;
+    double summaryTime = 0.;
+  };
+}
@@ -0,0 +1,400 @@
+#define DAR_MODULE_NAME "JobSystem"
+
+#include "JobSystem.hpp"
+
+#include <condition_variable>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "DarEngine.hpp"
+#include "Profiler.hpp"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace De
+{
+  namespace
+  {
+    constexpr size_t cacheLineSize = 64;
+
+    /**
+     * @brief Fixed size Chase-Lev deque, with the memory orders of Le et al., "Correct and Efficient Work-Stealing
+     * for Weak Memory Models". The owner pushes and pops at the bottom, other threads steal from the top.
+     */
+    class WorkStealingDeque
+    {
+    public:
+      static constexpr int64_t capacity = JobSystem::maxPendingJobsPerThread;
+      static_assert((capacity & (capacity - 1)) == 0, "The capacity has to be a power of two.");
+
+      /**
+       * @return false if the deque is full.
+       */
+      bool push(Job* job) noexcept
+      {
+        const int64_t b = bottom.load(std::memory_order_relaxed);
+        const int64_t t = top.load(std::memory_order_acquire);
+        if(b - t >= capacity) {
+          return false;
+        }
+        jobs[b & (capacity - 1)].store(job, std::memory_order_relaxed);
+        bottom.store(b + 1, std::memory_order_release);
+        return true;
+      }
+
+      Job* pop() noexcept
+      {
+        const int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+        bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = top.load(std::memory_order_relaxed);
+        if(t > b) {
+          bottom.store(b + 1, std::memory_order_relaxed);
+          return nullptr;
+        }
+        Job* job = jobs[b & (capacity - 1)].load(std::memory_order_relaxed);
+        if(t == b) {
+          // Last job, a thief may be taking it at the same time.
+          if(!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            job = nullptr;
+          }
+          bottom.store(b + 1, std::memory_order_relaxed);
+        }
+        return job;
+      }
+
+      /**
+       * @return nullptr if the deque is empty or another thread took the job first.
+       */
+      Job* steal() noexcept
+      {
+        int64_t t = top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const int64_t b = bottom.load(std::memory_order_acquire);
+        if(t >= b) {
+          return nullptr;
+        }
+        Job* job = jobs[t & (capacity - 1)].load(std::memory_order_relaxed);
+        if(!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+          return nullptr;
+        }
+        return job;
+      }
+
+      bool isEmpty() const noexcept
+      {
+        return top.load(std::memory_order_acquire) >= bottom.load(std::memory_order_acquire);
+      }
+
+    private:
+      alignas(cacheLineSize) std::atomic<int64_t> top{ 0 };
+      alignas(cacheLineSize) std::atomic<int64_t> bottom{ 0 };
+      alignas(cacheLineSize) std::atomic<Job*> jobs[capacity];
+    };
+
+    struct ThreadContext
+    {
+      explicit ThreadContext(const void* owner, uint32_t seed)
+        : owner(owner)
+        , randomState(seed)
+      {}
+
+      // Nudges the next steal to another victim, xorshift32.
+      uint32_t nextRandom() noexcept
+      {
+        randomState ^= randomState << 13;
+        randomState ^= randomState >> 17;
+        randomState ^= randomState << 5;
+        return randomState;
+      }
+
+      const void* owner;
+      WorkStealingDeque deque;
+      // Only the owning thread allocates from its pool, any thread frees a job after running it.
+      Job jobPool[JobSystem::maxPendingJobsPerThread];
+      int nextJobIndex = 0;
+      uint32_t randomState;
+    };
+
+    thread_local ThreadContext* currentContext = nullptr;
+
+    void pinThread(std::thread& thread, int processor)
+    {
+#ifdef _WIN32
+      if(processor >= 64 || !SetThreadAffinityMask(thread.native_handle(), DWORD_PTR(1) << processor)) {
+        logWarning("Failed to pin a worker to processor %d.", processor);
+      }
+#elif defined(__linux__)
+      cpu_set_t cpuSet;
+      CPU_ZERO(&cpuSet);
+      CPU_SET(processor, &cpuSet);
+      if(pthread_setaffinity_np(thread.native_handle(), sizeof(cpuSet), &cpuSet) != 0) {
+        logWarning("Failed to pin a worker to processor %d.", processor);
+      }
+#else
+      (void)thread;
+      (void)processor;
+#endif
+    }
+  }
+
+  class JobSystem::Impl
+  {
+  public:
+    Impl(JobSystem& jobSystem, int workerCount, bool pinWorkers);
+    ~Impl();
+
+    ThreadContext* getContext() noexcept
+    {
+      return currentContext && currentContext->owner == this ? currentContext : nullptr;
+    }
+    Job* findJob(ThreadContext* context) noexcept;
+    void execute(Job* job);
+    void notifySubmitted();
+
+    std::vector<std::unique_ptr<ThreadContext>> contexts;
+
+  private:
+    void runWorker(ThreadContext& context);
+
+    JobSystem& jobSystem;
+    std::vector<std::thread> workers;
+    // Counts submissions so that a worker notices jobs submitted while it was falling asleep.
+    std::atomic<uint64_t> submitCount{ 0 };
+    std::atomic<int> sleepingCount{ 0 };
+    std::atomic<bool> isStopping{ false };
+    std::mutex sleepMutex;
+    std::condition_variable wakeCondition;
+  };
+
+  JobSystem::Impl::Impl(JobSystem& jobSystem, int workerCount, bool pinWorkers)
+    : jobSystem(jobSystem)
+  {
+    workerCount = std::max(workerCount, 0);
+    for(int i = 0; i <= workerCount; ++i) {
+      contexts.push_back(std::make_unique<ThreadContext>(this, 0x9e3779b9u * uint32_t(i + 1)));
+    }
+    currentContext = contexts[0].get();
+
+    workers.reserve(workerCount);
+    for(int i = 1; i <= workerCount; ++i) {
+      workers.emplace_back(&Impl::runWorker, this, std::ref(*contexts[i]));
+      if(pinWorkers) {
+        pinThread(workers.back(), i);
+      }
+    }
+  }
+
+  JobSystem::Impl::~Impl()
+  {
+    ThreadContext* context = getContext();
+    for(;;) {
+      if(Job* job = findJob(context)) {
+        execute(job);
+        continue;
+      }
+      bool isIdle = true;
+      for(const auto& other : contexts) {
+        isIdle = isIdle && other->deque.isEmpty();
+      }
+      if(isIdle) {
+        break;
+      }
+      std::this_thread::yield();
+    }
+
+    {
+      std::lock_guard lock(sleepMutex);
+      isStopping = true;
+    }
+    wakeCondition.notify_all();
+    for(std::thread& worker : workers) {
+      worker.join();
+    }
+    if(currentContext == contexts[0].get()) {
+      currentContext = nullptr;
+    }
+  }
+
+  Job* JobSystem::Impl::findJob(ThreadContext* context) noexcept
+  {
+    if(context) {
+      if(Job* job = context->deque.pop()) {
+        return job;
+      }
+    }
+    const size_t count = contexts.size();
+    const size_t first = context ? context->nextRandom() % count : 0;
+    for(size_t i = 0; i < count; ++i) {
+      ThreadContext& victim = *contexts[(first + i) % count];
+      if(&victim == context) {
+        continue;
+      }
+      if(Job* job = victim.deque.steal()) {
+        return job;
+      }
+    }
+    return nullptr;
+  }
+
+  void JobSystem::Impl::execute(Job* job)
+  {
+    JobCounter* counter = job->counter;
+    job->invoke(*job);
+    job->isFree.store(true, std::memory_order_release);
+    if(counter) {
+      jobSystem.finish(*counter);
+    }
+  }
+
+  void JobSystem::Impl::notifySubmitted()
+  {
+    submitCount.fetch_add(1, std::memory_order_seq_cst);
+    if(sleepingCount.load(std::memory_order_seq_cst) > 0) {
+      std::lock_guard lock(sleepMutex);
+      wakeCondition.notify_one();
+    }
+  }
+
+  void JobSystem::Impl::runWorker(ThreadContext& context)
+  {
+    Profiler::setThreadName("JobWorker");
+    currentContext = &context;
+
+    constexpr int spinCount = 64;
+    for(;;) {
+      const uint64_t seenSubmitCount = submitCount.load(std::memory_order_seq_cst);
+      Job* job = nullptr;
+      for(int i = 0; i < spinCount && !job; ++i) {
+        job = findJob(&context);
+        if(!job) {
+          std::this_thread::yield();
+        }
+      }
+      if(job) {
+        execute(job);
+        continue;
+      }
+
+      std::unique_lock lock(sleepMutex);
+      if(isStopping) {
+        break;
+      }
+      sleepingCount.fetch_add(1, std::memory_order_seq_cst);
+      wakeCondition.wait(lock, [&]() {
+        return isStopping || submitCount.load(std::memory_order_seq_cst) != seenSubmitCount;
+      });
+      sleepingCount.fetch_sub(1, std::memory_order_relaxed);
+    }
+    currentContext = nullptr;
+  }
+
+  int JobSystem::getDefaultWorkerCount() noexcept
+  {
+    const int hardwareThreadCount = int(std::thread::hardware_concurrency());
+    return hardwareThreadCount > 1 ? hardwareThreadCount - 1 : 1;
+  }
+
+  JobSystem::JobSystem(int workerCount, bool pinWorkers)
+    : pImpl(std::make_unique<Impl>(*this, workerCount, pinWorkers))
+  {
+    logInfo("Started %d job workers.", getThreadCount() - 1);
+  }
+
+  JobSystem::~JobSystem() = default;
+
+  void JobSystem::wait(JobCounter& counter)
+  {
+    ThreadContext* context = pImpl->getContext();
+    while(!counter.isDone()) {
+      if(Job* job = pImpl->findJob(context)) {
+        pImpl->execute(job);
+      } else {
+        std::this_thread::yield();
+      }
+    }
+    // The last finish may still be releasing the continuations, the counter can't go away before it's done.
+    std::lock_guard lock(counter.continuationsMutex);
+  }
+
+  int JobSystem::getThreadCount() const noexcept
+  {
+    return int(pImpl->contexts.size());
+  }
+
+  Job* JobSystem::allocateJob() noexcept
+  {
+    ThreadContext* context = pImpl->getContext();
+    if(!context) {
+      // Threads outside the job system have no deque, their jobs run right away.
+      return nullptr;
+    }
+    for(int i = 0; i < maxPendingJobsPerThread; ++i) {
+      Job& job = context->jobPool[context->nextJobIndex];
+      context->nextJobIndex = (context->nextJobIndex + 1) & (maxPendingJobsPerThread - 1);
+      if(job.isFree.load(std::memory_order_acquire)) {
+        job.isFree.store(false, std::memory_order_relaxed);
+        return &job;
+      }
+    }
+    return nullptr;
+  }
+
+  void JobSystem::submit(Job* job)
+  {
+    ThreadContext* context = pImpl->getContext();
+    if(!context || !context->deque.push(job)) {
+      pImpl->execute(job);
+      return;
+    }
+    pImpl->notifySubmitted();
+  }
+
+  void JobSystem::submitAfter(JobCounter& dependency, Job* job)
+  {
+    {
+      std::lock_guard lock(dependency.continuationsMutex);
+      if(dependency.value.load(std::memory_order_acquire) != 0) {
+        job->nextContinuation = dependency.continuations;
+        dependency.continuations = job;
+        return;
+      }
+    }
+    submit(job);
+  }
+
+  void JobSystem::finish(JobCounter& counter)
+  {
+    int value = counter.value.load(std::memory_order_relaxed);
+    for(;;) {
+      if(value != 1) {
+        if(counter.value.compare_exchange_weak(value, value - 1, std::memory_order_acq_rel)) {
+          return;
+        }
+        continue;
+      }
+      // Reaching zero and taking the continuations happen under the lock, so none can be added in between.
+      Job* continuations;
+      {
+        std::lock_guard lock(counter.continuationsMutex);
+        if(!counter.value.compare_exchange_strong(value, 0, std::memory_order_acq_rel)) {
+          continue;
+        }
+        continuations = std::exchange(counter.continuations, nullptr);
+      }
+      while(continuations) {
+        Job* next = continuations->nextContinuation;
+        submit(continuations);
+        continuations = next;
+      }
+      return;
+    }
+  }
+}
@@ -0,0 +1,199 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace De
+{
+  class JobCounter;
+
+  /**
+   * @brief Unit of work, the function object is stored in place so that submitting a job doesn't allocate.
+   */
+  struct Job
+  {
+    static constexpr size_t dataSize = 64;
+
+    void (*invoke)(Job& job);
+    JobCounter* counter;
+    // Next job waiting for the same counter.
+    Job* nextContinuation;
+    std::atomic<bool> isFree{ true };
+    alignas(std::max_align_t) unsigned char data[dataSize];
+  };
+
+  /**
+   * @brief Counts unfinished jobs. Pass it when running jobs to wait for them or to run other jobs after them.
+   * A counter has to outlive the jobs counted by it and those waiting for it, destroy it after JobSystem::wait returned.
+   */
+  class JobCounter
+  {
+  public:
+    JobCounter() noexcept = default;
+    JobCounter(const JobCounter& other) = delete;
+    JobCounter& operator=(const JobCounter& rhs) = delete;
+
+    bool isDone() const noexcept { return value.load(std::memory_order_acquire) == 0; }
+
+  private:
+    friend class JobSystem;
+
+    std::atomic<int> value{ 0 };
+    std::mutex continuationsMutex;
+    Job* continuations = nullptr;
+  };
+
+  /**
+   * @brief Work stealing job scheduler. Every thread of the pool has a deque of jobs, it takes its own jobs from
+   * the bottom and steals from the top of the deques of others when it runs out (Chase-Lev deques).
+   * Jobs can be submitted from the thread that created the job system and from jobs. Waiting threads run jobs
+   * instead of blocking, so jobs may wait for other jobs. Jobs must not throw.
+   */
+  class JobSystem
+  {
+  public:
+    /**
+     * @brief Jobs one thread can have submitted and not yet finished, more run immediately on the submitting thread.
+     */
+    static constexpr int maxPendingJobsPerThread = 4096;
+
+    /**
+     * @return One worker per hardware thread besides the calling one.
+     */
+    static int getDefaultWorkerCount() noexcept;
+
+    /**
+     * @param pinWorkers Binds worker i to logical processor i + 1, processor 0 is left to the creating thread.
+     */
+    explicit JobSystem(int workerCount = getDefaultWorkerCount(), bool pinWorkers = false);
+    JobSystem(const JobSystem& other) = delete;
+    JobSystem& operator=(const JobSystem& rhs) = delete;
+    /**
+     * @brief Runs the remaining jobs, then stops the workers.
+     */
+    ~JobSystem();
+
+    /**
+     * @param counter Counts the job until it finished, can be nullptr.
+     */
+    template<typename Function>
+    void run(Function&& function, JobCounter* counter = nullptr);
+    /**
+     * @brief Runs the job once dependency reached zero, right away if it already has.
+     */
+    template<typename Function>
+    void runAfter(JobCounter& dependency, Function&& function, JobCounter* counter = nullptr);
+    /**
+     * @brief Runs other jobs until counter reaches zero.
+     */
+    void wait(JobCounter& counter);
+
+    /**
+     * @brief Calls function(rangeBegin, rangeEnd) for consecutive ranges of up to grainSize indices
+     * covering [begin, end) on all threads and returns when all ranges are done.
+     */
+    template<typename Function>
+    void parallelFor(int begin, int end, int grainSize, const Function& function);
+    /**
+     * @brief Splits [begin, end) into a few ranges per thread.
+     */
+    template<typename Function>
+    void parallelFor(int begin, int end, const Function& function);
+
+    /**
+     * @return Threads running jobs, including the creating thread.
+     */
+    int getThreadCount() const noexcept;
+
+  private:
+    class Impl;
+
+    /**
+     * @return nullptr if the job already ran on the calling thread.
+     */
+    template<typename Function>
+    Job* createJob(Function&& function, JobCounter* counter, JobCounter* dependency);
+    Job* allocateJob() noexcept;
+    void submit(Job* job);
+    void submitAfter(JobCounter& dependency, Job* job);
+    void finish(JobCounter& counter);
+
+    std::unique_ptr<Impl> pImpl;
+  };
+
+  template<typename Function>
+  Job* JobSystem::createJob(Function&& function, JobCounter* counter, JobCounter* dependency)
+  {
+    using Stored = std::decay_t<Function>;
+    static_assert(sizeof(Stored) <= Job::dataSize && alignof(Stored) <= alignof(std::max_align_t),
+      "The job captures too much, capture a pointer to the data instead.");
+
+    if(counter) {
+      counter->value.fetch_add(1, std::memory_order_relaxed);
+    }
+    Job* job = allocateJob();
+    if(!job) {
+      // Too many pending jobs, running it right away still makes progress.
+      if(dependency) {
+        wait(*dependency);
+      }
+      function();
+      if(counter) {
+        finish(*counter);
+      }
+      return nullptr;
+    }
+    new(job->data) Stored(std::forward<Function>(function));
+    job->invoke = [](Job& job) {
+      Stored& stored = *std::launder(reinterpret_cast<Stored*>(job.data));
+      stored();
+      stored.~Stored();
+    };
+    job->counter = counter;
+    job->nextContinuation = nullptr;
+    return job;
+  }
+
+  template<typename Function>
+  void JobSystem::run(Function&& function, JobCounter* counter)
+  {
+    if(Job* job = createJob(std::forward<Function>(function), counter, nullptr)) {
+      submit(job);
+    }
+  }
+
+  template<typename Function>
+  void JobSystem::runAfter(JobCounter& dependency, Function&& function, JobCounter* counter)
+  {
+    if(Job* job = createJob(std::forward<Function>(function), counter, &dependency)) {
+      submitAfter(dependency, job);
+    }
+  }
+
+  template<typename Function>
+  void JobSystem::parallelFor(int begin, int end, int grainSize, const Function& function)
+  {
+    grainSize = std::max(grainSize, 1);
+    JobCounter counter;
+    for(int rangeBegin = begin; rangeBegin < end; rangeBegin += grainSize) {
+      const int rangeEnd = end - rangeBegin > grainSize ? rangeBegin + grainSize : end;
+      run([&function, rangeBegin, rangeEnd]() { function(rangeBegin, rangeEnd); }, &counter);
+    }
+    wait(counter);
+  }
+
+  template<typename Function>
+  void JobSystem::parallelFor(int begin, int end, const Function& function)
+  {
+    // A few ranges per thread let fast threads steal from slow ones.
+    constexpr int rangesPerThread = 4;
+    const int rangeCount = getThreadCount() * rangesPerThread;
+    parallelFor(begin, end, (end - begin + rangeCount - 1) / rangeCount, function);
+  }
+}
@@ -23,7 +23,7 @@ public:
 	Impl& operator=(Impl&& rhs) = default;
 	void* loadFunction(const char* name)
 	{
-		return library->loadFunction(name);
+		return reinterpret_cast<void*>(library->loadFunction(name));
 	}
 private:
 	std::unique_ptr<LibraryType> library;
@@ -0,0 +1,266 @@
+#include "Log.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#endif
+
+namespace De::Log
+{
+  namespace
+  {
+    using namespace detail;
+
+    FILE* openFile(const char* fileName)
+    {
+#ifdef _WIN32
+      FILE* file = nullptr;
+      return fopen_s(&file, fileName, "w") == 0 ? file : nullptr;
+#else
+      return fopen(fileName, "w");
+#endif
+    }
+
+    // Constant initialized, still readable by threads that exit after the logger was destroyed.
+    bool isDestroyed = false;
+
+    class Logger
+    {
+    public:
+      Logger()
+        : thread([this]() { run(); })
+      {}
+      Logger(const Logger& other) = delete;
+      Logger& operator=(const Logger& rhs) = delete;
+      ~Logger()
+      {
+        isDestroyed = true;
+        {
+          std::lock_guard<std::mutex> lock(mutex);
+          running = false;
+        }
+        wake.notify_one();
+        thread.join();
+        if(file) {
+          fclose(file);
+        }
+      }
+
+      ThreadBuffer* registerThread()
+      {
+        std::lock_guard<std::mutex> lock(buffersMutex);
+        // The previous thread is gone, so the buffer still has a single producer. 
+        // Its write position was released before the buffer was unregistered.
+        if(!unusedBuffers.empty()) {
+          ThreadBuffer* buffer = unusedBuffers.back();
+          unusedBuffers.pop_back();
+          return buffer;
+        }
+        buffers.push_back(std::make_unique<ThreadBuffer>());
+        unusedBuffers.reserve(buffers.size());
+        return buffers.back().get();
+      }
+      void unregisterThread(ThreadBuffer* buffer) noexcept
+      {
+        std::lock_guard<std::mutex> lock(buffersMutex);
+        // Reserved as buffers grew, so that push_back can't throw.
+        unusedBuffers.push_back(buffer);
+      }
+      bool setOutputFile(const char* fileName)
+      {
+        FILE* newFile = nullptr;
+        if(fileName) {
+          newFile = openFile(fileName);
+          if(!newFile) {
+            return false;
+          }
+        }
+        std::lock_guard<std::mutex> lock(outputMutex);
+        if(file) {
+          fclose(file);
+        }
+        file = newFile;
+        return true;
+      }
+      void flush()
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        const uint64_t request = ++flushRequested;
+        wake.notify_one();
+        flushed.wait(lock, [&]() { return flushCompleted >= request || !running; });
+      }
+
+    private:
+      // Messages aren't signaled, waking the background thread would cost the logging thread a syscall.
+      static constexpr std::chrono::milliseconds pollInterval{ 5 };
+
+      void run()
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        while(true) {
+          const uint64_t request = flushRequested;
+          const bool stop = !running;
+          lock.unlock();
+          drain();
+          lock.lock();
+          if(flushCompleted != request) {
+            flushCompleted = request;
+            flushed.notify_all();
+          }
+          if(stop) {
+            break;
+          }
+          if(running && flushRequested == flushCompleted) {
+            wake.wait_for(lock, pollInterval);
+          }
+        }
+      }
+      void drain()
+      {
+        {
+          std::lock_guard<std::mutex> lock(buffersMutex);
+          drainedBuffers.clear();
+          for(const std::unique_ptr<ThreadBuffer>& buffer : buffers) {
+            drainedBuffers.push_back(buffer.get());
+          }
+        }
+        std::lock_guard<std::mutex> lock(outputMutex);
+        bool hasWritten = false;
+        for(ThreadBuffer* buffer : drainedBuffers) {
+          hasWritten |= drain(*buffer);
+        }
+        if(hasWritten) {
+          fflush(file ? file : stderr);
+        }
+      }
+      bool drain(ThreadBuffer& buffer)
+      {
+        bool hasWritten = false;
+        uint32_t readPosition = buffer.readPosition.load(std::memory_order_relaxed);
+        const uint32_t writePosition = buffer.writePosition.load(std::memory_order_acquire);
+        while(readPosition != writePosition) {
+          const uint32_t offset = readPosition & (ThreadBuffer::capacity - 1);
+          const uint32_t contiguousSize = ThreadBuffer::capacity - offset;
+          // Too small for a header, beginRecord skipped it as well.
+          if(contiguousSize < sizeof(RecordHeader)) {
+            readPosition += contiguousSize;
+            continue;
+          }
+          RecordHeader header;
+          memcpy(&header, buffer.data + offset, sizeof(header));
+          if(header.formatFunction) {
+            const unsigned char* arguments = buffer.data + offset + sizeof(header);
+            char text[1024];
+            const char* output = text;
+            int length = header.formatFunction(header.format, arguments, text, sizeof(text));
+            if(length >= (int)sizeof(text)) {
+              // Rare, e.g. shader compiler errors, formatted again at full length.
+              longText.resize(size_t(length) + 1);
+              length = header.formatFunction(header.format, arguments, longText.data(), longText.size());
+              output = longText.data();
+            }
+            if(length > 0) {
+              write(output, length);
+              hasWritten = true;
+            }
+          }
+          readPosition += header.size;
+        }
+        buffer.readPosition.store(readPosition, std::memory_order_release);
+
+        const uint32_t droppedCount = buffer.droppedCount.exchange(0, std::memory_order_relaxed);
+        if(droppedCount > 0) {
+          char text[128];
+          const int length = snprintf(text, sizeof(text), "[WARN][Log] %u messages dropped, the ring buffer was full or they were too long.\n", droppedCount);
+          write(text, length);
+          hasWritten = true;
+        }
+        return hasWritten;
+      }
+      void write(const char* text, int length)
+      {
+        fwrite(text, 1, length, file ? file : stderr);
+#ifdef _WIN32
+        OutputDebugStringA(text);
+#endif
+      }
+
+      std::mutex buffersMutex;
+      std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+      std::vector<ThreadBuffer*> unusedBuffers;
+      std::vector<ThreadBuffer*> drainedBuffers;
+
+      std::mutex outputMutex;
+      FILE* file = nullptr;
+      std::vector<char> longText;
+
+      std::mutex mutex;
+      std::condition_variable wake;
+      std::condition_variable flushed;
+      uint64_t flushRequested = 0;
+      uint64_t flushCompleted = 0;
+      bool running = true;
+
+      // Last, so that everything above is initialized when the thread starts.
+      std::thread thread;
+    };
+
+    Logger& getLogger()
+    {
+      static Logger logger;
+      return logger;
+    }
+  }
+
+  bool setOutputFile(const char* fileName)
+  {
+    return getLogger().setOutputFile(fileName);
+  }
+  void flush()
+  {
+    getLogger().flush();
+  }
+
+  namespace detail
+  {
+    ThreadBuffer* registerThread()
+    {
+      return getLogger().registerThread();
+    }
+    void unregisterThread(ThreadBuffer* buffer) noexcept
+    {
+      // Threads that exit after the logger was destroyed have nothing to return their buffer to.
+      if(!isDestroyed) {
+        getLogger().unregisterThread(buffer);
+      }
+    }
+    unsigned char* beginRecord(ThreadBuffer& buffer, uint32_t recordSize) noexcept
+    {
+      const uint32_t writePosition = buffer.writePosition.load(std::memory_order_relaxed);
+      const uint32_t readPosition = buffer.readPosition.load(std::memory_order_acquire);
+      uint32_t offset = writePosition & (ThreadBuffer::capacity - 1);
+      // Records are never split, the rest of the buffer is skipped if the record doesn't fit.
+      const uint32_t contiguousSize = ThreadBuffer::capacity - offset;
+      const uint32_t paddingSize = contiguousSize < recordSize ? contiguousSize : 0;
+      if(ThreadBuffer::capacity - (writePosition - readPosition) < paddingSize + recordSize) {
+        return nullptr;
+      }
+      if(paddingSize > 0) {
+        if(paddingSize >= sizeof(RecordHeader)) {
+          const RecordHeader padding = { paddingSize, nullptr, nullptr };
+          memcpy(buffer.data + offset, &padding, sizeof(padding));
+        }
+        buffer.writePosition.store(writePosition + paddingSize, std::memory_order_release);
+        offset = 0;
+      }
+      return buffer.data + offset;
+    }
+  }
+}
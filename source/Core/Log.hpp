@@ -0,0 +1,200 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <cwchar>
+#include <tuple>
+#include <type_traits>
+
+/**
+ * Asynchronous logging.
+ * The logging thread only copies the format string pointer and the arguments into its own ring buffer.
+ * A background thread formats the messages and writes them to stderr or a file.
+ * Use logError, logWarning and logInfo from DarEngine.hpp instead of calling De::Log::write directly.
+ */
+namespace De::Log
+{
+  /**
+   * @brief Writes the messages into fileName instead of stderr. nullptr switches back to stderr.
+   * @return false if the file couldn't be opened, the output stays unchanged then.
+   */
+  bool setOutputFile(const char* fileName);
+  /**
+   * @brief Blocks until all messages logged before the call are written.
+   */
+  void flush();
+
+  namespace detail
+  {
+    using FormatFunction = int (*)(const char* format, const unsigned char* arguments, char* output, size_t outputSize);
+
+    struct RecordHeader
+    {
+      uint32_t size;
+      FormatFunction formatFunction; // nullptr for padding at the end of the ring buffer.
+      const char* format;
+    };
+
+    /**
+     * @brief Single producer single consumer ring buffer, one per logging thread.
+     */
+    struct ThreadBuffer
+    {
+      static constexpr uint32_t capacity = 64 * 1024;
+      static_assert((capacity & (capacity - 1)) == 0, "capacity has to be a power of 2, so that positions can wrap around.");
+      static constexpr uint32_t maxRecordSize = capacity / 4;
+
+      alignas(64) std::atomic<uint32_t> writePosition{ 0 };
+      alignas(64) std::atomic<uint32_t> readPosition{ 0 };
+      std::atomic<uint32_t> droppedCount{ 0 };
+      alignas(alignof(RecordHeader)) unsigned char data[capacity];
+    };
+    ThreadBuffer* registerThread();
+    /**
+     * @brief Hands the buffer to the next thread that registers, records left in it are still written.
+     */
+    void unregisterThread(ThreadBuffer* buffer) noexcept;
+    /**
+     * @brief Registers the thread on its first message and unregisters it on exit, 
+     * so that short lived threads like the std::async ones of hot reloading reuse buffers instead of adding one each.
+     */
+    struct ThreadBufferOwner
+    {
+      ThreadBuffer* buffer = registerThread();
+
+      ThreadBufferOwner() = default;
+      ThreadBufferOwner(const ThreadBufferOwner& other) = delete;
+      ThreadBufferOwner& operator=(const ThreadBufferOwner& rhs) = delete;
+      ~ThreadBufferOwner() { unregisterThread(buffer); }
+    };
+    inline ThreadBuffer& getThreadBuffer()
+    {
+      thread_local ThreadBufferOwner owner;
+      return *owner.buffer;
+    }
+
+    /**
+     * @brief Applies the default argument promotions printf expects.
+     */
+    template<typename T>
+    auto promote(T value) noexcept
+    {
+      static_assert(std::is_arithmetic_v<T> || std::is_enum_v<T> || std::is_pointer_v<T> || std::is_null_pointer_v<T>,
+        "Only arithmetic, enum, pointer and string arguments can be logged.");
+      if constexpr(std::is_enum_v<T>) {
+        return +static_cast<std::underlying_type_t<T>>(value);
+      } else if constexpr(std::is_same_v<T, float>) {
+        return static_cast<double>(value);
+      } else if constexpr(std::is_pointer_v<T> || std::is_null_pointer_v<T>) {
+        return static_cast<const void*>(value);
+      } else {
+        return +value;
+      }
+    }
+    template<typename T>
+    struct Argument
+    {
+      using Stored = decltype(promote(std::declval<T>()));
+      static size_t size(T) noexcept { return sizeof(Stored); }
+      static void encode(unsigned char*& cursor, T value) noexcept
+      {
+        const Stored stored = promote(value);
+        memcpy(cursor, &stored, sizeof(stored));
+        cursor += sizeof(stored);
+      }
+      static Stored decode(const unsigned char*& cursor) noexcept
+      {
+        Stored stored;
+        memcpy(&stored, cursor, sizeof(stored));
+        cursor += sizeof(stored);
+        return stored;
+      }
+    };
+    // Strings are copied including the terminator, the caller's string may be gone by the time the message is formatted.
+    template<typename Char>
+    struct StringArgument
+    {
+      static size_t stringLength(const Char* value) noexcept
+      {
+        if constexpr(std::is_same_v<Char, char>) {
+          return strlen(value);
+        } else {
+          return wcslen(value);
+        }
+      }
+      // nullptr is logged as an empty string.
+      static size_t length(const Char* value) noexcept { return value ? stringLength(value) : 0; }
+      static size_t size(const Char* value) noexcept { return (length(value) + 1) * sizeof(Char); }
+      static void encode(unsigned char*& cursor, const Char* value) noexcept
+      {
+        const size_t valueSize = size(value) - sizeof(Char);
+        if(valueSize > 0) {
+          memcpy(cursor, value, valueSize);
+        }
+        memset(cursor + valueSize, 0, sizeof(Char));
+        cursor += valueSize + sizeof(Char);
+      }
+      static const Char* decode(const unsigned char*& cursor) noexcept
+      {
+        // Never nullptr, unlike the encoded value. Checking it would let the compiler assume cursor may be nullptr.
+        const Char* value = reinterpret_cast<const Char*>(cursor);
+        cursor += (stringLength(value) + 1) * sizeof(Char);
+        return value;
+      }
+    };
+    template<> struct Argument<const char*> : StringArgument<char> {};
+    template<> struct Argument<char*> : StringArgument<char> {};
+    template<> struct Argument<const wchar_t*> : StringArgument<wchar_t> {};
+    template<> struct Argument<wchar_t*> : StringArgument<wchar_t> {};
+
+    template<typename... Args>
+    int formatRecord(const char* format, const unsigned char* arguments, char* output, size_t outputSize)
+    {
+      // Braced initialization decodes the arguments in order.
+      const unsigned char* cursor = arguments;
+      const std::tuple<decltype(Argument<Args>::decode(cursor))...> values{ Argument<Args>::decode(cursor)... };
+      return std::apply([&](auto... decoded) { return snprintf(output, outputSize, format, decoded...); }, values);
+    }
+
+    constexpr uint32_t alignRecordSize(size_t size) noexcept
+    {
+      return uint32_t((size + alignof(RecordHeader) - 1) & ~(alignof(RecordHeader) - 1));
+    }
+    /**
+     * @return Where the record has to be written or nullptr if the ring buffer is full.
+     */
+    unsigned char* beginRecord(ThreadBuffer& buffer, uint32_t recordSize) noexcept;
+    inline void endRecord(ThreadBuffer& buffer, uint32_t recordSize) noexcept
+    {
+      const uint32_t writePosition = buffer.writePosition.load(std::memory_order_relaxed);
+      buffer.writePosition.store(writePosition + recordSize, std::memory_order_release);
+    }
+  }
+
+  /**
+   * @param format Has to be a string literal, only the pointer is stored.
+   */
+  template<typename... Args>
+  void write(const char* format, Args... args) noexcept
+  {
+    detail::ThreadBuffer& buffer = detail::getThreadBuffer();
+    const size_t size = sizeof(detail::RecordHeader) + (size_t(0) + ... + detail::Argument<Args>::size(args));
+    if(size > detail::ThreadBuffer::maxRecordSize) {
+      buffer.droppedCount.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+    const uint32_t recordSize = detail::alignRecordSize(size);
+    unsigned char* record = detail::beginRecord(buffer, recordSize);
+    if(!record) {
+      buffer.droppedCount.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+    const detail::RecordHeader header = { recordSize, &detail::formatRecord<Args...>, format };
+    memcpy(record, &header, sizeof(header));
+    [[maybe_unused]] unsigned char* cursor = record + sizeof(header);
+    (detail::Argument<Args>::encode(cursor, args), ...);
+    detail::endRecord(buffer, recordSize);
+  }
+}
@@ -0,0 +1,172 @@
+#define DAR_MODULE_NAME "Lz4"
+
+#include "Lz4.hpp"
+
+#include <cstring>
+#include <vector>
+
+#include "DarEngine.hpp"
+
+namespace De::Lz4
+{
+  namespace
+  {
+    constexpr size_t minMatchLength = 4;
+    // The block format requires the last 5 bytes to be literals and the last match to start 12 bytes before the end.
+    constexpr size_t lastLiteralCount = 5;
+    constexpr size_t matchFindLimit = 12;
+    constexpr size_t maxOffset = 65535;
+    constexpr int hashBits = 16;
+
+    uint32_t read32(const uint8_t* source) noexcept
+    {
+      uint32_t value;
+      memcpy(&value, source, sizeof(value));
+      return value;
+    }
+
+    uint32_t hash(uint32_t sequence) noexcept
+    {
+      return (sequence * 2654435761u) >> (32 - hashBits);
+    }
+
+    uint8_t* writeLength(uint8_t* output, size_t length) noexcept
+    {
+      for(; length >= 255; length -= 255) {
+        *output++ = 255;
+      }
+      *output++ = (uint8_t)length;
+      return output;
+    }
+
+    uint8_t* writeSequence(uint8_t* output, const uint8_t* literals, size_t literalCount, size_t offset, size_t matchLength) noexcept
+    {
+      uint8_t* token = output++;
+      *token = (uint8_t)((literalCount >= 15 ? 15 : literalCount) << 4);
+      if(literalCount >= 15) {
+        output = writeLength(output, literalCount - 15);
+      }
+      if(literalCount > 0) {
+        memcpy(output, literals, literalCount);
+        output += literalCount;
+      }
+      if(matchLength == 0) {
+        return output;
+      }
+      *output++ = (uint8_t)offset;
+      *output++ = (uint8_t)(offset >> 8);
+      const size_t matchLengthCode = matchLength - minMatchLength;
+      *token |= (uint8_t)(matchLengthCode >= 15 ? 15 : matchLengthCode);
+      if(matchLengthCode >= 15) {
+        output = writeLength(output, matchLengthCode - 15);
+      }
+      return output;
+    }
+
+    bool readLength(const uint8_t* source, size_t sourceSize, size_t* position, size_t* length) noexcept
+    {
+      uint8_t value;
+      do {
+        if(*position >= sourceSize) {
+          return false;
+        }
+        value = source[(*position)++];
+        *length += value;
+      } while(value == 255);
+      return true;
+    }
+  }
+
+  size_t compress(const uint8_t* source, size_t sourceSize, uint8_t* destination, size_t destinationCapacity) noexcept
+  {
+    assert(destinationCapacity >= getMaxCompressedSize(sourceSize));
+    (void)destinationCapacity;
+    uint8_t* output = destination;
+    size_t anchor = 0;
+    if(sourceSize > matchFindLimit) {
+      // Positions + 1, 0 marks an empty slot.
+      std::vector<uint32_t> table(size_t(1) << hashBits, 0);
+      const size_t matchLimit = sourceSize - lastLiteralCount;
+      size_t position = 0;
+      while(position + matchFindLimit <= sourceSize) {
+        const uint32_t sequence = read32(source + position);
+        uint32_t& slot = table[hash(sequence)];
+        const size_t candidate = slot;
+        slot = (uint32_t)(position + 1);
+        if(candidate == 0 || position - (candidate - 1) > maxOffset || read32(source + candidate - 1) != sequence) {
+          ++position;
+          continue;
+        }
+        size_t match = candidate - 1;
+        size_t length = minMatchLength;
+        while(position + length < matchLimit && source[match + length] == source[position + length]) {
+          ++length;
+        }
+        while(position > anchor && match > 0 && source[position - 1] == source[match - 1]) {
+          --position;
+          --match;
+          ++length;
+        }
+        output = writeSequence(output, source + anchor, position - anchor, position - match, length);
+        position += length;
+        anchor = position;
+      }
+    }
+    output = writeSequence(output, source + anchor, sourceSize - anchor, 0, 0);
+    return (size_t)(output - destination);
+  }
+
+  bool decompress(const uint8_t* source, size_t sourceSize, uint8_t* destination, size_t destinationSize) noexcept
+  {
+    size_t input = 0;
+    size_t output = 0;
+    while(input < sourceSize) {
+      const uint8_t token = source[input++];
+
+      size_t literalCount = token >> 4;
+      if(literalCount == 15 && !readLength(source, sourceSize, &input, &literalCount)) {
+        return false;
+      }
+      if(literalCount > sourceSize - input || literalCount > destinationSize - output) {
+        return false;
+      }
+      if(literalCount > 0) {
+        memcpy(destination + output, source + input, literalCount);
+        input += literalCount;
+        output += literalCount;
+      }
+      // The last sequence has only literals.
+      if(input == sourceSize) {
+        break;
+      }
+
+      if(sourceSize - input < 2) {
+        return false;
+      }
+      const size_t offset = size_t(source[input]) | (size_t(source[input + 1]) << 8);
+      input += 2;
+      if(offset == 0 || offset > output) {
+        return false;
+      }
+      size_t matchLength = token & 15;
+      if(matchLength == 15 && !readLength(source, sourceSize, &input, &matchLength)) {
+        return false;
+      }
+      matchLength += minMatchLength;
+      if(matchLength > destinationSize - output) {
+        return false;
+      }
+      const uint8_t* match = destination + output - offset;
+      if(offset >= matchLength) {
+        memcpy(destination + output, match, matchLength);
+      } else {
+        // Overlapping matches repeat the last offset bytes.
+        for(size_t i = 0; i < matchLength; ++i) {
+          destination[output + i] = match[i];
+        }
+      }
+      output += matchLength;
+    }
+    return output == destinationSize;
+  }
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * LZ4 block format, compatible with the reference implementation.
+ * The compressor is a single pass greedy matcher, it aims at fast decompression rather than ratio.
+ */
+namespace De::Lz4
+{
+  constexpr size_t getMaxCompressedSize(size_t sourceSize) noexcept
+  {
+    return sourceSize + sourceSize / 255 + 16;
+  }
+
+  /**
+   * @param destinationCapacity Has to be at least getMaxCompressedSize(sourceSize).
+   * @return Size of the compressed block.
+   */
+  size_t compress(const uint8_t* source, size_t sourceSize, uint8_t* destination, size_t destinationCapacity) noexcept;
+  /**
+   * @brief Validates the block, corrupted input never reads or writes out of bounds.
+   * @return false if the block is corrupted or doesn't decompress to exactly destinationSize bytes.
+   */
+  bool decompress(const uint8_t* source, size_t sourceSize, uint8_t* destination, size_t destinationSize) noexcept;
+}
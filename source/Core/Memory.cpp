@@ -0,0 +1,216 @@
+#define DAR_MODULE_NAME "Memory"
+
+#include "Memory.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+
+#include "DarEngine.hpp"
+
+namespace De
+{
+  static uintptr_t alignUp(uintptr_t value, size_t alignment) noexcept
+  {
+    return (value + (alignment - 1)) & ~uintptr_t(alignment - 1);
+  }
+
+  LinearArena::LinearArena(size_t capacity)
+    : memory(static_cast<unsigned char*>(::operator new(capacity)))
+    , capacity(capacity)
+  {}
+
+  LinearArena::~LinearArena()
+  {
+    ::operator delete(memory);
+  }
+
+  void* LinearArena::allocate(size_t size, size_t alignment)
+  {
+    const uintptr_t begin = uintptr_t(memory);
+    const uintptr_t allocationBegin = alignUp(begin + usedSize, alignment);
+    if(allocationBegin + size > begin + capacity) {
+      throw std::bad_alloc();
+    }
+    usedSize = allocationBegin + size - begin;
+    peakUsedSize = std::max(peakUsedSize, usedSize);
+    return reinterpret_cast<void*>(allocationBegin);
+  }
+
+  FixedSizePool::FixedSizePool(size_t blockSize, size_t blockCount, size_t alignment)
+    : blockSize(alignUp(std::max(blockSize, sizeof(FreeBlock)), std::max(alignment, alignof(FreeBlock))))
+    , blockCount(blockCount)
+    , alignment(std::max(alignment, alignof(FreeBlock)))
+    , freeCount(blockCount)
+    , firstFree(nullptr)
+  {
+    memory = static_cast<unsigned char*>(::operator new(this->blockSize * blockCount, std::align_val_t(this->alignment)));
+    // Blocks are handed out in address order.
+    for(size_t i = blockCount; i-- > 0;) {
+      FreeBlock* block = reinterpret_cast<FreeBlock*>(memory + i * this->blockSize);
+      block->next = firstFree;
+      firstFree = block;
+    }
+  }
+
+  FixedSizePool::~FixedSizePool()
+  {
+    ::operator delete(memory, std::align_val_t(alignment));
+  }
+
+  void* FixedSizePool::allocate() noexcept
+  {
+    if(!firstFree) {
+      return nullptr;
+    }
+    FreeBlock* block = firstFree;
+    firstFree = block->next;
+    --freeCount;
+    return block;
+  }
+
+  void FixedSizePool::deallocate(void* block) noexcept
+  {
+    if(!block) {
+      return;
+    }
+    assert(block >= memory && block < memory + blockSize * blockCount);
+    FreeBlock* freeBlock = static_cast<FreeBlock*>(block);
+    freeBlock->next = firstFree;
+    firstFree = freeBlock;
+    ++freeCount;
+  }
+
+  namespace AllocationTracking
+  {
+    namespace
+    {
+      struct AtomicCounts
+      {
+        std::atomic<uint64_t> allocationCount{ 0 };
+        std::atomic<uint64_t> byteCount{ 0 };
+      };
+
+      AtomicCounts counts[SubsystemCount];
+      thread_local Subsystem currentSubsystem = General;
+    }
+
+    const char* getSubsystemName(Subsystem subsystem) noexcept
+    {
+      switch(subsystem) {
+        case General: return "General";
+        case Platform: return "Platform";
+        case Game: return "Game";
+        case Renderer: return "Renderer";
+        case Audio: return "Audio";
+        default: return "Invalid";
+      }
+    }
+
+    Counts getCounts(Subsystem subsystem) noexcept
+    {
+      return {
+        counts[subsystem].allocationCount.load(std::memory_order_relaxed),
+        counts[subsystem].byteCount.load(std::memory_order_relaxed)
+      };
+    }
+
+    uint64_t getTotalAllocationCount() noexcept
+    {
+      uint64_t result = 0;
+      for(const AtomicCounts& subsystemCounts : counts) {
+        result += subsystemCounts.allocationCount.load(std::memory_order_relaxed);
+      }
+      return result;
+    }
+
+    Subsystem getCurrentSubsystem() noexcept
+    {
+      return currentSubsystem;
+    }
+
+    void setCurrentSubsystem(Subsystem subsystem) noexcept
+    {
+      currentSubsystem = subsystem;
+    }
+
+    static void count(size_t size) noexcept
+    {
+      AtomicCounts& subsystemCounts = counts[currentSubsystem];
+      subsystemCounts.allocationCount.fetch_add(1, std::memory_order_relaxed);
+      subsystemCounts.byteCount.fetch_add(size, std::memory_order_relaxed);
+    }
+  }
+}
+
+// Replacements of the global allocation functions, so that every allocation on the general heap is counted.
+// They are defined next to the allocators, which keeps this object file linked into every program that uses Core.
+
+static void* allocateCounted(size_t size)
+{
+  De::AllocationTracking::count(size);
+  void* result = std::malloc(size ? size : 1);
+  if(!result) {
+    throw std::bad_alloc();
+  }
+  return result;
+}
+
+static void* allocateCountedAligned(size_t size, std::align_val_t alignment)
+{
+  De::AllocationTracking::count(size);
+  size = size ? size : 1;
+#ifdef _WIN32
+  void* result = _aligned_malloc(size, size_t(alignment));
+#else
+  void* result = nullptr;
+  if(posix_memalign(&result, std::max(size_t(alignment), sizeof(void*)), size) != 0) {
+    result = nullptr;
+  }
+#endif
+  if(!result) {
+    throw std::bad_alloc();
+  }
+  return result;
+}
+
+static void freeAligned(void* memory) noexcept
+{
+#ifdef _WIN32
+  _aligned_free(memory);
+#else
+  std::free(memory);
+#endif
+}
+
+void* operator new(size_t size) { return allocateCounted(size); }
+void* operator new[](size_t size) { return allocateCounted(size); }
+void* operator new(size_t size, std::align_val_t alignment) { return allocateCountedAligned(size, alignment); }
+void* operator new[](size_t size, std::align_val_t alignment) { return allocateCountedAligned(size, alignment); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+  try {
+    return allocateCounted(size);
+  } catch(...) {
+    return nullptr;
+  }
+}
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+  try {
+    return allocateCounted(size);
+  } catch(...) {
+    return nullptr;
+  }
+}
+
+void operator delete(void* memory) noexcept { std::free(memory); }
+void operator delete[](void* memory) noexcept { std::free(memory); }
+void operator delete(void* memory, size_t) noexcept { std::free(memory); }
+void operator delete[](void* memory, size_t) noexcept { std::free(memory); }
+void operator delete(void* memory, const std::nothrow_t&) noexcept { std::free(memory); }
+void operator delete[](void* memory, const std::nothrow_t&) noexcept { std::free(memory); }
+void operator delete(void* memory, std::align_val_t) noexcept { freeAligned(memory); }
+void operator delete[](void* memory, std::align_val_t) noexcept { freeAligned(memory); }
+void operator delete(void* memory, size_t, std::align_val_t) noexcept { freeAligned(memory); }
+void operator delete[](void* memory, size_t, std::align_val_t) noexcept { freeAligned(memory); }
@@ -0,0 +1,194 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace De
+{
+  /**
+   * @brief Bump allocator over one fixed block. Memory is only given back all at once by reset.
+   * Destructors of the allocated objects are never called.
+   */
+  class LinearArena
+  {
+  public:
+    explicit LinearArena(size_t capacity);
+    LinearArena(const LinearArena& other) = delete;
+    LinearArena& operator=(const LinearArena& rhs) = delete;
+    ~LinearArena();
+
+    /**
+     * @param alignment Has to be a power of 2.
+     * @throws std::bad_alloc if the arena is full.
+     */
+    void* allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+    template<typename T>
+    T* allocateArray(size_t count)
+    {
+      static_assert(std::is_trivially_destructible_v<T>, "Arenas don't call destructors.");
+      T* result = static_cast<T*>(allocate(sizeof(T) * count, alignof(T)));
+      for(size_t i = 0; i < count; ++i) {
+        new(result + i) T();
+      }
+      return result;
+    }
+    void reset() noexcept { usedSize = 0; }
+
+    size_t getUsedSize() const noexcept { return usedSize; }
+    size_t getPeakUsedSize() const noexcept { return peakUsedSize; }
+    size_t getCapacity() const noexcept { return capacity; }
+
+  private:
+    unsigned char* memory;
+    size_t capacity;
+    size_t usedSize = 0;
+    size_t peakUsedSize = 0;
+  };
+
+  /**
+   * @brief Two linear arenas, one for the frame being built and one for the last frame,
+   * so that data of the last frame stays valid while the current frame is simulated and rendered.
+   */
+  class FrameArena
+  {
+  public:
+    explicit FrameArena(size_t capacityPerFrame)
+      : arenas{ LinearArena(capacityPerFrame), LinearArena(capacityPerFrame) }
+    {}
+
+    LinearArena& getCurrent() noexcept { return arenas[current]; }
+    const LinearArena& getPrevious() const noexcept { return arenas[current ^ 1]; }
+    /**
+     * @brief Frees everything allocated the frame before the one that ended.
+     */
+    void endFrame() noexcept
+    {
+      current ^= 1;
+      arenas[current].reset();
+    }
+
+  private:
+    LinearArena arenas[2];
+    int current = 0;
+  };
+
+  /**
+   * @brief Pool of equally sized blocks with an intrusive free list.
+   */
+  class FixedSizePool
+  {
+  public:
+    /**
+     * @param alignment Has to be a power of 2.
+     */
+    FixedSizePool(size_t blockSize, size_t blockCount, size_t alignment = alignof(std::max_align_t));
+    FixedSizePool(const FixedSizePool& other) = delete;
+    FixedSizePool& operator=(const FixedSizePool& rhs) = delete;
+    ~FixedSizePool();
+
+    /**
+     * @return nullptr if all blocks are in use.
+     */
+    void* allocate() noexcept;
+    void deallocate(void* block) noexcept;
+
+    size_t getBlockSize() const noexcept { return blockSize; }
+    size_t getFreeCount() const noexcept { return freeCount; }
+
+  private:
+    struct FreeBlock
+    {
+      FreeBlock* next;
+    };
+
+    unsigned char* memory;
+    size_t blockSize;
+    size_t blockCount;
+    size_t alignment;
+    size_t freeCount;
+    FreeBlock* firstFree;
+  };
+
+  template<typename T, size_t Count>
+  class ObjectPool
+  {
+  public:
+    ObjectPool()
+      : pool(sizeof(T), Count, alignof(T))
+    {}
+
+    /**
+     * @return nullptr if the pool is exhausted.
+     */
+    template<typename... Args>
+    T* create(Args&&... args)
+    {
+      void* block = pool.allocate();
+      return block ? new(block) T(std::forward<Args>(args)...) : nullptr;
+    }
+    void destroy(T* object) noexcept
+    {
+      if(object) {
+        object->~T();
+        pool.deallocate(object);
+      }
+    }
+
+    size_t getFreeCount() const noexcept { return pool.getFreeCount(); }
+
+  private:
+    FixedSizePool pool;
+  };
+
+  /**
+   * Counts allocations of the global operator new, attributed to the subsystem active on the allocating thread.
+   */
+  namespace AllocationTracking
+  {
+    enum Subsystem : uint8_t
+    {
+      General = 0,
+      Platform,
+      Game,
+      Renderer,
+      Audio,
+      SubsystemCount
+    };
+    struct Counts
+    {
+      uint64_t allocationCount;
+      uint64_t byteCount;
+    };
+
+    const char* getSubsystemName(Subsystem subsystem) noexcept;
+    Counts getCounts(Subsystem subsystem) noexcept;
+    uint64_t getTotalAllocationCount() noexcept;
+
+    Subsystem getCurrentSubsystem() noexcept;
+    void setCurrentSubsystem(Subsystem subsystem) noexcept;
+
+    class Scope
+    {
+    public:
+      explicit Scope(Subsystem subsystem) noexcept
+        : previous(getCurrentSubsystem())
+      {
+        setCurrentSubsystem(subsystem);
+      }
+      Scope(const Scope& other) = delete;
+      Scope& operator=(const Scope& rhs) = delete;
+      ~Scope() { setCurrentSubsystem(previous); }
+
+    private:
+      const Subsystem previous;
+    };
+  }
+}
+
+#define DAR_ALLOCATION_SCOPE_CONCATENATE_IMPL(a, b) a##b
+#define DAR_ALLOCATION_SCOPE_CONCATENATE(a, b) DAR_ALLOCATION_SCOPE_CONCATENATE_IMPL(a, b)
+#define DAR_ALLOCATION_SCOPE(subsystem) \
+  De::AllocationTracking::Scope DAR_ALLOCATION_SCOPE_CONCATENATE(allocationScope, __LINE__)(De::AllocationTracking::subsystem)
@@ -0,0 +1,241 @@
+#define DAR_MODULE_NAME "Profiler"
+
+#include "Profiler.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "DarEngine.hpp"
+
+#ifdef __linux__
+#include <pthread.h>
+#endif
+
+namespace De::Profiler
+{
+  namespace
+  {
+    struct Event
+    {
+      const char* name;
+      uint64_t begin;
+      uint64_t end;
+    };
+    /**
+     * @brief Written only by its thread. The writer of the trace reads the events below count.
+     */
+    struct ThreadEvents
+    {
+      static constexpr uint32_t capacity = 64 * 1024;
+
+      std::atomic<uint32_t> count{ 0 };
+      std::atomic<uint32_t> droppedCount{ 0 };
+      std::atomic<uint32_t> captureId{ 0 };
+      int threadIndex = 0;
+      const char* threadName = nullptr;
+      Event events[capacity];
+    };
+
+    std::mutex threadsMutex;
+    std::vector<std::unique_ptr<ThreadEvents>> threads;
+    uint32_t lastCaptureId = 0;
+
+    struct Clock
+    {
+      uint64_t timestamp;
+      std::chrono::steady_clock::time_point time;
+    };
+    Clock captureBegin;
+    Clock captureEnd;
+
+    std::mutex internedNamesMutex;
+    // Nodes never move, so the pointers to the strings stay valid.
+    std::set<std::string, std::less<>> internedNames;
+
+    Clock readClock() noexcept
+    {
+      return { readTimestamp(), std::chrono::steady_clock::now() };
+    }
+
+    ThreadEvents& getThreadEvents()
+    {
+      thread_local ThreadEvents* events = []() {
+        std::lock_guard<std::mutex> lock(threadsMutex);
+        threads.push_back(std::make_unique<ThreadEvents>());
+        threads.back()->threadIndex = (int)threads.size() - 1;
+        return threads.back().get();
+      }();
+      return *events;
+    }
+
+    void writeEscaped(FILE* file, const char* text)
+    {
+      for(; *text; ++text) {
+        if(*text == '"' || *text == '\\') {
+          fputc('\\', file);
+        }
+        fputc(*text, file);
+      }
+    }
+
+    /**
+     * @brief Sets the name ResourceSampler reads back.
+     */
+    void setSystemThreadName(const char* name) noexcept
+    {
+#ifdef _WIN32
+      // Thread descriptions exist since Windows 10 1607.
+      using SetThreadDescriptionFunction = HRESULT (WINAPI*)(HANDLE thread, PCWSTR description);
+      static const SetThreadDescriptionFunction setThreadDescription = []() {
+        const HMODULE kernel = GetModuleHandleA("kernel32.dll");
+        return kernel ? reinterpret_cast<SetThreadDescriptionFunction>(GetProcAddress(kernel, "SetThreadDescription")) : nullptr;
+      }();
+      wchar_t description[64];
+      if(setThreadDescription && MultiByteToWideChar(CP_UTF8, 0, name, -1, description, arrayCount(description)) > 0) {
+        setThreadDescription(GetCurrentThread(), description);
+      }
+#elif defined(__linux__)
+      // Linux limits names to 15 characters and fails on longer ones.
+      char shortName[16];
+      snprintf(shortName, sizeof(shortName), "%s", name);
+      pthread_setname_np(pthread_self(), shortName);
+#else
+      (void)name;
+#endif
+    }
+  }
+
+  namespace detail
+  {
+    std::atomic<uint32_t> captureId{ 0 };
+
+    void record(const char* name, uint64_t begin, uint64_t end, uint32_t captureId) noexcept
+    {
+      ThreadEvents& events = getThreadEvents();
+      // Only the owning thread resets its buffer, so a new capture never races with a scope still being written.
+      uint32_t count = events.count.load(std::memory_order_relaxed);
+      const uint32_t eventsCaptureId = events.captureId.load(std::memory_order_relaxed);
+      if(captureId < eventsCaptureId) {
+        // Scope started in an earlier capture.
+        return;
+      }
+      if(captureId != eventsCaptureId) {
+        events.captureId.store(captureId, std::memory_order_relaxed);
+        events.droppedCount.store(0, std::memory_order_relaxed);
+        count = 0;
+      }
+      if(count == ThreadEvents::capacity) {
+        events.droppedCount.fetch_add(1, std::memory_order_relaxed);
+        return;
+      }
+      events.events[count] = { name, begin, end };
+      events.count.store(count + 1, std::memory_order_release);
+    }
+  }
+
+  void startCapture()
+  {
+    std::lock_guard<std::mutex> lock(threadsMutex);
+    captureBegin = readClock();
+    ++lastCaptureId;
+    if(lastCaptureId == 0) {
+      lastCaptureId = 1;
+    }
+    detail::captureId.store(lastCaptureId, std::memory_order_relaxed);
+  }
+  void stopCapture()
+  {
+    std::lock_guard<std::mutex> lock(threadsMutex);
+    detail::captureId.store(0, std::memory_order_relaxed);
+    captureEnd = readClock();
+  }
+  bool isCapturing() noexcept
+  {
+    return detail::captureId.load(std::memory_order_relaxed) != 0;
+  }
+  void setThreadName(const char* name)
+  {
+    setSystemThreadName(name);
+    ThreadEvents& events = getThreadEvents();
+    std::lock_guard<std::mutex> lock(threadsMutex);
+    events.threadName = name;
+  }
+  const char* internName(const char* name)
+  {
+    std::lock_guard<std::mutex> lock(internedNamesMutex);
+    auto found = internedNames.find(name);
+    if(found == internedNames.end()) {
+      found = internedNames.emplace(name).first;
+    }
+    return found->c_str();
+  }
+
+  bool writeChromeTrace(const char* fileName)
+  {
+    std::lock_guard<std::mutex> lock(threadsMutex);
+    if(lastCaptureId == 0 || detail::captureId.load(std::memory_order_relaxed) != 0) {
+      logError("No finished capture to write into %s.", fileName);
+      return false;
+    }
+    FILE* file = nullptr;
+#ifdef _WIN32
+    if(fopen_s(&file, fileName, "w") != 0) {
+      file = nullptr;
+    }
+#else
+    file = fopen(fileName, "w");
+#endif
+    if(!file) {
+      logError("Failed to open %s for writing.", fileName);
+      return false;
+    }
+
+    // Measured over the whole capture, rdtsc has no fixed documented frequency.
+    const double captureMicroseconds = std::chrono::duration<double, std::micro>(captureEnd.time - captureBegin.time).count();
+    const uint64_t captureTicks = captureEnd.timestamp - captureBegin.timestamp;
+    const double microsecondsPerTick = captureTicks > 0 ? captureMicroseconds / (double)captureTicks : 0.;
+
+    fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n", file);
+    bool isFirstEvent = true;
+    uint32_t droppedCount = 0;
+    for(const std::unique_ptr<ThreadEvents>& thread : threads) {
+      if(thread->threadName) {
+        fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%d,\"args\":{\"name\":\"", isFirstEvent ? "" : ",\n", thread->threadIndex);
+        writeEscaped(file, thread->threadName);
+        fputs("\"}}", file);
+        isFirstEvent = false;
+      }
+      if(thread->captureId.load(std::memory_order_relaxed) != lastCaptureId) {
+        continue;
+      }
+      const uint32_t count = thread->count.load(std::memory_order_acquire);
+      droppedCount += thread->droppedCount.load(std::memory_order_relaxed);
+      for(uint32_t i = 0; i < count; ++i) {
+        const Event& event = thread->events[i];
+        // Events are written when their scope ends, so they come in order of their ends.
+        const double begin = (double)(int64_t)(event.begin - captureBegin.timestamp) * microsecondsPerTick;
+        const double duration = (double)(event.end - event.begin) * microsecondsPerTick;
+        fprintf(file, "%s{\"name\":\"", isFirstEvent ? "" : ",\n");
+        writeEscaped(file, event.name);
+        fprintf(file, "\",\"ph\":\"X\",\"pid\":0,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}", thread->threadIndex, begin, duration);
+        isFirstEvent = false;
+      }
+    }
+    fputs("\n]}\n", file);
+    const bool hasFailed = ferror(file) != 0;
+    fclose(file);
+    if(droppedCount > 0) {
+      logWarning("%u events didn't fit into the per thread buffers and are missing in %s.", droppedCount, fileName);
+    }
+    if(hasFailed) {
+      logError("Failed to write %s.", fileName);
+      return false;
+    }
+    return true;
+  }
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#if defined(_M_X64) || defined(_M_IX86)
+  #include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+  #include <x86intrin.h>
+#elif defined(__linux__)
+  #include <time.h>
+#else
+  #include <chrono>
+#endif
+
+/**
+ * CPU profiler.
+ * Scopes marked with DAR_PROFILE_SCOPE are recorded between startCapture and stopCapture
+ * into lock-free per-thread buffers and can be written out as a Chrome trace,
+ * which can be opened in chrome://tracing or https://ui.perfetto.dev.
+ * Outside of a capture a scope costs one atomic load.
+ */
+namespace De::Profiler
+{
+  /**
+   * @brief rdtsc on x86, otherwise a monotonic clock in nanoseconds.
+   * Ticks are converted to time with the frequency measured during a capture.
+   */
+  inline uint64_t readTimestamp() noexcept
+  {
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#elif defined(__linux__)
+    timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return uint64_t(time.tv_sec) * 1000000000ull + uint64_t(time.tv_nsec);
+#else
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+  }
+
+  /**
+   * @brief Discards the previous capture and starts recording scopes on all threads.
+   */
+  void startCapture();
+  void stopCapture();
+  bool isCapturing() noexcept;
+  /**
+   * @brief Writes the last capture in the Chrome trace event format. Call it between stopCapture and the next startCapture.
+   * @return false if the file couldn't be written.
+   */
+  bool writeChromeTrace(const char* fileName);
+  /**
+   * @brief Names the calling thread in traces and for the system, which shows it in debuggers and ResourceSampler.
+   * name has to outlive the profiler, e.g. a string literal. The system name is cut to 15 characters on Linux.
+   */
+  void setThreadName(const char* name);
+  /**
+   * @brief Copies name into storage that lives as long as the process, equal names give the same pointer.
+   * For scope names of code that may be unloaded before the trace is written, e.g. a reloadable library.
+   */
+  const char* internName(const char* name);
+
+  namespace detail
+  {
+    // 0 while not capturing, otherwise identifies the capture.
+    extern std::atomic<uint32_t> captureId;
+
+    void record(const char* name, uint64_t begin, uint64_t end, uint32_t captureId) noexcept;
+  }
+
+  class Scope
+  {
+  public:
+    explicit Scope(const char* name) noexcept
+      : name(name)
+      , captureId(detail::captureId.load(std::memory_order_relaxed))
+      , begin(captureId ? readTimestamp() : 0)
+    {}
+    Scope(const Scope& other) = delete;
+    Scope& operator=(const Scope& rhs) = delete;
+    ~Scope()
+    {
+      if(captureId) {
+        detail::record(name, begin, readTimestamp(), captureId);
+      }
+    }
+
+  private:
+    const char* name;
+    const uint32_t captureId;
+    const uint64_t begin;
+  };
+}
+
+#define DAR_PROFILE_CONCATENATE_IMPL(a, b) a##b
+#define DAR_PROFILE_CONCATENATE(a, b) DAR_PROFILE_CONCATENATE_IMPL(a, b)
+/**
+ * @param name Has to be a string literal, only the pointer is stored.
+ */
+#define DAR_PROFILE_SCOPE(name) De::Profiler::Scope DAR_PROFILE_CONCATENATE(profileScope, __LINE__)(name)
@@ -0,0 +1,97 @@
+#define DAR_MODULE_NAME "ReloadableLibrary"
+
+#include "ReloadableLibrary.hpp"
+
+#include <filesystem>
+#include <system_error>
+#include <utility>
+
+#include "DarEngine.hpp"
+#include "Exception.hpp"
+
+namespace fs = std::filesystem;
+
+namespace De
+{
+  namespace
+  {
+    // Copies alternate between two names, the loaded version stays in place while the next one is copied.
+    fs::path getCopyPath(const std::string& fileName, unsigned version)
+    {
+      const fs::path path(fileName);
+      fs::path copyPath(path);
+      copyPath.replace_filename(path.stem().string() + ".loaded" + std::to_string(version % 2) + path.extension().string());
+      return copyPath;
+    }
+  }
+
+  ReloadableLibrary::ReloadableLibrary(const char* fileName, LoadFunctions loadFunctions)
+    : fileName(fileName)
+    , loadFunctions(std::move(loadFunctions))
+  {
+    library = load(version);
+    this->loadFunctions(*library);
+  }
+
+  ReloadableLibrary::~ReloadableLibrary()
+  {
+    // Logged records point to format functions and strings of the library.
+    Log::flush();
+    library.reset();
+    std::error_code error;
+    fs::remove(getCopyPath(fileName, 0), error);
+    fs::remove(getCopyPath(fileName, 1), error);
+  }
+
+  std::unique_ptr<Library> ReloadableLibrary::load(unsigned loadVersion)
+  {
+    const fs::path copyPath = getCopyPath(fileName, loadVersion);
+    std::error_code error;
+    fs::copy_file(fileName, copyPath, fs::copy_options::overwrite_existing, error);
+    if(error) {
+      throw Exception("Failed to copy " + fileName + " to " + copyPath.string() + ": " + error.message());
+    }
+    return std::make_unique<Library>(copyPath.string().c_str());
+  }
+
+  bool ReloadableLibrary::watch(FileWatcher& fileWatcher)
+  {
+    const fs::path path(fileName);
+    const std::string directory = path.has_parent_path() ? path.parent_path().string() : std::string(".");
+    const std::string name = path.filename().string();
+    return fileWatcher.subscribe(directory.c_str(), name.c_str(), [this, name](const char* changedPath) {
+      if(fs::path(changedPath).filename() == name) {
+        hasChanged = true;
+      }
+    });
+  }
+
+  bool ReloadableLibrary::reloadIfChanged()
+  {
+    if(!hasChanged) {
+      return false;
+    }
+    hasChanged = false;
+
+    std::unique_ptr<Library> newLibrary;
+    try {
+      newLibrary = load(version + 1);
+      loadFunctions(*newLibrary);
+    } catch(const Exception& e) {
+      logError("Failed to reload %s, keeping version %u: %s", fileName.c_str(), version, e.what());
+      if(newLibrary) {
+        // loadFunctions may have replaced some of the pointers before it failed.
+        loadFunctions(*library);
+      }
+      return false;
+    }
+    // The logger formats records later on its own thread, with format functions and strings the old library
+    // logged them with. They have to be written before it is unloaded. Anything else the host keeps of the library,
+    // like profile scope names, has to be copied, see Profiler::internName.
+    Log::flush();
+    library = std::move(newLibrary);
+    ++version;
+    logInfo("Reloaded %s, version %u.", fileName.c_str(), version);
+    return true;
+  }
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "FileWatcher.hpp"
+#include "Library.hpp"
+
+namespace De
+{
+  /**
+   * @brief Shared library that is reloaded when the build replaces it, so that code can change while the process runs.
+   * A copy of the file is loaded, which keeps the original writable for the linker.
+   * The library must not keep state in its globals, they start over with every reload.
+   */
+  class ReloadableLibrary
+  {
+  public:
+    /**
+     * @brief Loads the function pointers the caller uses from library, called after every load.
+     * It throws De::Exception if a function is missing, as Library::loadFunction does.
+     */
+    using LoadFunctions = std::function<void(Library& library)>;
+
+    /**
+     * @throws De::Exception if the library can't be copied or loaded or if loadFunctions throws.
+     */
+    ReloadableLibrary(const char* fileName, LoadFunctions loadFunctions);
+    ReloadableLibrary(const ReloadableLibrary& other) = delete;
+    ReloadableLibrary& operator=(const ReloadableLibrary& rhs) = delete;
+    ~ReloadableLibrary();
+
+    /**
+     * @brief Marks the library for reloading whenever the file is written.
+     * @return false if the directory of the file can't be watched, the error is logged.
+     */
+    bool watch(FileWatcher& fileWatcher);
+    /**
+     * @brief Loads the new library if the file was written since the last call, call it where no function
+     * of the library is running. If the new library can't be loaded the old one stays, the error is logged.
+     * @return true if the library was replaced, loadFunctions was called with the new one then.
+     */
+    bool reloadIfChanged();
+    /**
+     * @brief Starts at 0 and increases with every reload.
+     */
+    unsigned getVersion() const noexcept { return version; }
+
+  private:
+    std::unique_ptr<Library> load(unsigned loadVersion);
+
+    std::string fileName;
+    LoadFunctions loadFunctions;
+    std::unique_ptr<Library> library;
+    unsigned version = 0;
+    bool hasChanged = false;
+  };
+}
@@ -0,0 +1,98 @@
+#define DAR_MODULE_NAME "RenderQueue"
+
+#include "RenderQueue.hpp"
+
+#include <algorithm>
+#include <utility>
+
+#include "DarEngine.hpp"
+#include "Profiler.hpp"
+
+namespace De
+{
+  void RenderQueue::reset(LinearArena& arena) noexcept
+  {
+    this->arena = &arena;
+    commands = nullptr;
+    commandCount = 0;
+    commandCapacity = 0;
+    meshUpdates = nullptr;
+    meshUpdateCount = 0;
+    meshUpdateCapacity = 0;
+  }
+
+  template<typename T>
+  void RenderQueue::append(LinearArena& arena, T*& items, int& count, int& capacity, const T& item)
+  {
+    if(count == capacity) {
+      // The old array stays in the arena until it's reset.
+      const int newCapacity = std::max(2 * capacity, 64);
+      T* newItems = static_cast<T*>(arena.allocate(sizeof(T) * newCapacity, alignof(T)));
+      std::copy_n(items, count, newItems);
+      items = newItems;
+      capacity = newCapacity;
+    }
+    items[count++] = item;
+  }
+
+  void RenderQueue::push(const RenderCommand& command)
+  {
+    assert(arena);
+    append(*arena, commands, commandCount, commandCapacity, command);
+  }
+
+  void RenderQueue::push(const MeshUpdate& update)
+  {
+    assert(arena);
+    append(*arena, meshUpdates, meshUpdateCount, meshUpdateCapacity, update);
+  }
+
+  void RenderQueue::sort()
+  {
+    DAR_PROFILE_SCOPE("RenderQueue::sort");
+    if(commandCount < 2) {
+      return;
+    }
+    constexpr int digitBits = 8;
+    constexpr int digitCount = 64 / digitBits;
+    constexpr int bucketCount = 1 << digitBits;
+
+    // One pass counts the digits of all positions.
+    uint32_t histograms[digitCount][bucketCount] = {};
+    for(int i = 0; i < commandCount; ++i) {
+      const uint64_t key = commands[i].sortKey;
+      for(int digit = 0; digit < digitCount; ++digit) {
+        ++histograms[digit][(key >> (digit * digitBits)) & (bucketCount - 1)];
+      }
+    }
+
+    RenderCommand* source = commands;
+    RenderCommand* destination = nullptr;
+    for(int digit = 0; digit < digitCount; ++digit) {
+      uint32_t* histogram = histograms[digit];
+      const int shift = digit * digitBits;
+      // Most keys share their upper digits, e.g. the layer, a digit that is the same in all keys changes nothing.
+      if(histogram[(source[0].sortKey >> shift) & (bucketCount - 1)] == uint32_t(commandCount)) {
+        continue;
+      }
+      if(!destination) {
+        destination = static_cast<RenderCommand*>(arena->allocate(sizeof(RenderCommand) * commandCount, alignof(RenderCommand)));
+      }
+      uint32_t offset = 0;
+      for(int bucket = 0; bucket < bucketCount; ++bucket) {
+        const uint32_t count = histogram[bucket];
+        histogram[bucket] = offset;
+        offset += count;
+      }
+      for(int i = 0; i < commandCount; ++i) {
+        destination[histogram[(source[i].sortKey >> shift) & (bucketCount - 1)]++] = source[i];
+      }
+      std::swap(source, destination);
+    }
+    // After an odd number of passes the sorted commands are in the scratch array, which has no room to grow.
+    if(source != commands) {
+      commands = source;
+      commandCapacity = commandCount;
+    }
+  }
+}
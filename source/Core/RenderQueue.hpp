@@ -0,0 +1,120 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#include "Memory.hpp"
+
+namespace De
+{
+  /**
+   * @brief Draw of a range of a mesh with a pipeline, independent of the graphics API.
+   * Pipelines and meshes are ids, the backend maps them to its own objects.
+   */
+  struct RenderCommand
+  {
+    uint64_t sortKey;
+    uint16_t pipeline;
+    uint16_t mesh;
+    // Indices if the mesh has any, otherwise vertices.
+    uint32_t firstElement;
+    uint32_t elementCount;
+    // Added to the indices.
+    int32_t baseVertex;
+    // Commands with the same constants share the pointer, the backend uploads them once.
+    const void* constants;
+    uint32_t constantsSize;
+  };
+
+  /**
+   * @brief Replaces a range of the vertices and indices of a mesh before the commands of the queue run.
+   * The backend knows the vertex format of the mesh.
+   */
+  struct MeshUpdate
+  {
+    uint16_t mesh;
+    uint32_t firstVertex;
+    uint32_t vertexCount;
+    const void* vertices;
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    const uint32_t* indices;
+  };
+
+  /**
+   * @brief Commands of one frame, recorded on one thread and consumed by a backend on another one.
+   * The commands, mesh updates and constants live in a linear arena, which has to keep them until the backend is done,
+   * e.g. the current arena of a FrameArena when the backend finishes a frame before the next one ends.
+   */
+  class RenderQueue
+  {
+  public:
+    // Keys order by layer, pipeline, mesh and depth, so that the backend changes its state as rarely as it can.
+    static constexpr int layerBits = 4;
+    static constexpr int pipelineBits = 12;
+    static constexpr int meshBits = 16;
+    static constexpr int depthBits = 32;
+
+    static constexpr uint64_t makeSortKey(unsigned layer, unsigned pipeline, unsigned mesh, uint32_t depth) noexcept
+    {
+      return uint64_t(layer) << (pipelineBits + meshBits + depthBits) |
+        uint64_t(pipeline & ((1u << pipelineBits) - 1)) << (meshBits + depthBits) |
+        uint64_t(mesh & ((1u << meshBits) - 1)) << depthBits |
+        depth;
+    }
+    /**
+     * @return Increases with depth, for depth >= 0. Negative depths count as 0.
+     */
+    static uint32_t toDepthKey(float depth) noexcept
+    {
+      // The bits of non-negative floats order like the floats.
+      depth = depth > 0.f ? depth : 0.f;
+      uint32_t key;
+      std::memcpy(&key, &depth, sizeof(key));
+      return key;
+    }
+
+    /**
+     * @brief Starts an empty queue in arena. The memory of the previous commands is given back when the arena is reset.
+     */
+    void reset(LinearArena& arena) noexcept;
+
+    void push(const RenderCommand& command);
+    void push(const MeshUpdate& update);
+    /**
+     * @return Copy of data in the arena of the queue, e.g. constants or vertices that have to outlive the recording.
+     */
+    template<typename T>
+    const T* copy(const T* data, size_t count)
+    {
+      static_assert(std::is_trivially_copyable_v<T>, "Copied bytewise.");
+      T* result = static_cast<T*>(arena->allocate(sizeof(T) * count, alignof(T)));
+      std::memcpy(result, data, sizeof(T) * count);
+      return result;
+    }
+    /**
+     * @brief Orders the commands by their keys with a least significant digit radix sort,
+     * commands with equal keys keep the order they were pushed in.
+     */
+    void sort();
+
+    const RenderCommand* begin() const noexcept { return commands; }
+    const RenderCommand* end() const noexcept { return commands + commandCount; }
+    int getCommandCount() const noexcept { return commandCount; }
+    const MeshUpdate* getMeshUpdates() const noexcept { return meshUpdates; }
+    int getMeshUpdateCount() const noexcept { return meshUpdateCount; }
+
+  private:
+    template<typename T>
+    static void append(LinearArena& arena, T*& items, int& count, int& capacity, const T& item);
+
+    LinearArena* arena = nullptr;
+    RenderCommand* commands = nullptr;
+    int commandCount = 0;
+    int commandCapacity = 0;
+    MeshUpdate* meshUpdates = nullptr;
+    int meshUpdateCount = 0;
+    int meshUpdateCapacity = 0;
+  };
+}
@@ -0,0 +1,471 @@
+#define DAR_MODULE_NAME "ResourceSampler"
+
+#include "ResourceSampler.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <thread>
+
+#include "Clock.hpp"
+#include "DarEngine.hpp"
+#include "Profiler.hpp"
+
+#ifdef _WIN32
+#include <Psapi.h>
+#include <TlHelp32.h>
+#elif defined(__linux__)
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace De
+{
+  namespace
+  {
+    // Cumulative since the start of the process or thread, snapshots hold the differences between two samples.
+    struct Counters
+    {
+      uint64_t cpuNanoseconds;
+      uint64_t pageFaults;
+      uint64_t majorPageFaults;
+      uint64_t voluntaryContextSwitches;
+      uint64_t involuntaryContextSwitches;
+    };
+
+    struct ThreadCounters
+    {
+      uint64_t id;
+      char name[16];
+      Counters counters;
+    };
+
+    struct Sample
+    {
+      int64_t time;
+      Counters process;
+      uint64_t residentBytes;
+      uint64_t virtualBytes;
+      int threadCount;
+      ThreadCounters threads[ResourceSnapshot::maxThreadCount];
+    };
+
+    void copyName(const char* begin, size_t length, char (&name)[16]) noexcept
+    {
+      length = std::min(length, sizeof(name) - 1);
+      std::memcpy(name, begin, length);
+      name[length] = '\0';
+    }
+
+#ifdef _WIN32
+    uint64_t toUint64(const FILETIME& time) noexcept
+    {
+      return (uint64_t(time.dwHighDateTime) << 32) | time.dwLowDateTime;
+    }
+
+    // Thread descriptions exist since Windows 10 1607.
+    using GetThreadDescriptionFunction = HRESULT (WINAPI*)(HANDLE thread, PWSTR* description);
+
+    GetThreadDescriptionFunction loadGetThreadDescription() noexcept
+    {
+      const HMODULE kernel = GetModuleHandleA("kernel32.dll");
+      return kernel ? reinterpret_cast<GetThreadDescriptionFunction>(GetProcAddress(kernel, "GetThreadDescription")) : nullptr;
+    }
+
+    void setLowPriority() noexcept
+    {
+      SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_LOWEST);
+    }
+
+    uint64_t readPhysicalMemoryBytes() noexcept
+    {
+      MEMORYSTATUSEX memoryStatus;
+      memoryStatus.dwLength = sizeof(memoryStatus);
+      return GlobalMemoryStatusEx(&memoryStatus) ? memoryStatus.ullTotalPhys : 0;
+    }
+
+    bool readThread(DWORD threadId, GetThreadDescriptionFunction getThreadDescription, ThreadCounters* thread) noexcept
+    {
+      const HANDLE handle = OpenThread(THREAD_QUERY_LIMITED_INFORMATION, false, threadId);
+      if(!handle) {
+        return false;
+      }
+      FILETIME creationTime, exitTime, kernelTime, userTime;
+      const bool hasTimes = GetThreadTimes(handle, &creationTime, &exitTime, &kernelTime, &userTime);
+      thread->id = threadId;
+      thread->name[0] = '\0';
+      PWSTR description = nullptr;
+      if(getThreadDescription && SUCCEEDED(getThreadDescription(handle, &description))) {
+        WideCharToMultiByte(CP_UTF8, 0, description, -1, thread->name, sizeof(thread->name), nullptr, nullptr);
+        thread->name[sizeof(thread->name) - 1] = '\0';
+        LocalFree(description);
+      }
+      CloseHandle(handle);
+      thread->counters = {};
+      thread->counters.cpuNanoseconds = (toUint64(kernelTime) + toUint64(userTime)) * 100;
+      return hasTimes;
+    }
+
+    bool readSample(Sample* sample) noexcept
+    {
+      static const GetThreadDescriptionFunction getThreadDescription = loadGetThreadDescription();
+      const HANDLE process = GetCurrentProcess();
+
+      FILETIME creationTime, exitTime, kernelTime, userTime;
+      PROCESS_MEMORY_COUNTERS_EX memoryCounters;
+      if(!GetProcessTimes(process, &creationTime, &exitTime, &kernelTime, &userTime) ||
+        !GetProcessMemoryInfo(process, reinterpret_cast<PROCESS_MEMORY_COUNTERS*>(&memoryCounters), sizeof(memoryCounters))) {
+        return false;
+      }
+      sample->process = {};
+      sample->process.cpuNanoseconds = (toUint64(kernelTime) + toUint64(userTime)) * 100;
+      sample->process.pageFaults = memoryCounters.PageFaultCount;
+      sample->residentBytes = memoryCounters.WorkingSetSize;
+      sample->virtualBytes = memoryCounters.PrivateUsage;
+
+      sample->threadCount = 0;
+      const HANDLE threads = CreateToolhelp32Snapshot(TH32CS_SNAPTHREAD, 0);
+      if(threads == INVALID_HANDLE_VALUE) {
+        return true;
+      }
+      const DWORD processId = GetCurrentProcessId();
+      THREADENTRY32 entry;
+      entry.dwSize = sizeof(entry);
+      for(BOOL found = Thread32First(threads, &entry); found && sample->threadCount < ResourceSnapshot::maxThreadCount; found = Thread32Next(threads, &entry)) {
+        if(entry.th32OwnerProcessID == processId &&
+          readThread(entry.th32ThreadID, getThreadDescription, &sample->threads[sample->threadCount])) {
+          ++sample->threadCount;
+        }
+      }
+      CloseHandle(threads);
+      return true;
+    }
+#elif defined(__linux__)
+    const uint64_t clockTicksPerSecond = uint64_t(sysconf(_SC_CLK_TCK));
+    const uint64_t pageSize = uint64_t(sysconf(_SC_PAGESIZE));
+
+    void setLowPriority() noexcept
+    {
+      // Linux applies the nice value to the calling thread only.
+      setpriority(PRIO_PROCESS, id_t(syscall(SYS_gettid)), 19);
+    }
+
+    uint64_t readPhysicalMemoryBytes() noexcept
+    {
+      return uint64_t(sysconf(_SC_PHYS_PAGES)) * pageSize;
+    }
+
+    /**
+     * @brief Reads a small file of /proc into buffer and null terminates it.
+     */
+    bool readProcFile(const char* path, char* buffer, size_t size) noexcept
+    {
+      const int file = open(path, O_RDONLY | O_CLOEXEC);
+      if(file < 0) {
+        return false;
+      }
+      const ssize_t length = read(file, buffer, size - 1);
+      close(file);
+      if(length <= 0) {
+        return false;
+      }
+      buffer[length] = '\0';
+      return true;
+    }
+
+    uint64_t readStatusValue(const char* status, const char* key) noexcept
+    {
+      const char* found = std::strstr(status, key);
+      return found ? std::strtoull(found + std::strlen(key), nullptr, 10) : 0;
+    }
+
+    bool readThread(uint64_t id, ThreadCounters* thread) noexcept
+    {
+      char path[64];
+      char buffer[2048];
+      std::snprintf(path, sizeof(path), "/proc/self/task/%llu/stat", (unsigned long long)id);
+      if(!readProcFile(path, buffer, sizeof(buffer))) {
+        return false;
+      }
+      // The name is in parentheses and may contain spaces and parentheses itself.
+      const char* nameBegin = std::strchr(buffer, '(');
+      const char* nameEnd = std::strrchr(buffer, ')');
+      if(!nameBegin || !nameEnd || nameEnd < nameBegin) {
+        return false;
+      }
+      unsigned long long minorFaults, majorFaults, userTicks, systemTicks;
+      if(std::sscanf(nameEnd + 1, " %*c %*d %*d %*d %*d %*d %*u %llu %*u %llu %*u %llu %llu",
+        &minorFaults, &majorFaults, &userTicks, &systemTicks) != 4) {
+        return false;
+      }
+      thread->id = id;
+      copyName(nameBegin + 1, size_t(nameEnd - nameBegin - 1), thread->name);
+      thread->counters.cpuNanoseconds = (userTicks + systemTicks) * 1000000000ull / clockTicksPerSecond;
+      thread->counters.pageFaults = minorFaults + majorFaults;
+      thread->counters.majorPageFaults = majorFaults;
+
+      std::snprintf(path, sizeof(path), "/proc/self/task/%llu/status", (unsigned long long)id);
+      if(readProcFile(path, buffer, sizeof(buffer))) {
+        thread->counters.voluntaryContextSwitches = readStatusValue(buffer, "\nvoluntary_ctxt_switches:");
+        thread->counters.involuntaryContextSwitches = readStatusValue(buffer, "\nnonvoluntary_ctxt_switches:");
+      } else {
+        thread->counters.voluntaryContextSwitches = 0;
+        thread->counters.involuntaryContextSwitches = 0;
+      }
+      return true;
+    }
+
+    bool readSample(Sample* sample) noexcept
+    {
+      rusage usage;
+      if(getrusage(RUSAGE_SELF, &usage) != 0) {
+        return false;
+      }
+      const uint64_t cpuMicroseconds = uint64_t(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000ull +
+        uint64_t(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec);
+      sample->process.cpuNanoseconds = cpuMicroseconds * 1000;
+      sample->process.pageFaults = uint64_t(usage.ru_minflt + usage.ru_majflt);
+      sample->process.majorPageFaults = uint64_t(usage.ru_majflt);
+      sample->process.voluntaryContextSwitches = uint64_t(usage.ru_nvcsw);
+      sample->process.involuntaryContextSwitches = uint64_t(usage.ru_nivcsw);
+
+      char buffer[256];
+      unsigned long long sizePages = 0, residentPages = 0;
+      if(readProcFile("/proc/self/statm", buffer, sizeof(buffer))) {
+        std::sscanf(buffer, "%llu %llu", &sizePages, &residentPages);
+      }
+      sample->residentBytes = residentPages * pageSize;
+      sample->virtualBytes = sizePages * pageSize;
+
+      sample->threadCount = 0;
+      DIR* tasks = opendir("/proc/self/task");
+      if(!tasks) {
+        return true;
+      }
+      while(const dirent* entry = readdir(tasks)) {
+        if(sample->threadCount == ResourceSnapshot::maxThreadCount) {
+          break;
+        }
+        if(entry->d_name[0] < '0' || entry->d_name[0] > '9') {
+          continue;
+        }
+        if(readThread(std::strtoull(entry->d_name, nullptr, 10), &sample->threads[sample->threadCount])) {
+          ++sample->threadCount;
+        }
+      }
+      closedir(tasks);
+      return true;
+    }
+#else
+    void setLowPriority() noexcept {}
+
+    uint64_t readPhysicalMemoryBytes() noexcept
+    {
+      return 0;
+    }
+
+    bool readSample(Sample* sample) noexcept
+    {
+      (void)sample;
+      return false;
+    }
+#endif
+
+    uint32_t toCount32(uint64_t count) noexcept
+    {
+      return uint32_t(std::min<uint64_t>(count, UINT32_MAX));
+    }
+
+    float toCpuPercent(uint64_t cpuNanoseconds, int64_t nanoseconds) noexcept
+    {
+      return nanoseconds > 0 ? float(100. * double(cpuNanoseconds) / double(nanoseconds)) : 0.f;
+    }
+  }
+
+  class ResourceSampler::Impl
+  {
+  public:
+    Impl(double samplePeriod, const char* summaryFileName);
+    ~Impl();
+
+    const ResourceSnapshot& getLatestSnapshot() noexcept;
+
+  private:
+    static constexpr int freshBit = 4;
+
+    void run();
+    void fillSnapshot(const Sample& previous, const Sample& current, ResourceSnapshot* snapshot) const noexcept;
+    void writeSummary(const ResourceSnapshot& snapshot);
+
+    const int64_t samplePeriod;
+    const int processorCount = std::max(int(std::thread::hardware_concurrency()), 1);
+    const uint64_t physicalMemoryBytes = readPhysicalMemoryBytes();
+    int64_t startTime;
+    FILE* summaryFile = nullptr;
+
+    // Triple buffer, the sampling thread fills one snapshot while the reader holds another
+    // and they exchange through the third. freshBit marks a snapshot the reader hasn't taken yet.
+    ResourceSnapshot snapshots[3] = {};
+    int writeIndex = 0;
+    int readIndex = 1;
+    std::atomic<int> middleIndex{ 2 };
+
+    Sample samples[2] = {};
+
+    std::mutex stopMutex;
+    std::condition_variable stopCondition;
+    bool isStopping = false;
+    std::thread thread;
+  };
+
+  ResourceSampler::Impl::Impl(double samplePeriod, const char* summaryFileName)
+    : samplePeriod(std::max(Clock::fromSeconds(samplePeriod), int64_t(1000000)))
+    , startTime(Clock::now())
+  {
+    if(summaryFileName) {
+#ifdef _WIN32
+      if(fopen_s(&summaryFile, summaryFileName, "w") != 0) {
+        summaryFile = nullptr;
+      }
+#else
+      summaryFile = fopen(summaryFileName, "w");
+#endif
+      if(summaryFile) {
+        fputs("time_s,thread,id,cpu_percent,page_faults,major_page_faults,voluntary_switches,involuntary_switches,resident_mb\n", summaryFile);
+      } else {
+        logError("Failed to open resource usage summary file %s.", summaryFileName);
+      }
+    }
+    thread = std::thread(&Impl::run, this);
+  }
+
+  ResourceSampler::Impl::~Impl()
+  {
+    {
+      std::lock_guard lock(stopMutex);
+      isStopping = true;
+    }
+    stopCondition.notify_one();
+    thread.join();
+    if(summaryFile) {
+      fclose(summaryFile);
+    }
+  }
+
+  const ResourceSnapshot& ResourceSampler::Impl::getLatestSnapshot() noexcept
+  {
+    if(middleIndex.load(std::memory_order_relaxed) & freshBit) {
+      readIndex = middleIndex.exchange(readIndex, std::memory_order_acq_rel) & ~freshBit;
+    }
+    return snapshots[readIndex];
+  }
+
+  void ResourceSampler::Impl::run()
+  {
+    Profiler::setThreadName("ResourceSampler");
+    setLowPriority();
+
+    int current = 0;
+    samples[current].time = Clock::now();
+    if(!readSample(&samples[current])) {
+      logWarning("Resource usage can't be sampled on this system.");
+      return;
+    }
+    std::unique_lock lock(stopMutex);
+    while(!stopCondition.wait_for(lock, std::chrono::nanoseconds(samplePeriod), [this]() { return isStopping; })) {
+      const int previous = current;
+      current ^= 1;
+      samples[current].time = Clock::now();
+      if(!readSample(&samples[current])) {
+        current = previous;
+        continue;
+      }
+      ResourceSnapshot& snapshot = snapshots[writeIndex];
+      fillSnapshot(samples[previous], samples[current], &snapshot);
+      if(summaryFile) {
+        writeSummary(snapshot);
+      }
+      writeIndex = middleIndex.exchange(writeIndex | freshBit, std::memory_order_acq_rel) & ~freshBit;
+    }
+  }
+
+  void ResourceSampler::Impl::fillSnapshot(const Sample& previous, const Sample& current, ResourceSnapshot* snapshot) const noexcept
+  {
+    const int64_t sampledNanoseconds = current.time - previous.time;
+    snapshot->time = Clock::toSeconds(current.time - startTime);
+    snapshot->sampledSeconds = Clock::toSeconds(sampledNanoseconds);
+    snapshot->cpuPercent = toCpuPercent(current.process.cpuNanoseconds - previous.process.cpuNanoseconds, sampledNanoseconds) / processorCount;
+    snapshot->residentBytes = current.residentBytes;
+    snapshot->virtualBytes = current.virtualBytes;
+    snapshot->physicalMemoryBytes = physicalMemoryBytes;
+    snapshot->pageFaults = current.process.pageFaults - previous.process.pageFaults;
+    snapshot->majorPageFaults = current.process.majorPageFaults - previous.process.majorPageFaults;
+    snapshot->voluntaryContextSwitches = current.process.voluntaryContextSwitches - previous.process.voluntaryContextSwitches;
+    snapshot->involuntaryContextSwitches = current.process.involuntaryContextSwitches - previous.process.involuntaryContextSwitches;
+
+    snapshot->threadCount = current.threadCount;
+    for(int i = 0; i < current.threadCount; ++i) {
+      const ThreadCounters& thread = current.threads[i];
+      // A thread started since the previous sample counts from its start.
+      Counters last = {};
+      for(int j = 0; j < previous.threadCount; ++j) {
+        if(previous.threads[j].id == thread.id) {
+          last = previous.threads[j].counters;
+          break;
+        }
+      }
+      ResourceSnapshot::Thread& threadSnapshot = snapshot->threads[i];
+      threadSnapshot.id = thread.id;
+      std::memcpy(threadSnapshot.name, thread.name, sizeof(threadSnapshot.name));
+      threadSnapshot.cpuPercent = toCpuPercent(thread.counters.cpuNanoseconds - last.cpuNanoseconds, sampledNanoseconds);
+      threadSnapshot.pageFaults = toCount32(thread.counters.pageFaults - last.pageFaults);
+      threadSnapshot.majorPageFaults = toCount32(thread.counters.majorPageFaults - last.majorPageFaults);
+      threadSnapshot.voluntaryContextSwitches = toCount32(thread.counters.voluntaryContextSwitches - last.voluntaryContextSwitches);
+      threadSnapshot.involuntaryContextSwitches = toCount32(thread.counters.involuntaryContextSwitches - last.involuntaryContextSwitches);
+    }
+  }
+
+  void ResourceSampler::Impl::writeSummary(const ResourceSnapshot& snapshot)
+  {
+    fprintf(summaryFile, "%.3f,process,,%.1f,%llu,%llu,%llu,%llu,%.1f\n",
+      snapshot.time,
+      snapshot.cpuPercent,
+      (unsigned long long)snapshot.pageFaults,
+      (unsigned long long)snapshot.majorPageFaults,
+      (unsigned long long)snapshot.voluntaryContextSwitches,
+      (unsigned long long)snapshot.involuntaryContextSwitches,
+      double(snapshot.residentBytes) / (1 << 20)
+    );
+    for(int i = 0; i < snapshot.threadCount; ++i) {
+      const ResourceSnapshot::Thread& thread = snapshot.threads[i];
+      fprintf(summaryFile, "%.3f,%s,%llu,%.1f,%u,%u,%u,%u,\n",
+        snapshot.time,
+        thread.name,
+        (unsigned long long)thread.id,
+        thread.cpuPercent,
+        thread.pageFaults,
+        thread.majorPageFaults,
+        thread.voluntaryContextSwitches,
+        thread.involuntaryContextSwitches
+      );
+    }
+    fflush(summaryFile);
+  }
+
+  ResourceSampler::ResourceSampler(double samplePeriod, const char* summaryFileName)
+    : pImpl(std::make_unique<Impl>(samplePeriod, summaryFileName))
+  {}
+
+  ResourceSampler::~ResourceSampler() = default;
+
+  const ResourceSnapshot& ResourceSampler::getLatestSnapshot() noexcept
+  {
+    return pImpl->getLatestSnapshot();
+  }
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+
+namespace De
+{
+  /**
+   * @brief Resource usage of the process. Counts are those since the previous sample, 0 where the system doesn't
+   * report them: Windows counts page faults without telling major ones apart and has no context switch counts.
+   */
+  struct ResourceSnapshot
+  {
+    static constexpr int maxThreadCount = 32;
+
+    struct Thread
+    {
+      uint64_t id;
+      char name[16];
+      // Of one processor.
+      float cpuPercent;
+      uint32_t pageFaults;
+      uint32_t majorPageFaults;
+      uint32_t voluntaryContextSwitches;
+      uint32_t involuntaryContextSwitches;
+    };
+
+    // Seconds since the sampler started, 0 until the first sample.
+    double time;
+    double sampledSeconds;
+    // Of all processors.
+    float cpuPercent;
+    uint64_t residentBytes;
+    // Committed private memory on Windows, the mapped address space on Linux.
+    uint64_t virtualBytes;
+    uint64_t physicalMemoryBytes;
+    uint64_t pageFaults;
+    uint64_t majorPageFaults;
+    uint64_t voluntaryContextSwitches;
+    uint64_t involuntaryContextSwitches;
+    // Threads beyond maxThreadCount are left out.
+    int threadCount;
+    Thread threads[maxThreadCount];
+  };
+
+  /**
+   * @brief Samples the resource usage of the process on a low priority background thread, /proc/self and getrusage
+   * on Linux and the process, memory and thread APIs on Windows. Snapshots are handed over through a triple buffer,
+   * so neither side ever waits for the other.
+   */
+  class ResourceSampler
+  {
+  public:
+    /**
+     * @param samplePeriod Seconds between samples.
+     * @param summaryFileName CSV file the sampling thread appends every sample to, nullptr for none.
+     */
+    explicit ResourceSampler(double samplePeriod = 1., const char* summaryFileName = nullptr);
+    ResourceSampler(const ResourceSampler& other) = delete;
+    ResourceSampler& operator=(const ResourceSampler& rhs) = delete;
+    ~ResourceSampler();
+
+    /**
+     * @brief Call from one thread only, the snapshot stays valid until the next call.
+     */
+    const ResourceSnapshot& getLatestSnapshot() noexcept;
+
+  private:
+    class Impl;
+    std::unique_ptr<Impl> pImpl;
+  };
+}
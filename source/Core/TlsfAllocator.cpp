@@ -0,0 +1,301 @@
+#define DAR_MODULE_NAME "TlsfAllocator"
+
+#include "TlsfAllocator.hpp"
+
+#include <algorithm>
+#include <iterator>
+
+#ifdef _MSC_VER
+  #include <intrin.h>
+#endif
+
+#include "DarEngine.hpp"
+
+namespace De
+{
+  namespace
+  {
+    constexpr uint64_t noPlacement = ~uint64_t(0);
+
+    // Index of the highest set bit, value has to be non-zero.
+    int findLastSet(uint64_t value) noexcept
+    {
+#ifdef _MSC_VER
+      unsigned long index;
+      _BitScanReverse64(&index, value);
+      return int(index);
+#else
+      return 63 - __builtin_clzll(value);
+#endif
+    }
+
+    // Index of the lowest set bit, value has to be non-zero.
+    int findFirstSet(uint64_t value) noexcept
+    {
+#ifdef _MSC_VER
+      unsigned long index;
+      _BitScanForward64(&index, value);
+      return int(index);
+#else
+      return __builtin_ctzll(value);
+#endif
+    }
+
+    uint64_t alignUp(uint64_t value, uint64_t alignment) noexcept
+    {
+      return (value + (alignment - 1)) & ~(alignment - 1);
+    }
+  }
+
+  TlsfAllocator::TlsfAllocator(uint64_t size, uint64_t granularity)
+    : size(size)
+    , granularity(granularity)
+  {
+    assert(size > 0 && granularity > 0 && (granularity & (granularity - 1)) == 0);
+    for(Handle (&secondLevel)[secondLevelCount] : freeLists) {
+      std::fill(std::begin(secondLevel), std::end(secondLevel), invalidHandle);
+    }
+    insertFree(createRange(0, size, invalidHandle, invalidHandle));
+  }
+
+  void TlsfAllocator::mapSize(uint64_t size, int* firstLevel, int* secondLevel) noexcept
+  {
+    // Sizes below secondLevelCount share the first list of the first level, one list per size.
+    if(size < secondLevelCount) {
+      *firstLevel = 0;
+      *secondLevel = int(size);
+      return;
+    }
+    const int lastSet = findLastSet(size);
+    *firstLevel = lastSet - secondLevelLog2 + 1;
+    *secondLevel = int(size >> (lastSet - secondLevelLog2)) - secondLevelCount;
+  }
+
+  TlsfAllocator::Handle TlsfAllocator::findFreeRange(uint64_t size) const noexcept
+  {
+    // Rounded up to the next size class, so that every range of the list that is found fits.
+    if(size >= secondLevelCount) {
+      size += (uint64_t(1) << (findLastSet(size) - secondLevelLog2)) - 1;
+    }
+    int firstLevel;
+    int secondLevel;
+    mapSize(size, &firstLevel, &secondLevel);
+    if(firstLevel >= firstLevelCount) {
+      return invalidHandle;
+    }
+
+    uint32_t secondLevelBitmap = secondLevelBitmaps[firstLevel] & (~0u << secondLevel);
+    if(!secondLevelBitmap) {
+      const uint64_t firstLevelBitmap = firstLevel + 1 < 64 ? this->firstLevelBitmap & (~uint64_t(0) << (firstLevel + 1)) : 0;
+      if(!firstLevelBitmap) {
+        return invalidHandle;
+      }
+      firstLevel = findFirstSet(firstLevelBitmap);
+      secondLevelBitmap = secondLevelBitmaps[firstLevel];
+    }
+    return freeLists[firstLevel][findFirstSet(secondLevelBitmap)];
+  }
+
+  uint64_t TlsfAllocator::place(const Range& range, uint64_t size, uint64_t alignment, uint8_t kind) const noexcept
+  {
+    // The neighbors of a free range are in use, free neighbors were merged.
+    uint64_t offset = alignUp(range.offset, alignment);
+    if(granularity > 1 && range.previous != invalidHandle) {
+      const Range& previous = ranges[range.previous];
+      if(previous.kind != kind && (previous.offset + previous.size - 1) / granularity == offset / granularity) {
+        offset = alignUp(offset, granularity);
+      }
+    }
+    const uint64_t end = range.offset + range.size;
+    if(offset > end || end - offset < size) {
+      return noPlacement;
+    }
+    if(granularity > 1 && range.next != invalidHandle) {
+      const Range& next = ranges[range.next];
+      if(next.kind != kind && (offset + size - 1) / granularity == next.offset / granularity) {
+        return noPlacement;
+      }
+    }
+    return offset;
+  }
+
+  bool TlsfAllocator::allocate(uint64_t size, uint64_t alignment, uint8_t kind, Allocation* result)
+  {
+    assert(alignment > 0 && (alignment & (alignment - 1)) == 0);
+    if(size == 0 || size > this->size) {
+      return false;
+    }
+
+    // The first range of the size class usually fits, padding for the alignment would waste the larger ranges.
+    Handle handle = findFreeRange(size);
+    uint64_t offset = handle != invalidHandle ? place(ranges[handle], size, alignment, kind) : noPlacement;
+    if(offset == noPlacement) {
+      // Any range of the padded size fits, whatever its offset and its neighbors.
+      const uint64_t padding = granularity > 1 ?
+        std::max(alignment, granularity) - 1 + granularity - 1 :
+        alignment - 1;
+      if(size > this->size - padding) {
+        return false;
+      }
+      handle = findFreeRange(size + padding);
+      if(handle == invalidHandle) {
+        return false;
+      }
+      offset = place(ranges[handle], size, alignment, kind);
+      assert(offset != noPlacement);
+    }
+
+    removeFree(handle);
+    const uint64_t rangeOffset = ranges[handle].offset;
+    const uint64_t rangeEnd = rangeOffset + ranges[handle].size;
+    if(offset > rangeOffset) {
+      const Handle gap = createRange(rangeOffset, offset - rangeOffset, ranges[handle].previous, handle);
+      if(ranges[gap].previous != invalidHandle) {
+        ranges[ranges[gap].previous].next = gap;
+      }
+      ranges[handle].previous = gap;
+      insertFree(gap);
+    }
+    if(offset + size < rangeEnd) {
+      const Handle gap = createRange(offset + size, rangeEnd - offset - size, handle, ranges[handle].next);
+      if(ranges[gap].next != invalidHandle) {
+        ranges[ranges[gap].next].previous = gap;
+      }
+      ranges[handle].next = gap;
+      insertFree(gap);
+    }
+    Range& range = ranges[handle];
+    range.offset = offset;
+    range.size = size;
+    range.isFree = false;
+    range.kind = kind;
+
+    usedSize += size;
+    ++allocationCount;
+    result->offset = offset;
+    result->handle = handle;
+    return true;
+  }
+
+  void TlsfAllocator::deallocate(Handle handle) noexcept
+  {
+    assert(handle < ranges.size() && !ranges[handle].isFree);
+    usedSize -= ranges[handle].size;
+    --allocationCount;
+
+    const Handle previous = ranges[handle].previous;
+    if(previous != invalidHandle && ranges[previous].isFree) {
+      removeFree(previous);
+      ranges[previous].size += ranges[handle].size;
+      ranges[previous].next = ranges[handle].next;
+      if(ranges[previous].next != invalidHandle) {
+        ranges[ranges[previous].next].previous = previous;
+      }
+      destroyRange(handle);
+      handle = previous;
+    }
+    const Handle next = ranges[handle].next;
+    if(next != invalidHandle && ranges[next].isFree) {
+      removeFree(next);
+      ranges[handle].size += ranges[next].size;
+      ranges[handle].next = ranges[next].next;
+      if(ranges[handle].next != invalidHandle) {
+        ranges[ranges[handle].next].previous = handle;
+      }
+      destroyRange(next);
+    }
+    insertFree(handle);
+  }
+
+  TlsfAllocator::Statistics TlsfAllocator::getStatistics() const noexcept
+  {
+    Statistics statistics;
+    statistics.usedSize = usedSize;
+    statistics.freeSize = size - usedSize;
+    statistics.allocationCount = allocationCount;
+    statistics.freeRangeCount = freeRangeCount;
+    statistics.largestFreeSize = 0;
+    // The largest range is in the highest list, which holds ranges of similar sizes.
+    if(firstLevelBitmap) {
+      const int firstLevel = findLastSet(firstLevelBitmap);
+      const int secondLevel = findLastSet(secondLevelBitmaps[firstLevel]);
+      for(Handle handle = freeLists[firstLevel][secondLevel]; handle != invalidHandle; handle = ranges[handle].nextFree) {
+        statistics.largestFreeSize = std::max(statistics.largestFreeSize, ranges[handle].size);
+      }
+    }
+    return statistics;
+  }
+
+  TlsfAllocator::Handle TlsfAllocator::createRange(uint64_t offset, uint64_t size, Handle previous, Handle next)
+  {
+    Handle handle;
+    if(!unusedRanges.empty()) {
+      handle = unusedRanges.back();
+      unusedRanges.pop_back();
+    } else {
+      handle = Handle(ranges.size());
+      ranges.emplace_back();
+      unusedRanges.reserve(ranges.capacity());
+    }
+    Range& range = ranges[handle];
+    range.offset = offset;
+    range.size = size;
+    range.previous = previous;
+    range.next = next;
+    range.previousFree = invalidHandle;
+    range.nextFree = invalidHandle;
+    range.isFree = false;
+    range.kind = 0;
+    return handle;
+  }
+
+  void TlsfAllocator::destroyRange(Handle handle) noexcept
+  {
+    // Reserved as ranges grew, so that deallocate can't throw.
+    unusedRanges.push_back(handle);
+  }
+
+  void TlsfAllocator::insertFree(Handle handle) noexcept
+  {
+    Range& range = ranges[handle];
+    int firstLevel;
+    int secondLevel;
+    mapSize(range.size, &firstLevel, &secondLevel);
+    range.isFree = true;
+    range.previousFree = invalidHandle;
+    range.nextFree = freeLists[firstLevel][secondLevel];
+    if(range.nextFree != invalidHandle) {
+      ranges[range.nextFree].previousFree = handle;
+    }
+    freeLists[firstLevel][secondLevel] = handle;
+    firstLevelBitmap |= uint64_t(1) << firstLevel;
+    secondLevelBitmaps[firstLevel] |= 1u << secondLevel;
+    ++freeRangeCount;
+  }
+
+  void TlsfAllocator::removeFree(Handle handle) noexcept
+  {
+    Range& range = ranges[handle];
+    int firstLevel;
+    int secondLevel;
+    mapSize(range.size, &firstLevel, &secondLevel);
+    if(range.previousFree != invalidHandle) {
+      ranges[range.previousFree].nextFree = range.nextFree;
+    } else {
+      freeLists[firstLevel][secondLevel] = range.nextFree;
+      if(range.nextFree == invalidHandle) {
+        secondLevelBitmaps[firstLevel] &= ~(1u << secondLevel);
+        if(!secondLevelBitmaps[firstLevel]) {
+          firstLevelBitmap &= ~(uint64_t(1) << firstLevel);
+        }
+      }
+    }
+    if(range.nextFree != invalidHandle) {
+      ranges[range.nextFree].previousFree = range.previousFree;
+    }
+    range.isFree = false;
+    range.previousFree = invalidHandle;
+    range.nextFree = invalidHandle;
+    --freeRangeCount;
+  }
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace De
+{
+  /**
+   * @brief Two-level segregated fit allocator of the ranges of a block it never touches, e.g. a block of device memory.
+   * Free ranges are kept in lists by size class, so allocate and deallocate take constant time.
+   * Free neighbors are merged on deallocate.
+   */
+  class TlsfAllocator
+  {
+  public:
+    using Handle = uint32_t;
+    static constexpr Handle invalidHandle = ~Handle(0);
+
+    struct Allocation
+    {
+      uint64_t offset;
+      // Passed to deallocate.
+      Handle handle;
+    };
+    struct Statistics
+    {
+      uint64_t usedSize;
+      uint64_t freeSize;
+      // Free size that can't be allocated at once is lost to fragmentation.
+      uint64_t largestFreeSize;
+      int allocationCount;
+      int freeRangeCount;
+    };
+
+    /**
+     * @param granularity Ranges of different kinds never share a page of this size, e.g. the bufferImageGranularity
+     * between linear and optimal resources in Vulkan. Has to be a power of 2, 1 if kinds may share pages.
+     */
+    explicit TlsfAllocator(uint64_t size, uint64_t granularity = 1);
+
+    /**
+     * @param alignment Has to be a power of 2.
+     * @param kind Compared between neighbors that are closer than the granularity.
+     * @return false if no free range fits.
+     */
+    bool allocate(uint64_t size, uint64_t alignment, uint8_t kind, Allocation* result);
+    void deallocate(Handle handle) noexcept;
+
+    uint64_t getSize() const noexcept { return size; }
+    bool isEmpty() const noexcept { return allocationCount == 0; }
+    Statistics getStatistics() const noexcept;
+
+  private:
+    static constexpr int secondLevelLog2 = 4;
+    static constexpr int secondLevelCount = 1 << secondLevelLog2;
+    static constexpr int firstLevelCount = 64 - secondLevelLog2 + 1;
+
+    struct Range
+    {
+      uint64_t offset;
+      uint64_t size;
+      // Neighbors in the block, invalidHandle at its ends.
+      Handle previous;
+      Handle next;
+      // Neighbors in the free list of the range while it's free.
+      Handle previousFree;
+      Handle nextFree;
+      bool isFree;
+      uint8_t kind;
+    };
+
+    static void mapSize(uint64_t size, int* firstLevel, int* secondLevel) noexcept;
+    Handle findFreeRange(uint64_t size) const noexcept;
+    /**
+     * @return Offset of a placement of size in the free range, or ~0 if it doesn't fit.
+     */
+    uint64_t place(const Range& range, uint64_t size, uint64_t alignment, uint8_t kind) const noexcept;
+    Handle createRange(uint64_t offset, uint64_t size, Handle previous, Handle next);
+    void destroyRange(Handle handle) noexcept;
+    void insertFree(Handle handle) noexcept;
+    void removeFree(Handle handle) noexcept;
+
+    uint64_t size;
+    uint64_t granularity;
+    std::vector<Range> ranges;
+    std::vector<Handle> unusedRanges;
+    uint64_t firstLevelBitmap = 0;
+    uint32_t secondLevelBitmaps[firstLevelCount] = {};
+    Handle freeLists[firstLevelCount][secondLevelCount];
+    uint64_t usedSize = 0;
+    int allocationCount = 0;
+    int freeRangeCount = 0;
+  };
+}
@@ -0,0 +1,126 @@
+#if defined(__linux__)
+#include "LinuxIoUring.hpp"
+#include "../Exception.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <string>
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+using namespace De;
+
+namespace
+{
+  int setup(unsigned entryCount, io_uring_params* parameters)
+  {
+    return (int)syscall(__NR_io_uring_setup, entryCount, parameters);
+  }
+
+  int enter(int ring, unsigned submitCount, unsigned waitCount, unsigned flags)
+  {
+    return (int)syscall(__NR_io_uring_enter, ring, submitCount, waitCount, flags, nullptr, 0);
+  }
+
+  template<typename T>
+  T* at(void* base, uint32_t offset)
+  {
+    return reinterpret_cast<T*>(static_cast<uint8_t*>(base) + offset);
+  }
+}
+
+LinuxIoUring::LinuxIoUring(unsigned entryCount)
+{
+  io_uring_params parameters;
+  memset(&parameters, 0, sizeof(parameters));
+  ring = setup(entryCount, &parameters);
+  if(ring < 0) {
+    throw Exception(std::string("io_uring_setup failed: ") + strerror(errno));
+  }
+
+  submissionRingSize = parameters.sq_off.array + parameters.sq_entries * sizeof(unsigned);
+  completionRingSize = parameters.cq_off.cqes + parameters.cq_entries * sizeof(io_uring_cqe);
+  const bool isSingleMapping = (parameters.features & IORING_FEAT_SINGLE_MMAP) != 0;
+  if(isSingleMapping) {
+    submissionRingSize = completionRingSize = std::max(submissionRingSize, completionRingSize);
+  }
+  submissionRing = mmap(nullptr, submissionRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring, IORING_OFF_SQ_RING);
+  if(submissionRing == MAP_FAILED) {
+    submissionRing = nullptr;
+    close(ring);
+    throw Exception("Failed to map io_uring submission ring.");
+  }
+  if(isSingleMapping) {
+    completionRing = submissionRing;
+  } else {
+    completionRing = mmap(nullptr, completionRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring, IORING_OFF_CQ_RING);
+    if(completionRing == MAP_FAILED) {
+      completionRing = nullptr;
+      munmap(submissionRing, submissionRingSize);
+      close(ring);
+      throw Exception("Failed to map io_uring completion ring.");
+    }
+  }
+  submissionEntriesSize = parameters.sq_entries * sizeof(io_uring_sqe);
+  void* entries = mmap(nullptr, submissionEntriesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring, IORING_OFF_SQES);
+  if(entries == MAP_FAILED) {
+    if(completionRing != submissionRing) {
+      munmap(completionRing, completionRingSize);
+    }
+    munmap(submissionRing, submissionRingSize);
+    close(ring);
+    throw Exception("Failed to map io_uring submission entries.");
+  }
+  submissionEntries = static_cast<io_uring_sqe*>(entries);
+
+  // The ring indices are shared with the kernel, which accesses them atomically.
+  submissionHead = at<std::atomic<unsigned>>(submissionRing, parameters.sq_off.head);
+  submissionTail = at<std::atomic<unsigned>>(submissionRing, parameters.sq_off.tail);
+  submissionMask = *at<unsigned>(submissionRing, parameters.sq_off.ring_mask);
+  submissionEntryCount = parameters.sq_entries;
+  submissionArray = at<unsigned>(submissionRing, parameters.sq_off.array);
+  localSubmissionTail = submissionTail->load(std::memory_order_relaxed);
+
+  completionHead = at<std::atomic<unsigned>>(completionRing, parameters.cq_off.head);
+  completionTail = at<std::atomic<unsigned>>(completionRing, parameters.cq_off.tail);
+  completionMask = *at<unsigned>(completionRing, parameters.cq_off.ring_mask);
+  completions = at<io_uring_cqe>(completionRing, parameters.cq_off.cqes);
+}
+
+LinuxIoUring::~LinuxIoUring()
+{
+  munmap(submissionEntries, submissionEntriesSize);
+  if(completionRing != submissionRing) {
+    munmap(completionRing, completionRingSize);
+  }
+  munmap(submissionRing, submissionRingSize);
+  close(ring);
+}
+
+io_uring_sqe* LinuxIoUring::getSubmissionEntry() noexcept
+{
+  if(localSubmissionTail - submissionHead->load(std::memory_order_acquire) >= submissionEntryCount) {
+    return nullptr;
+  }
+  const unsigned index = localSubmissionTail & submissionMask;
+  io_uring_sqe* entry = submissionEntries + index;
+  memset(entry, 0, sizeof(*entry));
+  submissionArray[index] = index;
+  ++localSubmissionTail;
+  return entry;
+}
+
+int LinuxIoUring::submitAndWait(unsigned waitCount) noexcept
+{
+  const unsigned submitCount = localSubmissionTail - submissionTail->load(std::memory_order_relaxed);
+  submissionTail->store(localSubmissionTail, std::memory_order_release);
+  int result;
+  do {
+    result = enter(ring, submitCount, waitCount, waitCount > 0 ? IORING_ENTER_GETEVENTS : 0);
+  } while(result < 0 && errno == EINTR);
+  return result < 0 ? -errno : result;
+}
+#endif
@@ -0,0 +1,74 @@
+#pragma once
+#if defined(__linux__)
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include <linux/io_uring.h>
+
+namespace De
+{
+  /**
+   * @brief Minimal io_uring wrapper on the raw system calls, so that there is no dependency on liburing.
+   * Not thread safe, it is meant to be driven by a single thread.
+   */
+  class LinuxIoUring
+  {
+  public:
+    /**
+     * @throws De::Exception if io_uring isn't supported or is disabled.
+     */
+    explicit LinuxIoUring(unsigned entryCount);
+    LinuxIoUring(const LinuxIoUring& other) = delete;
+    LinuxIoUring& operator=(const LinuxIoUring& rhs) = delete;
+    ~LinuxIoUring();
+
+    /**
+     * @return A cleared entry to fill, nullptr if the submission queue is full.
+     */
+    io_uring_sqe* getSubmissionEntry() noexcept;
+    /**
+     * @brief Submits the filled entries and blocks until at least waitCount completions are available.
+     * @return The number of submitted entries or -errno.
+     */
+    int submitAndWait(unsigned waitCount) noexcept;
+    /**
+     * @brief Calls function with each available completion and consumes them.
+     */
+    template<typename Function>
+    unsigned forEachCompletion(Function&& function)
+    {
+      unsigned head = completionHead->load(std::memory_order_relaxed);
+      const unsigned tail = completionTail->load(std::memory_order_acquire);
+      const unsigned count = tail - head;
+      for(; head != tail; ++head) {
+        function(completions[head & completionMask]);
+      }
+      completionHead->store(head, std::memory_order_release);
+      return count;
+    }
+
+  private:
+    int ring = -1;
+    void* submissionRing = nullptr;
+    size_t submissionRingSize = 0;
+    void* completionRing = nullptr;
+    size_t completionRingSize = 0;
+    io_uring_sqe* submissionEntries = nullptr;
+    size_t submissionEntriesSize = 0;
+
+    std::atomic<unsigned>* submissionHead = nullptr;
+    std::atomic<unsigned>* submissionTail = nullptr;
+    unsigned submissionMask = 0;
+    unsigned submissionEntryCount = 0;
+    unsigned* submissionArray = nullptr;
+    // Entries up to this one have been handed out, but maybe not yet submitted.
+    unsigned localSubmissionTail = 0;
+
+    std::atomic<unsigned>* completionHead = nullptr;
+    std::atomic<unsigned>* completionTail = nullptr;
+    unsigned completionMask = 0;
+    io_uring_cqe* completions = nullptr;
+  };
+}
+#endif
@@ -11,12 +11,12 @@ class LinuxLibrary::Impl
 public:
 	explicit Impl(const char* fileName)
 	{
-		library = dlopen(fileName, RTLD_NOW);
+		library = dlopen(fileName, RTLD_NOW | RTLD_LOCAL);
 		if (!library)
 		{
 			std::ostringstream errorMessage;
 			errorMessage << "Couldn't load library named \""
-				<< fileName << "\"";
+				<< fileName << "\": " << dlerror();
 			throw Exception(errorMessage.str());
 		}
 	}
@@ -29,6 +29,10 @@ public:
 	Impl& operator=(const Impl& rhs) = delete;
 	Impl& operator=(Impl&& rhs) noexcept
 	{
+		if (library && library != rhs.library)
+		{
+			dlclose(library);
+		}
 		library = rhs.library;
 		rhs.library = nullptr;
 		return *this;
@@ -37,7 +41,7 @@ public:
 	{
 		if (library)
 		{
-			dlcose(library);
+			dlclose(library);
 		}
 	}
 
@@ -60,7 +64,7 @@ private:
 LinuxLibrary::LinuxLibrary(const char* fileName)
 	:pImpl{ std::make_unique<Impl>(fileName) }
 {}
-Library::~Library() = default;
+LinuxLibrary::~LinuxLibrary() = default;
 void* LinuxLibrary::loadFunction(const char* name)
 {
 	return pImpl->loadFunction(name);
@@ -9,7 +9,7 @@ namespace De
 		explicit	LinuxLibrary(const char* fileName);
 					LinuxLibrary(const LinuxLibrary& other) = delete;
 					LinuxLibrary(LinuxLibrary&& other) = default;
-					~LinuxLibrary() = default;
+					~LinuxLibrary();
 		LinuxLibrary&	operator=(const LinuxLibrary& rhs) = delete;
 		LinuxLibrary&	operator=(LinuxLibrary&& rhs) = default;
 		void*	loadFunction(const char* name);
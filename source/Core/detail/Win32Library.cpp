@@ -34,6 +34,10 @@ Win32Library::~Win32Library()
 
 Win32Library& Win32Library::operator=(Win32Library&& rhs) noexcept
 {
+	if (library && library != rhs.library)
+	{
+		FreeLibrary(library);
+	}
 	library = rhs.library;
 	rhs.library = nullptr;
 	return *this;
@@ -0,0 +1,260 @@
+#include "Tests.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <random>
+#include <tuple>
+#include <vector>
+
+#include <CubeMesher.hpp>
+
+namespace
+{
+  // Unit face of a cell, sign is +1 if it faces towards +axis.
+  struct Face
+  {
+    int x, y, z;
+    int axis;
+    int sign;
+    PlayingSpace::ValueType cubeClassIndex;
+
+    bool operator<(const Face& rhs) const
+    {
+      return std::tie(x, y, z, axis, sign, cubeClassIndex) < std::tie(rhs.x, rhs.y, rhs.z, rhs.axis, rhs.sign, rhs.cubeClassIndex);
+    }
+    bool operator==(const Face& rhs) const
+    {
+      return std::tie(x, y, z, axis, sign, cubeClassIndex) == std::tie(rhs.x, rhs.y, rhs.z, rhs.axis, rhs.sign, rhs.cubeClassIndex);
+    }
+  };
+
+  PlayingSpace randomPlayingSpace(std::mt19937& random, const Vec3i& size, float fillRatio, int cubeClassCount)
+  {
+    std::bernoulli_distribution isFilled(fillRatio);
+    std::uniform_int_distribution<int> cubeClass(0, cubeClassCount - 1);
+    PlayingSpace playingSpace(size);
+    for(int y = 0; y < size.y; ++y) {
+      for(int z = 0; z < size.z; ++z) {
+        for(int x = 0; x < size.x; ++x) {
+          if(isFilled(random)) {
+            playingSpace.set(x, y, z, PlayingSpace::ValueType(cubeClass(random)));
+          }
+        }
+      }
+    }
+    return playingSpace;
+  }
+
+  /**
+   * @brief Every face of an occupied cell that borders an empty cell or the outside, sorted.
+   */
+  std::vector<Face> listVisibleFaces(const PlayingSpace& playingSpace)
+  {
+    std::vector<Face> faces;
+    const Vec3i& size = playingSpace.getSize();
+    for(int y = 0; y < size.y; ++y) {
+      for(int z = 0; z < size.z; ++z) {
+        for(int x = 0; x < size.x; ++x) {
+          const PlayingSpace::ValueType cubeClassIndex = playingSpace.at(x, y, z);
+          if(cubeClassIndex == PlayingSpace::emptyValue) {
+            continue;
+          }
+          for(int axis = 0; axis < 3; ++axis) {
+            for(int sign = -1; sign <= 1; sign += 2) {
+              int neighbour[3] = { x, y, z };
+              neighbour[axis] += sign;
+              if(!playingSpace.isInside(neighbour[0], neighbour[1], neighbour[2]) ||
+                playingSpace.at(neighbour[0], neighbour[1], neighbour[2]) == PlayingSpace::emptyValue) {
+                faces.push_back({ x, y, z, axis, sign, cubeClassIndex });
+              }
+            }
+          }
+        }
+      }
+    }
+    std::sort(faces.begin(), faces.end());
+    return faces;
+  }
+
+  /**
+   * @brief Splits the quads of a mesh into unit faces, sorted. The cell of a face lies behind its front side,
+   * so a quad with the wrong winding names the empty cell in front of it and doesn't match the visible faces.
+   * @return false if the mesh isn't made of axis aligned rectangles of one cube class, two triangles each.
+   */
+  bool splitIntoFaces(const std::vector<CubeMesher::Vertex>& vertices, const std::vector<uint32_t>& indices, std::vector<Face>* faces)
+  {
+    faces->clear();
+    if(indices.size() % 6 != 0) {
+      return false;
+    }
+    for(size_t quad = 0; quad < indices.size(); quad += 6) {
+      int positions[6][3];
+      for(int i = 0; i < 6; ++i) {
+        if(indices[quad + i] >= vertices.size()) {
+          return false;
+        }
+        const CubeMesher::Vertex& vertex = vertices[indices[quad + i]];
+        if(vertex.cubeClassIndex != vertices[indices[quad]].cubeClassIndex) {
+          return false;
+        }
+        positions[i][0] = vertex.x;
+        positions[i][1] = vertex.y;
+        positions[i][2] = vertex.z;
+      }
+
+      int minimum[3], maximum[3];
+      for(int axis = 0; axis < 3; ++axis) {
+        minimum[axis] = maximum[axis] = positions[0][axis];
+        for(const int (&position)[3] : positions) {
+          minimum[axis] = std::min(minimum[axis], position[axis]);
+          maximum[axis] = std::max(maximum[axis], position[axis]);
+        }
+      }
+      int axis = 0;
+      while(axis < 3 && minimum[axis] != maximum[axis]) {
+        ++axis;
+      }
+      if(axis == 3) {
+        return false;
+      }
+      const int u = (axis + 1) % 3;
+      const int v = (axis + 2) % 3;
+      const int width = maximum[u] - minimum[u];
+      const int height = maximum[v] - minimum[v];
+
+      // Both triangles have to face the same way and together cover the rectangle, half of it each.
+      int sign = 0;
+      for(int triangle = 0; triangle < 2; ++triangle) {
+        const int (&a)[3] = positions[triangle * 3];
+        const int (&b)[3] = positions[triangle * 3 + 1];
+        const int (&c)[3] = positions[triangle * 3 + 2];
+        const int normal = (b[u] - a[u]) * (c[v] - a[v]) - (b[v] - a[v]) * (c[u] - a[u]);
+        if(std::abs(normal) != width * height || (sign != 0 && (normal > 0 ? 1 : -1) != sign)) {
+          return false;
+        }
+        sign = normal > 0 ? 1 : -1;
+      }
+      for(const int (&position)[3] : positions) {
+        const bool isCorner = (position[u] == minimum[u] || position[u] == maximum[u]) &&
+          (position[v] == minimum[v] || position[v] == maximum[v]);
+        if(!isCorner) {
+          return false;
+        }
+      }
+
+      for(int j = 0; j < height; ++j) {
+        for(int i = 0; i < width; ++i) {
+          int cell[3];
+          cell[axis] = sign > 0 ? minimum[axis] - 1 : minimum[axis];
+          cell[u] = minimum[u] + i;
+          cell[v] = minimum[v] + j;
+          faces->push_back({ cell[0], cell[1], cell[2], axis, sign, vertices[indices[quad]].cubeClassIndex });
+        }
+      }
+    }
+    std::sort(faces->begin(), faces->end());
+    return true;
+  }
+
+  /**
+   * @brief The mesh of the whole grid and of the grid in chunks have to hold exactly the visible faces.
+   */
+  void testMeshMatchesVisibleFaces()
+  {
+    const Vec3i sizes[] = { { 1, 1, 1 }, { 5, 7, 3 }, GameState::gridSize, { 16, 12, 9 } };
+    const float fillRatios[] = { 0.1f, 0.5f, 0.9f, 1.f };
+    const Vec3i chunkSize = { 4, 4, 4 };
+    std::mt19937 random(42);
+    CubeMesher mesher;
+    std::vector<CubeMesher::Vertex> vertices;
+    std::vector<uint32_t> indices;
+    std::vector<Face> faces;
+    for(const Vec3i& size : sizes) {
+      for(float fillRatio : fillRatios) {
+        for(int cubeClassCount = 1; cubeClassCount <= 3; ++cubeClassCount) {
+          const PlayingSpace playingSpace = randomPlayingSpace(random, size, fillRatio, cubeClassCount);
+          const std::vector<Face> visibleFaces = listVisibleFaces(playingSpace);
+
+          vertices.clear();
+          indices.clear();
+          mesher.mesh(playingSpace, { 0, 0, 0 }, size, vertices, indices);
+          expect(splitIntoFaces(vertices, indices, &faces));
+          expect(faces == visibleFaces);
+          expect(vertices.size() <= size_t(CubeMesher::calculateMaxVertexCount(playingSpace.getCount())));
+          expect(indices.size() <= size_t(CubeMesher::calculateMaxIndexCount(playingSpace.getCount())));
+
+          vertices.clear();
+          indices.clear();
+          for(int y = 0; y < size.y; y += chunkSize.y) {
+            for(int z = 0; z < size.z; z += chunkSize.z) {
+              for(int x = 0; x < size.x; x += chunkSize.x) {
+                const Vec3i end = { std::min(x + chunkSize.x, size.x), std::min(y + chunkSize.y, size.y), std::min(z + chunkSize.z, size.z) };
+                mesher.mesh(playingSpace, { x, y, z }, end, vertices, indices);
+              }
+            }
+          }
+          expect(splitIntoFaces(vertices, indices, &faces));
+          expect(faces == visibleFaces);
+        }
+      }
+    }
+  }
+
+  /**
+   * @brief Faces of the same class in a plane merge into one quad, faces of different classes don't.
+   */
+  void testMerging()
+  {
+    const Vec3i size = { 5, 4, 3 };
+    PlayingSpace playingSpace(size);
+    for(int y = 0; y < size.y; ++y) {
+      for(int z = 0; z < size.z; ++z) {
+        for(int x = 0; x < size.x; ++x) {
+          playingSpace.set(x, y, z, 0);
+        }
+      }
+    }
+    CubeMesher mesher;
+    std::vector<CubeMesher::Vertex> vertices;
+    std::vector<uint32_t> indices;
+    mesher.mesh(playingSpace, { 0, 0, 0 }, size, vertices, indices);
+    expect(indices.size() == 6 * 6);
+
+    playingSpace.set(0, 0, 0, 1);
+    vertices.clear();
+    indices.clear();
+    mesher.mesh(playingSpace, { 0, 0, 0 }, size, vertices, indices);
+    // The three sides of the corner cell are split off, each side of the box becomes at most three quads.
+    expect(indices.size() > 6 * 6);
+    expect(indices.size() <= 3 * 3 * 6 + 3 * 6);
+  }
+
+  /**
+   * @brief appendCube has to give all six faces of the cell with the winding of mesh.
+   */
+  void testAppendCube()
+  {
+    const Vec3i position = { 3, -2, 7 };
+    std::vector<CubeMesher::Vertex> vertices;
+    std::vector<uint32_t> indices;
+    CubeMesher::appendCube(position, 2, vertices, indices);
+    std::vector<Face> faces;
+    expect(splitIntoFaces(vertices, indices, &faces));
+
+    std::vector<Face> expectedFaces;
+    for(int axis = 0; axis < 3; ++axis) {
+      for(int sign = -1; sign <= 1; sign += 2) {
+        expectedFaces.push_back({ position.x, position.y, position.z, axis, sign, 2 });
+      }
+    }
+    std::sort(expectedFaces.begin(), expectedFaces.end());
+    expect(faces == expectedFaces);
+  }
+}
+
+void runCubeMesherTests()
+{
+  testMeshMatchesVisibleFaces();
+  testMerging();
+  testAppendCube();
+}
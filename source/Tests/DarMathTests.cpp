@@ -0,0 +1,361 @@
+#include "Tests.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include <DarMath.hpp>
+
+namespace
+{
+  template<typename Matrix>
+  Matrix randomMatrix(std::mt19937& random)
+  {
+    std::uniform_real_distribution<float> distribution(-100.f, 100.f);
+    Matrix result;
+    for(auto& row : result.values) {
+      for(float& value : row) {
+        value = distribution(random);
+      }
+    }
+    return result;
+  }
+
+  /**
+   * @brief Mat4f * Mat4f, the only product dispatched per level, has to be bitwise equal to the scalar one at every level.
+   */
+  void testSimdLevels()
+  {
+    std::mt19937 random(42);
+    const SimdLevel detectedLevel = getSimdLevel();
+    for(int i = 0; i < 1000; ++i) {
+      const Mat4f left = randomMatrix<Mat4f>(random);
+      const Mat4f right = randomMatrix<Mat4f>(random);
+
+      setSimdLevel(SimdLevel::Scalar);
+      const Mat4f expected = left * right;
+      for(int level = (int)SimdLevel::Scalar + 1; level <= (int)detectedLevel; ++level) {
+        setSimdLevel((SimdLevel)level);
+        const Mat4f actual = left * right;
+        expect(std::memcmp(&expected, &actual, sizeof(Mat4f)) == 0);
+      }
+    }
+    setSimdLevel(detectedLevel);
+  }
+
+  /**
+   * @return Distance from |x| to the next float away from zero.
+   */
+  double ulp(float x)
+  {
+    const float magnitude = std::abs(x);
+    return double(std::nextafter(magnitude, INFINITY)) - double(magnitude);
+  }
+  /**
+   * @return Error of the result in ulps of the float nearest to the exact value, for the documented bound.
+   * The float nearest to a multiple of Pi/2 gives exactly 0, 1 or -1, which is off from the exact value
+   * by up to half an ulp of radians, that is allowed as well.
+   */
+  double trigonometryError(float radians, float result, double exact)
+  {
+    const double error = std::abs(double(result) - exact);
+    if((result == 0.f || result == 1.f || result == -1.f) && error <= 0.5 * ulp(radians) * (1. + 1e-9)) {
+      return 0.;
+    }
+    return error / ulp(float(exact));
+  }
+
+  /**
+   * @brief constexprSin and constexprCos have to stay within 0.53 ulp of sin and cos in double precision over their whole
+   * domain, give exactly 0, 1 or -1 at the floats nearest to multiples of Pi/2 and clamp larger radians.
+   */
+  void testConstexprTrigonometry()
+  {
+    constexpr double maxError = 0.53;
+    double sinError = 0.;
+    double cosError = 0.;
+    const auto check = [&](float radians) {
+      sinError = std::max(sinError, trigonometryError(radians, constexprSin(radians), std::sin(double(radians))));
+      cosError = std::max(cosError, trigonometryError(radians, constexprCos(radians), std::cos(double(radians))));
+    };
+    // Every 997th float from 1e-30 to maxTrigonometryRadians, of both signs.
+    uint32_t first, last;
+    const float smallest = 1e-30f;
+    std::memcpy(&first, &smallest, sizeof(first));
+    std::memcpy(&last, &maxTrigonometryRadians, sizeof(last));
+    for(uint32_t bits = first; bits <= last; bits += 997) {
+      float radians;
+      std::memcpy(&radians, &bits, sizeof(radians));
+      check(radians);
+      check(-radians);
+    }
+    // Evenly spaced over the first periods, where most rotations are.
+    for(int i = -200000; i <= 200000; ++i) {
+      check(float(i) * 1e-4f);
+    }
+    check(0.f);
+    check(maxTrigonometryRadians);
+    check(-maxTrigonometryRadians);
+    expect(sinError <= maxError);
+    expect(cosError <= maxError);
+
+    constexpr double halfPi = 1.57079632679489661923;
+    bool isExact = true;
+    for(int k = -4000; k <= 4000; ++k) {
+      const float radians = float(k * halfPi);
+      const float expectedSin[4] = { 0.f, 1.f, 0.f, -1.f };
+      isExact &= constexprSin(radians) == expectedSin[(k % 4 + 4) % 4];
+      isExact &= constexprCos(radians) == expectedSin[((k + 1) % 4 + 4) % 4];
+    }
+    expect(isExact);
+    static_assert(constexprSin(Pi) == 0.f && constexprCos(Pi) == -1.f, "Exact at multiples of Pi/2.");
+    static_assert(constexprSin(degreesToRadians(90.f)) == 1.f && constexprCos(Pi / 2.f) == 0.f, "Exact at multiples of Pi/2.");
+
+    for(float radians : { 2.f * maxTrigonometryRadians, 1e30f, INFINITY }) {
+      expect(constexprSin(radians) == constexprSin(maxTrigonometryRadians));
+      expect(constexprCos(radians) == constexprCos(maxTrigonometryRadians));
+      expect(constexprSin(-radians) == constexprSin(-maxTrigonometryRadians));
+      expect(constexprCos(-radians) == constexprCos(-maxTrigonometryRadians));
+    }
+  }
+
+  struct Quatd
+  {
+    double x, y, z, s;
+  };
+  Quatd toQuatd(const Quatf& q)
+  {
+    return { q.v.x, q.v.y, q.v.z, q.s };
+  }
+  Quatd normalized(const Quatd& q)
+  {
+    const double length = std::sqrt(q.x*q.x + q.y*q.y + q.z*q.z + q.s*q.s);
+    return { q.x / length, q.y / length, q.z / length, q.s / length };
+  }
+  /**
+   * @brief Angle of the rotation from q1 to q2, the same for q2 and -q2.
+   */
+  double angleBetween(Quatd q1, Quatd q2)
+  {
+    q1 = normalized(q1);
+    q2 = normalized(q2);
+    // From the chord instead of acos of the dot product, which loses the small angles.
+    const double d = q1.x*q2.x + q1.y*q2.y + q1.z*q2.z + q1.s*q2.s;
+    const double sign = d < 0. ? -1. : 1.;
+    const double chord = std::sqrt(
+      (q1.x - sign*q2.x)*(q1.x - sign*q2.x) + (q1.y - sign*q2.y)*(q1.y - sign*q2.y) +
+      (q1.z - sign*q2.z)*(q1.z - sign*q2.z) + (q1.s - sign*q2.s)*(q1.s - sign*q2.s)
+    );
+    return 4. * std::asin(std::min(chord / 2., 1.));
+  }
+  /**
+   * @brief Slerp along the shorter arc in double precision.
+   */
+  Quatd slerpReference(Quatd q1, Quatd q2, double t)
+  {
+    q1 = normalized(q1);
+    q2 = normalized(q2);
+    if(q1.x*q2.x + q1.y*q2.y + q1.z*q2.z + q1.s*q2.s < 0.) {
+      q2 = { -q2.x, -q2.y, -q2.z, -q2.s };
+    }
+    // Half the rotation angle, from the chord too.
+    const double theta = angleBetween(q1, q2) / 2.;
+    if(theta < 1e-9) {
+      return q1;
+    }
+    const double w1 = std::sin((1. - t)*theta) / std::sin(theta);
+    const double w2 = std::sin(t*theta) / std::sin(theta);
+    return { w1*q1.x + w2*q2.x, w1*q1.y + w2*q2.y, w1*q1.z + w2*q2.z, w1*q1.s + w2*q2.s };
+  }
+  Quatf randomRotation(std::mt19937& random)
+  {
+    std::normal_distribution<float> distribution;
+    return normalized(Quatf{ { distribution(random), distribution(random), distribution(random) }, distribution(random) });
+  }
+
+  /**
+   * @brief Compares slerp and slerpFast against slerp in double precision across the whole range of angles between
+   * the inputs, densely near parallel and antipodal inputs, where slerp switches to rlerp and the sign flips.
+   */
+  void testSlerpAccuracy()
+  {
+    constexpr double slerpMaxError = 1e-5;
+    constexpr double slerpFastMaxError = 1e-3;
+    constexpr int angleCount = 4096;
+    constexpr int tCount = 17;
+
+    std::vector<float> angles;
+    for(int i = 0; i <= angleCount; ++i) {
+      angles.push_back(2.f * Pi * i / angleCount);
+    }
+    for(float offset = 1e-6f; offset < 0.1f; offset *= 1.5f) {
+      // Rotations by 2*Pi - offset give quaternions close to -q1.
+      angles.push_back(offset);
+      angles.push_back(2.f * Pi - offset);
+    }
+
+    std::mt19937 random(7);
+    double slerpError = 0.;
+    double slerpFastError = 0.;
+    std::vector<float> fromValues[4], toValues[4], outputValues[4];
+    std::vector<float> tValues;
+    std::vector<Quatf> expected;
+    for(float angle : angles) {
+      const Quatf q1 = randomRotation(random);
+      const Vec3f axis = normalized(randomRotation(random).v);
+      const Quatf q2 = q1 * Quatf{ std::sin(angle / 2.f) * axis, std::cos(angle / 2.f) };
+      for(int i = 0; i < tCount; ++i) {
+        const float t = float(i) / (tCount - 1);
+        const Quatd reference = slerpReference(toQuatd(q1), toQuatd(q2), t);
+        slerpError = std::max(slerpError, angleBetween(toQuatd(slerp(q1, q2, t)), reference));
+        const Quatf fast = slerpFast(q1, q2, t);
+        slerpFastError = std::max(slerpFastError, angleBetween(toQuatd(fast), reference));
+
+        const float from[4] = { q1.v.x, q1.v.y, q1.v.z, q1.s };
+        const float to[4] = { q2.v.x, q2.v.y, q2.v.z, q2.s };
+        for(int c = 0; c < 4; ++c) {
+          fromValues[c].push_back(from[c]);
+          toValues[c].push_back(to[c]);
+          outputValues[c].push_back(0.f);
+        }
+        tValues.push_back(t);
+        expected.push_back(fast);
+      }
+    }
+    expect(slerpError < slerpMaxError);
+    expect(slerpFastError < slerpFastMaxError);
+
+    // The batch version has to match the single one.
+    const auto toArrays = [](std::vector<float>* values) { return QuatfArrays{ values[0].data(), values[1].data(), values[2].data(), values[3].data() }; };
+    slerpFast(toArrays(fromValues), toArrays(toValues), tValues.data(), (int)tValues.size(), toArrays(outputValues));
+    double batchError = 0.;
+    for(size_t i = 0; i < expected.size(); ++i) {
+      const Quatd output = { outputValues[0][i], outputValues[1][i], outputValues[2][i], outputValues[3][i] };
+      batchError = std::max(batchError, angleBetween(output, toQuatd(expected[i])));
+    }
+    expect(batchError < 1e-5);
+  }
+
+  /**
+   * @return Error of the float result relative to the magnitude of the terms it was summed from.
+   */
+  double relativeError(float actual, double expected, double termMagnitude)
+  {
+    return std::abs(actual - expected) / std::max(termMagnitude, 1e-30);
+  }
+
+  /**
+   * @brief The structure of arrays functions have to match the same operations in double precision,
+   * with counts that aren't multiples of any vector width.
+   */
+  void testBatchFunctions()
+  {
+    constexpr double maxError = 1e-6;
+    std::mt19937 random(3);
+    std::uniform_real_distribution<float> distribution(-10.f, 10.f);
+    for(int count : { 0, 1, 7, 37, 256 }) {
+      std::vector<float> x(count), y(count), z(count), w(count);
+      for(int i = 0; i < count; ++i) {
+        x[i] = distribution(random);
+        y[i] = distribution(random);
+        z[i] = distribution(random);
+        w[i] = distribution(random);
+      }
+      const Mat4f m = randomMatrix<Mat4f>(random);
+
+      std::vector<float> outX(count), outY(count), outZ(count), outW(count);
+      double pointsError = 0.;
+      transformPoints(x.data(), y.data(), z.data(), count, m, outX.data(), outY.data(), outZ.data(), outW.data());
+      for(int i = 0; i < count; ++i) {
+        const float* outputs[4] = { &outX[i], &outY[i], &outZ[i], &outW[i] };
+        for(int c = 0; c < 4; ++c) {
+          const double expected = double(x[i])*m[0][c] + double(y[i])*m[1][c] + double(z[i])*m[2][c] + m[3][c];
+          const double magnitude = std::abs(x[i]*m[0][c]) + std::abs(y[i]*m[1][c]) + std::abs(z[i]*m[2][c]) + std::abs(m[3][c]);
+          pointsError = std::max(pointsError, relativeError(*outputs[c], expected, magnitude));
+        }
+      }
+      expect(pointsError < maxError);
+
+      double vectorsError = 0.;
+      transform(x.data(), y.data(), z.data(), w.data(), count, m, outX.data(), outY.data(), outZ.data(), outW.data());
+      for(int i = 0; i < count; ++i) {
+        const float* outputs[4] = { &outX[i], &outY[i], &outZ[i], &outW[i] };
+        for(int c = 0; c < 4; ++c) {
+          const double expected = double(x[i])*m[0][c] + double(y[i])*m[1][c] + double(z[i])*m[2][c] + double(w[i])*m[3][c];
+          const double magnitude = std::abs(x[i]*m[0][c]) + std::abs(y[i]*m[1][c]) + std::abs(z[i]*m[2][c]) + std::abs(w[i]*m[3][c]);
+          vectorsError = std::max(vectorsError, relativeError(*outputs[c], expected, magnitude));
+        }
+      }
+      expect(vectorsError < maxError);
+
+      std::vector<Mat4f> concatenated(count);
+      concatenateTranslations(x.data(), y.data(), z.data(), count, m, concatenated.data());
+      double translationsError = 0.;
+      bool areUpperRowsEqual = true;
+      for(int i = 0; i < count; ++i) {
+        areUpperRowsEqual &= std::memcmp(concatenated[i].values, m.values, 3 * sizeof(m.values[0])) == 0;
+        const Mat4f expected = Mat4f::translation(x[i], y[i], z[i]) * m;
+        for(int c = 0; c < 4; ++c) {
+          const double magnitude = std::abs(x[i]*m[0][c]) + std::abs(y[i]*m[1][c]) + std::abs(z[i]*m[2][c]) + std::abs(m[3][c]);
+          translationsError = std::max(translationsError, relativeError(concatenated[i][3][c], expected[3][c], magnitude));
+        }
+      }
+      expect(areUpperRowsEqual);
+      expect(translationsError < maxError);
+    }
+  }
+
+  /**
+   * @brief Points have to be inside exactly if they are within radius of the inner side of all frustum planes.
+   * Points closer to a plane than float precision can decide are left out.
+   */
+  void testPointsAgainstFrustumPlanes()
+  {
+    constexpr int count = 4099;
+    constexpr float radius = 0.5f;
+    const Frustum frustum = Frustum::fromViewProjectionD3d(Mat4f::perspectiveProjectionD3d(1.2f, 16.f / 9.f, 1.f, 100.f));
+    std::mt19937 random(5);
+    std::uniform_real_distribution<float> side(-60.f, 60.f);
+    std::uniform_real_distribution<float> depth(-5.f, 110.f);
+    std::vector<float> x(count), y(count), z(count);
+    for(int i = 0; i < count; ++i) {
+      x[i] = side(random);
+      y[i] = side(random);
+      z[i] = depth(random);
+    }
+    std::vector<uint8_t> output(count, 2);
+    testPointsAgainstPlanes(x.data(), y.data(), z.data(), count, frustum.planes, Frustum::PlaneCount, radius, output.data());
+
+    int insideCount = 0;
+    int outsideCount = 0;
+    bool isMatching = true;
+    for(int i = 0; i < count; ++i) {
+      bool isInside = true;
+      bool isDecidable = true;
+      for(const Vec4f& plane : frustum.planes) {
+        const double distance = double(x[i])*plane.x + double(y[i])*plane.y + double(z[i])*plane.z + plane.w + radius;
+        const double magnitude = std::abs(x[i]*plane.x) + std::abs(y[i]*plane.y) + std::abs(z[i]*plane.z) + std::abs(plane.w) + radius;
+        isInside &= distance >= 0.;
+        isDecidable &= std::abs(distance) > 1e-5 * magnitude;
+      }
+      if(isDecidable) {
+        isMatching &= output[i] == (isInside ? 1 : 0);
+        ++(isInside ? insideCount : outsideCount);
+      }
+    }
+    expect(isMatching);
+    // Both outcomes have to be covered.
+    expect(insideCount > 100 && outsideCount > 100);
+  }
+}
+
+void runDarMathTests()
+{
+  testSimdLevels();
+  testConstexprTrigonometry();
+  testSlerpAccuracy();
+  testBatchFunctions();
+  testPointsAgainstFrustumPlanes();
+}
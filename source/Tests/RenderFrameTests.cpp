@@ -0,0 +1,151 @@
+#include "Tests.hpp"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include <RenderFrame.hpp>
+
+namespace
+{
+  /**
+   * @brief Cube mesh of a backend, kept up to date with the mesh updates of the frames.
+   */
+  struct CubeMeshCopy
+  {
+    std::vector<CubeMesher::Vertex> vertices = std::vector<CubeMesher::Vertex>(size_t(cubeChunkCount) * maxCubeChunkVertexCount);
+    std::vector<uint32_t> indices = std::vector<uint32_t>(size_t(cubeChunkCount) * maxCubeChunkIndexCount);
+
+    /**
+     * @return Number of mesh updates of the cubes.
+     */
+    int applyMeshUpdates(const RenderFrame& frame)
+    {
+      int updateCount = 0;
+      const De::MeshUpdate* updates = frame.queue.getMeshUpdates();
+      for(int i = 0; i < frame.queue.getMeshUpdateCount(); ++i) {
+        const De::MeshUpdate& update = updates[i];
+        if(update.mesh != RenderMesh::Cubes) {
+          continue;
+        }
+        expect(update.firstVertex + update.vertexCount <= vertices.size());
+        expect(update.firstIndex + update.indexCount <= indices.size());
+        const CubeMesher::Vertex* updateVertices = static_cast<const CubeMesher::Vertex*>(update.vertices);
+        std::copy_n(updateVertices, update.vertexCount, vertices.begin() + update.firstVertex);
+        std::copy_n(update.indices, update.indexCount, indices.begin() + update.firstIndex);
+        ++updateCount;
+      }
+      return updateCount;
+    }
+    /**
+     * @brief Vertices of the triangles the frame draws from the cube mesh, in the order of the slots they're in.
+     */
+    std::vector<CubeMesher::Vertex> resolveDraws(const RenderFrame& frame) const
+    {
+      std::vector<const De::RenderCommand*> commands;
+      for(const De::RenderCommand& command : frame.queue) {
+        if(command.mesh == RenderMesh::Cubes) {
+          commands.push_back(&command);
+        }
+      }
+      std::sort(commands.begin(), commands.end(), [](const De::RenderCommand* left, const De::RenderCommand* right) {
+        return left->firstElement < right->firstElement;
+      });
+      std::vector<CubeMesher::Vertex> result;
+      bool isInside = true;
+      for(const De::RenderCommand* command : commands) {
+        isInside &= command->firstElement + command->elementCount <= indices.size();
+        for(uint32_t i = command->firstElement; i < command->firstElement + command->elementCount && i < indices.size(); ++i) {
+          const uint32_t vertexIndex = indices[i] + command->baseVertex;
+          isInside &= vertexIndex < vertices.size();
+          if(vertexIndex < vertices.size()) {
+            result.push_back(vertices[vertexIndex]);
+          }
+        }
+      }
+      expect(isInside);
+      return result;
+    }
+  };
+
+  bool areEqual(const std::vector<CubeMesher::Vertex>& left, const std::vector<CubeMesher::Vertex>& right)
+  {
+    return std::equal(left.begin(), left.end(), right.begin(), right.end(), [](const CubeMesher::Vertex& l, const CubeMesher::Vertex& r) {
+      return l.x == r.x && l.y == r.y && l.z == r.z && l.cubeClassIndex == r.cubeClassIndex;
+    });
+  }
+
+  /**
+   * @brief A builder that meshes only the chunks that changed has to draw the same triangles
+   * as one that meshes the whole playing space again, and must not update anything while it stays the same.
+   */
+  void testIncrementalCubeMeshUpdates()
+  {
+    std::mt19937 random(42);
+    std::uniform_int_distribution<int> x(0, GameState::gridSize.x - 1);
+    std::uniform_int_distribution<int> y(0, GameState::gridSize.y - 1);
+    std::uniform_int_distribution<int> z(0, GameState::gridSize.z - 1);
+    std::uniform_int_distribution<int> value(PlayingSpace::emptyValue, 2);
+    std::uniform_int_distribution<int> editCount(0, 4);
+
+    GameState gameState = {};
+    gameState.clientAreaWidth = 1280;
+    gameState.clientAreaHeight = 720;
+    De::LinearArena arena(1 << 20);
+    RenderFrameBuilder builder;
+    CubeMeshCopy mesh;
+    for(int frameIndex = 0; frameIndex < 1000; ++frameIndex) {
+      const int count = editCount(random);
+      for(int i = 0; i < count; ++i) {
+        gameState.playingSpace.set(x(random), y(random), z(random), PlayingSpace::ValueType(value(random)));
+      }
+
+      arena.reset();
+      const RenderFrame& frame = builder.build(gameState, arena);
+      const int updateCount = mesh.applyMeshUpdates(frame);
+      const std::vector<CubeMesher::Vertex> drawn = mesh.resolveDraws(frame);
+
+      De::LinearArena referenceArena(1 << 20);
+      RenderFrameBuilder referenceBuilder;
+      CubeMeshCopy referenceMesh;
+      const RenderFrame& referenceFrame = referenceBuilder.build(gameState, referenceArena);
+      referenceMesh.applyMeshUpdates(referenceFrame);
+      expect(areEqual(drawn, referenceMesh.resolveDraws(referenceFrame)));
+      expect(updateCount <= referenceFrame.queue.getMeshUpdateCount());
+
+      arena.reset();
+      const RenderFrame& unchangedFrame = builder.build(gameState, arena);
+      expect(mesh.applyMeshUpdates(unchangedFrame) == 0);
+      expect(areEqual(mesh.resolveDraws(unchangedFrame), drawn));
+    }
+  }
+
+  /**
+   * @brief A cell whose neighbours are all in its own chunk updates that chunk alone.
+   */
+  void testChangeUpdatesItsChunk()
+  {
+    static_assert(cubeChunkSize.x >= 3 && cubeChunkSize.y >= 3 && cubeChunkSize.z >= 3, "The cell needs neighbours in its chunk.");
+    GameState gameState = {};
+    gameState.clientAreaWidth = 1280;
+    gameState.clientAreaHeight = 720;
+    De::LinearArena arena(1 << 20);
+    RenderFrameBuilder builder;
+    CubeMeshCopy mesh;
+    mesh.applyMeshUpdates(builder.build(gameState, arena));
+
+    gameState.playingSpace.set(1, 1, 1, 0);
+    arena.reset();
+    expect(mesh.applyMeshUpdates(builder.build(gameState, arena)) == 1);
+
+    gameState.playingSpace.set(1, 1, 1, 0);
+    arena.reset();
+    expect(mesh.applyMeshUpdates(builder.build(gameState, arena)) == 0);
+  }
+}
+
+void runRenderFrameTests()
+{
+  testIncrementalCubeMeshUpdates();
+  testChangeUpdatesItsChunk();
+}
@@ -0,0 +1,114 @@
+#include "Tests.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include <RenderQueue.hpp>
+
+namespace
+{
+  /**
+   * @brief Sorts the keys with the queue and with std::stable_sort, the commands have to come out in the same order.
+   * firstElement holds the push order, so that the order of equal keys is compared as well.
+   */
+  bool sortsLikeStableSort(const std::vector<uint64_t>& keys, De::LinearArena& arena)
+  {
+    arena.reset();
+    De::RenderQueue queue;
+    queue.reset(arena);
+    std::vector<De::RenderCommand> expected;
+    for(size_t i = 0; i < keys.size(); ++i) {
+      De::RenderCommand command = {};
+      command.sortKey = keys[i];
+      command.firstElement = uint32_t(i);
+      queue.push(command);
+      expected.push_back(command);
+    }
+    queue.sort();
+    std::stable_sort(expected.begin(), expected.end(), [](const De::RenderCommand& left, const De::RenderCommand& right) {
+      return left.sortKey < right.sortKey;
+    });
+    return std::equal(queue.begin(), queue.end(), expected.begin(), expected.end(), [](const De::RenderCommand& left, const De::RenderCommand& right) {
+      return left.sortKey == right.sortKey && left.firstElement == right.firstElement;
+    });
+  }
+
+  /**
+   * @brief Random keys, keys with few distinct values and keys whose digits are partly or all the same,
+   * which sort skips. An odd number of passes leaves the commands in the scratch array.
+   */
+  void testSortMatchesStableSort()
+  {
+    std::mt19937_64 random(11);
+    De::LinearArena arena(1 << 24);
+    const int counts[] = { 0, 1, 2, 3, 63, 64, 65, 1000, 4099 };
+    for(int count : counts) {
+      std::vector<uint64_t> keys(count);
+
+      for(uint64_t& key : keys) {
+        key = random();
+      }
+      expect(sortsLikeStableSort(keys, arena));
+
+      // Few distinct keys, most commands share theirs with others.
+      for(uint64_t& key : keys) {
+        key = random() % 5 * 0x0101010101010101ull;
+      }
+      expect(sortsLikeStableSort(keys, arena));
+
+      // Same layer and pipeline, like the commands of a frame.
+      for(uint64_t& key : keys) {
+        key = De::RenderQueue::makeSortKey(2, 7, unsigned(random() % 3), uint32_t(random()));
+      }
+      expect(sortsLikeStableSort(keys, arena));
+
+      // Only one varying digit, a single pass.
+      for(uint64_t& key : keys) {
+        key = 0x1234000000000000ull | (random() & 0xff) << 16;
+      }
+      expect(sortsLikeStableSort(keys, arena));
+
+      // Every digit the same in all keys, nothing to sort.
+      std::fill(keys.begin(), keys.end(), 0x0123456789abcdefull);
+      expect(sortsLikeStableSort(keys, arena));
+    }
+  }
+
+  /**
+   * @brief After a sort that ends in the scratch array the queue still has to grow when more commands are pushed.
+   */
+  void testPushAfterSort()
+  {
+    De::LinearArena arena(1 << 20);
+    De::RenderQueue queue;
+    queue.reset(arena);
+    for(int i = 0; i < 100; ++i) {
+      De::RenderCommand command = {};
+      command.sortKey = uint64_t(99 - i);
+      command.firstElement = uint32_t(i);
+      queue.push(command);
+    }
+    queue.sort();
+    for(int i = 0; i < 100; ++i) {
+      De::RenderCommand command = {};
+      command.sortKey = uint64_t(i);
+      command.firstElement = uint32_t(100 + i);
+      queue.push(command);
+    }
+    expect(queue.getCommandCount() == 200);
+    bool isSortedPart = true;
+    for(int i = 0; i < 100; ++i) {
+      isSortedPart &= queue.begin()[i].sortKey == uint64_t(i) && queue.begin()[i].firstElement == uint32_t(99 - i);
+      isSortedPart &= queue.begin()[100 + i].firstElement == uint32_t(100 + i);
+    }
+    expect(isSortedPart);
+  }
+}
+
+void runRenderQueueTests()
+{
+  testSortMatchesStableSort();
+  testPushAfterSort();
+}
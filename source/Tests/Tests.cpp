@@ -0,0 +1,36 @@
+#define DAR_MODULE_NAME "Tests"
+
+#include "Tests.hpp"
+
+#include <cstdio>
+
+namespace
+{
+  int expectationCount = 0;
+  int failureCount = 0;
+}
+
+void reportExpectation(bool isMet, const char* expression, const char* file, int line)
+{
+  ++expectationCount;
+  if(!isMet) {
+    ++failureCount;
+    fprintf(stderr, "%s(%d): expected %s\n", file, line, expression);
+  }
+}
+
+/**
+ * Usage: Tests
+ * Returns 1 if any expectation failed.
+ */
+int main()
+{
+  runCubeMesherTests();
+  runDarMathTests();
+  runRenderFrameTests();
+  runRenderQueueTests();
+  runTlsfAllocatorTests();
+
+  printf("%d of %d expectations failed\n", failureCount, expectationCount);
+  return failureCount != 0;
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+/**
+ * @brief Counts the expectation, prints it if it failed. Tests returns 1 if any expectation failed.
+ */
+void reportExpectation(bool isMet, const char* expression, const char* file, int line);
+
+#define expect(condition) reportExpectation(!!(condition), #condition, __FILE__, __LINE__)
+
+void runCubeMesherTests();
+void runDarMathTests();
+void runRenderFrameTests();
+void runRenderQueueTests();
+void runTlsfAllocatorTests();
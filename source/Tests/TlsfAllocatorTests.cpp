@@ -0,0 +1,123 @@
+#include "Tests.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include <TlsfAllocator.hpp>
+
+namespace
+{
+  struct LiveAllocation
+  {
+    uint64_t offset;
+    uint64_t size;
+    uint8_t kind;
+    De::TlsfAllocator::Handle handle;
+  };
+
+  /**
+   * @brief The live allocations have to be disjoint, ranges of different kinds must not share a page and the
+   * statistics have to match. Free neighbors are merged, so every gap between allocations is one free range.
+   */
+  bool isConsistent(const De::TlsfAllocator& allocator, uint64_t granularity, std::vector<LiveAllocation> live)
+  {
+    std::sort(live.begin(), live.end(), [](const LiveAllocation& left, const LiveAllocation& right) {
+      return left.offset < right.offset;
+    });
+    bool isValid = true;
+    uint64_t usedSize = 0;
+    uint64_t end = 0;
+    int gapCount = 0;
+    uint64_t largestGap = 0;
+    for(size_t i = 0; i < live.size(); ++i) {
+      const LiveAllocation& allocation = live[i];
+      usedSize += allocation.size;
+      isValid &= allocation.offset >= end;
+      if(allocation.offset > end) {
+        ++gapCount;
+        largestGap = std::max(largestGap, allocation.offset - end);
+      }
+      if(i > 0 && live[i - 1].kind != allocation.kind) {
+        isValid &= (live[i - 1].offset + live[i - 1].size - 1) / granularity != allocation.offset / granularity;
+      }
+      end = allocation.offset + allocation.size;
+    }
+    isValid &= end <= allocator.getSize();
+    if(end < allocator.getSize()) {
+      ++gapCount;
+      largestGap = std::max(largestGap, allocator.getSize() - end);
+    }
+
+    const De::TlsfAllocator::Statistics statistics = allocator.getStatistics();
+    isValid &= statistics.usedSize == usedSize;
+    isValid &= statistics.freeSize == allocator.getSize() - usedSize;
+    isValid &= statistics.allocationCount == int(live.size());
+    isValid &= statistics.freeRangeCount == gapCount;
+    isValid &= statistics.largestFreeSize == largestGap;
+    return isValid;
+  }
+
+  /**
+   * @brief Random allocations of two kinds with random sizes and alignments, freed in random order.
+   */
+  void testRandomAllocations(uint64_t granularity)
+  {
+    constexpr uint64_t size = 1 << 24;
+    De::TlsfAllocator allocator(size, granularity);
+    std::mt19937 random(1);
+    std::uniform_int_distribution<uint64_t> allocationSize(1, 70000);
+    std::uniform_int_distribution<int> alignmentLog2(0, 12);
+    std::uniform_int_distribution<int> kind(0, 1);
+    std::vector<LiveAllocation> live;
+    bool isAligned = true;
+    bool isPlacedWhereItFits = true;
+    bool isAlwaysConsistent = true;
+    int failureCount = 0;
+    for(int step = 0; step < 200000; ++step) {
+      if(live.empty() || random() % 3 != 0) {
+        const uint64_t allocationSizeValue = allocationSize(random);
+        const uint64_t alignment = uint64_t(1) << alignmentLog2(random);
+        const uint8_t allocationKind = uint8_t(kind(random));
+        De::TlsfAllocator::Allocation allocation;
+        if(allocator.allocate(allocationSizeValue, alignment, allocationKind, &allocation)) {
+          isAligned &= allocation.offset % alignment == 0;
+          live.push_back({ allocation.offset, allocationSizeValue, allocationKind, allocation.handle });
+        } else {
+          ++failureCount;
+          // A free range of twice the padded size is in a higher size class and always fits.
+          const uint64_t padding = std::max(alignment, granularity) - 1 + granularity - 1;
+          isPlacedWhereItFits &= allocator.getStatistics().largestFreeSize < 2 * (allocationSizeValue + padding);
+        }
+      } else {
+        const size_t index = random() % live.size();
+        allocator.deallocate(live[index].handle);
+        live[index] = live.back();
+        live.pop_back();
+      }
+      if(step % 997 == 0) {
+        isAlwaysConsistent &= isConsistent(allocator, granularity, live);
+      }
+    }
+    expect(isAligned);
+    expect(isPlacedWhereItFits);
+    expect(isAlwaysConsistent);
+    // The block fills up often enough that allocations fail.
+    expect(failureCount > 0);
+
+    for(const LiveAllocation& allocation : live) {
+      allocator.deallocate(allocation.handle);
+    }
+    const De::TlsfAllocator::Statistics statistics = allocator.getStatistics();
+    expect(allocator.isEmpty());
+    expect(statistics.freeRangeCount == 1);
+    expect(statistics.largestFreeSize == size);
+  }
+}
+
+void runTlsfAllocatorTests()
+{
+  testRandomAllocations(1);
+  testRandomAllocations(1024);
+}